@@ -0,0 +1,379 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <asyncfilereader.h>
+
+#include <logging.h>
+#include <span.h>
+#include <streams.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/syserror.h>
+#include <util/thread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <ios>
+#include <string>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define HAVE_IO_URING 1
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace {
+std::optional<std::vector<uint8_t>> ReadFileRange(const fs::path& path, uint64_t offset, size_t size)
+{
+    AutoFile file{fsbridge::fopen(path, "rb")};
+    if (file.IsNull()) return std::nullopt;
+    std::vector<uint8_t> data(size);
+    try {
+        file.seek(offset, SEEK_SET);
+        file.read(MakeWritableByteSpan(data));
+    } catch (const std::ios_base::failure&) {
+        return std::nullopt;
+    }
+    return data;
+}
+
+class ThreadPoolFileReader final : public AsyncFileReader
+{
+    struct Job {
+        fs::path path;
+        uint64_t offset;
+        size_t size;
+        Callback callback;
+    };
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Job> m_jobs GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    void Run() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        while (true) {
+            Job job;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_jobs.empty(); });
+                // Queued reads are completed before stopping.
+                if (m_jobs.empty()) return;
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+            job.callback(ReadFileRange(job.path, job.offset, job.size));
+        }
+    }
+
+public:
+    explicit ThreadPoolFileReader(unsigned int num_threads)
+    {
+        for (unsigned int n{0}; n < std::max(num_threads, 1U); ++n) {
+            m_threads.emplace_back(&util::TraceThread, strprintf("asyncread.%i", n), [this] { Run(); });
+        }
+    }
+
+    ~ThreadPoolFileReader() override
+    {
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_cv.notify_all();
+        for (std::thread& thread : m_threads) thread.join();
+    }
+
+    void Read(const fs::path& path, uint64_t offset, size_t size, Callback callback) override EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WITH_LOCK(m_mutex, m_jobs.push_back({path, offset, size, std::move(callback)}));
+        m_cv.notify_one();
+    }
+
+    const char* Name() const override { return "thread pool"; }
+};
+
+#ifdef HAVE_IO_URING
+/**
+ * Reads through an io_uring submission and completion queue pair, set up with
+ * raw system calls. Reads are submitted by the threads that queue them, and
+ * completed by a single thread that runs the callbacks.
+ */
+class IoUringFileReader final : public AsyncFileReader
+{
+    struct Request {
+        int fd;
+        uint64_t offset;
+        std::vector<uint8_t> data;
+        //! Bytes read so far. Short reads are resubmitted for the rest.
+        size_t done{0};
+        iovec iov;
+        Callback callback;
+    };
+
+    const unsigned int m_queue_depth;
+    const int m_ring_fd;
+    io_uring_params m_params{};
+
+    void* m_sq_ring{MAP_FAILED};
+    size_t m_sq_ring_size{0};
+    void* m_cq_ring{MAP_FAILED};
+    size_t m_cq_ring_size{0};
+    io_uring_sqe* m_sqes{static_cast<io_uring_sqe*>(MAP_FAILED)};
+    size_t m_sqes_size{0};
+
+    Mutex m_mutex;
+    std::condition_variable m_idle_cv;
+    //! Reads waiting for room in the submission queue.
+    std::deque<std::unique_ptr<Request>> m_pending GUARDED_BY(m_mutex);
+    size_t m_in_flight GUARDED_BY(m_mutex){0};
+    std::thread m_thread;
+
+    template <typename T>
+    T* RingField(void* ring, uint32_t offset) const { return reinterpret_cast<T*>(static_cast<char*>(ring) + offset); }
+
+    /**
+     * Add a read, or a no-op to wake up the completion thread if request is
+     * null, to the submission queue and submit it.
+     *
+     * @returns false if it could not be submitted, in which case it was
+     *          removed from the queue again.
+     */
+    [[nodiscard]] bool Submit(Request* request) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        std::atomic_ref tail_ref{*RingField<unsigned>(m_sq_ring, m_params.sq_off.tail)};
+        const unsigned tail{tail_ref.load(std::memory_order_relaxed)};
+        const unsigned index{tail & *RingField<unsigned>(m_sq_ring, m_params.sq_off.ring_mask)};
+        io_uring_sqe& sqe{m_sqes[index]};
+        std::memset(&sqe, 0, sizeof(sqe));
+        if (request) {
+            request->iov = {request->data.data() + request->done, request->data.size() - request->done};
+            sqe.opcode = IORING_OP_READV;
+            sqe.fd = request->fd;
+            sqe.off = request->offset + request->done;
+            sqe.addr = reinterpret_cast<uint64_t>(&request->iov);
+            sqe.len = 1;
+            sqe.user_data = reinterpret_cast<uint64_t>(request);
+        } else {
+            sqe.opcode = IORING_OP_NOP;
+        }
+        RingField<unsigned>(m_sq_ring, m_params.sq_off.array)[index] = index;
+        tail_ref.store(tail + 1, std::memory_order_release);
+        while (syscall(__NR_io_uring_enter, m_ring_fd, 1, 0, 0, nullptr, 0) < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                LogError("%s: io_uring_enter failed: %s\n", __func__, SysErrorString(errno));
+                // The kernel consumed no entry, and entries are only added
+                // with m_mutex held, so the tail can be moved back.
+                tail_ref.store(tail, std::memory_order_release);
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    /**
+     * Run the callback of a read that is counted in m_in_flight, and submit
+     * the next pending read in its place. Pending reads that cannot be
+     * submitted are finished as failed.
+     */
+    void Finish(std::unique_ptr<Request> request, bool success) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        while (request) {
+            close(request->fd);
+            request->callback(success ? std::make_optional(std::move(request->data)) : std::nullopt);
+            request.reset();
+
+            // Callbacks may have queued reads, so only count this one as
+            // finished now, so that the destructor keeps waiting for them.
+            LOCK(m_mutex);
+            --m_in_flight;
+            if (!m_pending.empty()) {
+                std::unique_ptr<Request> next{std::move(m_pending.front())};
+                m_pending.pop_front();
+                ++m_in_flight;
+                if (Submit(next.get())) {
+                    next.release();
+                } else {
+                    request = std::move(next);
+                    success = false;
+                }
+            }
+            if (m_in_flight == 0) m_idle_cv.notify_all();
+        }
+    }
+
+    void Run() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::atomic_ref cq_head_ref{*RingField<unsigned>(m_cq_ring, m_params.cq_off.head)};
+        std::atomic_ref cq_tail_ref{*RingField<unsigned>(m_cq_ring, m_params.cq_off.tail)};
+        const unsigned cq_mask{*RingField<unsigned>(m_cq_ring, m_params.cq_off.ring_mask)};
+        const io_uring_cqe* cqes{RingField<io_uring_cqe>(m_cq_ring, m_params.cq_off.cqes)};
+
+        std::vector<std::pair<Request*, int>> completed;
+        while (true) {
+            if (syscall(__NR_io_uring_enter, m_ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+                LogError("%s: io_uring_enter failed: %s\n", __func__, SysErrorString(errno));
+            }
+            completed.clear();
+            unsigned head{cq_head_ref.load(std::memory_order_relaxed)};
+            for (const unsigned tail{cq_tail_ref.load(std::memory_order_acquire)}; head != tail; ++head) {
+                const io_uring_cqe& cqe{cqes[head & cq_mask]};
+                completed.emplace_back(reinterpret_cast<Request*>(cqe.user_data), cqe.res);
+            }
+            cq_head_ref.store(head, std::memory_order_release);
+
+            bool stop{false};
+            for (const auto& [request, result] : completed) {
+                if (!request) {
+                    stop = true;
+                    continue;
+                }
+                if (result > 0 && request->done + size_t(result) < request->data.size()) {
+                    request->done += size_t(result);
+                    if (WITH_LOCK(m_mutex, return Submit(request))) continue;
+                    Finish(std::unique_ptr<Request>{request}, /*success=*/false);
+                    continue;
+                }
+                const bool success{result >= 0 && request->done + size_t(result) == request->data.size()};
+                Finish(std::unique_ptr<Request>{request}, success);
+            }
+            if (stop) return;
+        }
+    }
+
+    IoUringFileReader(unsigned int queue_depth, int ring_fd, const io_uring_params& params)
+        : m_queue_depth{queue_depth}, m_ring_fd{ring_fd}, m_params{params} {}
+
+    bool Map()
+    {
+        m_sq_ring_size = m_params.sq_off.array + m_params.sq_entries * sizeof(unsigned);
+        m_cq_ring_size = m_params.cq_off.cqes + m_params.cq_entries * sizeof(io_uring_cqe);
+        if (m_params.features & IORING_FEAT_SINGLE_MMAP) {
+            m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+        }
+        m_sq_ring = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+        if (m_sq_ring == MAP_FAILED) return false;
+        if (m_params.features & IORING_FEAT_SINGLE_MMAP) {
+            m_cq_ring = m_sq_ring;
+        } else {
+            m_cq_ring = mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+            if (m_cq_ring == MAP_FAILED) return false;
+        }
+        m_sqes_size = m_params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes{mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES)};
+        if (sqes == MAP_FAILED) return false;
+        m_sqes = static_cast<io_uring_sqe*>(sqes);
+        m_thread = std::thread{&util::TraceThread, "uring", [this] { Run(); }};
+        return true;
+    }
+
+public:
+    static std::unique_ptr<AsyncFileReader> Make(unsigned int queue_depth)
+    {
+        queue_depth = std::max(queue_depth, 1U);
+        io_uring_params params{};
+        const long ring_fd{syscall(__NR_io_uring_setup, queue_depth, &params)};
+        if (ring_fd < 0) {
+            LogPrintLevel(BCLog::BLOCKSTORAGE, BCLog::Level::Debug, "io_uring is not available: %s\n", SysErrorString(errno));
+            return nullptr;
+        }
+        std::unique_ptr<IoUringFileReader> reader{new IoUringFileReader{queue_depth, static_cast<int>(ring_fd), params}};
+        if (!reader->Map()) {
+            LogPrintLevel(BCLog::BLOCKSTORAGE, BCLog::Level::Debug, "io_uring is not available: mmap failed: %s\n", SysErrorString(errno));
+            return nullptr;
+        }
+        return reader;
+    }
+
+    ~IoUringFileReader() override
+    {
+        if (m_thread.joinable()) {
+            bool stopping;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_idle_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_in_flight == 0 && m_pending.empty(); });
+                stopping = Submit(nullptr);
+            }
+            if (!stopping) {
+                // Nothing is left to wake up the completion thread, which is
+                // idle. Leave it and the ring behind rather than hang.
+                m_thread.detach();
+                return;
+            }
+            m_thread.join();
+        }
+        if (m_sqes != MAP_FAILED) munmap(m_sqes, m_sqes_size);
+        if (m_cq_ring != MAP_FAILED && m_cq_ring != m_sq_ring) munmap(m_cq_ring, m_cq_ring_size);
+        if (m_sq_ring != MAP_FAILED) munmap(m_sq_ring, m_sq_ring_size);
+        close(m_ring_fd);
+    }
+
+    void Read(const fs::path& path, uint64_t offset, size_t size, Callback callback) override EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        const int fd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (fd < 0) {
+            callback(std::nullopt);
+            return;
+        }
+        auto request{std::make_unique<Request>()};
+        request->fd = fd;
+        request->offset = offset;
+        request->data.resize(size);
+        request->callback = std::move(callback);
+
+        {
+            LOCK(m_mutex);
+            if (m_in_flight >= m_queue_depth) {
+                m_pending.push_back(std::move(request));
+                return;
+            }
+            if (Submit(request.get())) {
+                request.release();
+                ++m_in_flight;
+                return;
+            }
+        }
+        close(request->fd);
+        request->callback(std::nullopt);
+    }
+
+    const char* Name() const override { return "io_uring"; }
+};
+#endif // HAVE_IO_URING
+} // namespace
+
+std::unique_ptr<AsyncFileReader> MakeIoUringFileReader(unsigned int queue_depth)
+{
+#ifdef HAVE_IO_URING
+    return IoUringFileReader::Make(queue_depth);
+#else
+    return nullptr;
+#endif
+}
+
+std::unique_ptr<AsyncFileReader> MakeThreadPoolFileReader(unsigned int num_threads)
+{
+    return std::make_unique<ThreadPoolFileReader>(num_threads);
+}
+
+std::unique_ptr<AsyncFileReader> MakeAsyncFileReader(unsigned int queue_depth)
+{
+    auto reader{MakeIoUringFileReader(queue_depth)};
+    if (!reader) reader = MakeThreadPoolFileReader(queue_depth);
+    LogPrintf("Using %s for asynchronous file reads, up to %u at once\n", reader->Name(), queue_depth);
+    return reader;
+}
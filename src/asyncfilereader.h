@@ -0,0 +1,63 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ASYNCFILEREADER_H
+#define BITCOIN_ASYNCFILEREADER_H
+
+#include <util/fs.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+/**
+ * Reads ranges of files in the background, with several reads in flight at
+ * once, so that the latency of the disk is paid once for a batch of reads
+ * rather than once per read.
+ *
+ * Destroying the reader waits for all queued reads to complete, including
+ * those queued by the callbacks of other reads.
+ */
+class AsyncFileReader
+{
+public:
+    /** Called with the data read, or std::nullopt if the read failed or was short. */
+    using Callback = std::function<void(std::optional<std::vector<uint8_t>>)>;
+
+    virtual ~AsyncFileReader() = default;
+
+    /**
+     * Queue a read of `size` bytes at `offset` in the file at `path`.
+     *
+     * The callback is run on a background thread, or on the calling thread if
+     * the file cannot be opened or the read cannot be submitted. It may queue further reads, and must not
+     * block on the completion of other reads.
+     */
+    virtual void Read(const fs::path& path, uint64_t offset, size_t size, Callback callback) = 0;
+
+    /** Name of the backend, for logging. */
+    virtual const char* Name() const = 0;
+};
+
+/**
+ * Make a reader using Linux io_uring, with up to `queue_depth` reads
+ * submitted to the kernel at once.
+ *
+ * @returns nullptr if io_uring is not available on this system.
+ */
+std::unique_ptr<AsyncFileReader> MakeIoUringFileReader(unsigned int queue_depth);
+
+/** Make a reader running up to `num_threads` blocking reads at once on a pool of threads. */
+std::unique_ptr<AsyncFileReader> MakeThreadPoolFileReader(unsigned int num_threads);
+
+/**
+ * Make a reader with up to `queue_depth` reads in flight, using io_uring if
+ * available and a pool of threads otherwise.
+ */
+std::unique_ptr<AsyncFileReader> MakeAsyncFileReader(unsigned int queue_depth);
+
+#endif // BITCOIN_ASYNCFILEREADER_H
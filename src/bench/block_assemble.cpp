@@ -2,16 +2,23 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <addresstype.h>
 #include <bench/bench.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
+#include <kernel/cs_main.h>
+#include <node/block_template_cache.h>
 #include <node/miner.h>
 #include <random.h>
 #include <test/util/mining.h>
 #include <test/util/script.h>
 #include <test/util/setup_common.h>
+#include <test/util/txmempool.h>
 #include <txmempool.h>
+#include <util/chaintype.h>
+#include <util/time.h>
 #include <validation.h>
+#include <validationinterface.h>
 
 
 #include <vector>
@@ -60,5 +67,100 @@ static void BlockAssemblerAddPackageTxns(benchmark::Bench& bench)
     });
 }
 
+
+/**
+ * Create transactions each spending an output of one confirmed transaction,
+ * funded by a coinbase transaction that PopulateMempool() will not spend.
+ */
+static std::vector<CTransactionRef> CreateSpends(TestChain100Setup& setup, uint32_t count)
+{
+    const CScript spk{GetScriptForDestination(WitnessV0KeyHash(setup.coinbaseKey.GetPubKey()))};
+    const CTransactionRef coinbase{setup.m_coinbase_txns.front()};
+    setup.m_coinbase_txns.erase(setup.m_coinbase_txns.begin());
+    const CTransactionRef fanout{MakeTransactionRef(setup.CreateValidMempoolTransaction(
+        {coinbase}, {COutPoint{coinbase->GetHash(), 0}}, /*input_height=*/1, {setup.coinbaseKey},
+        std::vector<CTxOut>(count, CTxOut{coinbase->vout[0].nValue / (count + 1), spk}), /*submit=*/false))};
+    setup.CreateAndProcessBlock({CMutableTransaction{*fanout}}, spk);
+    const int height{WITH_LOCK(::cs_main, return setup.m_node.chainman->ActiveHeight())};
+    std::vector<CTransactionRef> spends;
+    for (uint32_t n{0}; n < count; ++n) {
+        spends.push_back(MakeTransactionRef(setup.CreateValidMempoolTransaction(
+            fanout, n, height, setup.coinbaseKey, spk, fanout->vout[n].nValue - 1000, /*submit=*/false)));
+    }
+    return spends;
+}
+
+/**
+ * Measure the latency of getting a block template for a mempool of 1000
+ * transactions, from the maintained template or by selecting its
+ * transactions again, right after either a transaction was added to the
+ * mempool, or a block was connected. Time is frozen, so that the maintained
+ * template is never replaced in the background.
+ */
+static void BlockTemplate(benchmark::Bench& bench, bool cached, bool after_block)
+{
+    constexpr uint64_t NUM_EPOCHS{3};
+    constexpr uint64_t EPOCH_ITERATIONS{10};
+
+    FastRandomContext det_rand{true};
+    // The transactions added by PopulateMempool() are not valid against the chain.
+    auto testing_setup{MakeNoLogFileContext<TestChain100Setup>(ChainType::REGTEST, {"-checkmempool=0"})};
+    node::NodeContext& node{testing_setup->m_node};
+    const std::vector<CTransactionRef> spends{CreateSpends(*testing_setup, NUM_EPOCHS * EPOCH_ITERATIONS)};
+    if (after_block) {
+        LOCK(::cs_main);
+        for (const auto& tx : spends) {
+            assert(node.chainman->ProcessTransaction(tx).m_result_type == MempoolAcceptResult::ResultType::VALID);
+        }
+    }
+    {
+        // Add the transactions at the current time, rather than at time 0, so
+        // that they do not expire when a transaction is accepted.
+        TestMemPoolEntryHelper entry;
+        LOCK2(::cs_main, node.mempool->cs);
+        for (const auto& tx : testing_setup->PopulateMempool(det_rand, /*num_transactions=*/1000, /*submit=*/false)) {
+            node.mempool->addUnchecked(entry.Fee(100 * det_rand.randrange(30)).Time(Now<NodeSeconds>()).FromTx(tx));
+        }
+    }
+    SetMockTime(GetTime<std::chrono::seconds>());
+
+    node::BlockAssembler::Options assembler_options;
+    assembler_options.test_block_validity = false;
+    node::BlockTemplateCache cache{*node.chainman, *node.mempool, assembler_options};
+    node.validation_signals->RegisterValidationInterface(&cache);
+    assert(WITH_LOCK(::cs_main, return cache.Get().block_template));
+
+    size_t next{0};
+    bench.epochs(NUM_EPOCHS).epochIterations(EPOCH_ITERATIONS).run([&] {
+        assert(next < spends.size());
+        if (after_block) {
+            testing_setup->CreateAndProcessBlock({CMutableTransaction{*spends[next++]}}, P2WSH_OP_TRUE);
+        } else {
+            LOCK(::cs_main);
+            assert(node.chainman->ProcessTransaction(spends[next++]).m_result_type == MempoolAcceptResult::ResultType::VALID);
+        }
+        node.validation_signals->SyncWithValidationInterfaceQueue();
+        LOCK(::cs_main);
+        if (cached) {
+            assert(cache.Get().block_template);
+        } else {
+            node::BlockAssembler assembler{node.chainman->ActiveChainstate(), node.mempool.get(), assembler_options};
+            assert(assembler.CreateNewBlock(P2WSH_OP_TRUE));
+        }
+    });
+
+    node.validation_signals->UnregisterValidationInterface(&cache);
+    SetMockTime(0);
+}
+
+static void BlockTemplateCacheAfterTx(benchmark::Bench& bench) { BlockTemplate(bench, /*cached=*/true, /*after_block=*/false); }
+static void BlockTemplateRebuildAfterTx(benchmark::Bench& bench) { BlockTemplate(bench, /*cached=*/false, /*after_block=*/false); }
+static void BlockTemplateCacheAfterBlock(benchmark::Bench& bench) { BlockTemplate(bench, /*cached=*/true, /*after_block=*/true); }
+static void BlockTemplateRebuildAfterBlock(benchmark::Bench& bench) { BlockTemplate(bench, /*cached=*/false, /*after_block=*/true); }
+
 BENCHMARK(AssembleBlock, benchmark::PriorityLevel::HIGH);
 BENCHMARK(BlockAssemblerAddPackageTxns, benchmark::PriorityLevel::LOW);
+BENCHMARK(BlockTemplateCacheAfterTx, benchmark::PriorityLevel::LOW);
+BENCHMARK(BlockTemplateRebuildAfterTx, benchmark::PriorityLevel::LOW);
+BENCHMARK(BlockTemplateCacheAfterBlock, benchmark::PriorityLevel::LOW);
+BENCHMARK(BlockTemplateRebuildAfterBlock, benchmark::PriorityLevel::LOW);
@@ -5,9 +5,13 @@
 #include <bench/bench.h>
 #include <coins.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <script/signingprovider.h>
 #include <test/util/transaction_utils.h>
+#include <tinyformat.h>
 
+#include <cassert>
+#include <string>
 #include <vector>
 
 // Microbenchmark for simple accesses to a CCoinsViewCache database. Note from
@@ -49,4 +53,105 @@ static void CCoinsCaching(benchmark::Bench& bench)
     });
 }
 
+static constexpr size_t NUM_CACHED_COINS{100'000};
+static constexpr size_t NUM_LOOKUPS{1'000};
+
+static std::vector<COutPoint> RandomOutPoints(FastRandomContext& rng, size_t count)
+{
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(count);
+    for (size_t i{0}; i < count; ++i) {
+        outpoints.emplace_back(Txid::FromUint256(rng.rand256()), rng.randrange(4));
+    }
+    return outpoints;
+}
+
+static const CScript P2WPKH_SCRIPT{CScript() << OP_0 << std::vector<unsigned char>(20, 1)};
+static const CScript P2TR_SCRIPT{CScript() << OP_1 << std::vector<unsigned char>(32, 1)};
+
+static void AddCoins(CCoinsViewCache& cache, const std::vector<COutPoint>& outpoints, const CScript& script_pub_key)
+{
+    for (const auto& outpoint : outpoints) {
+        cache.AddCoin(outpoint, Coin{CTxOut{1000, script_pub_key}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+    }
+}
+
+// Lookups in a large CCoinsMap, for outpoints that are in the cache (hit) or
+// not (miss). Misses do not fall through to the (empty) base view because only
+// the cache itself is queried.
+static void CCoinsCacheLookup(benchmark::Bench& bench, bool hit)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    CCoinsView coins_dummy;
+    CCoinsViewCache cache{&coins_dummy, /*deterministic=*/true};
+    const auto cached{RandomOutPoints(rng, NUM_CACHED_COINS)};
+    AddCoins(cache, cached, P2WPKH_SCRIPT);
+
+    std::vector<COutPoint> lookups;
+    if (hit) {
+        for (size_t i{0}; i < NUM_LOOKUPS; ++i) lookups.push_back(cached[rng.randrange(cached.size())]);
+    } else {
+        lookups = RandomOutPoints(rng, NUM_LOOKUPS);
+    }
+
+    bench.batch(lookups.size()).unit("lookup").run([&] {
+        for (const auto& outpoint : lookups) {
+            const bool found{cache.HaveCoinInCache(outpoint)};
+            assert(found == hit);
+        }
+    });
+}
+
+static void CCoinsCacheLookupHit(benchmark::Bench& bench) { CCoinsCacheLookup(bench, /*hit=*/true); }
+static void CCoinsCacheLookupMiss(benchmark::Bench& bench) { CCoinsCacheLookup(bench, /*hit=*/false); }
+
+// Fill an empty cache with coins, and report the memory used per coin, which
+// determines how many coins fit in -dbcache.
+static void InsertCoins(benchmark::Bench& bench, const std::string& name, const CScript& script_pub_key)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    CCoinsView coins_dummy;
+    const auto outpoints{RandomOutPoints(rng, NUM_CACHED_COINS)};
+    {
+        CCoinsViewCache cache{&coins_dummy, /*deterministic=*/true};
+        AddCoins(cache, outpoints, script_pub_key);
+        bench.name(strprintf("%s (%.1f bytes/coin)", name, double(cache.DynamicMemoryUsage()) / cache.GetCacheSize()));
+    }
+
+    bench.batch(outpoints.size()).unit("coin").run([&] {
+        CCoinsViewCache cache{&coins_dummy, /*deterministic=*/true};
+        AddCoins(cache, outpoints, script_pub_key);
+        assert(cache.GetCacheSize() == outpoints.size());
+    });
+}
+
+static void CCoinsCacheInsert(benchmark::Bench& bench) { InsertCoins(bench, __func__, P2WPKH_SCRIPT); }
+static void CCoinsCacheInsertP2TR(benchmark::Bench& bench) { InsertCoins(bench, __func__, P2TR_SCRIPT); }
+
+// Reading the scripts of cached P2TR coins, which reconstructs each from the
+// cache's compact representation.
+static void CCoinsCacheAccessP2TR(benchmark::Bench& bench)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    CCoinsView coins_dummy;
+    CCoinsViewCache cache{&coins_dummy, /*deterministic=*/true};
+    const auto cached{RandomOutPoints(rng, NUM_CACHED_COINS)};
+    AddCoins(cache, cached, P2TR_SCRIPT);
+
+    std::vector<COutPoint> lookups;
+    for (size_t i{0}; i < NUM_LOOKUPS; ++i) lookups.push_back(cached[rng.randrange(cached.size())]);
+
+    bench.batch(lookups.size()).unit("coin").run([&] {
+        for (const auto& outpoint : lookups) {
+            const CScript script{cache.AccessCoin(outpoint).GetScript()};
+            assert(script.size() == P2TR_SCRIPT.size());
+        }
+    });
+}
+
 BENCHMARK(CCoinsCaching, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsCacheLookupHit, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsCacheLookupMiss, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsCacheInsert, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsCacheInsertP2TR, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsCacheAccessP2TR, benchmark::PriorityLevel::HIGH);
@@ -9,6 +9,7 @@
 #include <prevector.h>
 #include <pubkey.h>
 #include <random.h>
+#include <tinyformat.h>
 
 #include <vector>
 
@@ -17,31 +18,21 @@ static const size_t BATCH_SIZE = 30;
 static const int PREVECTOR_SIZE = 28;
 static const unsigned int QUEUE_BATCH_SIZE = 128;
 
-// This Benchmark tests the CheckQueue with a slightly realistic workload,
-// where checks all contain a prevector that is indirect 50% of the time
-// and there is a little bit of work done between calls to Add.
-static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
-{
-    // We shouldn't ever be running with the checkqueue on a single core machine.
-    if (GetNumCores() <= 1) return;
-
-    ECC_Context ecc_context{};
-
-    struct PrevectorJob {
-        prevector<PREVECTOR_SIZE, uint8_t> p;
-        explicit PrevectorJob(FastRandomContext& insecure_rand){
-            p.resize(insecure_rand.randrange(PREVECTOR_SIZE*2));
-        }
-        bool operator()()
-        {
-            return true;
-        }
-    };
+namespace {
+struct PrevectorJob {
+    prevector<PREVECTOR_SIZE, uint8_t> p;
+    explicit PrevectorJob(FastRandomContext& insecure_rand){
+        p.resize(insecure_rand.randrange(PREVECTOR_SIZE*2));
+    }
+    bool operator()()
+    {
+        return true;
+    }
+};
 
-    // The main thread should be counted to prevent thread oversubscription, and
-    // to decrease the variance of benchmark results.
-    int worker_threads_num{GetNumCores() - 1};
-    CCheckQueue<PrevectorJob> queue{QUEUE_BATCH_SIZE, worker_threads_num};
+void RunCheckQueue(benchmark::Bench& bench, int worker_threads_num, bool work_stealing)
+{
+    CCheckQueue<PrevectorJob> queue{QUEUE_BATCH_SIZE, worker_threads_num, work_stealing};
 
     // create all the data once, then submit copies in the benchmark.
     FastRandomContext insecure_rand(true);
@@ -63,4 +54,46 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
         control.Wait();
     });
 }
+} // namespace
+
+// This Benchmark tests the CheckQueue with a slightly realistic workload,
+// where checks all contain a prevector that is indirect 50% of the time
+// and there is a little bit of work done between calls to Add.
+static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
+{
+    // We shouldn't ever be running with the checkqueue on a single core machine.
+    if (GetNumCores() <= 1) return;
+
+    ECC_Context ecc_context{};
+
+    // The main thread should be counted to prevent thread oversubscription, and
+    // to decrease the variance of benchmark results.
+    RunCheckQueue(bench, GetNumCores() - 1, /*work_stealing=*/false);
+}
+
+static void CCheckQueueWorkStealingPrevectorJob(benchmark::Bench& bench)
+{
+    if (GetNumCores() <= 1) return;
+
+    ECC_Context ecc_context{};
+
+    RunCheckQueue(bench, GetNumCores() - 1, /*work_stealing=*/true);
+}
+
+// Measure how both schedulers scale from 1 to 64 threads (including the
+// master). Thread counts above the number of cores are oversubscribed.
+static void CCheckQueueScaling(benchmark::Bench& bench)
+{
+    ECC_Context ecc_context{};
+
+    for (const bool work_stealing : {false, true}) {
+        for (int threads = 1; threads <= 64; threads *= 2) {
+            bench.name(strprintf("%s, %s, %d threads", __func__, work_stealing ? "work stealing" : "shared queue", threads));
+            RunCheckQueue(bench, threads - 1, work_stealing);
+        }
+    }
+}
+
 BENCHMARK(CCheckQueueSpeedPrevectorJob, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCheckQueueWorkStealingPrevectorJob, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCheckQueueScaling, benchmark::PriorityLevel::LOW);
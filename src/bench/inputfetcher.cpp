@@ -0,0 +1,69 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <common/system.h>
+#include <inputfetcher.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <txdb.h>
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+static constexpr size_t NUM_INPUTS{5000};
+static constexpr size_t FETCH_BATCH_SIZE{16};
+
+// Replays a block whose inputs all live in the coins database against a cold
+// cache, the way ConnectBlock() sees blocks during IBD or after a restart.
+// Each iteration starts a fresh CCoinsViewCache, optionally prefetches the
+// inputs in parallel and then accesses every prevout in block order.
+static void ConnectBlockColdCache(benchmark::Bench& bench, bool prefetch)
+{
+    CCoinsViewDB db{{.path = "inputfetcher", .cache_bytes = 1 << 20, .memory_only = true}, {}};
+
+    FastRandomContext rng{/*fDeterministic=*/true};
+    CBlock block;
+    {
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vout.resize(1);
+        block.vtx.push_back(MakeTransactionRef(coinbase));
+
+        CCoinsViewCache cache{&db};
+        for (size_t i{0}; i < NUM_INPUTS; ++i) {
+            const COutPoint prevout{Txid::FromUint256(rng.rand256()), 0};
+            cache.AddCoin(prevout, Coin{CTxOut{1, CScript() << OP_TRUE}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+            CMutableTransaction tx;
+            tx.vin.emplace_back(prevout);
+            tx.vout.emplace_back(1, CScript() << OP_TRUE);
+            block.vtx.push_back(MakeTransactionRef(tx));
+        }
+        cache.SetBestBlock(rng.rand256());
+        const bool flushed{cache.Flush()};
+        assert(flushed);
+    }
+
+    InputFetcher fetcher{FETCH_BATCH_SIZE, prefetch ? std::max(GetNumCores() - 1, 1) : 0};
+    bench.batch(NUM_INPUTS).unit("input").run([&] {
+        CCoinsViewCache cache{&db};
+        fetcher.FetchInputs(cache, db, block);
+        for (const auto& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const auto& input : tx->vin) {
+                assert(!cache.AccessCoin(input.prevout).IsSpent());
+            }
+        }
+    });
+}
+
+static void ConnectBlockColdCacheSerial(benchmark::Bench& bench) { ConnectBlockColdCache(bench, /*prefetch=*/false); }
+static void ConnectBlockColdCachePrefetch(benchmark::Bench& bench) { ConnectBlockColdCache(bench, /*prefetch=*/true); }
+
+BENCHMARK(ConnectBlockColdCacheSerial, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ConnectBlockColdCachePrefetch, benchmark::PriorityLevel::HIGH);
@@ -10,27 +10,19 @@
 #include <util/chaintype.h>
 #include <validation.h>
 
+#include <cassert>
+
 /**
- * The LoadExternalBlockFile() function is used during -reindex and -loadblock.
- *
  * Create a test file that's similar to a datadir/blocks/blk?????.dat file,
  * It contains around 134 copies of the same block (typical size of real block files).
- * For each block in the file, LoadExternalBlockFile() won't find its parent,
- * and so will skip the block. (In the real system, it will re-read the block
- * from disk later when it encounters its parent.)
- *
- * This benchmark measures the performance of deserializing the block (or just
- * its header, beginning with PR 16981).
  */
-static void LoadExternalBlockFile(benchmark::Bench& bench)
+static fs::path CreateBlockFile(const TestingSetup& testing_setup)
 {
-    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
-
     // Create a single block as in the blocks files (magic bytes, block size,
     // block data) as a stream object.
-    const fs::path blkfile{testing_setup.get()->m_path_root / "blk.dat"};
+    const fs::path blkfile{testing_setup.m_path_root / "blk.dat"};
     DataStream ss{};
-    auto params{testing_setup->m_node.chainman->GetParams()};
+    auto params{testing_setup.m_node.chainman->GetParams()};
     ss << params.MessageStart();
     ss << static_cast<uint32_t>(benchmark::data::block413567.size());
     // We can't use the streaming serialization (ss << benchmark::data::block413567)
@@ -49,6 +41,23 @@ static void LoadExternalBlockFile(benchmark::Bench& bench)
         }
         fclose(file);
     }
+    return blkfile;
+}
+
+/**
+ * The LoadExternalBlockFile() function is used during -reindex and -loadblock.
+ *
+ * For each block in the test file, LoadExternalBlockFile() won't find its parent,
+ * and so will skip the block. (In the real system, it will re-read the block
+ * from disk later when it encounters its parent.)
+ *
+ * This benchmark measures the performance of deserializing the block (or just
+ * its header, beginning with PR 16981).
+ */
+static void LoadExternalBlockFile(benchmark::Bench& bench)
+{
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
+    const fs::path blkfile{CreateBlockFile(*testing_setup)};
 
     std::multimap<uint256, FlatFilePos> blocks_with_unknown_parent;
     FlatFilePos pos;
@@ -61,4 +70,25 @@ static void LoadExternalBlockFile(benchmark::Bench& bench)
     fs::remove(blkfile);
 }
 
+/**
+ * BlockManager::ScanBlockFile() is used by -reindexthreads to find the blocks
+ * of a block file before loading any of them, with one thread per file.
+ *
+ * This benchmark measures the performance of scanning the same test file,
+ * which only hashes the block headers and never deserializes a block.
+ */
+static void ScanBlockFile(benchmark::Bench& bench)
+{
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
+    const fs::path blkfile{CreateBlockFile(*testing_setup)};
+
+    bench.run([&] {
+        AutoFile file{fsbridge::fopen(blkfile, "rb")};
+        const auto blocks{testing_setup->m_node.chainman->m_blockman.ScanBlockFile(file, /*file_num=*/0)};
+        assert(blocks.size() == node::MAX_BLOCKFILE_SIZE / (benchmark::data::block413567.size() + 8));
+    });
+    fs::remove(blkfile);
+}
+
 BENCHMARK(LoadExternalBlockFile, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ScanBlockFile, benchmark::PriorityLevel::HIGH);
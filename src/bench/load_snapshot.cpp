@@ -0,0 +1,89 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <hash.h>
+#include <kernel/coinstats.h>
+#include <node/utxo_snapshot.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <serialize.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+#include <util/chaintype.h>
+#include <util/fs.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+static constexpr size_t NUM_SNAPSHOT_TXIDS{50'000};
+static constexpr int SNAPSHOT_BASE_HEIGHT{800'000};
+
+/**
+ * Load the coins of a synthetic UTXO snapshot with node::SnapshotCoinsLoader,
+ * as PopulateAndValidateSnapshot() does, into a coins cache.
+ *
+ * The snapshot holds the coins of 50,000 transactions in the order of the coins
+ * database, so that the loader computes the snapshot hash while reading.
+ */
+static void LoadSnapshotCoins(benchmark::Bench& bench)
+{
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
+    const fs::path snapshot_path{testing_setup->m_path_root / "utxo.dat"};
+
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<Txid> txids;
+    for (size_t i{0}; i < NUM_SNAPSHOT_TXIDS; ++i) txids.push_back(Txid::FromUint256(rng.rand256()));
+    std::sort(txids.begin(), txids.end());
+
+    // Serialize the coins as in the coins section of a snapshot file.
+    DataStream ss{};
+    HashWriter hasher{};
+    uint64_t coins_count{0};
+    for (const Txid& txid : txids) {
+        const uint32_t num_outputs{1 + uint32_t(rng.randrange(4))};
+        ss << txid;
+        WriteCompactSize(ss, num_outputs);
+        for (uint32_t n{0}; n < num_outputs; ++n) {
+            const Coin coin{CTxOut{int64_t(rng.randrange(100'000'000)), CScript() << OP_1 << rng.randbytes(32)},
+                            /*nHeightIn=*/int(rng.randrange(SNAPSHOT_BASE_HEIGHT)), /*fCoinBaseIn=*/false};
+            WriteCompactSize(ss, n);
+            ss << coin;
+            kernel::ApplyCoinHash(hasher, COutPoint{txid, n}, coin);
+            ++coins_count;
+        }
+    }
+    const uint256 expected_hash{hasher.GetHash()};
+    {
+        FILE* file{fsbridge::fopen(snapshot_path, "wb")};
+        if (fwrite(ss.data(), 1, ss.size(), file) != ss.size()) {
+            throw std::runtime_error("write to snapshot file failed\n");
+        }
+        fclose(file);
+    }
+
+    CCoinsView coins_dummy;
+    bench.batch(coins_count).unit("coin").run([&] {
+        AutoFile file{fsbridge::fopen(snapshot_path, "rb")};
+        CCoinsViewCache cache{&coins_dummy, /*deterministic=*/true};
+        node::SnapshotCoinsLoader loader{file, coins_count, SNAPSHOT_BASE_HEIGHT};
+        for (auto batch{loader.NextBatch()}; !batch.empty(); batch = loader.NextBatch()) {
+            for (auto& [outpoint, coin] : batch) {
+                cache.EmplaceCoinInternalDANGER(std::move(outpoint), std::move(coin));
+            }
+        }
+        assert(!loader.GetError());
+        assert(loader.GetSerializedHash() == expected_hash);
+        assert(cache.GetCacheSize() == coins_count);
+    });
+    fs::remove(snapshot_path);
+}
+
+BENCHMARK(LoadSnapshotCoins, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,124 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <addresstype.h>
+#include <bench/bench.h>
+#include <consensus/amount.h>
+#include <kernel/cs_main.h>
+#include <primitives/transaction.h>
+#include <rpc/mempool.h>
+#include <script/script.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <univalue.h>
+#include <util/chaintype.h>
+#include <util/check.h>
+#include <validation.h>
+
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+static constexpr int NUM_TXS{1000};
+//! Number of batches of transactions, each signed anew, so that their
+//! signatures miss the signature cache when they are first checked.
+static constexpr int NUM_ROUNDS{5};
+
+// Checks a pre-generated batch of independent transactions for mempool
+// acceptance, either one after the other under cs_main, or with
+// ProcessTransactions(), which verifies their scripts in parallel without it.
+static void MempoolAccept(benchmark::Bench& bench, bool parallel)
+{
+    const auto testing_setup{MakeNoLogFileContext<TestChain100Setup>(ChainType::REGTEST)};
+    const CScript spk{GetScriptForDestination(WitnessV0KeyHash(testing_setup->coinbaseKey.GetPubKey()))};
+    const CTransactionRef coinbase{testing_setup->m_coinbase_txns[0]};
+    const CTransactionRef fanout{MakeTransactionRef(testing_setup->CreateValidMempoolTransaction(
+        {coinbase}, {COutPoint{coinbase->GetHash(), 0}}, /*input_height=*/1, {testing_setup->coinbaseKey},
+        std::vector<CTxOut>(NUM_TXS, CTxOut{coinbase->vout[0].nValue / (NUM_TXS + 1), spk}), /*submit=*/false))};
+    testing_setup->CreateAndProcessBlock({CMutableTransaction{*fanout}}, spk);
+    const int fanout_height{WITH_LOCK(::cs_main, return testing_setup->m_node.chainman->ActiveHeight())};
+
+    // Vary the fees between the rounds and the two variants, so that no
+    // signature is in the cache yet.
+    std::vector<std::vector<CTransactionRef>> rounds(NUM_ROUNDS);
+    for (int round{0}; round < NUM_ROUNDS; ++round) {
+        const CAmount fee{1000 + 10 * round + parallel};
+        for (uint32_t n{0}; n < NUM_TXS; ++n) {
+            rounds[round].push_back(MakeTransactionRef(testing_setup->CreateValidMempoolTransaction(
+                fanout, n, fanout_height, testing_setup->coinbaseKey, spk, fanout->vout[n].nValue - fee, /*submit=*/false)));
+        }
+    }
+
+    ChainstateManager& chainman{*testing_setup->m_node.chainman};
+    int round{0};
+    bench.batch(NUM_TXS).unit("tx").epochs(NUM_ROUNDS).epochIterations(1).run([&] {
+        const auto& txs{rounds.at(round++ % NUM_ROUNDS)};
+        if (parallel) {
+            for (const auto& result : chainman.ProcessTransactions(txs, /*test_accept=*/true)) {
+                assert(result.m_result_type == MempoolAcceptResult::ResultType::VALID);
+            }
+        } else {
+            LOCK(::cs_main);
+            for (const auto& tx : txs) {
+                assert(chainman.ProcessTransaction(tx, /*test_accept=*/true).m_result_type == MempoolAcceptResult::ResultType::VALID);
+            }
+        }
+    });
+}
+
+static void MempoolAcceptSerial(benchmark::Bench& bench) { MempoolAccept(bench, /*parallel=*/false); }
+static void MempoolAcceptParallel(benchmark::Bench& bench) { MempoolAccept(bench, /*parallel=*/true); }
+
+// Adds batches of independent transactions to a mempool already holding a
+// batch, while another thread polls verbose getrawmempool as fast as it can.
+// The poller serves from mempool snapshots, so it only holds the mempool lock
+// while a snapshot is copied, not while its JSON result is built.
+static void MempoolAcceptWithRpcPoller(benchmark::Bench& bench)
+{
+    const auto testing_setup{MakeNoLogFileContext<TestChain100Setup>(ChainType::REGTEST)};
+    const CScript spk{GetScriptForDestination(WitnessV0KeyHash(testing_setup->coinbaseKey.GetPubKey()))};
+    const CTransactionRef coinbase{testing_setup->m_coinbase_txns[0]};
+    const uint32_t num_outputs{NUM_TXS * (NUM_ROUNDS + 1)};
+    const CTransactionRef fanout{MakeTransactionRef(testing_setup->CreateValidMempoolTransaction(
+        {coinbase}, {COutPoint{coinbase->GetHash(), 0}}, /*input_height=*/1, {testing_setup->coinbaseKey},
+        std::vector<CTxOut>(num_outputs, CTxOut{coinbase->vout[0].nValue / (num_outputs + 1), spk}), /*submit=*/false))};
+    testing_setup->CreateAndProcessBlock({CMutableTransaction{*fanout}}, spk);
+    const int fanout_height{WITH_LOCK(::cs_main, return testing_setup->m_node.chainman->ActiveHeight())};
+
+    std::vector<CTransactionRef> txs;
+    for (uint32_t n{0}; n < num_outputs; ++n) {
+        txs.push_back(MakeTransactionRef(testing_setup->CreateValidMempoolTransaction(
+            fanout, n, fanout_height, testing_setup->coinbaseKey, spk, fanout->vout[n].nValue - 1000, /*submit=*/false)));
+    }
+
+    ChainstateManager& chainman{*testing_setup->m_node.chainman};
+    const CTxMemPool& pool{*Assert(testing_setup->m_node.mempool)};
+    const auto accept{[&](size_t begin) {
+        for (size_t i{begin}; i < begin + NUM_TXS; ++i) {
+            LOCK(::cs_main);
+            assert(chainman.ProcessTransaction(txs[i]).m_result_type == MempoolAcceptResult::ResultType::VALID);
+        }
+    }};
+    accept(0);
+
+    std::atomic<bool> stop{false};
+    std::thread poller{[&] {
+        while (!stop) {
+            assert(MempoolToJSON(pool, /*verbose=*/true).size() >= NUM_TXS);
+        }
+    }};
+    size_t next{NUM_TXS};
+    bench.batch(NUM_TXS).unit("tx").epochs(NUM_ROUNDS).epochIterations(1).run([&] {
+        accept(next);
+        next += NUM_TXS;
+    });
+    stop = true;
+    poller.join();
+}
+
+BENCHMARK(MempoolAcceptSerial, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MempoolAcceptParallel, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MempoolAcceptWithRpcPoller, benchmark::PriorityLevel::HIGH);
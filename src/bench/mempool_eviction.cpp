@@ -5,8 +5,13 @@
 #include <bench/bench.h>
 #include <kernel/mempool_entry.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <test/util/setup_common.h>
 #include <txmempool.h>
+#include <util/chaintype.h>
+
+#include <cassert>
+#include <vector>
 
 
 static void AddTx(const CTransactionRef& tx, const CAmount& nFee, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
@@ -22,9 +27,8 @@ static void AddTx(const CTransactionRef& tx, const CAmount& nFee, CTxMemPool& po
         spendsCoinbase, sigOpCost, lp));
 }
 
-// Right now this is only testing eviction performance in an extremely small
-// mempool. Code needs to be written to generate a much wider variety of
-// unique transactions for a more meaningful performance measurement.
+// Eviction performance in an extremely small mempool. See
+// MempoolEvictionLarge for a full mempool.
 static void MempoolEviction(benchmark::Bench& bench)
 {
     const auto testing_setup = MakeNoLogFileContext<const TestingSetup>();
@@ -134,4 +138,44 @@ static void MempoolEviction(benchmark::Bench& bench)
     });
 }
 
+
+/**
+ * Evict a tenth of a mempool filled to 300 MB with chains of 25 transactions,
+ * each paying a random fee, like a flood of low-fee chained transactions.
+ */
+static void MempoolEvictionLarge(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(ChainType::REGTEST, {"-checkmempool=0"});
+    CTxMemPool& pool = *Assert(testing_setup->m_node.mempool);
+    FastRandomContext det_rand{true};
+
+    size_t usage{0};
+    {
+        LOCK2(cs_main, pool.cs);
+        while (pool.DynamicMemoryUsage() < 300'000'000) {
+            COutPoint prevout(Txid::FromUint256(det_rand.rand256()), 0);
+            for (unsigned i{0}; i < DEFAULT_ANCESTOR_LIMIT; ++i) {
+                CMutableTransaction tx;
+                tx.vin.resize(1);
+                tx.vin[0].prevout = prevout;
+                tx.vin[0].scriptWitness.stack.push_back(std::vector<unsigned char>(2'000));
+                tx.vout.resize(1);
+                tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+                tx.vout[0].nValue = 10 * COIN;
+                const CTransactionRef tx_r{MakeTransactionRef(tx)};
+                AddTx(tx_r, det_rand.randrange(10'000), pool);
+                prevout = COutPoint(tx_r->GetHash(), 0);
+            }
+        }
+        usage = pool.DynamicMemoryUsage();
+    }
+
+    bench.epochs(1).epochIterations(1).run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        LOCK2(cs_main, pool.cs);
+        pool.TrimToSize(usage * 9 / 10);
+        assert(pool.DynamicMemoryUsage() <= usage * 9 / 10);
+    });
+}
+
 BENCHMARK(MempoolEviction, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MempoolEvictionLarge, benchmark::PriorityLevel::LOW);
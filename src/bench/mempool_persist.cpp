@@ -0,0 +1,88 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <addresstype.h>
+#include <bench/bench.h>
+#include <consensus/amount.h>
+#include <kernel/cs_main.h>
+#include <kernel/mempool_persist.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <test/util/txmempool.h>
+#include <txmempool.h>
+#include <util/chaintype.h>
+#include <util/check.h>
+#include <util/fs.h>
+#include <util/time.h>
+#include <util/translation.h>
+#include <validation.h>
+
+#include <cassert>
+#include <vector>
+
+//! Number of transactions funding the transactions in the dump, each in its own block.
+static constexpr uint32_t NUM_FANOUTS{25};
+//! Outputs of each funding transaction, each spent by a parent with one child in the dump.
+static constexpr uint32_t FANOUT_OUTPUTS{2'000};
+
+/**
+ * Load a synthetic mempool.dat of 100,000 transactions, half of them children
+ * of the other half, into an empty mempool. The file is written in the
+ * current format, whose layers let the loader check all parents, and then all
+ * children, in parallel, or in the legacy format, where each child is checked
+ * after the rest of its batch.
+ */
+static void MempoolLoad(benchmark::Bench& bench, bool legacy_format)
+{
+    const auto testing_setup{MakeNoLogFileContext<TestChain100Setup>(ChainType::REGTEST, {"-checkmempool=0"})};
+    const CScript spk{GetScriptForDestination(WitnessV0KeyHash(testing_setup->coinbaseKey.GetPubKey()))};
+
+    std::vector<CTransactionRef> txs;
+    for (uint32_t f{0}; f < NUM_FANOUTS; ++f) {
+        const CTransactionRef coinbase{testing_setup->m_coinbase_txns[f]};
+        const CTransactionRef fanout{MakeTransactionRef(testing_setup->CreateValidMempoolTransaction(
+            {coinbase}, {COutPoint{coinbase->GetHash(), 0}}, /*input_height=*/int(f + 1), {testing_setup->coinbaseKey},
+            std::vector<CTxOut>(FANOUT_OUTPUTS, CTxOut{coinbase->vout[0].nValue / (FANOUT_OUTPUTS + 1), spk}), /*submit=*/false))};
+        testing_setup->CreateAndProcessBlock({CMutableTransaction{*fanout}}, spk);
+        const int fanout_height{WITH_LOCK(::cs_main, return testing_setup->m_node.chainman->ActiveHeight())};
+        for (uint32_t n{0}; n < FANOUT_OUTPUTS; ++n) {
+            const CTransactionRef parent{MakeTransactionRef(testing_setup->CreateValidMempoolTransaction(
+                fanout, n, fanout_height, testing_setup->coinbaseKey, spk, fanout->vout[n].nValue - 1000, /*submit=*/false))};
+            txs.push_back(parent);
+            txs.push_back(MakeTransactionRef(testing_setup->CreateValidMempoolTransaction(
+                parent, 0, fanout_height + 1, testing_setup->coinbaseKey, spk, parent->vout[0].nValue - 1000, /*submit=*/false)));
+        }
+    }
+
+    // Write the dump from a separate mempool, filled without validation.
+    const fs::path dump_path{testing_setup->m_path_root / "mempool.dat"};
+    {
+        auto opts{MemPoolOptionsForTest(testing_setup->m_node)};
+        opts.persist_v1_dat = legacy_format;
+        bilingual_str error;
+        CTxMemPool dump_pool{opts, error};
+        assert(error.empty());
+        TestMemPoolEntryHelper entry;
+        LOCK2(::cs_main, dump_pool.cs);
+        for (const auto& tx : txs) {
+            dump_pool.addUnchecked(entry.Fee(1000).Time(Now<NodeSeconds>()).FromTx(tx));
+        }
+        assert(kernel::DumpMempool(dump_pool, dump_path, fsbridge::fopen, /*skip_file_commit=*/true));
+    }
+
+    CTxMemPool& pool{*Assert(testing_setup->m_node.mempool)};
+    Chainstate& chainstate{testing_setup->m_node.chainman->ActiveChainstate()};
+    bench.batch(txs.size()).unit("tx").epochs(1).epochIterations(1).run([&] {
+        assert(kernel::LoadMempool(pool, dump_path, chainstate, {}));
+        assert(pool.size() == txs.size());
+    });
+}
+
+static void MempoolLoadLayered(benchmark::Bench& bench) { MempoolLoad(bench, /*legacy_format=*/false); }
+static void MempoolLoadLegacy(benchmark::Bench& bench) { MempoolLoad(bench, /*legacy_format=*/true); }
+
+BENCHMARK(MempoolLoadLayered, benchmark::PriorityLevel::LOW);
+BENCHMARK(MempoolLoadLegacy, benchmark::PriorityLevel::LOW);
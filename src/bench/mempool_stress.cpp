@@ -7,10 +7,12 @@
 #include <policy/policy.h>
 #include <random.h>
 #include <test/util/setup_common.h>
+#include <tinyformat.h>
 #include <txmempool.h>
 #include <util/chaintype.h>
 #include <validation.h>
 
+#include <cassert>
 #include <vector>
 
 static void AddTx(const CTransactionRef& tx, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
@@ -103,6 +105,43 @@ static void ComplexMemPool(benchmark::Bench& bench)
     });
 }
 
+// Add unrelated transactions to an empty mempool and evict them all again, and
+// report the memory mapTx uses per entry, which determines how many fit in
+// -maxmempool.
+static void MempoolInsertEvict(benchmark::Bench& bench)
+{
+    FastRandomContext det_rand{true};
+    std::vector<CTransactionRef> ordered_coins;
+    for (int x = 0; x < 10000; ++x) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(Txid::FromUint256(det_rand.rand256()), 0);
+        tx.vin[0].scriptWitness.stack.push_back(CScriptNum(x).getvch());
+        tx.vout.resize(det_rand.randrange(3) + 1);
+        for (auto& out : tx.vout) {
+            out.scriptPubKey = CScript() << CScriptNum(x) << OP_EQUAL;
+            out.nValue = 10 * COIN;
+        }
+        ordered_coins.emplace_back(MakeTransactionRef(tx));
+    }
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN);
+    CTxMemPool& pool = *testing_setup.get()->m_node.mempool;
+    LOCK2(cs_main, pool.cs);
+    for (auto& tx : ordered_coins) {
+        AddTx(tx, pool);
+    }
+    bench.name(strprintf("%s (%.1f bytes/entry)", __func__, double(pool.mapTx.DynamicMemoryUsage()) / pool.size()));
+    pool.TrimToSize(0);
+
+    bench.batch(ordered_coins.size()).unit("tx").run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        for (auto& tx : ordered_coins) {
+            AddTx(tx, pool);
+        }
+        pool.TrimToSize(0);
+        assert(pool.size() == 0);
+    });
+}
+
 static void MempoolCheck(benchmark::Bench& bench)
 {
     FastRandomContext det_rand{true};
@@ -119,4 +158,5 @@ static void MempoolCheck(benchmark::Bench& bench)
 }
 
 BENCHMARK(ComplexMemPool, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MempoolInsertEvict, benchmark::PriorityLevel::HIGH);
 BENCHMARK(MempoolCheck, benchmark::PriorityLevel::HIGH);
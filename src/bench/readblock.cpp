@@ -7,47 +7,137 @@
 
 #include <consensus/validation.h>
 #include <node/blockstorage.h>
+#include <node/kernel_notifications.h>
+#include <random.h>
 #include <streams.h>
 #include <test/util/setup_common.h>
 #include <util/chaintype.h>
 #include <validation.h>
 
-static FlatFilePos WriteBlockToDisk(ChainstateManager& chainman)
+static FlatFilePos WriteBlockToDisk(node::BlockManager& blockman)
 {
     DataStream stream{benchmark::data::block413567};
     CBlock block;
     stream >> TX_WITH_WITNESS(block);
 
-    return chainman.m_blockman.SaveBlockToDisk(block, 0);
+    return blockman.SaveBlockToDisk(block, 0);
 }
 
-static void ReadBlockFromDiskTest(benchmark::Bench& bench)
+//! Read blocks with a block manager over the test setup's block files, which
+//! reads them through memory mappings if `mmap` is set.
+static std::unique_ptr<node::BlockManager> MakeBlockManager(const TestingSetup& setup, bool mmap)
+{
+    return std::make_unique<node::BlockManager>(*Assert(setup.m_node.shutdown), node::BlockManager::Options{
+        .chainparams = setup.m_node.chainman->GetParams(),
+        .blocks_dir = setup.m_args.GetBlocksDirPath(),
+        .notifications = *Assert(setup.m_node.notifications),
+        .mmap_block_files = mmap,
+    });
+}
+
+static void ReadBlock(benchmark::Bench& bench, bool mmap)
 {
     const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
     ChainstateManager& chainman{*testing_setup->m_node.chainman};
+    const auto blockman{MakeBlockManager(*testing_setup, mmap)};
 
     CBlock block;
-    const auto pos{WriteBlockToDisk(chainman)};
+    const auto pos{WriteBlockToDisk(chainman.m_blockman)};
 
     bench.run([&] {
-        const auto success{chainman.m_blockman.ReadBlockFromDisk(block, pos)};
+        const auto success{blockman->ReadBlockFromDisk(block, pos)};
         assert(success);
     });
 }
 
-static void ReadRawBlockFromDiskTest(benchmark::Bench& bench)
+static void ReadRawBlock(benchmark::Bench& bench, bool mmap)
 {
     const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
     ChainstateManager& chainman{*testing_setup->m_node.chainman};
+    const auto blockman{MakeBlockManager(*testing_setup, mmap)};
 
     std::vector<uint8_t> block_data;
-    const auto pos{WriteBlockToDisk(chainman)};
+    const auto pos{WriteBlockToDisk(chainman.m_blockman)};
 
     bench.run([&] {
-        const auto success{chainman.m_blockman.ReadRawBlockFromDisk(block_data, pos)};
+        const auto success{blockman->ReadRawBlockFromDisk(block_data, pos)};
         assert(success);
     });
 }
 
+// Serving a block to a peer does not copy it out of the mapping.
+static void ReadMappedRawBlockFromDisk(benchmark::Bench& bench)
+{
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
+    ChainstateManager& chainman{*testing_setup->m_node.chainman};
+    const auto blockman{MakeBlockManager(*testing_setup, /*mmap=*/true)};
+
+    const auto pos{WriteBlockToDisk(chainman.m_blockman)};
+
+    bench.run([&] {
+        const auto mapped{blockman->ReadMappedRawBlockFromDisk(pos)};
+        assert(mapped && mapped->data.size() == benchmark::data::block413567.size());
+    });
+}
+
+//! Number of copies of the test block written to read from at random.
+static constexpr int NUM_STORED_BLOCKS{32};
+//! Number of blocks read at random per iteration.
+static constexpr int NUM_RANDOM_READS{64};
+
+/**
+ * Queue reads of random blocks out of a few block files, and wait for all of
+ * them, with up to `queue_depth` reads in flight at once (-asyncblockreads),
+ * or one at a time if it is 0.
+ *
+ * The block files are in the page cache, so this measures the overhead of
+ * the reads, not the latency of the disk that queueing reads hides.
+ */
+static void ReadRandomBlocks(benchmark::Bench& bench, int queue_depth)
+{
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
+    const fs::path blocks_dir{testing_setup->m_path_root / "async_blocks"};
+    fs::create_directories(blocks_dir);
+    node::BlockManager blockman{*Assert(testing_setup->m_node.shutdown), node::BlockManager::Options{
+        .chainparams = testing_setup->m_node.chainman->GetParams(),
+        .blocks_dir = blocks_dir,
+        .notifications = *Assert(testing_setup->m_node.notifications),
+        .async_block_reads = queue_depth,
+    }};
+    assert(blockman.HasAsyncReads() == (queue_depth > 0));
+
+    std::vector<FlatFilePos> positions;
+    for (int i{0}; i < NUM_STORED_BLOCKS; ++i) positions.push_back(WriteBlockToDisk(blockman));
+
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<node::BlockManager::AsyncRead> reads;
+    bench.batch(NUM_RANDOM_READS).unit("block").run([&] {
+        reads.clear();
+        for (int i{0}; i < NUM_RANDOM_READS; ++i) {
+            reads.push_back(blockman.ReadRawBlockAsync(positions[rng.randrange(positions.size())]));
+        }
+        for (auto& read : reads) {
+            const auto block_data{read.get()};
+            assert(block_data && block_data->size() == benchmark::data::block413567.size());
+        }
+    });
+}
+
+static void ReadBlockFromDiskTest(benchmark::Bench& bench) { ReadBlock(bench, /*mmap=*/false); }
+static void ReadBlockFromDiskMmapTest(benchmark::Bench& bench) { ReadBlock(bench, /*mmap=*/true); }
+static void ReadRawBlockFromDiskTest(benchmark::Bench& bench) { ReadRawBlock(bench, /*mmap=*/false); }
+static void ReadRawBlockFromDiskMmapTest(benchmark::Bench& bench) { ReadRawBlock(bench, /*mmap=*/true); }
+static void ReadRandomBlocksSync(benchmark::Bench& bench) { ReadRandomBlocks(bench, /*queue_depth=*/0); }
+static void ReadRandomBlocksQueueDepth1(benchmark::Bench& bench) { ReadRandomBlocks(bench, /*queue_depth=*/1); }
+static void ReadRandomBlocksQueueDepth4(benchmark::Bench& bench) { ReadRandomBlocks(bench, /*queue_depth=*/4); }
+static void ReadRandomBlocksQueueDepth16(benchmark::Bench& bench) { ReadRandomBlocks(bench, /*queue_depth=*/16); }
+
 BENCHMARK(ReadBlockFromDiskTest, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadBlockFromDiskMmapTest, benchmark::PriorityLevel::HIGH);
 BENCHMARK(ReadRawBlockFromDiskTest, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadRawBlockFromDiskMmapTest, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadMappedRawBlockFromDisk, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadRandomBlocksSync, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadRandomBlocksQueueDepth1, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadRandomBlocksQueueDepth4, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadRandomBlocksQueueDepth16, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,93 @@
+// Copyright (c) 2024 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+
+#include <chain.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <node/blockstorage.h>
+#include <node/kernel_notifications.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <undo.h>
+#include <util/chaintype.h>
+#include <validation.h>
+
+#include <cassert>
+
+//! Undo data of the test block, with each input spending an output of the
+//! block in turn, so that the spent scripts and amounts are realistic.
+static CBlockUndo MakeBlockUndo(const CBlock& block)
+{
+    std::vector<CTxOut> outputs;
+    for (const auto& tx : block.vtx) outputs.insert(outputs.end(), tx->vout.begin(), tx->vout.end());
+
+    CBlockUndo undo;
+    size_t next{0};
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        CTxUndo& txundo{undo.vtxundo.emplace_back()};
+        for (size_t i{0}; i < tx->vin.size(); ++i, ++next) {
+            txundo.vprevout.emplace_back(outputs[next % outputs.size()], /*nHeightIn=*/413000 + next % 500, /*fCoinBaseIn=*/false);
+        }
+    }
+    return undo;
+}
+
+/**
+ * Read the undo data of the test block, stored as a compressed frame if
+ * `compress` is set (-compressundofiles), in block files of its own.
+ */
+static void ReadUndo(benchmark::Bench& bench, bool compress)
+{
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
+    const fs::path blocks_dir{testing_setup->m_path_root / (compress ? "compressed_undo" : "undo")};
+    fs::create_directories(blocks_dir);
+    node::BlockManager blockman{*Assert(testing_setup->m_node.shutdown), node::BlockManager::Options{
+        .chainparams = testing_setup->m_node.chainman->GetParams(),
+        .blocks_dir = blocks_dir,
+        .notifications = *Assert(testing_setup->m_node.notifications),
+        .compress_undo_files = compress,
+    }};
+
+    DataStream stream{benchmark::data::block413567};
+    CBlock block;
+    stream >> TX_WITH_WITNESS(block);
+    const CBlockUndo undo{MakeBlockUndo(block)};
+
+    const uint256 prev_hash{block.hashPrevBlock};
+    CBlockIndex prev;
+    prev.phashBlock = &prev_hash;
+    CBlockIndex index{block};
+    index.pprev = &prev;
+    index.nHeight = 413567;
+    const FlatFilePos pos{blockman.SaveBlockToDisk(block, index.nHeight)};
+    assert(!pos.IsNull());
+    index.nFile = pos.nFile;
+    index.nDataPos = pos.nPos;
+    index.nStatus = BLOCK_HAVE_DATA;
+
+    const uint64_t block_usage{blockman.CalculateCurrentUsage()};
+    BlockValidationState state;
+    const bool written{WITH_LOCK(::cs_main, return blockman.WriteUndoDataForBlock(undo, state, index))};
+    assert(written);
+    // The undo data, its header and checksum never take more space than
+    // uncompressed, as data that does not shrink is stored as it is.
+    const uint64_t undo_usage{blockman.CalculateCurrentUsage() - block_usage};
+    assert(undo_usage <= ::GetSerializeSize(undo) + 40);
+
+    bench.run([&] {
+        CBlockUndo read_undo;
+        const auto success{blockman.UndoReadFromDisk(read_undo, index)};
+        assert(success && read_undo.vtxundo.size() == undo.vtxundo.size());
+    });
+}
+
+static void ReadUndoFromDisk(benchmark::Bench& bench) { ReadUndo(bench, /*compress=*/false); }
+static void ReadUndoFromDiskCompressed(benchmark::Bench& bench) { ReadUndo(bench, /*compress=*/true); }
+
+BENCHMARK(ReadUndoFromDisk, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadUndoFromDiskCompressed, benchmark::PriorityLevel::HIGH);
@@ -23,7 +23,6 @@ static void RpcMempool(benchmark::Bench& bench)
 {
     const auto testing_setup = MakeNoLogFileContext<const ChainTestingSetup>(ChainType::MAIN);
     CTxMemPool& pool = *Assert(testing_setup->m_node.mempool);
-    LOCK2(cs_main, pool.cs);
 
     for (int i = 0; i < 1000; ++i) {
         CMutableTransaction tx = CMutableTransaction();
@@ -34,6 +33,7 @@ static void RpcMempool(benchmark::Bench& bench)
         tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
         tx.vout[0].nValue = i;
         const CTransactionRef tx_r{MakeTransactionRef(tx)};
+        LOCK2(cs_main, pool.cs);
         AddTx(tx_r, /*fee=*/i, pool);
     }
 
@@ -0,0 +1,59 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockservecache.h>
+
+#include <memusage.h>
+
+size_t BlockServeCache::MemoryUsage(const Entry& entry)
+{
+    // The list node, the index node and the serialized block.
+    return memusage::MallocUsage(sizeof(Entry) + 2 * sizeof(void*)) +
+           memusage::MallocUsage(sizeof(std::pair<const Key, std::list<Entry>::iterator>) + 4 * sizeof(void*)) +
+           memusage::MallocUsage(sizeof(std::vector<unsigned char>)) +
+           memusage::DynamicUsage(*entry.data);
+}
+
+BlockServeCache::Data BlockServeCache::Get(const uint256& hash, Format format)
+{
+    LOCK(m_mutex);
+    const auto it{m_index.find({hash, format})};
+    if (it == m_index.end()) {
+        ++m_misses;
+        return nullptr;
+    }
+    ++m_hits;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->data;
+}
+
+void BlockServeCache::Put(const uint256& hash, Format format, Data data)
+{
+    Entry entry{{hash, format}, std::move(data)};
+    const size_t usage{MemoryUsage(entry)};
+    if (usage > m_max_memory_usage) return;
+
+    LOCK(m_mutex);
+    if (m_index.contains(entry.key)) return;
+    while (m_memory_usage + usage > m_max_memory_usage) {
+        m_memory_usage -= MemoryUsage(m_entries.back());
+        m_index.erase(m_entries.back().key);
+        m_entries.pop_back();
+    }
+    m_entries.push_front(std::move(entry));
+    m_index.emplace(m_entries.front().key, m_entries.begin());
+    m_memory_usage += usage;
+}
+
+BlockServeCache::Stats BlockServeCache::GetStats() const
+{
+    LOCK(m_mutex);
+    return Stats{
+        .hits = m_hits,
+        .misses = m_misses,
+        .entries = m_entries.size(),
+        .memory_usage = m_memory_usage,
+        .max_memory_usage = m_max_memory_usage,
+    };
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKSERVECACHE_H
+#define BITCOIN_BLOCKSERVECACHE_H
+
+#include <sync.h>
+#include <uint256.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Bounded least-recently-used cache of serialized block messages, to serve
+ * blocks that several peers request in a short time without reading and
+ * serializing them again for each peer.
+ *
+ * Blocks are cached per serialization, as requests with and without witness
+ * data, and for compact blocks, each need their own message.
+ */
+class BlockServeCache
+{
+public:
+    enum class Format : uint8_t {
+        WITNESS,
+        NO_WITNESS,
+        COMPACT,
+    };
+
+    using Data = std::shared_ptr<const std::vector<unsigned char>>;
+
+    struct Stats {
+        uint64_t hits{0};
+        uint64_t misses{0};
+        size_t entries{0};
+        size_t memory_usage{0};
+        size_t max_memory_usage{0};
+    };
+
+    explicit BlockServeCache(size_t max_memory_usage) : m_max_memory_usage{max_memory_usage} {}
+
+    /** Get a serialized block, and mark it as the most recently used. Returns nullptr if it is not cached. */
+    Data Get(const uint256& hash, Format format) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Add a serialized block, evicting the least recently used ones to make room. */
+    void Put(const uint256& hash, Format format, Data data) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    Stats GetStats() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    using Key = std::pair<uint256, Format>;
+    struct Entry {
+        Key key;
+        Data data;
+    };
+
+    static size_t MemoryUsage(const Entry& entry);
+
+    mutable Mutex m_mutex;
+    const size_t m_max_memory_usage;
+    //! Entries from the most to the least recently used.
+    std::list<Entry> m_entries GUARDED_BY(m_mutex);
+    std::map<Key, std::list<Entry>::iterator> m_index GUARDED_BY(m_mutex);
+    size_t m_memory_usage GUARDED_BY(m_mutex){0};
+    uint64_t m_hits GUARDED_BY(m_mutex){0};
+    uint64_t m_misses GUARDED_BY(m_mutex){0};
+};
+
+#endif // BITCOIN_BLOCKSERVECACHE_H
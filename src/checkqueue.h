@@ -10,7 +10,10 @@
 #include <util/threadnames.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <iterator>
+#include <memory>
 #include <vector>
 
 /**
@@ -22,6 +25,13 @@
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * By default all threads take their batches from one shared queue. When
+  * constructed with work_stealing set, every thread (including the master)
+  * instead owns a deque that Add() fills round-robin. Threads take work from
+  * the back of their own deque and steal from the front of other threads'
+  * deques once it runs dry, so the shared mutex is only taken to go to sleep
+  * or to wake sleeping threads.
   */
 template <typename T>
 class CCheckQueue
@@ -62,6 +72,126 @@ private:
     std::vector<std::thread> m_worker_threads;
     bool m_request_stop GUARDED_BY(m_mutex){false};
 
+    //! Whether the per-thread deques below are used instead of `queue`.
+    const bool m_work_stealing;
+
+    //! A thread's own deque of checks, which other threads may steal from.
+    struct alignas(64) WorkDeque {
+        Mutex m_mutex;
+        std::deque<T> m_checks GUARDED_BY(m_mutex);
+    };
+
+    //! Deques for work stealing. Index 0 belongs to the master, index n + 1 to worker n.
+    std::vector<std::unique_ptr<WorkDeque>> m_deques;
+
+    //! Deque that the next Add() call will push to.
+    size_t m_next_deque{0};
+
+    //! Number of checks sitting in the deques. May transiently overestimate.
+    std::atomic<unsigned int> m_queued{0};
+
+    //! Number of checks that were added but haven't completed yet.
+    std::atomic<unsigned int> m_pending{0};
+
+    //! Number of worker threads waiting on m_worker_cv for work to be stolen.
+    std::atomic<int> m_sleeping{0};
+
+    //! The temporary evaluation result when work stealing.
+    std::atomic<bool> m_all_ok{true};
+
+    /**
+     * Move a batch of checks into vChecks: from the back of the thread's own
+     * deque if possible, otherwise stolen from the front of another deque.
+     * Batches are half of the deque, capped to nBatchSize, so that the
+     * remaining work is spread out as it runs low.
+     */
+    bool TakeWork(size_t self, std::vector<T>& vChecks)
+    {
+        for (size_t i = 0; i < m_deques.size(); ++i) {
+            WorkDeque& deque{*m_deques[(self + i) % m_deques.size()]};
+            LOCK(deque.m_mutex);
+            auto& checks{deque.m_checks};
+            if (checks.empty()) continue;
+            const size_t now{std::max<size_t>(1, std::min<size_t>(nBatchSize, checks.size() / 2))};
+            if (i == 0) {
+                auto start_it = checks.end() - now;
+                vChecks.assign(std::make_move_iterator(start_it), std::make_move_iterator(checks.end()));
+                checks.erase(start_it, checks.end());
+            } else {
+                auto end_it = checks.begin() + now;
+                vChecks.assign(std::make_move_iterator(checks.begin()), std::make_move_iterator(end_it));
+                checks.erase(checks.begin(), end_it);
+            }
+            m_queued.fetch_sub(now);
+            return true;
+        }
+        return false;
+    }
+
+    /** Execute a batch taken by TakeWork() and wake the master if it was the last one. */
+    void RunChecks(std::vector<T>& vChecks) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        const unsigned int now = vChecks.size();
+        // Skip the work if another batch has already failed.
+        bool fOk = m_all_ok.load(std::memory_order_relaxed);
+        for (T& check : vChecks)
+            if (fOk)
+                fOk = check();
+        // Destroy the checks before reporting completion, so that the master
+        // does not return while they are still being cleaned up.
+        vChecks.clear();
+        if (!fOk) m_all_ok.store(false, std::memory_order_relaxed);
+        if (m_pending.fetch_sub(now) == now) {
+            LOCK(m_mutex);
+            m_master_cv.notify_one();
+        }
+    }
+
+    /** Worker thread loop when work stealing. */
+    void WorkerLoop(size_t self) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::vector<T> vChecks;
+        vChecks.reserve(nBatchSize);
+        while (true) {
+            if (TakeWork(self, vChecks)) {
+                RunChecks(vChecks);
+                continue;
+            }
+            WAIT_LOCK(m_mutex, lock);
+            // Announce ourselves before looking at m_queued, so that Add()
+            // either sees a sleeper to notify or we see its work.
+            m_sleeping++;
+            while (m_queued.load() == 0 && !m_request_stop) {
+                m_worker_cv.wait(lock);
+            }
+            m_sleeping--;
+            if (m_request_stop) return;
+        }
+    }
+
+    /** Master side of Wait() when work stealing. */
+    bool MasterLoop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::vector<T> vChecks;
+        vChecks.reserve(nBatchSize);
+        while (true) {
+            if (TakeWork(0, vChecks)) {
+                RunChecks(vChecks);
+                continue;
+            }
+            WAIT_LOCK(m_mutex, lock);
+            // Only the master adds work, so once the deques are empty we just
+            // wait for the batches still held by workers to finish.
+            while (m_pending.load() != 0 && m_queued.load() == 0 && !m_request_stop) {
+                m_master_cv.wait(lock);
+            }
+            if (m_request_stop) return false;
+            if (m_pending.load() == 0) break;
+        }
+        // reset the status for new work later, and return the current status
+        return m_all_ok.exchange(true);
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
@@ -127,14 +257,24 @@ public:
     Mutex m_control_mutex;
 
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int batch_size, int worker_threads_num)
-        : nBatchSize(batch_size)
+    explicit CCheckQueue(unsigned int batch_size, int worker_threads_num, bool work_stealing = false)
+        : nBatchSize(batch_size), m_work_stealing(work_stealing)
     {
+        if (m_work_stealing) {
+            m_deques.reserve(worker_threads_num + 1);
+            for (int n = 0; n <= worker_threads_num; ++n) {
+                m_deques.push_back(std::make_unique<WorkDeque>());
+            }
+        }
         m_worker_threads.reserve(worker_threads_num);
         for (int n = 0; n < worker_threads_num; ++n) {
             m_worker_threads.emplace_back([this, n]() {
                 util::ThreadRename(strprintf("scriptch.%i", n));
-                Loop(false /* worker thread */);
+                if (m_work_stealing) {
+                    WorkerLoop(n + 1);
+                } else {
+                    Loop(false /* worker thread */);
+                }
             });
         }
     }
@@ -149,6 +289,7 @@ public:
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
+        if (m_work_stealing) return MasterLoop();
         return Loop(true /* master thread */);
     }
 
@@ -159,6 +300,29 @@ public:
             return;
         }
 
+        if (m_work_stealing) {
+            const unsigned int count = vChecks.size();
+            // Count the checks before publishing them, so that the counters
+            // never drop below the number of checks actually outstanding.
+            m_pending += count;
+            m_queued += count;
+            {
+                WorkDeque& deque{*m_deques[m_next_deque]};
+                m_next_deque = (m_next_deque + 1) % m_deques.size();
+                LOCK(deque.m_mutex);
+                deque.m_checks.insert(deque.m_checks.end(), std::make_move_iterator(vChecks.begin()), std::make_move_iterator(vChecks.end()));
+            }
+            if (m_sleeping.load() > 0) {
+                LOCK(m_mutex);
+                if (count == 1) {
+                    m_worker_cv.notify_one();
+                } else {
+                    m_worker_cv.notify_all();
+                }
+            }
+            return;
+        }
+
         {
             LOCK(m_mutex);
             queue.insert(queue.end(), std::make_move_iterator(vChecks.begin()), std::make_move_iterator(vChecks.end()));
@@ -12,34 +12,158 @@
 bool CCoinsView::GetCoin(const COutPoint &outpoint, Coin &coin) const { return false; }
 uint256 CCoinsView::GetBestBlock() const { return uint256(); }
 std::vector<uint256> CCoinsView::GetHeadBlocks() const { return std::vector<uint256>(); }
-bool CCoinsView::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase) { return false; }
+bool CCoinsView::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashBlock) { return false; }
 std::unique_ptr<CCoinsViewCursor> CCoinsView::Cursor() const { return nullptr; }
 
+std::vector<std::unique_ptr<CCoinsViewCursor>> CCoinsView::Cursors(size_t num_ranges) const
+{
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    if (auto cursor{Cursor()}) cursors.push_back(std::move(cursor));
+    return cursors;
+}
+
 bool CCoinsView::HaveCoin(const COutPoint &outpoint) const
 {
     Coin coin;
     return GetCoin(outpoint, coin);
 }
 
+void CompactCoin::SetScript(const CScript& script)
+{
+    CompressedScript compressed;
+    int witness_version;
+    std::vector<unsigned char> program;
+    // Uncompressed public keys are left out, as decompressing them on every
+    // access would be expensive.
+    if (CompressScript(script, compressed) && compressed[0] < 0x04) {
+        m_type = compressed[0];
+        m_size = compressed.size() - 1;
+        std::memcpy(m_data, compressed.data() + 1, m_size);
+    } else if (script.size() == 34 && script.IsWitnessProgram(witness_version, program) && witness_version <= 1) {
+        m_type = witness_version == 0 ? WITNESS_V0_SCRIPTHASH : WITNESS_V1_TAPROOT;
+        m_size = program.size();
+        std::memcpy(m_data, program.data(), m_size);
+    } else if (script.size() <= MAX_INLINE_SIZE) {
+        m_type = RAW;
+        m_size = script.size();
+        std::memcpy(m_data, script.data(), m_size);
+    } else {
+        m_type = HEAP;
+        m_size = 0;
+        CScript* heap_script{new CScript(script)};
+        std::memcpy(m_data, &heap_script, sizeof(heap_script));
+    }
+}
+
+void CompactCoin::FreeScript() noexcept
+{
+    if (m_type == HEAP) delete HeapScript();
+    m_type = RAW;
+    m_size = 0;
+}
+
+CompactCoin& CompactCoin::operator=(const CompactCoin& other)
+{
+    if (this == &other) return *this;
+    FreeScript();
+    m_value = other.m_value;
+    m_code = other.m_code;
+    m_type = other.m_type;
+    m_size = other.m_size;
+    if (m_type == HEAP) {
+        CScript* heap_script{new CScript(*other.HeapScript())};
+        std::memcpy(m_data, &heap_script, sizeof(heap_script));
+    } else {
+        std::memcpy(m_data, other.m_data, m_size);
+    }
+    return *this;
+}
+
+CompactCoin& CompactCoin::operator=(CompactCoin&& other) noexcept
+{
+    if (this == &other) return *this;
+    FreeScript();
+    m_value = other.m_value;
+    m_code = other.m_code;
+    m_type = other.m_type;
+    m_size = other.m_size;
+    std::memcpy(m_data, other.m_data, m_type == HEAP ? sizeof(CScript*) : m_size);
+    // The heap script, if any, is now owned by this coin.
+    other.m_type = RAW;
+    other.Clear();
+    return *this;
+}
+
+CompactCoin& CompactCoin::operator=(const Coin& coin)
+{
+    FreeScript();
+    m_value = coin.out.nValue;
+    m_code = coin.nHeight * uint32_t{2} + coin.fCoinBase;
+    SetScript(coin.out.scriptPubKey);
+    return *this;
+}
+
+CScript CompactCoin::GetScript() const
+{
+    CScript script;
+    switch (m_type) {
+    case RAW:
+        script.assign(m_data, m_data + m_size);
+        break;
+    case HEAP:
+        script = *HeapScript();
+        break;
+    case WITNESS_V0_SCRIPTHASH:
+    case WITNESS_V1_TAPROOT:
+        script.resize(2 + m_size);
+        script[0] = m_type == WITNESS_V0_SCRIPTHASH ? OP_0 : OP_1;
+        script[1] = m_size;
+        std::memcpy(&script[2], m_data, m_size);
+        break;
+    default:
+        const bool ok{DecompressScript(script, m_type, CompressedScript(m_data, m_data + m_size))};
+        Assume(ok);
+    }
+    return script;
+}
+
+Coin CompactCoin::ToCoin() const
+{
+    Coin coin;
+    if (IsSpent()) return coin;
+    coin.out.nValue = m_value;
+    coin.out.scriptPubKey = GetScript();
+    coin.fCoinBase = IsCoinBase();
+    coin.nHeight = GetHeight();
+    return coin;
+}
+
 CCoinsViewBacked::CCoinsViewBacked(CCoinsView *viewIn) : base(viewIn) { }
 bool CCoinsViewBacked::GetCoin(const COutPoint &outpoint, Coin &coin) const { return base->GetCoin(outpoint, coin); }
 bool CCoinsViewBacked::HaveCoin(const COutPoint &outpoint) const { return base->HaveCoin(outpoint); }
 uint256 CCoinsViewBacked::GetBestBlock() const { return base->GetBestBlock(); }
 std::vector<uint256> CCoinsViewBacked::GetHeadBlocks() const { return base->GetHeadBlocks(); }
 void CCoinsViewBacked::SetBackend(CCoinsView &viewIn) { base = &viewIn; }
-bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase) { return base->BatchWrite(mapCoins, hashBlock, erase); }
+bool CCoinsViewBacked::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashBlock) { return base->BatchWrite(cursor, hashBlock); }
 std::unique_ptr<CCoinsViewCursor> CCoinsViewBacked::Cursor() const { return base->Cursor(); }
+std::vector<std::unique_ptr<CCoinsViewCursor>> CCoinsViewBacked::Cursors(size_t num_ranges) const { return base->Cursors(num_ranges); }
 size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
 CCoinsViewCache::CCoinsViewCache(CCoinsView* baseIn, bool deterministic) :
     CCoinsViewBacked(baseIn), m_deterministic(deterministic),
     cacheCoins(0, SaltedOutpointHasher(/*deterministic=*/deterministic), CCoinsMap::key_equal{}, &m_cache_coins_memory_resource)
-{}
+{
+    m_sentinel.second.SelfRef(m_sentinel);
+}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
     return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
 }
 
+size_t CCoinsViewCache::LiveMemoryUsage() const {
+    return DynamicMemoryUsage() - (cacheCoins.peak_size() - cacheCoins.size()) * sizeof(CoinsCachePair);
+}
+
 CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const {
     CCoinsMap::iterator it = cacheCoins.find(outpoint);
     if (it != cacheCoins.end())
@@ -47,11 +171,11 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
     Coin tmp;
     if (!base->GetCoin(outpoint, tmp))
         return cacheCoins.end();
-    CCoinsMap::iterator ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(tmp))).first;
+    CCoinsMap::iterator ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(tmp)).first;
     if (ret->second.coin.IsSpent()) {
         // The parent only has an empty entry for this outpoint; we can consider our
         // version as fresh.
-        ret->second.flags = CCoinsCacheEntry::FRESH;
+        CCoinsCacheEntry::SetFresh(*ret, m_sentinel);
     }
     cachedCoinsUsage += ret->second.coin.DynamicMemoryUsage();
     return ret;
@@ -60,7 +184,7 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
 bool CCoinsViewCache::GetCoin(const COutPoint &outpoint, Coin &coin) const {
     CCoinsMap::const_iterator it = FetchCoin(outpoint);
     if (it != cacheCoins.end()) {
-        coin = it->second.coin;
+        coin = it->second.coin.ToCoin();
         return !coin.IsSpent();
     }
     return false;
@@ -93,25 +217,36 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
         //
         // If the coin doesn't exist in the current cache, or is spent but not
         // DIRTY, then it can be marked FRESH.
-        fresh = !(it->second.flags & CCoinsCacheEntry::DIRTY);
+        fresh = !it->second.IsDirty();
     }
-    it->second.coin = std::move(coin);
-    it->second.flags |= CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0);
+    it->second.coin = coin;
+    CCoinsCacheEntry::SetDirty(*it, m_sentinel);
+    if (fresh) CCoinsCacheEntry::SetFresh(*it, m_sentinel);
     cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
     TRACE5(utxocache, add,
            outpoint.hash.data(),
            (uint32_t)outpoint.n,
-           (uint32_t)it->second.coin.nHeight,
-           (int64_t)it->second.coin.out.nValue,
+           (uint32_t)it->second.coin.GetHeight(),
+           (int64_t)it->second.coin.GetValue(),
            (bool)it->second.coin.IsCoinBase());
 }
 
 void CCoinsViewCache::EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coin) {
-    cachedCoinsUsage += coin.DynamicMemoryUsage();
-    cacheCoins.emplace(
+    auto [it, inserted] = cacheCoins.emplace(
         std::piecewise_construct,
         std::forward_as_tuple(std::move(outpoint)),
-        std::forward_as_tuple(std::move(coin), CCoinsCacheEntry::DIRTY));
+        std::forward_as_tuple(coin));
+    if (inserted) {
+        cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+        CCoinsCacheEntry::SetDirty(*it, m_sentinel);
+    }
+}
+
+bool CCoinsViewCache::EmplaceFetchedCoin(const COutPoint& outpoint, Coin&& coin) {
+    assert(!coin.IsSpent());
+    const auto [it, inserted]{cacheCoins.try_emplace(outpoint, coin)};
+    if (inserted) cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    return inserted;
 }
 
 void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, bool check_for_overwrite) {
@@ -132,24 +267,24 @@ bool CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin* moveout) {
     TRACE5(utxocache, spent,
            outpoint.hash.data(),
            (uint32_t)outpoint.n,
-           (uint32_t)it->second.coin.nHeight,
-           (int64_t)it->second.coin.out.nValue,
+           (uint32_t)it->second.coin.GetHeight(),
+           (int64_t)it->second.coin.GetValue(),
            (bool)it->second.coin.IsCoinBase());
     if (moveout) {
-        *moveout = std::move(it->second.coin);
+        *moveout = it->second.coin.ToCoin();
     }
-    if (it->second.flags & CCoinsCacheEntry::FRESH) {
+    if (it->second.IsFresh()) {
         cacheCoins.erase(it);
     } else {
-        it->second.flags |= CCoinsCacheEntry::DIRTY;
+        CCoinsCacheEntry::SetDirty(*it, m_sentinel);
         it->second.coin.Clear();
     }
     return true;
 }
 
-static const Coin coinEmpty;
+static const CompactCoin coinEmpty{};
 
-const Coin& CCoinsViewCache::AccessCoin(const COutPoint &outpoint) const {
+const CompactCoin& CCoinsViewCache::AccessCoin(const COutPoint &outpoint) const {
     CCoinsMap::const_iterator it = FetchCoin(outpoint);
     if (it == cacheCoins.end()) {
         return coinEmpty;
@@ -178,42 +313,40 @@ void CCoinsViewCache::SetBestBlock(const uint256 &hashBlockIn) {
     hashBlock = hashBlockIn;
 }
 
-bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn, bool erase) {
-    for (CCoinsMap::iterator it = mapCoins.begin();
-            it != mapCoins.end();
-            it = erase ? mapCoins.erase(it) : std::next(it)) {
+bool CCoinsViewCache::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashBlockIn) {
+    for (auto it{cursor.Begin()}; it != cursor.End(); it = cursor.NextAndMaybeErase(*it)) {
         // Ignore non-dirty entries (optimization).
-        if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
+        if (!it->second.IsDirty()) {
             continue;
         }
         CCoinsMap::iterator itUs = cacheCoins.find(it->first);
         if (itUs == cacheCoins.end()) {
             // The parent cache does not have an entry, while the child cache does.
             // We can ignore it if it's both spent and FRESH in the child
-            if (!(it->second.flags & CCoinsCacheEntry::FRESH && it->second.coin.IsSpent())) {
+            if (!(it->second.IsFresh() && it->second.coin.IsSpent())) {
                 // Create the coin in the parent cache, move the data up
                 // and mark it as dirty.
-                CCoinsCacheEntry& entry = cacheCoins[it->first];
-                if (erase) {
-                    // The `move` call here is purely an optimization; we rely on the
-                    // `mapCoins.erase` call in the `for` expression to actually remove
-                    // the entry from the child map.
+                itUs = cacheCoins.try_emplace(it->first).first;
+                CCoinsCacheEntry& entry{itUs->second};
+                if (cursor.WillErase(*it)) {
+                    // Since this entry will be erased,
+                    // we can move the coin into us instead of copying it
                     entry.coin = std::move(it->second.coin);
                 } else {
                     entry.coin = it->second.coin;
                 }
                 cachedCoinsUsage += entry.coin.DynamicMemoryUsage();
-                entry.flags = CCoinsCacheEntry::DIRTY;
+                CCoinsCacheEntry::SetDirty(*itUs, m_sentinel);
                 // We can mark it FRESH in the parent if it was FRESH in the child
                 // Otherwise it might have just been flushed from the parent's cache
                 // and already exist in the grandparent
-                if (it->second.flags & CCoinsCacheEntry::FRESH) {
-                    entry.flags |= CCoinsCacheEntry::FRESH;
+                if (it->second.IsFresh()) {
+                    CCoinsCacheEntry::SetFresh(*itUs, m_sentinel);
                 }
             }
         } else {
             // Found the entry in the parent cache
-            if ((it->second.flags & CCoinsCacheEntry::FRESH) && !itUs->second.coin.IsSpent()) {
+            if (it->second.IsFresh() && !itUs->second.coin.IsSpent()) {
                 // The coin was marked FRESH in the child cache, but the coin
                 // exists in the parent cache. If this ever happens, it means
                 // the FRESH flag was misapplied and there is a logic error in
@@ -221,7 +354,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
                 throw std::logic_error("FRESH flag misapplied to coin that exists in parent cache");
             }
 
-            if ((itUs->second.flags & CCoinsCacheEntry::FRESH) && it->second.coin.IsSpent()) {
+            if (itUs->second.IsFresh() && it->second.coin.IsSpent()) {
                 // The grandparent cache does not have an entry, and the coin
                 // has been spent. We can just delete it from the parent cache.
                 cachedCoinsUsage -= itUs->second.coin.DynamicMemoryUsage();
@@ -229,16 +362,15 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
             } else {
                 // A normal modification.
                 cachedCoinsUsage -= itUs->second.coin.DynamicMemoryUsage();
-                if (erase) {
-                    // The `move` call here is purely an optimization; we rely on the
-                    // `mapCoins.erase` call in the `for` expression to actually remove
-                    // the entry from the child map.
+                if (cursor.WillErase(*it)) {
+                    // Since this entry will be erased,
+                    // we can move the coin into us instead of copying it
                     itUs->second.coin = std::move(it->second.coin);
                 } else {
                     itUs->second.coin = it->second.coin;
                 }
                 cachedCoinsUsage += itUs->second.coin.DynamicMemoryUsage();
-                itUs->second.flags |= CCoinsCacheEntry::DIRTY;
+                CCoinsCacheEntry::SetDirty(*itUs, m_sentinel);
                 // NOTE: It isn't safe to mark the coin as FRESH in the parent
                 // cache. If it already existed and was spent in the parent
                 // cache then marking it FRESH would prevent that spentness
@@ -251,12 +383,10 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
 }
 
 bool CCoinsViewCache::Flush() {
-    bool fOk = base->BatchWrite(cacheCoins, hashBlock, /*erase=*/true);
+    auto cursor{CoinsViewCacheCursor(cachedCoinsUsage, m_sentinel, cacheCoins, /*will_erase=*/true)};
+    bool fOk = base->BatchWrite(cursor, hashBlock);
     if (fOk) {
-        if (!cacheCoins.empty()) {
-            /* BatchWrite must erase all cacheCoins elements when erase=true. */
-            throw std::logic_error("Not all cached coins were erased");
-        }
+        cacheCoins.clear();
         ReallocateCache();
     }
     cachedCoinsUsage = 0;
@@ -265,31 +395,68 @@ bool CCoinsViewCache::Flush() {
 
 bool CCoinsViewCache::Sync()
 {
-    bool fOk = base->BatchWrite(cacheCoins, hashBlock, /*erase=*/false);
-    // Instead of clearing `cacheCoins` as we would in Flush(), just clear the
-    // FRESH/DIRTY flags of any coin that isn't spent.
-    for (auto it = cacheCoins.begin(); it != cacheCoins.end(); ) {
-        if (it->second.coin.IsSpent()) {
+    // Only the flagged entries are visited: spent ones are erased, and the
+    // rest are unflagged and stay cached.
+    auto cursor{CoinsViewCacheCursor(cachedCoinsUsage, m_sentinel, cacheCoins, /*will_erase=*/false)};
+    bool fOk = base->BatchWrite(cursor, hashBlock);
+    if (m_sentinel.second.Next() != &m_sentinel) {
+        /* BatchWrite must clear flags of all entries */
+        throw std::logic_error("Not all unspent flagged entries were cleared");
+    }
+    return fOk;
+}
+
+size_t CCoinsViewCache::EvictClean(size_t target_usage, bool compact)
+{
+    size_t evicted{0};
+    // Erasing does not rebuild the index, so slots stay valid while evicting.
+    const auto evict_before{[&](CCoinsMap::iterator it, size_t stop_index) {
+        while (it != cacheCoins.end() && cacheCoins.index_of(it) < stop_index && LiveMemoryUsage() > target_usage) {
+            if (it->second.GetFlags()) {
+                ++it;
+                continue;
+            }
             cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
             it = cacheCoins.erase(it);
-        } else {
-            it->second.flags = 0;
-            ++it;
+            ++evicted;
         }
+        return it;
+    }};
+    // Continue where the previous call stopped, and wrap around, so that the
+    // entries at the start of the index are not the first to go every time.
+    const size_t start_index{m_evict_index};
+    auto it{evict_before(cacheCoins.begin_at(start_index), cacheCoins.bucket_count())};
+    if (it == cacheCoins.end()) it = evict_before(cacheCoins.begin(), start_index);
+    m_evict_index = cacheCoins.index_of(it);
+
+    // The pool keeps the nodes of erased entries for reuse, and entries are
+    // erased in hash order, so hardly any of its chunks ends up unused. Move
+    // the remaining entries to a new pool to release the old one. Flagged
+    // entries are linked to each other, so they cannot be moved.
+    if (compact && m_sentinel.second.Next() == &m_sentinel &&
+        cacheCoins.peak_size() - cacheCoins.size() >= cacheCoins.size()) {
+        std::vector<std::pair<COutPoint, CompactCoin>> coins;
+        coins.reserve(cacheCoins.size());
+        for (auto& [outpoint, entry] : cacheCoins) coins.emplace_back(outpoint, std::move(entry.coin));
+        cacheCoins.clear();
+        ReallocateCache();
+        cacheCoins.reserve(coins.size());
+        for (auto& [outpoint, coin] : coins) cacheCoins.try_emplace(outpoint).first->second.coin = std::move(coin);
+        m_evict_index = 0;
     }
-    return fOk;
+    return evicted;
 }
 
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
-    if (it != cacheCoins.end() && it->second.flags == 0) {
+    if (it != cacheCoins.end() && !it->second.GetFlags()) {
         cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
         TRACE5(utxocache, uncache,
                hash.hash.data(),
                (uint32_t)hash.n,
-               (uint32_t)it->second.coin.nHeight,
-               (int64_t)it->second.coin.out.nValue,
+               (uint32_t)it->second.coin.GetHeight(),
+               (int64_t)it->second.coin.GetValue(),
                (bool)it->second.coin.IsCoinBase());
         cacheCoins.erase(it);
     }
@@ -324,28 +491,44 @@ void CCoinsViewCache::ReallocateCache()
 void CCoinsViewCache::SanityCheck() const
 {
     size_t recomputed_usage = 0;
+    size_t count_flagged = 0;
     for (const auto& [_, entry] : cacheCoins) {
         unsigned attr = 0;
-        if (entry.flags & CCoinsCacheEntry::DIRTY) attr |= 1;
-        if (entry.flags & CCoinsCacheEntry::FRESH) attr |= 2;
+        if (entry.IsDirty()) attr |= 1;
+        if (entry.IsFresh()) attr |= 2;
         if (entry.coin.IsSpent()) attr |= 4;
         // Only 5 combinations are possible.
         assert(attr != 2 && attr != 4 && attr != 7);
 
         // Recompute cachedCoinsUsage.
         recomputed_usage += entry.coin.DynamicMemoryUsage();
+
+        // Count the number of entries we expect in the linked list.
+        if (entry.IsDirty() || entry.IsFresh()) ++count_flagged;
+    }
+    // Iterate over the linked list of flagged entries.
+    size_t count_linked = 0;
+    for (auto it = m_sentinel.second.Next(); it != &m_sentinel; it = it->second.Next()) {
+        // Verify linked list integrity.
+        assert(it->second.Next()->second.Prev() == it);
+        assert(it->second.Prev()->second.Next() == it);
+        // Verify they are actually flagged.
+        assert(it->second.IsDirty() || it->second.IsFresh());
+        // Count the number of entries actually in the list.
+        ++count_linked;
     }
+    assert(count_linked == count_flagged);
     assert(recomputed_usage == cachedCoinsUsage);
 }
 
 static const size_t MIN_TRANSACTION_OUTPUT_WEIGHT = WITNESS_SCALE_FACTOR * ::GetSerializeSize(CTxOut());
 static const size_t MAX_OUTPUTS_PER_BLOCK = MAX_BLOCK_WEIGHT / MIN_TRANSACTION_OUTPUT_WEIGHT;
 
-const Coin& AccessByTxid(const CCoinsViewCache& view, const Txid& txid)
+const CompactCoin& AccessByTxid(const CCoinsViewCache& view, const Txid& txid)
 {
     COutPoint iter(txid, 0);
     while (iter.n < MAX_OUTPUTS_PER_BLOCK) {
-        const Coin& alternate = view.AccessCoin(iter);
+        const CompactCoin& alternate = view.AccessCoin(iter);
         if (!alternate.IsSpent()) return alternate;
         ++iter.n;
     }
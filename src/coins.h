@@ -6,20 +6,23 @@
 #ifndef BITCOIN_COINS_H
 #define BITCOIN_COINS_H
 
+#include <attributes.h>
 #include <compressor.h>
 #include <core_memusage.h>
+#include <flatnodemap.h>
 #include <memusage.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
 #include <support/allocators/pool.h>
 #include <uint256.h>
+#include <util/check.h>
 #include <util/hasher.h>
 
 #include <assert.h>
 #include <stdint.h>
 
+#include <cstring>
 #include <functional>
-#include <unordered_map>
 
 /**
  * A UTXO entry.
@@ -74,7 +77,7 @@ public:
         ::Unserialize(s, Using<TxOutCompression>(out));
     }
 
-    /** Either this coin never existed (see e.g. coinEmpty in coins.cpp), or it
+    /** Either this coin never existed (see e.g. CCoinsViewCache::AccessCoin()), or it
       * did exist and has been spent.
       */
     bool IsSpent() const {
@@ -86,6 +89,91 @@ public:
     }
 };
 
+/**
+ * In-memory representation of a Coin, used by the coins cache.
+ *
+ * A Coin's scriptPubKey is a prevector with 28 bytes of inline storage, so
+ * every cached P2WSH, P2TR and P2PK coin also pays for a heap allocation.
+ * CompactCoin stores the standard script templates of ScriptCompression
+ * (P2PKH, P2SH and P2PK with a compressed key), 32-byte witness v0 and v1
+ * programs, and any other script of up to 33 bytes inline, in the footprint
+ * of a Coin. Only other scripts are allocated on the heap.
+ *
+ * The value, height and coinbase flag are read directly. The script is
+ * reconstructed by GetScript(), and the whole Coin by ToCoin().
+ */
+class CompactCoin
+{
+private:
+    //! Script types. Values below ScriptCompression::nSpecialScripts are
+    //! the special script types of ScriptCompression.
+    enum Type : uint8_t {
+        WITNESS_V0_SCRIPTHASH = ScriptCompression::nSpecialScripts,
+        WITNESS_V1_TAPROOT,
+        //! m_size bytes of script in m_data.
+        RAW,
+        //! A CScript*, stored in m_data.
+        HEAP,
+    };
+    static constexpr size_t MAX_INLINE_SIZE{33};
+    //! ScriptCompression special script type of P2SH scripts.
+    static constexpr uint8_t P2SH{0x01};
+
+    //! Value of the output, -1 if spent (like CTxOut::SetNull()).
+    CAmount m_value{-1};
+    //! Height * 2 + coinbase flag, as in the serialized Coin.
+    uint32_t m_code{0};
+    uint8_t m_type{RAW};
+    uint8_t m_size{0};
+    unsigned char m_data[MAX_INLINE_SIZE];
+
+    CScript* HeapScript() const noexcept
+    {
+        CScript* script;
+        std::memcpy(&script, m_data, sizeof(script));
+        return script;
+    }
+    void SetScript(const CScript& script);
+    void FreeScript() noexcept;
+
+public:
+    CompactCoin() noexcept = default;
+    explicit CompactCoin(const Coin& coin) { *this = coin; }
+    CompactCoin(const CompactCoin& other) { *this = other; }
+    CompactCoin(CompactCoin&& other) noexcept { *this = std::move(other); }
+    CompactCoin& operator=(const CompactCoin& other);
+    CompactCoin& operator=(CompactCoin&& other) noexcept;
+    CompactCoin& operator=(const Coin& coin);
+    ~CompactCoin() { FreeScript(); }
+
+    //! Reconstruct the full Coin.
+    Coin ToCoin() const;
+    CScript GetScript() const;
+    CTxOut GetTxOut() const { return CTxOut{m_value, GetScript()}; }
+
+    void Clear() noexcept
+    {
+        FreeScript();
+        m_value = -1;
+        m_code = 0;
+        m_type = RAW;
+        m_size = 0;
+    }
+
+    bool IsSpent() const noexcept { return m_value == -1; }
+    bool IsCoinBase() const noexcept { return m_code & 1; }
+    uint32_t GetHeight() const noexcept { return m_code >> 1; }
+    CAmount GetValue() const noexcept { return m_value; }
+    //! Whether the script is P2SH, without reconstructing it.
+    bool IsPayToScriptHash() const noexcept { return m_type == P2SH; }
+
+    size_t DynamicMemoryUsage() const
+    {
+        if (m_type != HEAP) return 0;
+        return memusage::MallocUsage(sizeof(CScript)) + memusage::DynamicUsage(*HeapScript());
+    }
+};
+
 /**
  * A Coin in one level of the coins database caching hierarchy.
  *
@@ -101,10 +189,45 @@ public:
  * - spent, FRESH, not DIRTY (e.g. a spent coin fetched from the parent cache)
  * - spent, not FRESH, DIRTY (e.g. a coin is spent and spentness needs to be flushed to the parent)
  */
+struct CCoinsCacheEntry;
+using CoinsCachePair = std::pair<const COutPoint, CCoinsCacheEntry>;
+
 struct CCoinsCacheEntry
 {
-    Coin coin; // The actual cached data.
-    unsigned char flags;
+private:
+    /**
+     * These are used to create a doubly linked list of flagged entries.
+     * They are set in SetDirty, SetFresh, and unset in SetClean.
+     * A flagged entry is any entry that is either DIRTY, FRESH, or both.
+     *
+     * DIRTY entries are tracked so that only modified entries are passed to
+     * the parent cache for batch writing, instead of the parent scanning the
+     * whole cache for them. This also lets Sync() keep clean entries cached
+     * while only touching the modified ones.
+     */
+    CoinsCachePair* m_prev{nullptr};
+    CoinsCachePair* m_next{nullptr};
+    uint8_t m_flags{0};
+
+    //! Adding a flag also requires a self reference to the pair that contains
+    //! this entry in the CCoinsCache map and a reference to the sentinel of the
+    //! flagged pair linked list.
+    static void AddFlags(uint8_t flags, CoinsCachePair& pair, CoinsCachePair& sentinel) noexcept
+    {
+        Assume(flags & (DIRTY | FRESH));
+        if (!pair.second.m_flags) {
+            Assume(!pair.second.m_prev && !pair.second.m_next);
+            pair.second.m_prev = sentinel.second.m_prev;
+            pair.second.m_next = &sentinel;
+            sentinel.second.m_prev = &pair;
+            pair.second.m_prev->second.m_next = &pair;
+        }
+        Assume(pair.second.m_prev && pair.second.m_next);
+        pair.second.m_flags |= flags;
+    }
+
+public:
+    CompactCoin coin; // The actual cached data.
 
     enum Flags {
         /**
@@ -127,28 +250,121 @@ struct CCoinsCacheEntry
         FRESH = (1 << 1),
     };
 
-    CCoinsCacheEntry() : flags(0) {}
-    explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
-    CCoinsCacheEntry(Coin&& coin_, unsigned char flag) : coin(std::move(coin_)), flags(flag) {}
+    CCoinsCacheEntry() noexcept = default;
+    explicit CCoinsCacheEntry(const Coin& coin_) : coin(coin_) {}
+    ~CCoinsCacheEntry()
+    {
+        SetClean();
+    }
+
+    static void SetDirty(CoinsCachePair& pair, CoinsCachePair& sentinel) noexcept { AddFlags(DIRTY, pair, sentinel); }
+    static void SetFresh(CoinsCachePair& pair, CoinsCachePair& sentinel) noexcept { AddFlags(FRESH, pair, sentinel); }
+
+    void SetClean() noexcept
+    {
+        if (!m_flags) return;
+        m_next->second.m_prev = m_prev;
+        m_prev->second.m_next = m_next;
+        m_flags = 0;
+        m_prev = m_next = nullptr;
+    }
+    bool IsDirty() const noexcept { return m_flags & DIRTY; }
+    bool IsFresh() const noexcept { return m_flags & FRESH; }
+    uint8_t GetFlags() const noexcept { return m_flags; }
+
+    //! Only call Next when this entry is DIRTY, FRESH, or both
+    CoinsCachePair* Next() const noexcept
+    {
+        Assume(m_flags);
+        return m_next;
+    }
+
+    //! Only call Prev when this entry is DIRTY, FRESH, or both
+    CoinsCachePair* Prev() const noexcept
+    {
+        Assume(m_flags);
+        return m_prev;
+    }
+
+    //! Only use this for initializing the linked list sentinel
+    void SelfRef(CoinsCachePair& pair) noexcept
+    {
+        Assume(&pair.second == this);
+        m_prev = &pair;
+        m_next = &pair;
+        // Set sentinel to DIRTY so we can call Next on it
+        m_flags = DIRTY;
+    }
 };
 
 /**
- * PoolAllocator's MAX_BLOCK_SIZE_BYTES parameter here uses sizeof the data, and adds the size
- * of 4 pointers. We do not know the exact node size used in the std::unordered_node implementation
- * because it is implementation defined. Most implementations have an overhead of 1 or 2 pointers,
- * so nodes can be connected in a linked list, and in some cases the hash value is stored as well.
- * Using an additional sizeof(void*)*4 for MAX_BLOCK_SIZE_BYTES should thus be sufficient so that
- * all implementations can allocate the nodes from the PoolAllocator.
+ * Nodes are allocated one at a time from the PoolResource, so MAX_BLOCK_SIZE_BYTES is exactly
+ * the size of an element. Unlike std::unordered_map, FlatNodeMap keeps no per-node link or hash,
+ * and finds elements through an open-addressing index of 9 bytes per slot.
  */
-using CCoinsMap = std::unordered_map<COutPoint,
-                                     CCoinsCacheEntry,
-                                     SaltedOutpointHasher,
-                                     std::equal_to<COutPoint>,
-                                     PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
-                                                   sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4>>;
+using CCoinsMap = FlatNodeMap<COutPoint,
+                              CCoinsCacheEntry,
+                              SaltedOutpointHasher,
+                              std::equal_to<COutPoint>,
+                              sizeof(CoinsCachePair)>;
 
 using CCoinsMapMemoryResource = CCoinsMap::allocator_type::ResourceType;
 
+/** Cursor for iterating over the linked list of flagged entries in CCoinsViewCache.
+ *
+ * This is a helper struct to encapsulate the diverging logic between a non-erasing
+ * CCoinsViewCache::Sync and an erasing CCoinsViewCache::Flush. This allows the receiver
+ * of CCoinsView::BatchWrite to iterate through the flagged entries without knowing
+ * the caller's intent.
+ *
+ * However, the receiver can still call CoinsViewCacheCursor::WillErase to see if the
+ * caller will erase the entry after BatchWrite returns. If so, the receiver can
+ * perform optimizations such as moving the coin out of the CCoinsCacheEntry instead
+ * of copying it.
+ */
+struct CoinsViewCacheCursor
+{
+    //! If will_erase is not set, iterating through the cursor will erase spent coins from the map,
+    //! and other coins will be unflagged (removing them from the linked list).
+    //! If will_erase is set, the underlying map and linked list will not be modified,
+    //! as the caller is expected to wipe the entire map anyway.
+    //! This is an optimization compared to erasing all entries as the cursor iterates them when will_erase is set.
+    //! Calling CCoinsMap::clear() afterwards is faster because a CoinsCachePair cannot be coerced back into a
+    //! CCoinsMap::iterator to be erased, and must therefore be looked up again by key in the CCoinsMap before being erased.
+    CoinsViewCacheCursor(size_t& usage LIFETIMEBOUND,
+                        CoinsCachePair& sentinel LIFETIMEBOUND,
+                        CCoinsMap& map LIFETIMEBOUND,
+                        bool will_erase) noexcept
+        : m_usage(usage), m_sentinel(sentinel), m_map(map), m_will_erase(will_erase) {}
+
+    inline CoinsCachePair* Begin() const noexcept { return m_sentinel.second.Next(); }
+    inline CoinsCachePair* End() const noexcept { return &m_sentinel; }
+
+    //! Return the next entry after current, possibly erasing current
+    inline CoinsCachePair* NextAndMaybeErase(CoinsCachePair& current) noexcept
+    {
+        const auto next_entry{current.second.Next()};
+        // If we are not going to erase the cache, we must still erase spent entries.
+        // Otherwise, clear the state of the entry.
+        if (!m_will_erase) {
+            if (current.second.coin.IsSpent()) {
+                m_usage -= current.second.coin.DynamicMemoryUsage();
+                m_map.erase(current.first);
+            } else {
+                current.second.SetClean();
+            }
+        }
+        return next_entry;
+    }
+
+    inline bool WillErase(CoinsCachePair& current) const noexcept { return m_will_erase || current.second.coin.IsSpent(); }
+private:
+    size_t& m_usage;
+    CoinsCachePair& m_sentinel;
+    CCoinsMap& m_map;
+    bool m_will_erase;
+};
+
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
 {
@@ -191,12 +407,18 @@ public:
     virtual std::vector<uint256> GetHeadBlocks() const;
 
     //! Do a bulk modification (multiple Coin changes + BestBlock change).
-    //! The passed mapCoins can be modified.
-    virtual bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true);
+    //! The passed cursor is used to iterate through the coins.
+    virtual bool BatchWrite(CoinsViewCacheCursor& cursor, const uint256& hashBlock);
 
     //! Get a cursor to iterate over the whole state
     virtual std::unique_ptr<CCoinsViewCursor> Cursor() const;
 
+    //! Get cursors over up to `num_ranges` consecutive ranges of the state,
+    //! in key order, which can be iterated concurrently. The outputs of a
+    //! transaction are all in the same range. Views that cannot be split
+    //! return Cursor() alone.
+    virtual std::vector<std::unique_ptr<CCoinsViewCursor>> Cursors(size_t num_ranges) const;
+
     //! As we use CCoinsViews polymorphically, have a virtual destructor
     virtual ~CCoinsView() {}
 
@@ -218,8 +440,9 @@ public:
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
     void SetBackend(CCoinsView &viewIn);
-    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true) override;
+    bool BatchWrite(CoinsViewCacheCursor& cursor, const uint256& hashBlock) override;
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
+    std::vector<std::unique_ptr<CCoinsViewCursor>> Cursors(size_t num_ranges) const override;
     size_t EstimateSize() const override;
 };
 
@@ -237,11 +460,16 @@ protected:
      */
     mutable uint256 hashBlock;
     mutable CCoinsMapMemoryResource m_cache_coins_memory_resource{};
+    /* The starting sentinel of the flagged entry circular doubly linked list. */
+    mutable CoinsCachePair m_sentinel;
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage{0};
 
+    /* Slot of the cacheCoins index at which the next EvictClean() starts. */
+    size_t m_evict_index{0};
+
 public:
     CCoinsViewCache(CCoinsView *baseIn, bool deterministic = false);
 
@@ -255,7 +483,7 @@ public:
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     void SetBestBlock(const uint256 &hashBlock);
-    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true) override;
+    bool BatchWrite(CoinsViewCacheCursor& cursor, const uint256& hashBlock) override;
     std::unique_ptr<CCoinsViewCursor> Cursor() const override {
         throw std::logic_error("CCoinsViewCache cursor iteration not supported.");
     }
@@ -268,7 +496,7 @@ public:
     bool HaveCoinInCache(const COutPoint &outpoint) const;
 
     /**
-     * Return a reference to Coin in the cache, or coinEmpty if not found. This is
+     * Return a reference to the coin in the cache, or coinEmpty if not found. This is
      * more efficient than GetCoin.
      *
      * Generally, do not hold the reference returned for more than a short scope.
@@ -276,8 +504,11 @@ public:
      * of the cache while holding the reference, this behavior should not be relied
      * on! To be safe, best to not hold the returned reference through any other
      * calls to this cache.
+     *
+     * The coin is returned in its compact in-memory representation: reading its
+     * value, height or coinbase flag does not reconstruct its script.
      */
-    const Coin& AccessCoin(const COutPoint &output) const;
+    const CompactCoin& AccessCoin(const COutPoint &output) const;
 
     /**
      * Add a coin. Set possible_overwrite to true if an unspent version may
@@ -294,6 +525,16 @@ public:
      */
     void EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coin);
 
+    /**
+     * Insert an unspent coin that was read from the backing view, unless this
+     * cache already has an entry for the outpoint. The entry is neither DIRTY
+     * nor FRESH, as if it had been pulled in by FetchCoin().
+     *
+     * @returns whether the coin was inserted.
+     * @sa InputFetcher::FetchInputs()
+     */
+    bool EmplaceFetchedCoin(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
@@ -330,6 +571,31 @@ public:
     //! Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
 
+    /**
+     * Calculate the size of the cache (in bytes), not counting the memory of
+     * erased entries. That memory stays allocated by the cache's pool, but is
+     * reused for new entries before the pool grows again.
+     */
+    size_t LiveMemoryUsage() const;
+
+    /**
+     * Erase clean (neither DIRTY nor FRESH) entries, in no particular order,
+     * until LiveMemoryUsage() is at most target_usage. Unlike Flush(), this
+     * keeps the remaining entries cached. Call Sync() first to make all
+     * unspent entries clean. Each call continues where the previous one
+     * stopped.
+     *
+     * If `compact` is set, no entry is flagged, and the memory of erased
+     * entries (also by earlier calls) is at least that of the remaining ones,
+     * the remaining entries are moved to a new pool so that the memory is
+     * returned to the system. Moving them temporarily takes additional memory
+     * for a copy of the remaining entries, so callers that are short of
+     * memory leave it to a later call.
+     *
+     * @returns the number of erased entries.
+     */
+    size_t EvictClean(size_t target_usage, bool compact = true);
+
     //! Check whether all prevouts of the transaction are present in the UTXO set represented by this view
     bool HaveInputs(const CTransaction& tx) const;
 
@@ -363,7 +629,7 @@ void AddCoins(CCoinsViewCache& cache, const CTransaction& tx, int nHeight, bool
 //! This function can be quite expensive because in the event of a transaction
 //! which is not found in the cache, it can cause up to MAX_OUTPUTS_PER_BLOCK
 //! lookups to database, so it should be used with care.
-const Coin& AccessByTxid(const CCoinsViewCache& cache, const Txid& txid);
+const CompactCoin& AccessByTxid(const CCoinsViewCache& cache, const Txid& txid);
 
 /**
  * This is a minimally invasive approach to shutdown on LevelDB read errors from the
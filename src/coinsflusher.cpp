@@ -0,0 +1,122 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coinsflusher.h>
+
+#include <logging.h>
+#include <memusage.h>
+#include <util/thread.h>
+#include <util/time.h>
+
+#include <exception>
+#include <utility>
+
+CCoinsViewFlusher::~CCoinsViewFlusher()
+{
+    if (m_thread.joinable()) m_thread.join();
+}
+
+bool CCoinsViewFlusher::GetCoin(const COutPoint& outpoint, Coin& coin) const
+{
+    if (m_snapshot) {
+        const auto it{m_snapshot->coins.find(outpoint)};
+        if (it != m_snapshot->coins.end()) {
+            coin = it->second.coin.ToCoin();
+            return !coin.IsSpent();
+        }
+    }
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewFlusher::HaveCoin(const COutPoint& outpoint) const
+{
+    Coin coin;
+    return GetCoin(outpoint, coin);
+}
+
+uint256 CCoinsViewFlusher::GetBestBlock() const
+{
+    if (m_snapshot) return m_snapshot->best_block;
+    return base->GetBestBlock();
+}
+
+bool CCoinsViewFlusher::BatchWrite(CoinsViewCacheCursor& cursor, const uint256& hashBlock)
+{
+    const bool was_writing{IsWriting()};
+    const auto wait_start{SteadyClock::now()};
+    if (!Wait()) return false;
+    if (was_writing) {
+        LogPrint(BCLog::BENCH, "Waited %.2fms for the previous background coins write\n",
+                 Ticks<MillisecondsDouble>(SteadyClock::now() - wait_start));
+    }
+    if (!std::exchange(m_in_background, false)) return base->BatchWrite(cursor, hashBlock);
+
+    auto snapshot{std::make_unique<Snapshot>()};
+    for (auto it{cursor.Begin()}; it != cursor.End(); it = cursor.NextAndMaybeErase(*it)) {
+        // Like CCoinsViewCache::BatchWrite(), skip clean entries, and spent
+        // FRESH ones, which the base view does not have.
+        if (!it->second.IsDirty() || (it->second.IsFresh() && it->second.coin.IsSpent())) continue;
+        auto [entry, inserted]{snapshot->coins.try_emplace(it->first)};
+        if (cursor.WillErase(*it)) {
+            entry->second.coin = std::move(it->second.coin);
+        } else {
+            entry->second.coin = it->second.coin;
+        }
+        snapshot->usage += entry->second.coin.DynamicMemoryUsage();
+        CCoinsCacheEntry::SetDirty(*entry, snapshot->sentinel);
+    }
+    snapshot->best_block = hashBlock;
+
+    m_snapshot = std::move(snapshot);
+    m_write_done = false;
+    m_thread = std::thread{&util::TraceThread, "coinsflush", [this] { WriteSnapshot(); }};
+    return true;
+}
+
+void CCoinsViewFlusher::WriteSnapshot()
+{
+    const auto start{SteadyClock::now()};
+    const size_t count{m_snapshot->coins.size()};
+    // The cursor does not modify the snapshot when will_erase is set, so
+    // readers can keep looking up coins in it while it is written.
+    size_t usage{m_snapshot->usage};
+    auto cursor{CoinsViewCacheCursor(usage, m_snapshot->sentinel, m_snapshot->coins, /*will_erase=*/true)};
+    bool ok{false};
+    try {
+        ok = base->BatchWrite(cursor, m_snapshot->best_block);
+    } catch (const std::exception& e) {
+        LogError("Background coins write failed: %s\n", e.what());
+    }
+    if (!ok) m_write_ok = false;
+    LogPrint(BCLog::BENCH, "Background write of %u coins (%.2f MiB) %s in %.2fms\n",
+             count, DynamicMemoryUsage() * (1.0 / (1 << 20)), ok ? "completed" : "failed",
+             Ticks<MillisecondsDouble>(SteadyClock::now() - start));
+    m_write_done = true;
+}
+
+bool CCoinsViewFlusher::SyncInBackground(CCoinsViewCache& cache)
+{
+    m_in_background = true;
+    const bool ok{cache.Sync()};
+    m_in_background = false;
+    return ok;
+}
+
+bool CCoinsViewFlusher::Wait()
+{
+    if (m_thread.joinable()) m_thread.join();
+    m_snapshot.reset();
+    return m_write_ok;
+}
+
+void CCoinsViewFlusher::ReleaseIfDone()
+{
+    if (m_snapshot && !IsWriting()) Wait();
+}
+
+size_t CCoinsViewFlusher::DynamicMemoryUsage() const
+{
+    if (!m_snapshot) return 0;
+    return memusage::DynamicUsage(m_snapshot->coins) + m_snapshot->usage;
+}
@@ -0,0 +1,104 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COINSFLUSHER_H
+#define BITCOIN_COINSFLUSHER_H
+
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * CCoinsView between the top coins cache and the coins database that can
+ * write a cache's modified coins to the database on a background thread.
+ *
+ * SyncInBackground() syncs the cache into this view, which copies the
+ * modified coins into an immutable snapshot and hands it to a background
+ * thread that writes it to the base view with a single BatchWrite(). The cache
+ * stays warm and validation continues while the database is written to.
+ * Until the write has finished, lookups that miss the cache are answered from
+ * the snapshot before falling back to the base view, so readers never see the
+ * partially written database.
+ *
+ * Crash safety is that of CCoinsViewDB::BatchWrite(): the database is marked
+ * as being in transition between the old and the new best block until the
+ * last batch is written, and ReplayBlocks() completes an interrupted write on
+ * startup.
+ *
+ * At most one write is in progress. The next BatchWrite() waits for it, as do
+ * Wait() and the destructor. Other than the background thread's reads of the
+ * snapshot and writes to the base view, this object must only be used by one
+ * thread at a time (validation holds cs_main), except that GetCoin() may be
+ * called concurrently if the base view allows that.
+ */
+class CCoinsViewFlusher final : public CCoinsViewBacked
+{
+private:
+    /** Modified coins being written, and the best block they are written for. */
+    struct Snapshot {
+        CCoinsMapMemoryResource resource{};
+        CoinsCachePair sentinel{};
+        CCoinsMap coins{0, SaltedOutpointHasher{}, CCoinsMap::key_equal{}, &resource};
+        //! Dynamic memory usage of the coins' scripts.
+        size_t usage{0};
+        uint256 best_block;
+
+        Snapshot() { sentinel.second.SelfRef(sentinel); }
+    };
+
+    std::unique_ptr<Snapshot> m_snapshot;
+    std::thread m_thread;
+    //! Set by the background thread once it is done with m_snapshot.
+    std::atomic<bool> m_write_done{true};
+    //! Written by the background thread, read after joining it. Once a write
+    //! failed, the base view is in an unknown state and all later writes fail.
+    bool m_write_ok{true};
+    //! Whether the next BatchWrite() should write in the background.
+    bool m_in_background{false};
+
+    void WriteSnapshot();
+
+public:
+    explicit CCoinsViewFlusher(CCoinsView* view) : CCoinsViewBacked(view) {}
+    ~CCoinsViewFlusher() override;
+
+    CCoinsViewFlusher(const CCoinsViewFlusher&) = delete;
+    CCoinsViewFlusher& operator=(const CCoinsViewFlusher&) = delete;
+
+    bool GetCoin(const COutPoint& outpoint, Coin& coin) const override;
+    bool HaveCoin(const COutPoint& outpoint) const override;
+    uint256 GetBestBlock() const override;
+    bool BatchWrite(CoinsViewCacheCursor& cursor, const uint256& hashBlock) override;
+
+    /**
+     * Sync cache, whose base view must be this object, and write its
+     * modified coins to the base view on a background thread.
+     *
+     * @returns false if the previous background write failed.
+     */
+    bool SyncInBackground(CCoinsViewCache& cache);
+
+    /**
+     * Wait for the background write to finish, and release the snapshot.
+     *
+     * @returns false if any background write failed.
+     */
+    bool Wait();
+
+    //! Release the snapshot if the background write has finished.
+    void ReleaseIfDone();
+
+    //! Whether a background write is in progress.
+    bool IsWriting() const { return !m_write_done.load(); }
+
+    //! Memory used by the snapshot (in bytes).
+    size_t DynamicMemoryUsage() const;
+};
+
+#endif // BITCOIN_COINSFLUSHER_H
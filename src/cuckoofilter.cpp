@@ -0,0 +1,91 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cuckoofilter.h>
+
+#include <memusage.h>
+#include <util/fastrange.h>
+
+#include <algorithm>
+#include <utility>
+
+//! Fraction of the slots, in percent, to allocate room for. Insertions
+//! usually start failing at a load of about 95%.
+static constexpr uint64_t TARGET_LOAD_PERCENT{90};
+
+CuckooFilter::CuckooFilter(size_t capacity)
+    : m_num_buckets{std::max<uint64_t>(1, (uint64_t{capacity} * 100 + SLOTS_PER_BUCKET * TARGET_LOAD_PERCENT - 1) / (SLOTS_PER_BUCKET * TARGET_LOAD_PERCENT))}
+{
+    m_table.assign(m_num_buckets * SLOTS_PER_BUCKET, 0);
+}
+
+uint16_t CuckooFilter::Fingerprint(uint64_t hash) const
+{
+    // Zero marks an empty slot. The high bits of the hash select the bucket.
+    const uint16_t fingerprint = hash & 0xffff;
+    return fingerprint ? fingerprint : 1;
+}
+
+uint64_t CuckooFilter::AltBucket(uint64_t bucket, uint16_t fingerprint) const
+{
+    // (h - bucket) mod n maps the two candidate buckets onto each other, for
+    // any number of buckets.
+    const uint64_t h{FastRange64(fingerprint * uint64_t{0x9e3779b97f4a7c15}, m_num_buckets)};
+    return h >= bucket ? h - bucket : h + m_num_buckets - bucket;
+}
+
+bool CuckooFilter::InsertIntoBucket(uint64_t bucket, uint16_t fingerprint)
+{
+    for (size_t i{0}; i < SLOTS_PER_BUCKET; ++i) {
+        uint16_t& slot{m_table[bucket * SLOTS_PER_BUCKET + i]};
+        if (slot == 0) {
+            slot = fingerprint;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CuckooFilter::BucketContains(uint64_t bucket, uint16_t fingerprint) const
+{
+    const uint16_t* slots{&m_table[bucket * SLOTS_PER_BUCKET]};
+    return slots[0] == fingerprint || slots[1] == fingerprint || slots[2] == fingerprint || slots[3] == fingerprint;
+}
+
+bool CuckooFilter::Insert(uint64_t hash)
+{
+    uint16_t fingerprint{Fingerprint(hash)};
+    uint64_t bucket{FastRange64(hash, m_num_buckets)};
+    const uint64_t alt_bucket{AltBucket(bucket, fingerprint)};
+    if (InsertIntoBucket(bucket, fingerprint) || InsertIntoBucket(alt_bucket, fingerprint)) {
+        ++m_size;
+        return true;
+    }
+
+    // Both buckets are full. Evict a fingerprint and move it to its other
+    // bucket, until one has room.
+    if (++m_kick_counter & 1) bucket = alt_bucket;
+    for (int kick{0}; kick < MAX_KICKS; ++kick) {
+        std::swap(fingerprint, m_table[bucket * SLOTS_PER_BUCKET + (++m_kick_counter % SLOTS_PER_BUCKET)]);
+        bucket = AltBucket(bucket, fingerprint);
+        if (InsertIntoBucket(bucket, fingerprint)) {
+            ++m_size;
+            return true;
+        }
+    }
+    // The last evicted fingerprint is lost.
+    return false;
+}
+
+bool CuckooFilter::MayContain(uint64_t hash) const
+{
+    const uint16_t fingerprint{Fingerprint(hash)};
+    const uint64_t bucket{FastRange64(hash, m_num_buckets)};
+    return BucketContains(bucket, fingerprint) || BucketContains(AltBucket(bucket, fingerprint), fingerprint);
+}
+
+size_t CuckooFilter::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(m_table);
+}
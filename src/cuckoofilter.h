@@ -0,0 +1,71 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CUCKOOFILTER_H
+#define BITCOIN_CUCKOOFILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Probabilistic set membership filter (Fan et al., "Cuckoo Filter: Practically
+ * Better Than Bloom", 2014).
+ *
+ * Elements are identified by a 64-bit hash, which the caller computes with a
+ * salted hasher. Each element is stored as a 16-bit fingerprint in one of two
+ * candidate buckets of four slots, so that MayContain() only inspects two
+ * buckets. There are no false negatives, and the false positive rate is at
+ * most about 8 / 2^16 when the filter is full.
+ *
+ * Elements cannot be removed: there is no way to tell whether an element that
+ * was never inserted shares its fingerprint and bucket with one that was.
+ * When Insert() fails, the filter is full and must no longer be used, as it
+ * may have dropped an element.
+ *
+ * Not thread-safe.
+ */
+class CuckooFilter
+{
+private:
+    static constexpr size_t SLOTS_PER_BUCKET{4};
+    //! Number of relocations Insert() attempts before giving up.
+    static constexpr int MAX_KICKS{500};
+
+    std::vector<uint16_t> m_table;
+    uint64_t m_num_buckets;
+    size_t m_size{0};
+    //! Source of the slot to evict when relocating.
+    uint32_t m_kick_counter{0};
+
+    uint16_t Fingerprint(uint64_t hash) const;
+    uint64_t AltBucket(uint64_t bucket, uint16_t fingerprint) const;
+    bool InsertIntoBucket(uint64_t bucket, uint16_t fingerprint);
+    bool BucketContains(uint64_t bucket, uint16_t fingerprint) const;
+
+public:
+    //! Create a filter with room for about `capacity` elements.
+    explicit CuckooFilter(size_t capacity);
+
+    /**
+     * Insert an element.
+     *
+     * @returns false if the filter is full. The filter may have dropped an
+     *          element, and must be discarded.
+     */
+    bool Insert(uint64_t hash);
+
+    //! @returns false if the element was definitely never inserted.
+    bool MayContain(uint64_t hash) const;
+
+    //! Number of elements inserted.
+    size_t Size() const { return m_size; }
+
+    //! Number of elements there is room for.
+    size_t Capacity() const { return m_table.size(); }
+
+    size_t DynamicMemoryUsage() const;
+};
+
+#endif // BITCOIN_CUCKOOFILTER_H
@@ -9,15 +9,21 @@
 #include <serialize.h>
 #include <span.h>
 #include <streams.h>
+#include <tinyformat.h>
 #include <util/fs.h>
 #include <util/fs_helpers.h>
 #include <util/strencodings.h>
+#include <util/time.h>
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cassert>
 #include <cstdarg>
 #include <cstdint>
 #include <cstdio>
+#include <limits>
+#include <locale>
 #include <leveldb/cache.h>
 #include <leveldb/db.h>
 #include <leveldb/env.h>
@@ -30,6 +36,8 @@
 #include <leveldb/write_batch.h>
 #include <memory>
 #include <optional>
+#include <sstream>
+#include <string>
 #include <utility>
 
 static auto CharCast(const std::byte* data) { return reinterpret_cast<const char*>(data); }
@@ -134,12 +142,16 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+static leveldb::Options GetOptions(size_t nCacheSize, const DBOptions& db_options)
 {
     leveldb::Options options;
     options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.write_buffer_size = db_options.write_buffer_bytes.value_or(nCacheSize / 4); // up to two write buffers may be held in memory simultaneously
+    options.max_file_size = db_options.max_file_bytes;
+    options.block_size = db_options.block_bytes;
+    // Table files written with another number of bits per key, or without
+    // a filter, remain readable.
+    options.filter_policy = db_options.bloom_bits > 0 ? leveldb::NewBloomFilterPolicy(db_options.bloom_bits) : nullptr;
     options.compression = leveldb::kNoCompression;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
@@ -226,7 +238,7 @@ CDBWrapper::CDBWrapper(const DBParams& params)
     DBContext().iteroptions.verify_checksums = true;
     DBContext().iteroptions.fill_cache = false;
     DBContext().syncoptions.sync = true;
-    DBContext().options = GetOptions(params.cache_bytes);
+    DBContext().options = GetOptions(params.cache_bytes, params.options);
     DBContext().options.create_if_missing = true;
     if (params.memory_only) {
         DBContext().penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -295,7 +307,9 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     if (log_memory) {
         mem_before = DynamicMemoryUsage() / 1024.0 / 1024;
     }
+    const auto start{SteadyClock::now()};
     leveldb::Status status = DBContext().pdb->Write(fSync ? DBContext().syncoptions : DBContext().writeoptions, &batch.m_impl_batch->batch);
+    m_write_latency.Add(SteadyClock::now() - start);
     HandleError(status);
     if (log_memory) {
         double mem_after = DynamicMemoryUsage() / 1024.0 / 1024;
@@ -316,6 +330,64 @@ size_t CDBWrapper::DynamicMemoryUsage() const
     return parsed.value();
 }
 
+DBStats CDBWrapper::GetStats() const
+{
+    leveldb::DB& db{*DBContext().pdb};
+    DBStats stats;
+    std::string files;
+    while (db.GetProperty(strprintf("leveldb.num-files-at-level%d", stats.levels.size()), &files)) {
+        stats.levels.push_back({.files = ToIntegral<int>(files).value_or(0)});
+    }
+    // Each level with table files or compactions has a row
+    // "<level> <files> <size> <time> <read> <written>" in leveldb.stats.
+    db.GetProperty("leveldb.stats", &stats.leveldb_stats);
+    std::istringstream table{stats.leveldb_stats};
+    table.imbue(std::locale::classic());
+    for (std::string line; std::getline(table, line);) {
+        std::istringstream row{line};
+        row.imbue(std::locale::classic());
+        size_t level;
+        int level_files;
+        DBLevelStats level_stats;
+        if (row >> level >> level_files >> level_stats.size_mib >> level_stats.compaction_seconds >>
+                level_stats.compaction_read_mib >> level_stats.compaction_write_mib &&
+            level < stats.levels.size()) {
+            level_stats.files = stats.levels[level].files;
+            stats.levels[level] = level_stats;
+        }
+    }
+    // Keys are serialized with a leading type byte below 0xff.
+    const std::string key_limit(DBWRAPPER_PREALLOC_KEY_SIZE, '\xff');
+    const leveldb::Range range{leveldb::Slice{}, key_limit};
+    db.GetApproximateSizes(&range, 1, &stats.approximate_size);
+    stats.memory_usage = DynamicMemoryUsage();
+
+    stats.write_latency = m_write_latency.GetBuckets();
+    stats.write_time = m_write_latency.GetTotal();
+    return stats;
+}
+
+void LatencyHistogram::Add(std::chrono::nanoseconds latency)
+{
+    const auto us{static_cast<uint64_t>(std::max<int64_t>(Ticks<std::chrono::microseconds>(latency), 0))};
+    m_buckets[std::min<size_t>(std::bit_width(us), NUM_BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+    m_total_us.fetch_add(us, std::memory_order_relaxed);
+}
+
+std::array<uint64_t, LatencyHistogram::NUM_BUCKETS> LatencyHistogram::GetBuckets() const
+{
+    std::array<uint64_t, NUM_BUCKETS> buckets;
+    for (size_t i{0}; i < NUM_BUCKETS; ++i) {
+        buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+    return buckets;
+}
+
+std::chrono::microseconds LatencyHistogram::GetTotal() const
+{
+    return std::chrono::microseconds{m_total_us.load(std::memory_order_relaxed)};
+}
+
 // Prefixed with null character to avoid collisions with other keys
 //
 // We must use a string constructor which specifies length so that we copy
@@ -382,9 +454,15 @@ bool CDBWrapper::IsEmpty()
 }
 
 struct CDBIterator::IteratorImpl {
+    //! Snapshot read by the iterator, if shared with other iterators.
+    const std::shared_ptr<const leveldb::Snapshot> snapshot;
     const std::unique_ptr<leveldb::Iterator> iter;
+    //! Key at which iteration ends, if any.
+    const std::optional<std::string> end;
 
     explicit IteratorImpl(leveldb::Iterator* _iter) : iter{_iter} {}
+    IteratorImpl(std::shared_ptr<const leveldb::Snapshot> _snapshot, leveldb::Iterator* _iter, std::optional<std::string> _end)
+        : snapshot{std::move(_snapshot)}, iter{_iter}, end{std::move(_end)} {}
 };
 
 CDBIterator::CDBIterator(const CDBWrapper& _parent, std::unique_ptr<IteratorImpl> _piter) : parent(_parent),
@@ -395,6 +473,73 @@ CDBIterator* CDBWrapper::NewIterator()
     return new CDBIterator{*this, std::make_unique<CDBIterator::IteratorImpl>(DBContext().pdb->NewIterator(DBContext().iteroptions))};
 }
 
+std::vector<std::unique_ptr<CDBIterator>> CDBWrapper::NewRangeIteratorsImpl(Span<const std::byte> prefix, size_t num_ranges)
+{
+    leveldb::DB* const db{DBContext().pdb};
+    // Position p in [0, 2^64) stands for the key made of the prefix and the
+    // 8 bytes of p in big-endian order.
+    const auto key_at{[&](uint64_t pos) {
+        std::string key(CharCast(prefix.data()), prefix.size());
+        for (int shift{56}; shift >= 0; shift -= 8) key.push_back(static_cast<char>(pos >> shift));
+        return key;
+    }};
+    // The first key after all keys with the prefix, if there is one.
+    std::optional<std::string> limit{std::string(CharCast(prefix.data()), prefix.size())};
+    while (!limit->empty() && static_cast<uint8_t>(limit->back()) == 0xff) limit->pop_back();
+    if (limit->empty()) {
+        limit.reset();
+    } else {
+        limit->back() = static_cast<char>(static_cast<uint8_t>(limit->back()) + 1);
+    }
+    const std::string first(CharCast(prefix.data()), prefix.size());
+    const std::string last{limit.value_or(std::string(prefix.size() + 9, '\xff'))};
+    const auto size_to{[&](const std::string& key) {
+        const leveldb::Range range{first, key};
+        uint64_t size{0};
+        db->GetApproximateSizes(&range, 1, &size);
+        return size;
+    }};
+
+    // Start each range after the first where the data before it reaches its
+    // share of the total. Without data in table files yet, split the keys
+    // evenly.
+    num_ranges = std::max<size_t>(num_ranges, 1);
+    const uint64_t total{size_to(last)};
+    std::vector<uint64_t> begins{0};
+    for (size_t i{1}; i < num_ranges; ++i) {
+        uint64_t pos;
+        if (total == 0) {
+            pos = std::numeric_limits<uint64_t>::max() / num_ranges * i;
+        } else {
+            const uint64_t target{static_cast<uint64_t>(static_cast<double>(total) * i / num_ranges)};
+            uint64_t low{begins.back()}, high{std::numeric_limits<uint64_t>::max()};
+            while (low < high) {
+                const uint64_t mid{low + (high - low) / 2};
+                if (size_to(key_at(mid)) < target) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            pos = low;
+        }
+        if (pos > begins.back()) begins.push_back(pos);
+    }
+
+    std::shared_ptr<const leveldb::Snapshot> snapshot{db->GetSnapshot(), [db](const leveldb::Snapshot* s) { db->ReleaseSnapshot(s); }};
+    leveldb::ReadOptions options{DBContext().iteroptions};
+    options.snapshot = snapshot.get();
+    std::vector<std::unique_ptr<CDBIterator>> iterators;
+    for (size_t i{0}; i < begins.size(); ++i) {
+        auto end{i + 1 < begins.size() ? std::optional{key_at(begins[i + 1])} : limit};
+        auto impl{std::make_unique<CDBIterator::IteratorImpl>(snapshot, db->NewIterator(options), std::move(end))};
+        // The first range also holds keys shorter than the prefix and 8 bytes.
+        impl->iter->Seek(i == 0 ? first : key_at(begins[i]));
+        iterators.push_back(std::make_unique<CDBIterator>(*this, std::move(impl)));
+    }
+    return iterators;
+}
+
 void CDBIterator::SeekImpl(Span<const std::byte> key)
 {
     leveldb::Slice slKey(CharCast(key.data()), key.size());
@@ -412,7 +557,10 @@ Span<const std::byte> CDBIterator::GetValueImpl() const
 }
 
 CDBIterator::~CDBIterator() = default;
-bool CDBIterator::Valid() const { return m_impl_iter->iter->Valid(); }
+bool CDBIterator::Valid() const
+{
+    return m_impl_iter->iter->Valid() && (!m_impl_iter->end || m_impl_iter->iter->key().compare(*m_impl_iter->end) < 0);
+}
 void CDBIterator::SeekToFirst() { m_impl_iter->iter->SeekToFirst(); }
 void CDBIterator::Next() { m_impl_iter->iter->Next(); }
 
@@ -12,7 +12,11 @@
 #include <util/check.h>
 #include <util/fs.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <memory>
 #include <optional>
@@ -23,10 +27,22 @@
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
+static constexpr int DEFAULT_DB_BLOOM_BITS{10};
+static constexpr size_t DEFAULT_DB_MAX_FILE_SIZE{2 << 20};
+static constexpr size_t DEFAULT_DB_BLOCK_SIZE{4 << 10};
+
 //! User-controlled performance and debug options.
 struct DBOptions {
     //! Compact database on startup.
     bool force_compact = false;
+    //! Bits per key of the bloom filter in each table file, or 0 for none.
+    int bloom_bits{DEFAULT_DB_BLOOM_BITS};
+    //! Size of the in-memory write buffer. Defaults to a quarter of the cache.
+    std::optional<size_t> write_buffer_bytes{};
+    //! Size of the table files written by compactions.
+    size_t max_file_bytes{DEFAULT_DB_MAX_FILE_SIZE};
+    //! Approximate size of the uncompressed data of each block of a table file.
+    size_t block_bytes{DEFAULT_DB_BLOCK_SIZE};
 };
 
 //! Application-specific storage settings.
@@ -46,6 +62,54 @@ struct DBParams {
     DBOptions options{};
 };
 
+/**
+ * Histogram of the latencies of database operations. Bucket 0 counts
+ * operations taking less than a microsecond, and bucket i > 0 those taking
+ * from 2^(i-1) up to 2^i microseconds, except for the last bucket, which
+ * counts all slower operations.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr size_t NUM_BUCKETS{24};
+
+    void Add(std::chrono::nanoseconds latency);
+    std::array<uint64_t, NUM_BUCKETS> GetBuckets() const;
+    std::chrono::microseconds GetTotal() const;
+
+private:
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> m_buckets{};
+    std::atomic<uint64_t> m_total_us{0};
+};
+
+//! Table files and compactions of a level of a database, as reported by leveldb.
+struct DBLevelStats {
+    //! Number of table files.
+    int files{0};
+    //! Size of the table files, in MiB.
+    double size_mib{0};
+    //! Time spent in, and data read and written by, the compactions into the
+    //! level, in seconds and MiB. Those of level 0 are the writes of the
+    //! write buffer to table files.
+    double compaction_seconds{0};
+    double compaction_read_mib{0};
+    double compaction_write_mib{0};
+};
+
+//! Statistics of a database, as reported by leveldb and measured by CDBWrapper.
+struct DBStats {
+    //! Output of the "leveldb.stats" property, which `levels` is parsed from.
+    std::string leveldb_stats;
+    std::vector<DBLevelStats> levels;
+    //! Approximate size of all data on disk, in bytes.
+    uint64_t approximate_size{0};
+    //! Approximate memory used by leveldb, in bytes.
+    uint64_t memory_usage{0};
+    //! Latencies of batch writes.
+    std::array<uint64_t, LatencyHistogram::NUM_BUCKETS> write_latency{};
+    std::chrono::microseconds write_time{0};
+};
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -205,9 +269,13 @@ private:
     //! whether or not the database resides in memory
     bool m_is_memory;
 
+    //! latencies of batch writes
+    LatencyHistogram m_write_latency;
+
     std::optional<std::string> ReadImpl(Span<const std::byte> key) const;
     bool ExistsImpl(Span<const std::byte> key) const;
     size_t EstimateSizeImpl(Span<const std::byte> key1, Span<const std::byte> key2) const;
+    std::vector<std::unique_ptr<CDBIterator>> NewRangeIteratorsImpl(Span<const std::byte> prefix, size_t num_ranges);
     auto& DBContext() const LIFETIMEBOUND { return *Assert(m_db_context); }
 
 public:
@@ -275,8 +343,30 @@ public:
     // Get an estimate of LevelDB memory usage (in bytes).
     size_t DynamicMemoryUsage() const;
 
+    //! Get leveldb properties and batch write latencies of the database.
+    DBStats GetStats() const;
+
     CDBIterator* NewIterator();
 
+    /**
+     * Split the keys starting with `prefix` into up to `num_ranges`
+     * consecutive ranges holding roughly the same amount of data on disk, as
+     * estimated by leveldb, and return an iterator over each range,
+     * positioned at its first key. The iterators read the same snapshot of
+     * the database, and can be used concurrently.
+     *
+     * Ranges begin at the prefix followed by 8 bytes, so keys that share
+     * their first 8 bytes after the prefix are always in the same range.
+     */
+    template <typename P>
+    std::vector<std::unique_ptr<CDBIterator>> NewRangeIterators(const P& prefix, size_t num_ranges)
+    {
+        DataStream ssPrefix{};
+        ssPrefix.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssPrefix << prefix;
+        return NewRangeIteratorsImpl(ssPrefix, num_ranges);
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
@@ -10,6 +10,13 @@
 #include <tinyformat.h>
 #include <util/fs_helpers.h>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 FlatFileSeq::FlatFileSeq(fs::path dir, const char* prefix, size_t chunk_size) :
     m_dir(std::move(dir)),
     m_prefix(prefix),
@@ -100,3 +107,54 @@ bool FlatFileSeq::Flush(const FlatFilePos& pos, bool finalize)
     fclose(file);
     return true;
 }
+
+MappedFlatFile::~MappedFlatFile()
+{
+#ifndef WIN32
+    munmap(m_data, m_size);
+#endif
+}
+
+std::shared_ptr<const MappedFlatFile> MappedFlatFile::Map(const fs::path& path)
+{
+#ifdef WIN32
+    return nullptr;
+#else
+    const int fd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd == -1) return nullptr;
+    struct stat st;
+    void* data{MAP_FAILED};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    // The mapping remains valid after the file descriptor is closed.
+    close(fd);
+    if (data == MAP_FAILED) {
+        LogPrint(BCLog::BLOCKSTORAGE, "Unable to map %s\n", fs::PathToString(path));
+        return nullptr;
+    }
+    return std::shared_ptr<const MappedFlatFile>{new MappedFlatFile{static_cast<std::byte*>(data), static_cast<size_t>(st.st_size)}};
+#endif
+}
+
+std::optional<MappedFlatFileSpan> FlatFileMapper::Read(const FlatFilePos& pos, size_t size)
+{
+    const uint64_t end{uint64_t{pos.nPos} + size};
+    std::shared_ptr<const MappedFlatFile> file;
+    {
+        LOCK(m_mutex);
+        auto& mapped{m_files[pos.nFile]};
+        if (!mapped || mapped->Data().size() < end) {
+            mapped = MappedFlatFile::Map(m_seq.FileName(pos));
+        }
+        file = mapped;
+    }
+    if (!file || file->Data().size() < end) return std::nullopt;
+    return MappedFlatFileSpan{file, file->Data().subspan(pos.nPos, size)};
+}
+
+void FlatFileMapper::Forget(int file)
+{
+    LOCK(m_mutex);
+    m_files.erase(file);
+}
@@ -6,9 +6,14 @@
 #ifndef BITCOIN_FLATFILE_H
 #define BITCOIN_FLATFILE_H
 
+#include <map>
+#include <memory>
+#include <optional>
 #include <string>
 
 #include <serialize.h>
+#include <span.h>
+#include <sync.h>
 #include <util/fs.h>
 
 struct FlatFilePos
@@ -86,4 +91,55 @@ public:
     bool Flush(const FlatFilePos& pos, bool finalize = false);
 };
 
+/** Read-only memory mapping of a file, covering the file as it was when mapped. */
+class MappedFlatFile
+{
+private:
+    std::byte* const m_data;
+    const size_t m_size;
+
+    MappedFlatFile(std::byte* data, size_t size) : m_data(data), m_size(size) {}
+
+public:
+    ~MappedFlatFile();
+
+    MappedFlatFile(const MappedFlatFile&) = delete;
+    MappedFlatFile& operator=(const MappedFlatFile&) = delete;
+
+    /** Map a file. Returns nullptr if it cannot be mapped, or is empty. */
+    static std::shared_ptr<const MappedFlatFile> Map(const fs::path& path);
+
+    Span<const std::byte> Data() const { return {m_data, m_size}; }
+};
+
+/** Data in a mapped file, which remains valid as long as the mapping is referenced. */
+struct MappedFlatFileSpan {
+    std::shared_ptr<const MappedFlatFile> file;
+    Span<const std::byte> data;
+};
+
+/**
+ * Maps the files of a FlatFileSeq into memory for reading, and keeps the
+ * mappings for later reads. A file that grew past its mapping is mapped again.
+ *
+ * Files are mapped with MAP_SHARED, so data written through stdio is visible
+ * once it was flushed from the FILE buffer. Not supported on Windows.
+ */
+class FlatFileMapper
+{
+private:
+    const FlatFileSeq m_seq;
+    Mutex m_mutex;
+    std::map<int, std::shared_ptr<const MappedFlatFile>> m_files GUARDED_BY(m_mutex);
+
+public:
+    explicit FlatFileMapper(FlatFileSeq seq) : m_seq(std::move(seq)) {}
+
+    /** Get `size` bytes at `pos`. Returns std::nullopt if the file cannot be mapped or is too short. */
+    std::optional<MappedFlatFileSpan> Read(const FlatFilePos& pos, size_t size) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Drop the mapping of a file, e.g. before it is deleted. Existing spans remain valid. */
+    void Forget(int file) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+
 #endif // BITCOIN_FLATFILE_H
@@ -0,0 +1,379 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_FLATNODEMAP_H
+#define BITCOIN_FLATNODEMAP_H
+
+#include <support/allocators/pool.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Hash map with an open-addressing index over individually allocated nodes.
+ *
+ * The index consists of two parallel arrays: one control byte per slot, and
+ * one node pointer per slot. A full slot's control byte holds 7 bits of the
+ * key's hash, so a lookup scans a few adjacent control bytes and only
+ * dereferences nodes whose hash bits match. Compared to std::unordered_map,
+ * this avoids the per-bucket linked list (one pointer per node plus one per
+ * bucket), and misses almost never touch a node.
+ *
+ * Nodes are allocated from a PoolResource and never move, so references and
+ * pointers to elements stay valid until the element is erased, like in
+ * std::unordered_map. Iterators are invalidated when an insertion grows the
+ * index. Erasing leaves a tombstone in the index, so erasing an element does
+ * not invalidate iterators to other elements, and erase-while-iterating works
+ * as with std::unordered_map.
+ *
+ * The interface is the subset of std::unordered_map that CCoinsMap users need.
+ */
+template <typename Key, typename T, typename Hash, typename KeyEqual, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES = alignof(std::pair<const Key, T>)>
+class FlatNodeMap
+{
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = PoolAllocator<value_type, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>;
+
+private:
+    /** Control byte values. Full slots store the low 7 bits of the hash. */
+    static constexpr uint8_t CTRL_EMPTY{0x80};
+    static constexpr uint8_t CTRL_DELETED{0xfe};
+    static constexpr size_type MIN_CAPACITY{16};
+
+    static bool IsFull(uint8_t ctrl) { return (ctrl & 0x80) == 0; }
+    /**
+     * Maximum number of full and deleted slots before the index is rebuilt
+     * (3/4 load factor). Probing is linear, so keep the clusters a lookup
+     * scans short rather than packing the index tighter.
+     */
+    static size_type MaxLoad(size_type capacity) { return capacity - capacity / 4; }
+
+    Hash m_hash;
+    KeyEqual m_key_equal;
+    allocator_type m_alloc;
+
+    std::unique_ptr<uint8_t[]> m_ctrl;
+    std::unique_ptr<value_type*[]> m_slots;
+    //! Number of slots, zero or a power of two.
+    size_type m_capacity{0};
+    size_type m_size{0};
+    size_type m_peak_size{0};
+    size_type m_deleted{0};
+
+    template <bool IS_CONST>
+    class Iterator
+    {
+        friend class FlatNodeMap;
+        friend class Iterator<!IS_CONST>;
+        using MapPtr = std::conditional_t<IS_CONST, const FlatNodeMap*, FlatNodeMap*>;
+
+        MapPtr m_map{nullptr};
+        size_type m_index{0};
+
+        Iterator(MapPtr map, size_type index) : m_map{map}, m_index{index} {}
+
+        void SkipToFull()
+        {
+            while (m_index < m_map->m_capacity && !IsFull(m_map->m_ctrl[m_index])) ++m_index;
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatNodeMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IS_CONST, const value_type*, value_type*>;
+        using reference = std::conditional_t<IS_CONST, const value_type&, value_type&>;
+
+        Iterator() = default;
+        //! Allow conversion from iterator to const_iterator.
+        template <bool OTHER_CONST, typename = std::enable_if_t<IS_CONST && !OTHER_CONST>>
+        Iterator(const Iterator<OTHER_CONST>& other) : m_map{other.m_map}, m_index{other.m_index} {}
+
+        reference operator*() const { return *m_map->m_slots[m_index]; }
+        pointer operator->() const { return m_map->m_slots[m_index]; }
+
+        Iterator& operator++()
+        {
+            ++m_index;
+            SkipToFull();
+            return *this;
+        }
+        Iterator operator++(int)
+        {
+            Iterator copy{*this};
+            ++*this;
+            return copy;
+        }
+
+        friend bool operator==(const Iterator& a, const Iterator& b) { return a.m_index == b.m_index; }
+        friend bool operator!=(const Iterator& a, const Iterator& b) { return a.m_index != b.m_index; }
+    };
+
+public:
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    /** Same signature as the std::unordered_map constructor, so CCoinsMap can be built the same way. */
+    FlatNodeMap(size_type bucket_count, const Hash& hash, const KeyEqual& key_equal, const allocator_type& alloc)
+        : m_hash{hash}, m_key_equal{key_equal}, m_alloc{alloc}
+    {
+        reserve(bucket_count);
+    }
+
+    FlatNodeMap(const FlatNodeMap&) = delete;
+    FlatNodeMap& operator=(const FlatNodeMap&) = delete;
+
+    ~FlatNodeMap() { DestroyNodes(); }
+
+    iterator begin()
+    {
+        iterator it{this, 0};
+        it.SkipToFull();
+        return it;
+    }
+    const_iterator begin() const
+    {
+        const_iterator it{this, 0};
+        it.SkipToFull();
+        return it;
+    }
+    iterator end() { return {this, m_capacity}; }
+    const_iterator end() const { return {this, m_capacity}; }
+
+    /** Iterator to the first element at or after slot `index` of the index, to resume a scan where an earlier one stopped. */
+    iterator begin_at(size_type index)
+    {
+        iterator it{this, std::min(index, m_capacity)};
+        it.SkipToFull();
+        return it;
+    }
+    /** Slot of the index an iterator points to. Only valid until the index is rebuilt. */
+    size_type index_of(const_iterator it) const { return it.m_index; }
+
+    size_type size() const { return m_size; }
+    /**
+     * Largest size() since construction. The pool keeps the nodes of erased
+     * elements on its freelist, so a map with its own PoolResource holds
+     * memory for peak_size() nodes and reuses peak_size() - size() of them
+     * before allocating more.
+     */
+    size_type peak_size() const { return m_peak_size; }
+    bool empty() const { return m_size == 0; }
+    size_type bucket_count() const { return m_capacity; }
+    allocator_type get_allocator() const { return m_alloc; }
+    hasher hash_function() const { return m_hash; }
+    key_equal key_eq() const { return m_key_equal; }
+
+    iterator find(const Key& key) { return {this, FindIndex(key)}; }
+    const_iterator find(const Key& key) const { return {this, FindIndex(key)}; }
+    size_type count(const Key& key) const { return FindIndex(key) != m_capacity; }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+    {
+        const size_type hash{m_hash(key)};
+        const auto [index, found]{FindOrPrepareInsert(key, hash)};
+        if (found) return {iterator{this, index}, false};
+        value_type* node{NewNode(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...))};
+        return {iterator{this, InsertNode(index, hash, node)}, true};
+    }
+
+    /** Like std::unordered_map::emplace, the element is constructed before checking whether its key exists. */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        value_type* node{NewNode(std::forward<Args>(args)...)};
+        const size_type hash{m_hash(node->first)};
+        const auto [index, found]{FindOrPrepareInsert(node->first, hash)};
+        if (found) {
+            DeleteNode(node);
+            return {iterator{this, index}, false};
+        }
+        return {iterator{this, InsertNode(index, hash, node)}, true};
+    }
+
+    T& operator[](const Key& key) { return try_emplace(key).first->second; }
+
+    /** Erase the element at pos, and return an iterator to the next element. */
+    iterator erase(const_iterator pos)
+    {
+        const size_type index{pos.m_index};
+        assert(index < m_capacity && IsFull(m_ctrl[index]));
+        DeleteNode(m_slots[index]);
+        m_slots[index] = nullptr;
+        // No probe sequence continues past an empty slot, so if the next slot
+        // is empty this one can be made empty too instead of a tombstone.
+        if (m_ctrl[(index + 1) & (m_capacity - 1)] == CTRL_EMPTY) {
+            m_ctrl[index] = CTRL_EMPTY;
+        } else {
+            m_ctrl[index] = CTRL_DELETED;
+            ++m_deleted;
+        }
+        --m_size;
+        iterator next{this, index + 1};
+        next.SkipToFull();
+        return next;
+    }
+    iterator erase(iterator pos) { return erase(const_iterator{pos}); }
+
+    size_type erase(const Key& key)
+    {
+        const size_type index{FindIndex(key)};
+        if (index == m_capacity) return 0;
+        erase(const_iterator{this, index});
+        return 1;
+    }
+
+    /** Destroy all elements, keeping the index allocated. */
+    void clear()
+    {
+        DestroyNodes();
+        if (m_capacity > 0) std::memset(m_ctrl.get(), CTRL_EMPTY, m_capacity);
+        m_size = 0;
+        m_deleted = 0;
+    }
+
+    /** Make room for at least count elements without rebuilding the index. */
+    void reserve(size_type count)
+    {
+        if (count == 0 || MaxLoad(m_capacity) >= count) return;
+        size_type capacity{std::max(m_capacity, MIN_CAPACITY)};
+        while (MaxLoad(capacity) < count) capacity *= 2;
+        Rehash(capacity);
+    }
+
+private:
+    template <typename... Args>
+    value_type* NewNode(Args&&... args)
+    {
+        value_type* node{m_alloc.allocate(1)};
+        try {
+            ::new (node) value_type(std::forward<Args>(args)...);
+        } catch (...) {
+            m_alloc.deallocate(node, 1);
+            throw;
+        }
+        return node;
+    }
+
+    void DeleteNode(value_type* node)
+    {
+        node->~value_type();
+        m_alloc.deallocate(node, 1);
+    }
+
+    void DestroyNodes()
+    {
+        for (size_type i{0}; i < m_capacity; ++i) {
+            if (IsFull(m_ctrl[i])) {
+                DeleteNode(m_slots[i]);
+                m_slots[i] = nullptr;
+            }
+        }
+    }
+
+    static uint8_t HashTag(size_type hash) { return hash & 0x7f; }
+
+    /** Index of key's slot, or m_capacity if not found. */
+    size_type FindIndex(const Key& key) const
+    {
+        if (m_size == 0) return m_capacity;
+        const size_type hash{m_hash(key)};
+        const uint8_t tag{HashTag(hash)};
+        const size_type mask{m_capacity - 1};
+        for (size_type index{(hash >> 7) & mask};; index = (index + 1) & mask) {
+            const uint8_t ctrl{m_ctrl[index]};
+            if (ctrl == tag && m_key_equal(m_slots[index]->first, key)) return index;
+            if (ctrl == CTRL_EMPTY) return m_capacity;
+        }
+    }
+
+    /**
+     * Look up key. If found, return its slot and true. Otherwise return the
+     * slot a new element would be inserted at (the first tombstone or empty
+     * slot on its probe sequence) and false.
+     */
+    std::pair<size_type, bool> FindOrPrepareInsert(const Key& key, size_type hash) const
+    {
+        if (m_capacity == 0) return {0, false};
+        const uint8_t tag{HashTag(hash)};
+        const size_type mask{m_capacity - 1};
+        size_type insert_index{m_capacity};
+        for (size_type index{(hash >> 7) & mask};; index = (index + 1) & mask) {
+            const uint8_t ctrl{m_ctrl[index]};
+            if (ctrl == tag && m_key_equal(m_slots[index]->first, key)) return {index, true};
+            if (ctrl == CTRL_DELETED && insert_index == m_capacity) insert_index = index;
+            if (ctrl == CTRL_EMPTY) return {insert_index == m_capacity ? index : insert_index, false};
+        }
+    }
+
+    /** First non-full slot on hash's probe sequence. */
+    size_type FindInsertIndex(size_type hash) const
+    {
+        const size_type mask{m_capacity - 1};
+        size_type index{(hash >> 7) & mask};
+        while (IsFull(m_ctrl[index])) index = (index + 1) & mask;
+        return index;
+    }
+
+    /** Store node at index (as returned by FindOrPrepareInsert), growing the index first if needed. */
+    size_type InsertNode(size_type index, size_type hash, value_type* node)
+    {
+        // Reusing a tombstone never pushes the load past its limit.
+        if (m_capacity == 0 || m_ctrl[index] != CTRL_DELETED) {
+            if (m_capacity == 0 || m_size + m_deleted + 1 > MaxLoad(m_capacity)) {
+                // If enough of the load is tombstones, rebuilding the index at
+                // the same capacity is enough (at most 5/8 full afterwards).
+                const size_type capacity{m_capacity == 0 ? MIN_CAPACITY : ((m_size + 1) * 8 <= m_capacity * 5 ? m_capacity : m_capacity * 2)};
+                Rehash(capacity);
+                index = FindInsertIndex(hash);
+            }
+        }
+        if (m_ctrl[index] == CTRL_DELETED) --m_deleted;
+        m_ctrl[index] = HashTag(hash);
+        m_slots[index] = node;
+        m_peak_size = std::max(m_peak_size, ++m_size);
+        return index;
+    }
+
+    /** Rebuild the index with the given capacity, dropping all tombstones. Nodes do not move. */
+    void Rehash(size_type capacity)
+    {
+        assert(capacity >= MIN_CAPACITY && (capacity & (capacity - 1)) == 0 && MaxLoad(capacity) >= m_size);
+        auto old_ctrl{std::move(m_ctrl)};
+        auto old_slots{std::move(m_slots)};
+        const size_type old_capacity{m_capacity};
+
+        m_ctrl = std::make_unique<uint8_t[]>(capacity);
+        m_slots = std::make_unique<value_type*[]>(capacity);
+        m_capacity = capacity;
+        m_deleted = 0;
+        std::memset(m_ctrl.get(), CTRL_EMPTY, capacity);
+
+        for (size_type i{0}; i < old_capacity; ++i) {
+            if (!IsFull(old_ctrl[i])) continue;
+            value_type* node{old_slots[i]};
+            const size_type hash{m_hash(node->first)};
+            const size_type index{FindInsertIndex(hash)};
+            m_ctrl[index] = HashTag(hash);
+            m_slots[index] = node;
+        }
+    }
+};
+
+#endif // BITCOIN_FLATNODEMAP_H
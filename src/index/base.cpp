@@ -5,27 +5,36 @@
 #include <chainparams.h>
 #include <common/args.h>
 #include <index/base.h>
+#include <index/indexwriter.h>
 #include <interfaces/chain.h>
 #include <kernel/chain.h>
 #include <logging.h>
 #include <node/abort.h>
+#include <node/blockreadahead.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
 #include <node/database_args.h>
 #include <node/interface_ui.h>
+#include <sync.h>
 #include <tinyformat.h>
 #include <util/thread.h>
+#include <util/time.h>
 #include <util/translation.h>
 #include <validation.h> // For g_chainman
 
+#include <memory>
+#include <optional>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 constexpr uint8_t DB_BEST_BLOCK{'B'};
 
 constexpr auto SYNC_LOG_INTERVAL{30s};
 constexpr auto SYNC_LOCATOR_WRITE_INTERVAL{30s};
-
+//! Number of blocks Sync() hands to a BlockReadAhead at once.
+constexpr size_t SYNC_READ_AHEAD_BLOCKS{1000};
 template <typename... Args>
 void BaseIndex::FatalErrorf(const char* fmt, const Args&... args)
 {
@@ -42,16 +51,23 @@ CBlockLocator GetLocator(interfaces::Chain& chain, const uint256& block_hash)
     return locator;
 }
 
-BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate) :
+BaseIndex::DB::DB(const fs::path& path, std::string_view db_name, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate) :
     CDBWrapper{DBParams{
         .path = path,
         .cache_bytes = n_cache_size,
         .memory_only = f_memory,
         .wipe_data = f_wipe,
         .obfuscate = f_obfuscate,
-        .options = [] { DBOptions options; node::ReadDatabaseArgs(gArgs, options); return options; }()}}
+        .options = [&] { DBOptions options; node::ReadDatabaseArgs(gArgs, options, db_name); return options; }()}},
+    m_name{db_name},
+    m_writer{IndexWriter::Get()}
 {}
 
+BaseIndex::DB::~DB()
+{
+    m_writer->Remove(*this);
+}
+
 bool BaseIndex::DB::ReadBestBlock(CBlockLocator& locator) const
 {
     bool success = Read(DB_BEST_BLOCK, locator);
@@ -66,13 +82,25 @@ void BaseIndex::DB::WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator
     batch.Write(DB_BEST_BLOCK, locator);
 }
 
+bool BaseIndex::DB::QueueWrite(const std::function<void(CDBBatch&)>& fill)
+{
+    return m_writer->Queue(*this, fill);
+}
+
+bool BaseIndex::DB::WaitForWrites()
+{
+    return m_writer->Flush(*this);
+}
+
 BaseIndex::BaseIndex(std::unique_ptr<interfaces::Chain> chain, std::string name)
     : m_chain{std::move(chain)}, m_name{std::move(name)} {}
 
 BaseIndex::~BaseIndex()
 {
     Interrupt();
-    Stop();
+    // The database of the derived class is already destroyed, and wrote the
+    // batches still queued then.
+    StopSync();
 }
 
 bool BaseIndex::Init()
@@ -146,6 +174,7 @@ void BaseIndex::Sync()
     if (!m_synced) {
         std::chrono::steady_clock::time_point last_log_time{0s};
         std::chrono::steady_clock::time_point last_locator_write_time{0s};
+        std::optional<node::BlockReadAhead> read_ahead;
         while (true) {
             if (m_interrupt) {
                 LogPrintf("%s: m_interrupt set; exiting ThreadSync\n", GetName());
@@ -184,15 +213,38 @@ void BaseIndex::Sync()
             }
             pindex = pindex_next;
 
+            std::shared_ptr<const CBlock> block;
+            std::optional<CBlockUndo> block_undo;
+            if (const int window{m_chainstate->m_blockman.ReadAheadWindow()}; window > 0) {
+                // Read the next blocks ahead, and their undo data if used.
+                // Start over when those read are used up, or the chain changed.
+                if (!read_ahead || read_ahead->Peek() != pindex) {
+                    read_ahead.reset();
+                    std::vector<const CBlockIndex*> blocks;
+                    {
+                        LOCK(cs_main);
+                        for (const CBlockIndex* next{pindex}; next && blocks.size() < SYNC_READ_AHEAD_BLOCKS; next = m_chainstate->m_chain.Next(next)) {
+                            blocks.push_back(next);
+                        }
+                    }
+                    read_ahead.emplace(m_chainstate->m_blockman, std::move(blocks), UsesUndoData(), window);
+                }
+                auto entry{read_ahead->Next()};
+                block = std::move(entry.block);
+                block_undo = std::move(entry.undo);
+            } else {
+                auto block_read{std::make_shared<CBlock>()};
+                if (m_chainstate->m_blockman.ReadBlockFromDisk(*block_read, *pindex)) block = std::move(block_read);
+            }
 
-            CBlock block;
             interfaces::BlockInfo block_info = kernel::MakeBlockInfo(pindex);
-            if (!m_chainstate->m_blockman.ReadBlockFromDisk(block, *pindex)) {
+            if (!block) {
                 FatalErrorf("%s: Failed to read block %s from disk",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
             } else {
-                block_info.data = &block;
+                block_info.data = block.get();
+                if (block_undo) block_info.undo_data = &*block_undo;
             }
             if (!CustomAppend(block_info)) {
                 FatalErrorf("%s: Failed to write block %s to index database",
@@ -228,6 +280,9 @@ bool BaseIndex::Commit()
     // Don't commit anything if we haven't indexed any block yet
     // (this could happen if init is interrupted).
     bool ok = m_best_block_index != nullptr;
+    // Write the batches queued for the blocks indexed so far first, so that
+    // the locator never points past the data written.
+    if (ok) ok = GetDB().WaitForWrites();
     if (ok) {
         CDBBatch batch(GetDB());
         ok = CustomCommit(batch);
@@ -248,6 +303,7 @@ bool BaseIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_ti
     assert(current_tip == m_best_block_index);
     assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
 
+    if (!GetDB().WaitForWrites()) return false;
     if (!CustomRewind({current_tip->GetBlockHash(), current_tip->nHeight}, {new_tip->GetBlockHash(), new_tip->nHeight})) {
         return false;
     }
@@ -407,6 +463,14 @@ bool BaseIndex::StartBackgroundSync()
 }
 
 void BaseIndex::Stop()
+{
+    StopSync();
+    if (m_init && !GetDB().WaitForWrites()) {
+        LogError("%s: Failed to write queued %s batches\n", __func__, GetName());
+    }
+}
+
+void BaseIndex::StopSync()
 {
     if (m_chain->context()->validation_signals) {
         m_chain->context()->validation_signals->UnregisterValidationInterface(this);
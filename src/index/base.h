@@ -10,12 +10,16 @@
 #include <util/threadinterrupt.h>
 #include <validationinterface.h>
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
 
 class CBlock;
 class CBlockIndex;
 class Chainstate;
 class ChainstateManager;
+class IndexWriter;
 namespace interfaces {
 class Chain;
 } // namespace interfaces
@@ -50,14 +54,34 @@ protected:
     class DB : public CDBWrapper
     {
     public:
-        DB(const fs::path& path, size_t n_cache_size,
+        DB(const fs::path& path, std::string_view db_name, size_t n_cache_size,
            bool f_memory = false, bool f_wipe = false, bool f_obfuscate = false);
+        /// Writes the batches still queued.
+        ~DB();
+
+        /// Name of the database in the database options, e.g. -dbbloombits=<name>:<n>.
+        const std::string& GetName() const LIFETIMEBOUND { return m_name; }
 
         /// Read block locator of the chain that the index is in sync with.
         bool ReadBestBlock(CBlockLocator& locator) const;
 
         /// Write block locator of the chain that the index is in sync with.
         void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator);
+
+        /// Queue the writes made by `fill` to a batch, which a background
+        /// thread shared by all index databases writes together with the
+        /// batches queued before and after it. Reads of the database only see
+        /// them once written, see WaitForWrites(). Returns false if a queued
+        /// write failed.
+        [[nodiscard]] bool QueueWrite(const std::function<void(CDBBatch&)>& fill);
+
+        /// Write the queued batches now, and wait for them to be written.
+        /// Returns false if a queued write failed.
+        [[nodiscard]] bool WaitForWrites();
+
+    private:
+        const std::string m_name;
+        const std::shared_ptr<IndexWriter> m_writer;
     };
 
 private:
@@ -93,6 +117,10 @@ private:
 
     virtual bool AllowPrune() const = 0;
 
+    /// Unregisters from the validation interface and waits for the sync
+    /// thread to exit.
+    void StopSync();
+
     template <typename... Args>
     void FatalErrorf(const char* fmt, const Args&... args);
 
@@ -111,6 +139,10 @@ protected:
     /// Write update index entries for a newly connected block.
     [[nodiscard]] virtual bool CustomAppend(const interfaces::BlockInfo& block) { return true; }
 
+    /// Whether CustomAppend() uses the undo data of blocks, which Sync() then
+    /// reads ahead with the blocks and passes in BlockInfo::undo_data.
+    virtual bool UsesUndoData() const { return false; }
+
     /// Virtual method called internally by Commit that can be overridden to atomically
     /// commit more index state.
     virtual bool CustomCommit(CDBBatch& batch) { return true; }
@@ -132,6 +164,12 @@ public:
     /// Get the name of the index for display in logs.
     const std::string& GetName() const LIFETIMEBOUND { return m_name; }
 
+    /// Get the name of the index database, as in the database options.
+    const std::string& GetDBName() const LIFETIMEBOUND { return GetDB().GetName(); }
+
+    /// Get statistics of the index database.
+    DBStats GetDBStats() const { return GetDB().GetStats(); }
+
     /// Blocks the current thread until the index is caught up to the current
     /// state of the block chain. This only blocks if the index has gotten in
     /// sync once and only needs to process blocks in the ValidationInterface
@@ -155,7 +193,8 @@ public:
     /// over and the sync thread exits.
     void Sync();
 
-    /// Stops the instance from staying in sync with blockchain updates.
+    /// Stops the instance from staying in sync with blockchain updates, and
+    /// writes the batches still queued.
     void Stop();
 
     /// Get a summary of the index and its state.
@@ -108,7 +108,7 @@ BlockFilterIndex::BlockFilterIndex(std::unique_ptr<interfaces::Chain> chain, Blo
     fs::path path = gArgs.GetDataDirNet() / "indexes" / "blockfilter" / fs::u8path(filter_name);
     fs::create_directories(path);
 
-    m_db = std::make_unique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe);
+    m_db = std::make_unique<BaseIndex::DB>(path / "db", "blockfilterindex", n_cache_size, f_memory, f_wipe);
     m_filter_fileseq = std::make_unique<FlatFileSeq>(std::move(path), "fltr", FLTR_FILE_CHUNK_SIZE);
 }
 
@@ -252,7 +252,8 @@ bool BlockFilterIndex::CustomAppend(const interfaces::BlockInfo& block)
 {
     CBlockUndo block_undo;
 
-    if (block.height > 0) {
+    // Use the undo data read ahead by Sync(), if any.
+    if (block.height > 0 && !block.undo_data) {
         // pindex variable gives indexing code access to node internals. It
         // will be removed in upcoming commit
         const CBlockIndex* pindex = WITH_LOCK(cs_main, return m_chainstate->m_blockman.LookupBlockIndex(block.hash));
@@ -261,7 +262,7 @@ bool BlockFilterIndex::CustomAppend(const interfaces::BlockInfo& block)
         }
     }
 
-    BlockFilter filter(m_filter_type, *Assert(block.data), block_undo);
+    BlockFilter filter(m_filter_type, *Assert(block.data), block.undo_data ? *block.undo_data : block_undo);
 
     const uint256& header = filter.ComputeHeader(m_last_header);
     bool res = Write(filter, block.height, header);
@@ -280,7 +281,7 @@ bool BlockFilterIndex::Write(const BlockFilter& filter, uint32_t block_height, c
     value.second.header = filter_header;
     value.second.pos = m_next_filter_pos;
 
-    if (!m_db->Write(DBHeightKey(block_height), value)) {
+    if (!m_db->QueueWrite([&](CDBBatch& batch) { batch.Write(DBHeightKey(block_height), value); })) {
         return false;
     }
 
@@ -419,7 +420,7 @@ static bool LookupRange(CDBWrapper& db, const std::string& index_name, int start
 bool BlockFilterIndex::LookupFilter(const CBlockIndex* block_index, BlockFilter& filter_out) const
 {
     DBVal entry;
-    if (!LookupOne(*m_db, block_index, entry)) {
+    if (!m_db->WaitForWrites() || !LookupOne(*m_db, block_index, entry)) {
         return false;
     }
 
@@ -442,7 +443,7 @@ bool BlockFilterIndex::LookupFilterHeader(const CBlockIndex* block_index, uint25
     }
 
     DBVal entry;
-    if (!LookupOne(*m_db, block_index, entry)) {
+    if (!m_db->WaitForWrites() || !LookupOne(*m_db, block_index, entry)) {
         return false;
     }
 
@@ -460,7 +461,7 @@ bool BlockFilterIndex::LookupFilterRange(int start_height, const CBlockIndex* st
                                          std::vector<BlockFilter>& filters_out) const
 {
     std::vector<DBVal> entries;
-    if (!LookupRange(*m_db, m_name, start_height, stop_index, entries)) {
+    if (!m_db->WaitForWrites() || !LookupRange(*m_db, m_name, start_height, stop_index, entries)) {
         return false;
     }
 
@@ -481,7 +482,7 @@ bool BlockFilterIndex::LookupFilterHashRange(int start_height, const CBlockIndex
 
 {
     std::vector<DBVal> entries;
-    if (!LookupRange(*m_db, m_name, start_height, stop_index, entries)) {
+    if (!m_db->WaitForWrites() || !LookupRange(*m_db, m_name, start_height, stop_index, entries)) {
         return false;
     }
 
@@ -47,6 +47,8 @@ private:
 
     bool AllowPrune() const override { return true; }
 
+    bool UsesUndoData() const override { return true; }
+
     bool Write(const BlockFilter& filter, uint32_t block_height, const uint256& filter_header);
 
     std::optional<uint256> ReadFilterHeader(int height, const uint256& expected_block_hash);
@@ -109,7 +109,7 @@ CoinStatsIndex::CoinStatsIndex(std::unique_ptr<interfaces::Chain> chain, size_t
     fs::path path{gArgs.GetDataDirNet() / "indexes" / "coinstats"};
     fs::create_directories(path);
 
-    m_db = std::make_unique<CoinStatsIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe);
+    m_db = std::make_unique<CoinStatsIndex::DB>(path / "db", "coinstatsindex", n_cache_size, f_memory, f_wipe);
 }
 
 bool CoinStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
@@ -123,25 +123,31 @@ bool CoinStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
         // pindex variable gives indexing code access to node internals. It
         // will be removed in upcoming commit
         const CBlockIndex* pindex = WITH_LOCK(cs_main, return m_chainstate->m_blockman.LookupBlockIndex(block.hash));
-        if (!m_chainstate->m_blockman.UndoReadFromDisk(block_undo, *pindex)) {
-            return false;
-        }
-
-        std::pair<uint256, DBVal> read_out;
-        if (!m_db->Read(DBHeightKey(block.height - 1), read_out)) {
+        // Use the undo data read ahead by Sync(), if any.
+        if (!block.undo_data && !m_chainstate->m_blockman.UndoReadFromDisk(block_undo, *pindex)) {
             return false;
         }
+        const CBlockUndo& undo{block.undo_data ? *block.undo_data : block_undo};
 
         uint256 expected_block_hash{*Assert(block.prev_hash)};
-        if (read_out.first != expected_block_hash) {
-            LogPrintf("WARNING: previous block header belongs to unexpected block %s; expected %s\n",
-                      read_out.first.ToString(), expected_block_hash.ToString());
-
-            if (!m_db->Read(DBHashKey(expected_block_hash), read_out)) {
-                LogError("%s: previous block header not found; expected %s\n",
-                             __func__, expected_block_hash.ToString());
+        // Only check the entry of the previous block if it was not the last
+        // one appended, as that entry may still be queued for writing.
+        if (expected_block_hash != m_last_block_hash) {
+            std::pair<uint256, DBVal> read_out;
+            if (!m_db->WaitForWrites() || !m_db->Read(DBHeightKey(block.height - 1), read_out)) {
                 return false;
             }
+
+            if (read_out.first != expected_block_hash) {
+                LogPrintf("WARNING: previous block header belongs to unexpected block %s; expected %s\n",
+                          read_out.first.ToString(), expected_block_hash.ToString());
+
+                if (!m_db->Read(DBHashKey(expected_block_hash), read_out)) {
+                    LogError("%s: previous block header not found; expected %s\n",
+                                 __func__, expected_block_hash.ToString());
+                    return false;
+                }
+            }
         }
 
         // Add the new utxos created from the block
@@ -183,7 +189,7 @@ bool CoinStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
 
             // The coinbase tx has no undo data since no former output is spent
             if (!tx->IsCoinBase()) {
-                const auto& tx_undo{block_undo.vtxundo.at(i - 1)};
+                const auto& tx_undo{undo.vtxundo.at(i - 1)};
 
                 for (size_t j = 0; j < tx_undo.vprevout.size(); ++j) {
                     Coin coin{tx_undo.vprevout[j]};
@@ -234,7 +240,11 @@ bool CoinStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
 
     // Intentionally do not update DB_MUHASH here so it stays in sync with
     // DB_BEST_BLOCK, and the index is not corrupted if there is an unclean shutdown.
-    return m_db->Write(DBHeightKey(block.height), value);
+    if (!m_db->QueueWrite([&](CDBBatch& batch) { batch.Write(DBHeightKey(block.height), value); })) {
+        return false;
+    }
+    m_last_block_hash = block.hash;
+    return true;
 }
 
 [[nodiscard]] static bool CopyHeightIndexToHashIndex(CDBIterator& db_it, CDBBatch& batch,
@@ -329,7 +339,7 @@ std::optional<CCoinsStats> CoinStatsIndex::LookUpStats(const CBlockIndex& block_
     stats.index_used = true;
 
     DBVal entry;
-    if (!LookUpOne(*m_db, {block_index.GetBlockHash(), block_index.nHeight}, entry)) {
+    if (!m_db->WaitForWrites() || !LookUpOne(*m_db, {block_index.GetBlockHash(), block_index.nHeight}, entry)) {
         return std::nullopt;
     }
 
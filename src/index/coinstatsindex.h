@@ -7,6 +7,7 @@
 
 #include <crypto/muhash.h>
 #include <index/base.h>
+#include <uint256.h>
 
 class CBlockIndex;
 class CDBBatch;
@@ -37,11 +38,16 @@ private:
     CAmount m_total_unspendables_bip30{0};
     CAmount m_total_unspendables_scripts{0};
     CAmount m_total_unspendables_unclaimed_rewards{0};
+    //! Hash of the last block appended, whose entry may still be queued for
+    //! writing.
+    uint256 m_last_block_hash;
 
     [[nodiscard]] bool ReverseBlock(const CBlock& block, const CBlockIndex* pindex);
 
     bool AllowPrune() const override { return true; }
 
+    bool UsesUndoData() const override { return true; }
+
 protected:
     bool CustomInit(const std::optional<interfaces::BlockKey>& block) override;
 
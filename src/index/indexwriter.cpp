@@ -0,0 +1,144 @@
+// Copyright (c) 2024 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/indexwriter.h>
+
+#include <dbwrapper.h>
+#include <logging.h>
+#include <util/thread.h>
+
+#include <optional>
+#include <utility>
+
+//! Size of the batches queued for an index database at which they are written.
+constexpr size_t INDEX_WRITE_BATCH_SIZE{4 << 20};
+//! Size of the batches queued for an index database at which queueing more
+//! waits for them to be written.
+constexpr size_t MAX_INDEX_QUEUED_SIZE{4 * INDEX_WRITE_BATCH_SIZE};
+//! Time after which queued batches are written, even if small.
+constexpr auto INDEX_WRITE_DELAY{500ms};
+
+static GlobalMutex g_index_writer_mutex;
+static std::weak_ptr<IndexWriter> g_index_writer GUARDED_BY(g_index_writer_mutex);
+
+std::shared_ptr<IndexWriter> IndexWriter::Get()
+{
+    LOCK(g_index_writer_mutex);
+    auto writer{g_index_writer.lock()};
+    if (!writer) {
+        writer = std::make_shared<IndexWriter>();
+        g_index_writer = writer;
+    }
+    return writer;
+}
+
+IndexWriter::IndexWriter()
+    : IndexWriter{[](CDBWrapper& db, CDBBatch& batch) { return db.WriteBatch(batch); }}
+{
+}
+
+IndexWriter::IndexWriter(WriteBatchFn write_batch)
+    : m_write_batch{std::move(write_batch)},
+      m_thread{&util::TraceThread, "idxwrite", [this] { ThreadWrite(); }}
+{
+}
+
+IndexWriter::~IndexWriter()
+{
+    WITH_LOCK(m_mutex, m_stop = true);
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+IndexWriter::DBQueue& IndexWriter::GetQueue(CDBWrapper& db)
+{
+    auto [it, inserted]{m_queues.try_emplace(&db)};
+    if (inserted) {
+        it->second.pending = std::make_unique<CDBBatch>(db);
+        it->second.writing = std::make_unique<CDBBatch>(db);
+    }
+    return it->second;
+}
+
+bool IndexWriter::Queue(CDBWrapper& db, const std::function<void(CDBBatch&)>& fill)
+{
+    WAIT_LOCK(m_mutex, lock);
+    DBQueue& queue{GetQueue(db)};
+    m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return queue.failed || queue.pending->SizeEstimate() < MAX_INDEX_QUEUED_SIZE; });
+    if (queue.failed) return false;
+    const bool was_empty{queue.queued == queue.written};
+    if (was_empty) queue.first_queued = SteadyClock::now();
+    fill(*queue.pending);
+    ++queue.queued;
+    if (was_empty || queue.pending->SizeEstimate() >= INDEX_WRITE_BATCH_SIZE) m_cv.notify_all();
+    return true;
+}
+
+bool IndexWriter::Flush(CDBWrapper& db)
+{
+    WAIT_LOCK(m_mutex, lock);
+    DBQueue& queue{GetQueue(db)};
+    const uint64_t target{queue.queued};
+    if (queue.written < target) {
+        queue.flush = true;
+        m_cv.notify_all();
+        m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return queue.failed || queue.written >= target; });
+    }
+    return !queue.failed;
+}
+
+void IndexWriter::Remove(CDBWrapper& db)
+{
+    Flush(db);
+    LOCK(m_mutex);
+    m_queues.erase(&db);
+}
+
+void IndexWriter::ThreadWrite()
+{
+    WAIT_LOCK(m_mutex, lock);
+    while (true) {
+        const auto now{SteadyClock::now()};
+        std::optional<SteadyClock::time_point> next_due;
+        CDBWrapper* db{nullptr};
+        for (auto& [queue_db, queue] : m_queues) {
+            if (queue.failed || queue.queued == queue.written) continue;
+            const auto due{queue.first_queued + INDEX_WRITE_DELAY};
+            if (m_stop || queue.flush || due <= now || queue.pending->SizeEstimate() >= INDEX_WRITE_BATCH_SIZE) {
+                db = queue_db;
+                break;
+            }
+            if (!next_due || due < *next_due) next_due = due;
+        }
+        if (!db) {
+            // Databases write their queued batches before being destroyed,
+            // and the writer is destroyed with the last of them.
+            if (m_stop) return;
+            if (next_due) {
+                m_cv.wait_until(lock, *next_due);
+            } else {
+                m_cv.wait(lock);
+            }
+            continue;
+        }
+
+        DBQueue& queue{m_queues.at(db)};
+        std::swap(queue.pending, queue.writing);
+        const uint64_t target{queue.queued};
+        queue.flush = false;
+        bool ok{false};
+        {
+            REVERSE_LOCK(lock);
+            try {
+                ok = m_write_batch(*db, *queue.writing);
+            } catch (const dbwrapper_error& e) {
+                LogError("%s: %s\n", __func__, e.what());
+            }
+            queue.writing->Clear();
+        }
+        queue.written = target;
+        if (!ok) queue.failed = true;
+        m_cv.notify_all();
+    }
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2024 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_INDEXWRITER_H
+#define BITCOIN_INDEX_INDEXWRITER_H
+
+#include <sync.h>
+#include <util/time.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
+
+class CDBBatch;
+class CDBWrapper;
+
+/**
+ * Writes the batches queued for the index databases on a background thread.
+ *
+ * The batches queued for a database are accumulated into one, which is
+ * written when it grows large, when it is waited for, or after a short delay.
+ * This way the validation interface thread and the sync threads of the
+ * indexes do not wait for a write of each block, and the databases see fewer,
+ * larger writes.
+ *
+ * Each database gets its own batch and its own write, in the order the
+ * batches were queued; writes to different databases are not atomic with
+ * respect to each other.
+ */
+class IndexWriter
+{
+public:
+    using WriteBatchFn = std::function<bool(CDBWrapper&, CDBBatch&)>;
+
+    //! Get the writer shared by all index databases, starting it if needed.
+    static std::shared_ptr<IndexWriter> Get();
+
+    IndexWriter();
+    //! Write the batches with `write_batch` instead of CDBWrapper::WriteBatch.
+    explicit IndexWriter(WriteBatchFn write_batch);
+    ~IndexWriter();
+
+    //! Queue the writes made by `fill` for a database. Returns false if a
+    //! queued write of the database failed.
+    bool Queue(CDBWrapper& db, const std::function<void(CDBBatch&)>& fill) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    //! Write the batches queued for a database, and wait for them to be
+    //! written. Returns false if a queued write of the database failed.
+    bool Flush(CDBWrapper& db) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    //! Write the batches queued for a database that is being destroyed.
+    void Remove(CDBWrapper& db) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    struct DBQueue {
+        //! Batch accumulating queued writes.
+        std::unique_ptr<CDBBatch> pending;
+        //! Batch being written by the writer thread.
+        std::unique_ptr<CDBBatch> writing;
+        //! Number of batches queued, and written, so far.
+        uint64_t queued{0};
+        uint64_t written{0};
+        //! When the oldest batch not yet written was queued.
+        SteadyClock::time_point first_queued;
+        bool flush{false};
+        bool failed{false};
+    };
+
+    const WriteBatchFn m_write_batch;
+    Mutex m_mutex;
+    //! Signals both batches being queued or waited for, and batches written.
+    std::condition_variable m_cv;
+    std::map<CDBWrapper*, DBQueue> m_queues GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::thread m_thread;
+
+    DBQueue& GetQueue(CDBWrapper& db) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void ThreadWrite() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+
+#endif // BITCOIN_INDEX_INDEXWRITER_H
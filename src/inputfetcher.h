@@ -0,0 +1,204 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INPUTFETCHER_H
+#define BITCOIN_INPUTFETCHER_H
+
+#include <coins.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/hasher.h>
+#include <util/threadnames.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Warm a CCoinsViewCache with the prevouts of a block before it is connected.
+ *
+ * Without prefetching, ConnectBlock() looks up every input through
+ * CCoinsViewCache::AccessCoin(), so each cache miss results in a blocking
+ * database read on the validation thread. The InputFetcher collects all
+ * prevouts of a block that are neither created in the block itself nor
+ * already cached, reads them from the backing view on a pool of worker
+ * threads (the calling thread joins in as well), and then inserts the results
+ * into the cache from the calling thread.
+ *
+ * The backing view passed to FetchInputs() must be safe to read from several
+ * threads at once. CCoinsViewDB (and a CCoinsViewErrorCatcher on top of it)
+ * are, because concurrent LevelDB reads are thread-safe. The cache itself is
+ * only ever touched by the calling thread.
+ */
+class InputFetcher
+{
+private:
+    //! Mutex to protect the inner state
+    Mutex m_mutex;
+
+    //! Worker threads block on this when out of work
+    std::condition_variable m_worker_cv;
+
+    //! Master thread blocks on this while workers are still reading
+    std::condition_variable m_master_cv;
+
+    //! Incremented for every new round of work, so workers know to wake up.
+    uint64_t m_generation GUARDED_BY(m_mutex){0};
+
+    //! The number of workers that have not finished the current round yet.
+    int m_active_workers GUARDED_BY(m_mutex){0};
+
+    bool m_request_stop GUARDED_BY(m_mutex){false};
+
+    /**
+     * State of the current round. Written by the master thread before
+     * m_generation is incremented and read by the workers afterwards, so access
+     * is ordered by m_mutex even though the members are not guarded by it.
+     */
+    const CCoinsView* m_db{nullptr};
+    std::vector<COutPoint> m_outpoints;
+    std::vector<Coin> m_coins;
+
+    //! Index of the next outpoint to be claimed by a worker.
+    std::atomic<size_t> m_next{0};
+
+    //! The maximum number of outpoints claimed by a worker at once
+    const size_t m_batch_size;
+
+    std::vector<std::thread> m_worker_threads;
+
+    /** Read coins from the backing view until there is nothing left to claim. */
+    void Work()
+    {
+        const size_t count{m_outpoints.size()};
+        while (true) {
+            const size_t start{m_next.fetch_add(m_batch_size, std::memory_order_relaxed)};
+            if (start >= count) return;
+            const size_t end{std::min(start + m_batch_size, count)};
+            for (size_t i{start}; i < end; ++i) {
+                if (!m_db->GetCoin(m_outpoints[i], m_coins[i])) {
+                    m_coins[i].Clear();
+                }
+            }
+        }
+    }
+
+    void Loop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        uint64_t generation{0};
+        while (true) {
+            {
+                WAIT_LOCK(m_mutex, lock);
+                while (m_generation == generation && !m_request_stop) {
+                    m_worker_cv.wait(lock);
+                }
+                if (m_request_stop) return;
+                generation = m_generation;
+            }
+            Work();
+            {
+                LOCK(m_mutex);
+                if (--m_active_workers == 0) m_master_cv.notify_one();
+            }
+        }
+    }
+
+public:
+    explicit InputFetcher(size_t batch_size, int worker_threads_num)
+        : m_batch_size{std::max<size_t>(batch_size, 1)}
+    {
+        m_worker_threads.reserve(worker_threads_num);
+        for (int n = 0; n < worker_threads_num; ++n) {
+            m_worker_threads.emplace_back([this, n]() {
+                util::ThreadRename(strprintf("inputfetch.%i", n));
+                Loop();
+            });
+        }
+    }
+
+    // Since this class manages its own resources, which is a thread
+    // pool `m_worker_threads`, copy and move operations are not appropriate.
+    InputFetcher(const InputFetcher&) = delete;
+    InputFetcher& operator=(const InputFetcher&) = delete;
+    InputFetcher(InputFetcher&&) = delete;
+    InputFetcher& operator=(InputFetcher&&) = delete;
+
+    /**
+     * Read the coins spent by block from db in parallel and add them to cache.
+     *
+     * Coins that are created within the block, or for which cache already has
+     * an entry, are not looked up. Fetched coins are inserted as clean entries,
+     * exactly as if they had been pulled in through CCoinsViewCache::FetchCoin().
+     * Calls must not overlap.
+     *
+     * @returns the number of coins that were added to the cache.
+     */
+    size_t FetchInputs(CCoinsViewCache& cache, const CCoinsView& db, const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        if (m_worker_threads.empty() || block.vtx.size() <= 1) return 0;
+
+        std::unordered_set<Txid, SaltedTxidHasher> txids{};
+        txids.reserve(block.vtx.size() - 1);
+        m_outpoints.clear();
+        for (const auto& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const auto& input : tx->vin) {
+                const COutPoint& prevout{input.prevout};
+                if (txids.contains(prevout.hash)) continue;
+                if (cache.HaveCoinInCache(prevout)) continue;
+                m_outpoints.emplace_back(prevout);
+            }
+            txids.emplace(tx->GetHash());
+        }
+        if (m_outpoints.empty()) return 0;
+
+        m_db = &db;
+        m_coins.clear();
+        m_coins.resize(m_outpoints.size());
+        m_next.store(0, std::memory_order_relaxed);
+        {
+            LOCK(m_mutex);
+            m_active_workers = m_worker_threads.size();
+            ++m_generation;
+        }
+        m_worker_cv.notify_all();
+
+        // The master participates in the reads instead of sitting idle.
+        Work();
+        {
+            WAIT_LOCK(m_mutex, lock);
+            while (m_active_workers > 0) {
+                m_master_cv.wait(lock);
+            }
+        }
+
+        size_t fetched{0};
+        for (size_t i{0}; i < m_outpoints.size(); ++i) {
+            if (m_coins[i].IsSpent()) continue;
+            if (cache.EmplaceFetchedCoin(m_outpoints[i], std::move(m_coins[i]))) ++fetched;
+        }
+        m_db = nullptr;
+        m_outpoints.clear();
+        m_coins.clear();
+        return fetched;
+    }
+
+    ~InputFetcher()
+    {
+        WITH_LOCK(m_mutex, m_request_stop = true);
+        m_worker_cv.notify_all();
+        for (std::thread& t : m_worker_threads) {
+            t.join();
+        }
+    }
+
+    bool HasThreads() const { return !m_worker_threads.empty(); }
+};
+
+#endif // BITCOIN_INPUTFETCHER_H
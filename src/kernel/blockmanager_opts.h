@@ -14,6 +14,23 @@ class CChainParams;
 
 namespace kernel {
 
+/** Default for -asyncblockreads, the number of block and undo file reads in flight at once (0 = read synchronously) */
+static constexpr int DEFAULT_ASYNC_BLOCK_READS{0};
+/** Maximum number of block and undo file reads in flight at once */
+static constexpr int MAX_ASYNC_BLOCK_READS{64};
+/** Default for -blockreadahead, the number of blocks read ahead when disconnecting blocks or syncing indexes (0 = read them one at a time) */
+static constexpr int DEFAULT_BLOCK_READ_AHEAD{8};
+/** Maximum number of blocks read ahead when disconnecting blocks or syncing indexes */
+static constexpr int MAX_BLOCK_READ_AHEAD{256};
+/** Default for -compressundofiles, whether to store new undo data as compressed frames */
+static constexpr bool DEFAULT_COMPRESS_UNDO_FILES{false};
+/** Default for -mmapblockfiles, whether to read block and undo files through memory mappings */
+static constexpr bool DEFAULT_MMAP_BLOCK_FILES{false};
+/** Default for -reindexthreads, the number of threads scanning block files during -reindex (0 = scan them one at a time) */
+static constexpr int DEFAULT_REINDEX_THREADS{0};
+/** Maximum number of threads scanning block files during -reindex */
+static constexpr int MAX_REINDEX_THREADS{16};
+
 /**
  * An options struct for `BlockManager`, more ergonomically referred to as
  * `BlockManager::Options` due to the using-declaration in `BlockManager`.
@@ -24,6 +41,11 @@ struct BlockManagerOpts {
     bool fast_prune{false};
     const fs::path blocks_dir;
     Notifications& notifications;
+    bool mmap_block_files{DEFAULT_MMAP_BLOCK_FILES};
+    int reindex_threads{DEFAULT_REINDEX_THREADS};
+    bool compress_undo_files{DEFAULT_COMPRESS_UNDO_FILES};
+    int async_block_reads{DEFAULT_ASYNC_BLOCK_READS};
+    int block_read_ahead{DEFAULT_BLOCK_READ_AHEAD};
 };
 
 } // namespace kernel
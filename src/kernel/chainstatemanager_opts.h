@@ -48,6 +48,10 @@ struct ChainstateManagerOpts {
     ValidationSignals* signals{nullptr};
     //! Number of script check worker threads. Zero means no parallel verification.
     int worker_threads_num{0};
+    //! Whether script check workers steal work from per-thread queues instead of sharing one queue.
+    bool script_check_work_stealing{false};
+    //! Whether periodic and cache-size triggered chainstate flushes write the coins database on a background thread.
+    bool async_coins_flush{false};
 };
 
 } // namespace kernel
@@ -0,0 +1,151 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_KERNEL_COINSRANGEREADER_H
+#define BITCOIN_KERNEL_COINSRANGEREADER_H
+
+#include <coins.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/thread.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace kernel {
+//! Maximum number of threads that read coins for one CoinsRangeReader.
+static constexpr int MAX_COINS_READ_THREADS{8};
+//! Number of ranges the coins are split into per reading thread, so that
+//! threads finishing early can claim more of them.
+static constexpr int COINS_READ_RANGES_PER_THREAD{4};
+//! Number of chunks a range may be read ahead of the one being handed out.
+static constexpr size_t COINS_READ_QUEUE_DEPTH{4};
+
+/**
+ * Reads the ranges of coins returned by CCoinsView::Cursors() on several
+ * threads, and hands out the chunks they are turned into in key order.
+ *
+ * Ranges are claimed in key order, and each range may only be read a few
+ * chunks ahead, which bounds memory use to a few chunks per thread.
+ */
+template <typename Chunk>
+class CoinsRangeReader
+{
+public:
+    //! Passes a chunk on, waiting for room in its range. Returns false if the
+    //! reader is being destroyed.
+    using PushChunk = std::function<bool(Chunk&&)>;
+    //! Turns the coins of a cursor into chunks. Returns false if a coin could
+    //! not be read, or pushing a chunk failed.
+    using ReadRange = std::function<bool(CCoinsViewCursor&, const PushChunk&)>;
+
+private:
+    struct Range {
+        std::unique_ptr<CCoinsViewCursor> cursor;
+        std::deque<Chunk> chunks;
+        bool done{false};
+    };
+
+    const ReadRange m_read_range;
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<Range> m_ranges GUARDED_BY(m_mutex);
+    bool m_interrupt GUARDED_BY(m_mutex){false};
+    bool m_failed GUARDED_BY(m_mutex){false};
+    //! Next range to be claimed by a reading thread.
+    std::atomic<size_t> m_next_range{0};
+    //! Range being handed out by NextChunk().
+    size_t m_current_range{0};
+    std::vector<std::thread> m_threads;
+
+    bool Push(size_t range, Chunk&& chunk) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_interrupt || m_ranges[range].chunks.size() < COINS_READ_QUEUE_DEPTH; });
+        if (m_interrupt) return false;
+        m_ranges[range].chunks.push_back(std::move(chunk));
+        m_cv.notify_all();
+        return true;
+    }
+
+    void ReadRanges() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        for (size_t range{m_next_range++}; range < WITH_LOCK(m_mutex, return m_ranges.size()); range = m_next_range++) {
+            CCoinsViewCursor& cursor{*WITH_LOCK(m_mutex, return m_ranges[range].cursor.get())};
+            const bool ok{m_read_range(cursor, [&](Chunk&& chunk) { return Push(range, std::move(chunk)); })};
+            LOCK(m_mutex);
+            if (!ok) m_failed = true;
+            m_ranges[range].done = true;
+            m_ranges[range].cursor.reset();
+            m_cv.notify_all();
+            if (!ok) return;
+        }
+    }
+
+public:
+    /**
+     * Start reading coins.
+     *
+     * @param[in] cursors      Cursors over disjoint ranges in key order, which
+     *                         see the same database state
+     * @param[in] num_threads  Number of reading threads
+     * @param[in] thread_name  Name of the reading threads, suffixed by their number
+     * @param[in] read_range   Called on the reading threads for each range
+     */
+    CoinsRangeReader(std::vector<std::unique_ptr<CCoinsViewCursor>> cursors, int num_threads, const std::string& thread_name, ReadRange read_range)
+        : m_read_range{std::move(read_range)}
+    {
+        {
+            LOCK(m_mutex);
+            for (auto& cursor : cursors) m_ranges.emplace_back().cursor = std::move(cursor);
+        }
+        for (int i{0}; i < num_threads; ++i) {
+            m_threads.emplace_back(&util::TraceThread, strprintf("%s.%i", thread_name, i), [this] { ReadRanges(); });
+        }
+    }
+
+    ~CoinsRangeReader()
+    {
+        WITH_LOCK(m_mutex, m_interrupt = true);
+        m_cv.notify_all();
+        for (auto& thread : m_threads) thread.join();
+    }
+
+    CoinsRangeReader(const CoinsRangeReader&) = delete;
+    CoinsRangeReader& operator=(const CoinsRangeReader&) = delete;
+
+    //! The next chunk in key order, or std::nullopt once all coins were read
+    //! or reading failed.
+    std::optional<Chunk> NextChunk() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        while (m_current_range < m_ranges.size()) {
+            Range& range{m_ranges[m_current_range]};
+            m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_failed || !range.chunks.empty() || range.done; });
+            if (m_failed) return std::nullopt;
+            if (!range.chunks.empty()) {
+                Chunk chunk{std::move(range.chunks.front())};
+                range.chunks.pop_front();
+                m_cv.notify_all();
+                return chunk;
+            }
+            ++m_current_range;
+        }
+        return std::nullopt;
+    }
+
+    bool Failed() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex) { return WITH_LOCK(m_mutex, return m_failed); }
+};
+} // namespace kernel
+
+#endif // BITCOIN_KERNEL_COINSRANGEREADER_H
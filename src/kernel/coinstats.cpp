@@ -8,6 +8,7 @@
 #include <coins.h>
 #include <crypto/muhash.h>
 #include <hash.h>
+#include <kernel/coinsrangereader.h>
 #include <logging.h>
 #include <node/blockstorage.h>
 #include <primitives/transaction.h>
@@ -22,12 +23,14 @@
 #include <util/overflow.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <cassert>
 #include <iosfwd>
 #include <iterator>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 
 namespace kernel {
@@ -55,7 +58,12 @@ static void TxOutSer(T& ss, const COutPoint& outpoint, const Coin& coin)
     ss << coin.out;
 }
 
-static void ApplyCoinHash(HashWriter& ss, const COutPoint& outpoint, const Coin& coin)
+void ApplyCoinHash(HashWriter& ss, const COutPoint& outpoint, const Coin& coin)
+{
+    TxOutSer(ss, outpoint, coin);
+}
+
+void SerializeCoinForHash(DataStream& ss, const COutPoint& outpoint, const Coin& coin)
 {
     TxOutSer(ss, outpoint, coin);
 }
@@ -76,6 +84,12 @@ void RemoveCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& c
 
 static void ApplyCoinHash(std::nullptr_t, const COutPoint& outpoint, const Coin& coin) {}
 
+//! Serialize a coin for hashing with HashWriter later, see PartialHash.
+static void ApplyCoinHash(DataStream& ss, const COutPoint& outpoint, const Coin& coin)
+{
+    TxOutSer(ss, outpoint, coin);
+}
+
 //! Warning: be very careful when changing this! assumeutxo and UTXO snapshot
 //! validation commitments are reliant on the hash constructed by this
 //! function.
@@ -111,38 +125,96 @@ static void ApplyStats(CCoinsStats& stats, const uint256& hash, const std::map<u
     }
 }
 
-//! Calculate statistics about the unspent transaction output set
+//! Number of coins a thread of ComputeUTXOStats() hashes before passing them on.
+static constexpr uint64_t UTXO_STATS_CHUNK_COINS{10'000};
+
+//! The hash of a chunk of coins, which is merged into the hash of the UTXO set
+//! in key order. The serialized coins are hashed in order as a whole, while
+//! MuHash3072 sets can be combined.
 template <typename T>
-static bool ComputeUTXOStats(CCoinsView* view, CCoinsStats& stats, T hash_obj, const std::function<void()>& interruption_point)
+struct PartialHash {
+    using type = T;
+};
+template <>
+struct PartialHash<HashWriter> {
+    using type = DataStream;
+};
+
+static void MergeHash(HashWriter& ss, const DataStream& chunk) { ss.write(chunk); }
+static void MergeHash(MuHash3072& muhash, const MuHash3072& chunk) { muhash *= chunk; }
+static void MergeHash(std::nullptr_t, std::nullptr_t) {}
+
+//! Statistics and hash of the coins of one or more whole transactions.
+template <typename T>
+struct UTXOStatsChunk {
+    CCoinsStats stats{};
+    typename PartialHash<T>::type hash{};
+};
+
+static void MergeStats(CCoinsStats& stats, const CCoinsStats& chunk)
 {
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-    assert(pcursor);
+    stats.nTransactions += chunk.nTransactions;
+    stats.nTransactionOutputs += chunk.nTransactionOutputs;
+    stats.nBogoSize += chunk.nBogoSize;
+    if (stats.total_amount.has_value()) {
+        stats.total_amount = chunk.total_amount.has_value() ? CheckedAdd(*stats.total_amount, *chunk.total_amount) : std::nullopt;
+    }
+    stats.coins_count += chunk.coins_count;
+}
 
+//! Turn the coins of a range into chunks, which only end between transactions.
+template <typename T>
+static bool ReadStatsRange(CCoinsViewCursor& cursor, const typename CoinsRangeReader<UTXOStatsChunk<T>>::PushChunk& push)
+{
+    UTXOStatsChunk<T> chunk;
     Txid prevkey;
     std::map<uint32_t, Coin> outputs;
-    while (pcursor->Valid()) {
-        if (interruption_point) interruption_point();
+    for (; cursor.Valid(); cursor.Next()) {
         COutPoint key;
         Coin coin;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
-            if (!outputs.empty() && key.hash != prevkey) {
-                ApplyStats(stats, prevkey, outputs);
-                ApplyHash(hash_obj, prevkey, outputs);
-                outputs.clear();
-            }
-            prevkey = key.hash;
-            outputs[key.n] = std::move(coin);
-            stats.coins_count++;
-        } else {
+        if (!cursor.GetKey(key) || !cursor.GetValue(coin)) {
             LogError("%s: unable to read value\n", __func__);
             return false;
         }
-        pcursor->Next();
+        if (!outputs.empty() && key.hash != prevkey) {
+            ApplyStats(chunk.stats, prevkey, outputs);
+            ApplyHash(chunk.hash, prevkey, outputs);
+            outputs.clear();
+            if (chunk.stats.coins_count >= UTXO_STATS_CHUNK_COINS) {
+                if (!push(std::move(chunk))) return false;
+                chunk = {};
+            }
+        }
+        prevkey = key.hash;
+        outputs[key.n] = std::move(coin);
+        chunk.stats.coins_count++;
     }
     if (!outputs.empty()) {
-        ApplyStats(stats, prevkey, outputs);
-        ApplyHash(hash_obj, prevkey, outputs);
+        ApplyStats(chunk.stats, prevkey, outputs);
+        ApplyHash(chunk.hash, prevkey, outputs);
+    }
+    return chunk.stats.coins_count == 0 || push(std::move(chunk));
+}
+
+//! Calculate statistics about the unspent transaction output set
+//!
+//! The coins are read and hashed in disjoint key ranges on several threads,
+//! and merged in key order, so the result does not depend on the number of
+//! threads.
+template <typename T>
+static bool ComputeUTXOStats(CCoinsView* view, CCoinsStats& stats, T hash_obj, const std::function<void()>& interruption_point)
+{
+    const int num_threads{std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1, MAX_COINS_READ_THREADS)};
+    auto cursors{view->Cursors(num_threads * COINS_READ_RANGES_PER_THREAD)};
+    assert(!cursors.empty());
+
+    CoinsRangeReader<UTXOStatsChunk<T>> reader{std::move(cursors), num_threads, "coinstats", ReadStatsRange<T>};
+    while (auto chunk{reader.NextChunk()}) {
+        if (interruption_point) interruption_point();
+        MergeStats(stats, chunk->stats);
+        MergeHash(hash_obj, chunk->hash);
     }
+    if (reader.Failed()) return false;
 
     FinalizeHash(hash_obj, stats);
 
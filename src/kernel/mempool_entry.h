@@ -11,6 +11,7 @@
 #include <policy/policy.h>
 #include <policy/settings.h>
 #include <primitives/transaction.h>
+#include <txmempoolindex.h>
 #include <util/epochguard.h>
 #include <util/overflow.h>
 
@@ -185,6 +186,7 @@ public:
     Children& GetMemPoolChildren() const { return m_children; }
 
     mutable size_t idx_randomized; //!< Index in mempool's txns_randomized
+    mutable TxMemPoolIndexPositions m_index_positions; //!< Positions in mempool's mapTx indexes
     mutable Epoch::Marker m_epoch_marker; //!< epoch when last touched, useful for graph algorithms
 };
 
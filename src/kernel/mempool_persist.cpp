@@ -14,20 +14,26 @@
 #include <sync.h>
 #include <txmempool.h>
 #include <uint256.h>
+#include <util/check.h>
 #include <util/fs.h>
 #include <util/fs_helpers.h>
+#include <util/hasher.h>
 #include <util/signalinterrupt.h>
 #include <util/time.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <exception>
 #include <functional>
+#include <ios>
 #include <map>
 #include <memory>
+#include <numeric>
 #include <set>
 #include <stdexcept>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -36,7 +42,16 @@ using fsbridge::FopenFn;
 namespace kernel {
 
 static const uint64_t MEMPOOL_DUMP_VERSION_NO_XOR_KEY{1};
-static const uint64_t MEMPOOL_DUMP_VERSION{2};
+static const uint64_t MEMPOOL_DUMP_VERSION_NO_LAYERS{2};
+/**
+ * Since version 3, the transactions are written in layers: each transaction
+ * only spends outputs of transactions in earlier layers, not of any in its
+ * own, so that a whole layer can be checked for acceptance at once.
+ */
+static const uint64_t MEMPOOL_DUMP_VERSION{3};
+
+//! Maximum number of transactions submitted to ProcessTransactions() at once when loading.
+static constexpr size_t LOAD_BATCH_SIZE{1000};
 
 bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active_chainstate, ImportMempoolOptions&& opts)
 {
@@ -61,7 +76,7 @@ bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active
         std::vector<std::byte> xor_key;
         if (version == MEMPOOL_DUMP_VERSION_NO_XOR_KEY) {
             // Leave XOR-key empty
-        } else if (version == MEMPOOL_DUMP_VERSION) {
+        } else if (version == MEMPOOL_DUMP_VERSION_NO_LAYERS || version == MEMPOOL_DUMP_VERSION) {
             file >> xor_key;
         } else {
             return false;
@@ -72,6 +87,34 @@ bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active
         uint64_t txns_tried = 0;
         LogInfo("Loading %u mempool transactions from file...\n", total_txns_to_load);
         int next_tenth_to_report = 0;
+
+        // Transactions are submitted in batches, whose scripts are checked in
+        // parallel. A batch never spans layers, so that all its transactions
+        // only spend outputs that are in the mempool or the UTXO set already.
+        // Without layers, children are checked after the rest of their batch.
+        std::vector<CTransactionRef> batch;
+        std::vector<int64_t> batch_times;
+        const auto submit_batch{[&] {
+            const auto results{active_chainstate.m_chainman.ProcessTransactions(batch, /*test_accept=*/false, batch_times)};
+            for (size_t i{0}; i < batch.size(); ++i) {
+                if (results[i].m_result_type == MempoolAcceptResult::ResultType::VALID) {
+                    ++count;
+                } else {
+                    // mempool may contain the transaction already, e.g. from
+                    // wallet(s) having loaded it while we were processing
+                    // mempool transactions; consider these as valid, instead of
+                    // failed, but mark them as 'already there'
+                    if (pool.exists(GenTxid::Txid(batch[i]->GetHash()))) {
+                        ++already_there;
+                    } else {
+                        ++failed;
+                    }
+                }
+            }
+            batch.clear();
+            batch_times.clear();
+        }};
+        uint64_t layer_txns_left{0};
         while (txns_tried < total_txns_to_load) {
             const int percentage_done(100.0 * txns_tried / total_txns_to_load);
             if (next_tenth_to_report < percentage_done / 10) {
@@ -79,7 +122,15 @@ bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active
                         percentage_done, txns_tried, total_txns_to_load - txns_tried);
                 next_tenth_to_report = percentage_done / 10;
             }
+            if (version == MEMPOOL_DUMP_VERSION && layer_txns_left == 0) {
+                submit_batch();
+                layer_txns_left = ReadCompactSize(file);
+                if (layer_txns_left == 0 || layer_txns_left > total_txns_to_load - txns_tried) {
+                    throw std::ios_base::failure("Invalid layer size");
+                }
+            }
             ++txns_tried;
+            if (layer_txns_left) --layer_txns_left;
 
             CTransactionRef tx;
             int64_t nTime;
@@ -97,27 +148,18 @@ bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active
                 pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
             if (nTime > TicksSinceEpoch<std::chrono::seconds>(now - pool.m_opts.expiry)) {
-                LOCK(cs_main);
-                const auto& accepted = AcceptToMemoryPool(active_chainstate, tx, nTime, /*bypass_limits=*/false, /*test_accept=*/false);
-                if (accepted.m_result_type == MempoolAcceptResult::ResultType::VALID) {
-                    ++count;
-                } else {
-                    // mempool may contain the transaction already, e.g. from
-                    // wallet(s) having loaded it while we were processing
-                    // mempool transactions; consider these as valid, instead of
-                    // failed, but mark them as 'already there'
-                    if (pool.exists(GenTxid::Txid(tx->GetHash()))) {
-                        ++already_there;
-                    } else {
-                        ++failed;
-                    }
-                }
+                batch.push_back(std::move(tx));
+                batch_times.push_back(nTime);
             } else {
                 ++expired;
             }
+            if (batch.size() >= LOAD_BATCH_SIZE) submit_batch();
             if (active_chainstate.m_chainman.m_interrupt)
                 return false;
         }
+        submit_batch();
+        if (active_chainstate.m_chainman.m_interrupt)
+            return false;
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
 
@@ -152,6 +194,8 @@ bool DumpMempool(const CTxMemPool& pool, const fs::path& dump_path, FopenFn mock
 
     std::map<uint256, CAmount> mapDeltas;
     std::vector<TxMempoolInfo> vinfo;
+    //! Layer of each transaction in vinfo, see MEMPOOL_DUMP_VERSION.
+    std::vector<size_t> layers;
     std::set<uint256> unbroadcast_txids;
 
     static Mutex dump_mutex;
@@ -164,6 +208,20 @@ bool DumpMempool(const CTxMemPool& pool, const fs::path& dump_path, FopenFn mock
         }
         vinfo = pool.infoAll();
         unbroadcast_txids = pool.GetUnbroadcastTxs();
+        if (!pool.m_opts.persist_v1_dat) {
+            // Parents come before their children in vinfo, so their layers
+            // are known when those of the children are determined.
+            std::unordered_map<Txid, size_t, SaltedTxidHasher> layer_of;
+            layers.reserve(vinfo.size());
+            for (const auto& info : vinfo) {
+                size_t layer{0};
+                for (const CTxMemPoolEntry& parent : Assert(pool.GetEntry(info.tx->GetHash()))->GetMemPoolParentsConst()) {
+                    layer = std::max(layer, layer_of.at(parent.GetTx().GetHash()) + 1);
+                }
+                layer_of.emplace(info.tx->GetHash(), layer);
+                layers.push_back(layer);
+            }
+        }
     }
 
     auto mid = SteadyClock::now();
@@ -187,11 +245,23 @@ bool DumpMempool(const CTxMemPool& pool, const fs::path& dump_path, FopenFn mock
         uint64_t mempool_transactions_to_write(vinfo.size());
         file << mempool_transactions_to_write;
         LogInfo("Writing %u mempool transactions to file...\n", mempool_transactions_to_write);
-        for (const auto& i : vinfo) {
+        const auto write_tx{[&](const TxMempoolInfo& i) {
             file << TX_WITH_WITNESS(*(i.tx));
             file << int64_t{count_seconds(i.m_time)};
             file << int64_t{i.nFeeDelta};
             mapDeltas.erase(i.tx->GetHash());
+        }};
+        if (pool.m_opts.persist_v1_dat) {
+            for (const auto& i : vinfo) write_tx(i);
+        } else {
+            std::vector<size_t> order(vinfo.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return layers[a] < layers[b]; });
+            for (size_t begin{0}, end; begin < order.size(); begin = end) {
+                for (end = begin + 1; end < order.size() && layers[order[end]] == layers[order[begin]]; ++end) {}
+                WriteCompactSize(file, end - begin);
+                for (size_t n{begin}; n < end; ++n) write_tx(vinfo[order[n]]);
+            }
         }
 
         file << mapDeltas;
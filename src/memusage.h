@@ -5,6 +5,7 @@
 #ifndef BITCOIN_MEMUSAGE_H
 #define BITCOIN_MEMUSAGE_H
 
+#include <flatnodemap.h>
 #include <indirectmap.h>
 #include <prevector.h>
 #include <support/allocators/pool.h>
@@ -202,6 +203,20 @@ static inline size_t DynamicUsage(const std::unordered_map<Key,
     return usage_resource + usage_chunks + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+template <class Key, class T, class Hash, class Pred, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const FlatNodeMap<Key, T, Hash, Pred, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& m)
+{
+    auto* pool_resource = m.get_allocator().resource();
+
+    // Chunk bookkeeping is the same as for the unordered_map above. The index
+    // is two arrays: one control byte and one node pointer per slot.
+    size_t estimated_list_node_size = MallocUsage(sizeof(void*) * 3);
+    size_t usage_resource = estimated_list_node_size * pool_resource->NumAllocatedChunks();
+    size_t usage_chunks = MallocUsage(pool_resource->ChunkSizeBytes()) * pool_resource->NumAllocatedChunks();
+    size_t usage_index = m.bucket_count() == 0 ? 0 : MallocUsage(m.bucket_count()) + MallocUsage(sizeof(void*) * m.bucket_count());
+    return usage_resource + usage_chunks + usage_index;
+}
+
 } // namespace memusage
 
 #endif // BITCOIN_MEMUSAGE_H
@@ -180,6 +180,10 @@ static constexpr double MAX_ADDR_RATE_PER_SECOND{0.1};
 static constexpr size_t MAX_ADDR_PROCESSING_TOKEN_BUCKET{MAX_ADDR_TO_SEND};
 /** The compactblocks version we support. See BIP 152. */
 static constexpr uint64_t CMPCTBLOCKS_VERSION{2};
+/** Maximum number of blocks requested by a peer that are read ahead of their turn to be sent, with -asyncblockreads. */
+static constexpr size_t MAX_BLOCK_READS_PER_PEER{8};
+/** Maximum number of blocks read ahead of their turn for all peers together, with -asyncblockreads. */
+static constexpr size_t MAX_BLOCK_READS{64};
 
 // Internal stuff
 namespace {
@@ -370,6 +374,8 @@ struct Peer {
     Mutex m_getdata_requests_mutex;
     /** Work queue of items requested by this peer **/
     std::deque<CInv> m_getdata_requests GUARDED_BY(m_getdata_requests_mutex);
+    /** Reads of blocks in m_getdata_requests, queued ahead of their turn to be sent **/
+    std::map<uint256, node::BlockManager::AsyncRead> m_block_reads GUARDED_BY(m_getdata_requests_mutex);
 
     /** Time of the last getheaders message to this peer */
     NodeClock::time_point m_last_getheaders_timestamp GUARDED_BY(NetEventsInterface::g_msgproc_mutex){};
@@ -783,6 +789,9 @@ private:
     TxRequestTracker m_txrequest GUARDED_BY(::cs_main);
     std::unique_ptr<TxReconciliationTracker> m_txreconciliation;
 
+    /** Serialized blocks recently served to peers. nullptr if disabled. */
+    std::unique_ptr<BlockServeCache> m_block_serve_cache;
+
     /** The height of the best chain */
     std::atomic<int> m_best_height{-1};
     /** The time of the best chain tip block */
@@ -842,6 +851,9 @@ private:
     /** Number of peers with wtxid relay. */
     std::atomic<int> m_wtxid_relay_peers{0};
 
+    /** Number of blocks read ahead of their turn to be sent, for all peers. */
+    std::atomic<size_t> m_block_reads_count{0};
+
     /** Number of outbound peers with m_chain_sync.m_protect. */
     int m_outbound_peers_with_protect_from_disconnect GUARDED_BY(cs_main) = 0;
 
@@ -1108,8 +1120,21 @@ private:
      */
     bool BlockRequestAllowed(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool AlreadyHaveBlock(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
-    void ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv& inv)
+    /**
+     * Send a block that the peer requested.
+     *
+     * @param[in] queued_read  Read of the block queued by QueueBlockReads(), if any
+     */
+    void ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv& inv, std::optional<node::BlockManager::AsyncRead> queued_read)
         EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex);
+    /**
+     * Queue reads of the blocks requested by the peer from `begin` on, so that
+     * they are read from disk while earlier ones are sent. Nothing is read
+     * ahead while the peer's send buffer is full or the upload target is
+     * reached, and at most MAX_BLOCK_READS blocks are read ahead in total.
+     */
+    void QueueBlockReads(CNode& pfrom, Peer& peer, std::deque<CInv>::const_iterator begin)
+        EXCLUSIVE_LOCKS_REQUIRED(peer.m_getdata_requests_mutex, !::cs_main);
 
     /**
      * Validation logic for compact filters request handling.
@@ -1732,6 +1757,11 @@ void PeerManagerImpl::FinalizeNode(const CNode& node)
         misbehavior = WITH_LOCK(peer->m_misbehavior_mutex, return peer->m_misbehavior_score);
         m_wtxid_relay_peers -= peer->m_wtxid_relay;
         assert(m_wtxid_relay_peers >= 0);
+        {
+            LOCK(peer->m_getdata_requests_mutex);
+            m_block_reads_count -= peer->m_block_reads.size();
+            peer->m_block_reads.clear();
+        }
     }
     CNodeState *state = State(nodeid);
     assert(state != nullptr);
@@ -1880,6 +1910,7 @@ PeerManagerInfo PeerManagerImpl::GetInfo() const
     return PeerManagerInfo{
         .median_outbound_time_offset = m_outbound_time_offsets.Median(),
         .ignores_incoming_txs = m_opts.ignore_incoming_txs,
+        .block_serve_cache = m_block_serve_cache ? std::make_optional(m_block_serve_cache->GetStats()) : std::nullopt,
     };
 }
 
@@ -2068,6 +2099,9 @@ PeerManagerImpl::PeerManagerImpl(CConnman& connman, AddrMan& addrman,
     if (opts.reconcile_txs) {
         m_txreconciliation = std::make_unique<TxReconciliationTracker>(TXRECONCILIATION_VERSION);
     }
+    if (opts.block_serve_cache_bytes > 0) {
+        m_block_serve_cache = std::make_unique<BlockServeCache>(opts.block_serve_cache_bytes);
+    }
 }
 
 void PeerManagerImpl::StartScheduledTasks(CScheduler& scheduler)
@@ -2407,7 +2441,33 @@ void PeerManagerImpl::RelayAddress(NodeId originator,
     }
 }
 
-void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv& inv)
+void PeerManagerImpl::QueueBlockReads(CNode& pfrom, Peer& peer, std::deque<CInv>::const_iterator begin)
+{
+    // Blocks read ahead are held in memory until they are sent.
+    if (pfrom.fPauseSend || m_connman.OutboundTargetReached(/*historicalBlockServingLimit=*/true)) return;
+    std::vector<std::pair<uint256, FlatFilePos>> blocks;
+    {
+        LOCK(cs_main);
+        for (auto it{begin}; it != peer.m_getdata_requests.cend() &&
+                             peer.m_block_reads.size() + blocks.size() < MAX_BLOCK_READS_PER_PEER &&
+                             m_block_reads_count + blocks.size() < MAX_BLOCK_READS;
+             ++it) {
+            if (!it->IsGenBlkMsg() || peer.m_block_reads.count(it->hash)) continue;
+            const CBlockIndex* pindex{m_chainman.m_blockman.LookupBlockIndex(it->hash)};
+            // The remaining checks are done when the block is sent.
+            if (!pindex || !(pindex->nStatus & BLOCK_HAVE_DATA) || !BlockRequestAllowed(pindex)) continue;
+            blocks.emplace_back(it->hash, pindex->GetBlockPos());
+        }
+    }
+    for (const auto& [hash, pos] : blocks) {
+        // A block may have been requested more than once.
+        if (peer.m_block_reads.count(hash)) continue;
+        peer.m_block_reads.emplace(hash, m_chainman.m_blockman.ReadRawBlockAsync(pos));
+        ++m_block_reads_count;
+    }
+}
+
+void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv& inv, std::optional<node::BlockManager::AsyncRead> queued_read)
 {
     std::shared_ptr<const CBlock> a_recent_block;
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> a_recent_compact_block;
@@ -2482,14 +2542,50 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
         block_pos = pindex->GetBlockPos();
     }
 
+    // If a peer is asking for old blocks, we're almost guaranteed
+    // they won't have a useful mempool to match against a compact block,
+    // and we don't feel like constructing the object for them, so
+    // instead we respond with the full, non-compact block.
+    const bool send_compact{can_direct_fetch && pindex->nHeight >= tip->nHeight - MAX_CMPCTBLOCK_DEPTH};
+    // How the block is serialized for the peer. Filtered blocks depend on the
+    // peer's filter, and are not cached.
+    std::optional<BlockServeCache::Format> format;
+    if (inv.IsMsgBlk()) {
+        format = BlockServeCache::Format::NO_WITNESS;
+    } else if (inv.IsMsgWitnessBlk() || (inv.IsMsgCmpctBlk() && !send_compact)) {
+        format = BlockServeCache::Format::WITNESS;
+    } else if (inv.IsMsgCmpctBlk()) {
+        format = BlockServeCache::Format::COMPACT;
+    }
+    const std::string block_msg_type{format == BlockServeCache::Format::COMPACT ? NetMsgType::CMPCTBLOCK : NetMsgType::BLOCK};
+    const bool use_cache{m_block_serve_cache && format};
+    // Send the block message, and add it to the cache.
+    const auto push_and_cache{[&](const auto& msg) {
+        if (!use_cache) return MakeAndPushMessage(pfrom, block_msg_type, msg);
+        auto data{std::make_shared<std::vector<unsigned char>>()};
+        VectorWriter{*data, 0, msg};
+        MakeAndPushMessage(pfrom, block_msg_type, Span{*data});
+        m_block_serve_cache->Put(pindex->GetBlockHash(), *format, std::move(data));
+    }};
+
     std::shared_ptr<const CBlock> pblock;
-    if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
+    BlockServeCache::Data cached_block;
+    if (use_cache) cached_block = m_block_serve_cache->Get(pindex->GetBlockHash(), *format);
+    if (cached_block) {
+        MakeAndPushMessage(pfrom, block_msg_type, Span{*cached_block});
+    } else if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
         pblock = a_recent_block;
     } else if (inv.IsMsgWitnessBlk()) {
         // Fast-path: in this case it is possible to serve the block directly from disk,
         // as the network format matches the format on disk
         std::vector<uint8_t> block_data;
-        if (!m_chainman.m_blockman.ReadRawBlockFromDisk(block_data, block_pos)) {
+        if (auto queued_block{queued_read ? queued_read->get() : std::nullopt}) {
+            push_and_cache(Span{*queued_block});
+        } else if (const auto mapped_block{m_chainman.m_blockman.ReadMappedRawBlockFromDisk(block_pos)}) {
+            push_and_cache(mapped_block->data);
+        } else if (m_chainman.m_blockman.ReadRawBlockFromDisk(block_data, block_pos)) {
+            push_and_cache(Span{block_data});
+        } else {
             if (WITH_LOCK(m_chainman.GetMutex(), return m_chainman.m_blockman.IsBlockPruned(*pindex))) {
                 LogPrint(BCLog::NET, "Block was pruned before it could be read, disconnect peer=%s\n", pfrom.GetId());
             } else {
@@ -2498,12 +2594,20 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
             pfrom.fDisconnect = true;
             return;
         }
-        MakeAndPushMessage(pfrom, NetMsgType::BLOCK, Span{block_data});
         // Don't set pblock as we've sent the block
     } else {
         // Send block from disk
         std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
-        if (!m_chainman.m_blockman.ReadBlockFromDisk(*pblockRead, block_pos)) {
+        bool have_block{false};
+        if (auto queued_block{queued_read ? queued_read->get() : std::nullopt}) {
+            try {
+                SpanReader{*queued_block} >> TX_WITH_WITNESS(*pblockRead);
+                have_block = true;
+            } catch (const std::exception&) {
+                // Fall back to reading the block again.
+            }
+        }
+        if (!have_block && !m_chainman.m_blockman.ReadBlockFromDisk(*pblockRead, block_pos)) {
             if (WITH_LOCK(m_chainman.GetMutex(), return m_chainman.m_blockman.IsBlockPruned(*pindex))) {
                 LogPrint(BCLog::NET, "Block was pruned before it could be read, disconnect peer=%s\n", pfrom.GetId());
             } else {
@@ -2516,9 +2620,9 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
     }
     if (pblock) {
         if (inv.IsMsgBlk()) {
-            MakeAndPushMessage(pfrom, NetMsgType::BLOCK, TX_NO_WITNESS(*pblock));
+            push_and_cache(TX_NO_WITNESS(*pblock));
         } else if (inv.IsMsgWitnessBlk()) {
-            MakeAndPushMessage(pfrom, NetMsgType::BLOCK, TX_WITH_WITNESS(*pblock));
+            push_and_cache(TX_WITH_WITNESS(*pblock));
         } else if (inv.IsMsgFilteredBlk()) {
             bool sendMerkleBlock = false;
             CMerkleBlock merkleBlock;
@@ -2544,19 +2648,15 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
             // else
             // no response
         } else if (inv.IsMsgCmpctBlk()) {
-            // If a peer is asking for old blocks, we're almost guaranteed
-            // they won't have a useful mempool to match against a compact block,
-            // and we don't feel like constructing the object for them, so
-            // instead we respond with the full, non-compact block.
-            if (can_direct_fetch && pindex->nHeight >= tip->nHeight - MAX_CMPCTBLOCK_DEPTH) {
+            if (send_compact) {
                 if (a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
-                    MakeAndPushMessage(pfrom, NetMsgType::CMPCTBLOCK, *a_recent_compact_block);
+                    push_and_cache(*a_recent_compact_block);
                 } else {
                     CBlockHeaderAndShortTxIDs cmpctblock{*pblock};
-                    MakeAndPushMessage(pfrom, NetMsgType::CMPCTBLOCK, cmpctblock);
+                    push_and_cache(cmpctblock);
                 }
             } else {
-                MakeAndPushMessage(pfrom, NetMsgType::BLOCK, TX_WITH_WITNESS(*pblock));
+                push_and_cache(TX_WITH_WITNESS(*pblock));
             }
         }
     }
@@ -2638,7 +2738,13 @@ void PeerManagerImpl::ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic
     if (it != peer.m_getdata_requests.end() && !pfrom.fPauseSend) {
         const CInv &inv = *it++;
         if (inv.IsGenBlkMsg()) {
-            ProcessGetBlockData(pfrom, peer, inv);
+            std::optional<node::BlockManager::AsyncRead> queued_read;
+            if (auto queued{peer.m_block_reads.extract(inv.hash)}) {
+                queued_read = std::move(queued.mapped());
+                --m_block_reads_count;
+            }
+            ProcessGetBlockData(pfrom, peer, inv, std::move(queued_read));
+            if (m_chainman.m_blockman.HasAsyncReads()) QueueBlockReads(pfrom, peer, it);
         }
         // else: If the first item on the queue is an unknown type, we erase it
         // and continue processing the queue on the next call.
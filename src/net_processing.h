@@ -6,10 +6,12 @@
 #ifndef BITCOIN_NET_PROCESSING_H
 #define BITCOIN_NET_PROCESSING_H
 
+#include <blockservecache.h>
 #include <net.h>
 #include <validationinterface.h>
 
 #include <chrono>
+#include <optional>
 
 class AddrMan;
 class CChainParams;
@@ -27,6 +29,8 @@ static const uint32_t DEFAULT_MAX_ORPHAN_TRANSACTIONS{100};
 /** Default number of non-mempool transactions to keep around for block reconstruction. Includes
     orphan, replaced, and rejected transactions. */
 static const uint32_t DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN{100};
+/** Default for -blockservecache, memory in MiB to cache serialized blocks served to peers in */
+static constexpr uint32_t DEFAULT_BLOCK_SERVE_CACHE_MB{0};
 static const bool DEFAULT_PEERBLOOMFILTERS = false;
 static const bool DEFAULT_PEERBLOCKFILTERS = false;
 /** Threshold for marking a node to be discouraged, e.g. disconnected and added to the discouragement filter. */
@@ -53,6 +57,7 @@ struct CNodeStateStats {
 struct PeerManagerInfo {
     std::chrono::seconds median_outbound_time_offset{0s};
     bool ignores_incoming_txs{false};
+    std::optional<BlockServeCache::Stats> block_serve_cache;
 };
 
 class PeerManager : public CValidationInterface, public NetEventsInterface
@@ -68,6 +73,9 @@ public:
         //! Number of non-mempool transactions to keep around for block reconstruction. Includes
         //! orphan, replaced, and rejected transactions.
         uint32_t max_extra_txs{DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN};
+        //! Memory in bytes to cache serialized blocks served to peers in, or 0
+        //! to serve every block from disk.
+        size_t block_serve_cache_bytes{size_t{DEFAULT_BLOCK_SERVE_CACHE_MB} << 20};
         //! Whether all P2P messages are captured to disk
         bool capture_messages{false};
         //! Whether or not the internal RNG behaves deterministically (this is
@@ -0,0 +1,191 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/block_template_cache.h>
+
+#include <chain.h>
+#include <consensus/consensus.h>
+#include <consensus/tx_verify.h>
+#include <logging.h>
+#include <policy/policy.h>
+#include <txmempool.h>
+#include <util/hasher.h>
+#include <util/thread.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <exception>
+#include <unordered_set>
+
+namespace node {
+BlockTemplateCache::BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool, const BlockAssembler::Options& options)
+    : m_chainman{chainman},
+      m_mempool{mempool},
+      m_options{options}
+{
+}
+
+BlockTemplateCache::~BlockTemplateCache()
+{
+    WITH_LOCK(m_mutex, m_stop = true);
+    m_cv.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+BlockTemplateCache::Result BlockTemplateCache::Get()
+{
+    AssertLockHeld(::cs_main);
+    const CBlockIndex* tip{m_chainman.ActiveChain().Tip()};
+    LOCK(m_mutex);
+    if (!m_active) {
+        // The thread of an earlier period of use has exited, or is about to.
+        if (m_thread.joinable()) m_thread.join();
+        m_active = true;
+        m_thread = std::thread{&util::TraceThread, "blocktemplate", [this] { ThreadRefresh(); }};
+    }
+    m_last_get = GetTime();
+    if (!Update(tip)) {
+        Template built{Build()};
+        if (!built.block_template) return {nullptr, built.transactions_updated};
+        Install(std::move(built));
+    }
+    return {m_template->block_template, m_template->transactions_updated};
+}
+
+void BlockTemplateCache::TransactionAddedToMempool(const NewMempoolTransactionInfo& tx, uint64_t mempool_sequence)
+{
+    LOCK(m_mutex);
+    if (m_active) m_added.emplace_back(mempool_sequence, tx.info.m_tx->GetHash());
+}
+
+BlockTemplateCache::Template BlockTemplateCache::Build() const
+{
+    AssertLockHeld(::cs_main);
+    Template result;
+    result.prev = m_chainman.ActiveChain().Tip();
+    result.transactions_updated = m_mempool.GetTransactionsUpdated();
+    result.sequence = WITH_LOCK(m_mempool.cs, return m_mempool.GetSequence());
+    result.time = GetTime();
+    result.block_template = BlockAssembler{m_chainman.ActiveChainstate(), &m_mempool, m_options}.CreateNewBlock(m_script);
+    return result;
+}
+
+void BlockTemplateCache::Install(Template&& block_template)
+{
+    std::erase_if(m_added, [&](const auto& added) { return added.first < block_template.sequence; });
+    m_template = std::move(block_template);
+}
+
+bool BlockTemplateCache::Update(const CBlockIndex* tip)
+{
+    AssertLockHeld(::cs_main);
+    if (!m_template) return false;
+    Template& current{*m_template};
+    // After a new block, the transactions are selected again: appending to
+    // what is left of the template would leave the weight freed by the mined
+    // transactions to the transactions added since, whatever their feerate.
+    if (current.prev != tip) return false;
+    // Never serve a template older than getblocktemplate used to.
+    if (m_mempool.GetTransactionsUpdated() != current.transactions_updated && GetTime() - current.time > count_seconds(MAX_AGE)) {
+        return false;
+    }
+
+    LOCK(m_mempool.cs);
+    const std::vector<CTransactionRef>& vtx{current.block_template->block.vtx};
+    std::vector<CTxMemPool::txiter> selected;
+    selected.reserve(vtx.size() + m_added.size());
+    std::unordered_set<Txid, SaltedTxidHasher> in_block;
+    bool changed{false};
+    // Same reservations for the coinbase, and limits, as BlockAssembler.
+    const uint64_t max_weight{std::clamp<uint64_t>(m_options.nBlockMaxWeight, 4000, DEFAULT_BLOCK_MAX_WEIGHT)};
+    uint64_t weight{4000};
+    int64_t sigops_cost{400};
+
+    // Drop the transactions that left the mempool: they were replaced or
+    // evicted, and so were their descendants.
+    for (size_t i{1}; i < vtx.size(); ++i) {
+        const auto it{m_mempool.GetIter(vtx[i]->GetHash())};
+        if (!it) {
+            changed = true;
+            continue;
+        }
+        selected.push_back(*it);
+        in_block.insert((*it)->GetTx().GetHash());
+        weight += (*it)->GetTxWeight();
+        sigops_cost += (*it)->GetSigOpCost();
+    }
+
+    // Append the transactions added since, in the order they were added, when
+    // all their parents are in the block. Those skipped are left to the next
+    // full selection.
+    const int height{tip->nHeight + 1};
+    const int64_t lock_time_cutoff{tip->GetMedianTimePast()};
+    for (const auto& [sequence, txid] : m_added) {
+        if (sequence < current.sequence || in_block.count(txid)) continue;
+        const auto it{m_mempool.GetIter(txid)};
+        if (!it) continue;
+        const CTxMemPoolEntry& entry{**it};
+        if (entry.GetModifiedFee() < m_options.blockMinFeeRate.GetFee(entry.GetTxSize())) continue;
+        if (weight + WITNESS_SCALE_FACTOR * entry.GetTxSize() >= max_weight ||
+            sigops_cost + entry.GetSigOpCost() >= MAX_BLOCK_SIGOPS_COST) {
+            continue;
+        }
+        if (!IsFinalTx(entry.GetTx(), height, lock_time_cutoff)) continue;
+        const auto& parents{entry.GetMemPoolParentsConst()};
+        if (!std::all_of(parents.begin(), parents.end(), [&](const CTxMemPoolEntry& parent) {
+                return in_block.count(parent.GetTx().GetHash()) > 0;
+            })) {
+            continue;
+        }
+        selected.push_back(*it);
+        in_block.insert(txid);
+        weight += entry.GetTxWeight();
+        sigops_cost += entry.GetSigOpCost();
+        changed = true;
+    }
+    m_added.clear();
+    if (!changed) return true;
+
+    BlockAssembler::Options options{m_options};
+    options.test_block_validity = false;
+    std::unique_ptr<CBlockTemplate> updated{BlockAssembler{m_chainman.ActiveChainstate(), &m_mempool, options}.CreateNewBlock(m_script, selected)};
+    if (!updated) return false;
+    current.block_template = std::move(updated);
+    return true;
+}
+
+void BlockTemplateCache::ThreadRefresh()
+{
+    while (true) {
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cv.wait_for(lock, std::chrono::seconds{1}, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop; });
+            if (m_stop) return;
+            if (GetTime() - m_last_get > count_seconds(IDLE_TIMEOUT)) {
+                // Transactions are no longer tracked, so the template could
+                // not be updated once requested again.
+                m_active = false;
+                m_template.reset();
+                m_added.clear();
+                return;
+            }
+            if (!m_template) continue;
+            if (m_mempool.GetTransactionsUpdated() == m_template->transactions_updated) {
+                m_template->time = GetTime();
+                continue;
+            }
+            if (GetTime() - m_template->time < count_seconds(REFRESH_INTERVAL)) continue;
+        }
+        try {
+            LOCK(::cs_main);
+            Template built{Build()};
+            LOCK(m_mutex);
+            if (built.block_template) Install(std::move(built));
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Failed to refresh block template: %s\n", __func__, e.what());
+        }
+    }
+}
+} // namespace node
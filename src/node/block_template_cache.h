@@ -0,0 +1,118 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCK_TEMPLATE_CACHE_H
+#define BITCOIN_NODE_BLOCK_TEMPLATE_CACHE_H
+
+#include <kernel/cs_main.h>
+#include <node/miner.h>
+#include <script/script.h>
+#include <sync.h>
+#include <util/transaction_identifier.h>
+#include <validationinterface.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class CBlockIndex;
+class ChainstateManager;
+class CTxMemPool;
+
+namespace node {
+/**
+ * Maintains the block template served by getblocktemplate.
+ *
+ * Once a template was requested, transactions entering the mempool are
+ * appended to the current template when it is requested again, and
+ * transactions that left the mempool are dropped from it, so that a template
+ * is served without running the transaction selection again. After a new
+ * block, the transactions are always selected again. A background thread
+ * replaces the template with a fully selected one every REFRESH_INTERVAL
+ * while the mempool changes, so that higher-feerate transactions displace the
+ * appended ones. It exits, and the template is no longer maintained, once no
+ * template was requested for IDLE_TIMEOUT.
+ */
+class BlockTemplateCache final : public CValidationInterface
+{
+public:
+    //! Minimum age of a template before the background thread replaces it
+    //! because the mempool changed.
+    static constexpr std::chrono::seconds REFRESH_INTERVAL{4};
+    //! Age after which a template is no longer served when the mempool
+    //! changed, even if the background thread did not replace it yet.
+    static constexpr std::chrono::seconds MAX_AGE{5};
+    //! Time without a request after which the template is dropped.
+    static constexpr std::chrono::seconds IDLE_TIMEOUT{60};
+
+    struct Result {
+        std::shared_ptr<const CBlockTemplate> block_template;
+        //! Value of CTxMemPool::GetTransactionsUpdated() when the template
+        //! was last fully selected.
+        unsigned int transactions_updated;
+    };
+
+    BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool, const BlockAssembler::Options& options);
+    ~BlockTemplateCache();
+
+    BlockTemplateCache(const BlockTemplateCache&) = delete;
+    BlockTemplateCache& operator=(const BlockTemplateCache&) = delete;
+
+    /**
+     * Return a template on top of the active tip, paying to OP_TRUE. The
+     * template is maintained from the first call on, until no call was made
+     * for IDLE_TIMEOUT. Its transactions are
+     * only checked with TestBlockValidity() when they were fully selected.
+     */
+    Result Get() EXCLUSIVE_LOCKS_REQUIRED(::cs_main, !m_mutex);
+
+protected:
+    void TransactionAddedToMempool(const NewMempoolTransactionInfo& tx, uint64_t mempool_sequence) override
+        EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    struct Template {
+        std::shared_ptr<const CBlockTemplate> block_template;
+        const CBlockIndex* prev;
+        //! Mempool sequence before the transactions were fully selected.
+        //! Transactions added with a lower sequence were considered then.
+        uint64_t sequence;
+        unsigned int transactions_updated;
+        //! Last time the transactions were known to be fully selected from
+        //! the mempool.
+        int64_t time;
+    };
+
+    ChainstateManager& m_chainman;
+    const CTxMemPool& m_mempool;
+    const BlockAssembler::Options m_options;
+    const CScript m_script{CScript() << OP_TRUE};
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::optional<Template> m_template GUARDED_BY(m_mutex);
+    //! Transactions added to the mempool since the template was fully
+    //! selected, with their mempool sequence.
+    std::vector<std::pair<uint64_t, Txid>> m_added GUARDED_BY(m_mutex);
+    bool m_active GUARDED_BY(m_mutex){false};
+    //! Time of the last Get() call.
+    int64_t m_last_get GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::thread m_thread;
+
+    //! Fully select the transactions of a new template.
+    Template Build() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+    void Install(Template&& block_template) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    //! Update the template for the mempool and tip, if it can be.
+    bool Update(const CBlockIndex* tip) EXCLUSIVE_LOCKS_REQUIRED(::cs_main, m_mutex);
+    void ThreadRefresh() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+} // namespace node
+
+#endif // BITCOIN_NODE_BLOCK_TEMPLATE_CACHE_H
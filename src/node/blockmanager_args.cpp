@@ -11,6 +11,7 @@
 #include <util/translation.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <cstdint>
 
 namespace node {
@@ -32,6 +33,17 @@ util::Result<void> ApplyArgsManOptions(const ArgsManager& args, BlockManager::Op
     opts.prune_target = nPruneTarget;
 
     if (auto value{args.GetBoolArg("-fastprune")}) opts.fast_prune = *value;
+    if (auto value{args.GetIntArg("-asyncblockreads")}) {
+        opts.async_block_reads = std::clamp<int64_t>(*value, 0, kernel::MAX_ASYNC_BLOCK_READS);
+    }
+    if (auto value{args.GetIntArg("-blockreadahead")}) {
+        opts.block_read_ahead = std::clamp<int64_t>(*value, 0, kernel::MAX_BLOCK_READ_AHEAD);
+    }
+    if (auto value{args.GetBoolArg("-compressundofiles")}) opts.compress_undo_files = *value;
+    if (auto value{args.GetBoolArg("-mmapblockfiles")}) opts.mmap_block_files = *value;
+    if (auto value{args.GetIntArg("-reindexthreads")}) {
+        opts.reindex_threads = std::clamp<int64_t>(*value, 0, kernel::MAX_REINDEX_THREADS);
+    }
 
     return {};
 }
@@ -0,0 +1,102 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockreadahead.h>
+
+#include <chain.h>
+#include <kernel/cs_main.h>
+#include <logging.h>
+#include <node/blockstorage.h>
+#include <tinyformat.h>
+#include <util/thread.h>
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace node {
+BlockReadAhead::BlockReadAhead(const BlockManager& blockman, std::vector<const CBlockIndex*> blocks, bool read_undo, int window)
+    : m_blockman{blockman},
+      m_read_undo{read_undo},
+      m_window{static_cast<size_t>(std::max(window, 1))},
+      m_slots{[&] {
+          std::vector<Slot> slots;
+          slots.reserve(blocks.size());
+          LOCK(::cs_main);
+          for (const CBlockIndex* index : blocks) {
+              slots.push_back({index, index->GetBlockPos(), index->GetUndoPos()});
+          }
+          return slots;
+      }()},
+      m_entries(m_slots.size())
+{
+    const size_t num_threads{std::min({m_window, m_slots.size(), size_t{MAX_READ_AHEAD_THREADS}})};
+    for (size_t n{0}; n < num_threads; ++n) {
+        m_threads.emplace_back(&util::TraceThread, strprintf("readahead.%i", n), [this] { ThreadRead(); });
+    }
+}
+
+BlockReadAhead::~BlockReadAhead()
+{
+    WITH_LOCK(m_mutex, m_stop = true);
+    m_cv.notify_all();
+    for (std::thread& thread : m_threads) thread.join();
+}
+
+const CBlockIndex* BlockReadAhead::Peek() const
+{
+    LOCK(m_mutex);
+    return m_next_taken < m_slots.size() ? m_slots[m_next_taken].index : nullptr;
+}
+
+BlockReadAhead::Entry BlockReadAhead::Next()
+{
+    WAIT_LOCK(m_mutex, lock);
+    assert(m_next_taken < m_slots.size());
+    std::optional<Entry>& entry{m_entries[m_next_taken]};
+    m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return entry.has_value(); });
+    Entry result{std::move(*entry)};
+    entry.reset();
+    ++m_next_taken;
+    // Room was made for reading another block.
+    m_cv.notify_all();
+    return result;
+}
+
+BlockReadAhead::Entry BlockReadAhead::Read(const Slot& slot) const
+{
+    Entry entry{.index = slot.index, .block = nullptr, .undo = std::nullopt};
+    auto block{std::make_shared<CBlock>()};
+    if (!m_blockman.ReadBlockFromDisk(*block, slot.block_pos)) {
+        LogError("%s: Failed to read block %s\n", __func__, slot.index->GetBlockHash().ToString());
+    } else if (block->GetHash() != slot.index->GetBlockHash()) {
+        LogError("%s: GetHash() doesn't match index for %s at %s\n", __func__, slot.index->ToString(), slot.block_pos.ToString());
+    } else {
+        entry.block = std::move(block);
+    }
+    if (m_read_undo && !slot.undo_pos.IsNull()) {
+        CBlockUndo undo;
+        if (m_blockman.UndoReadFromDisk(undo, *slot.index, slot.undo_pos)) entry.undo = std::move(undo);
+    }
+    return entry;
+}
+
+void BlockReadAhead::ThreadRead()
+{
+    while (true) {
+        size_t next;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                return m_stop || m_next_read == m_slots.size() || m_next_read < m_next_taken + m_window;
+            });
+            if (m_stop || m_next_read == m_slots.size()) return;
+            next = m_next_read++;
+        }
+        Entry entry{Read(m_slots[next])};
+        WITH_LOCK(m_mutex, m_entries[next] = std::move(entry));
+        m_cv.notify_all();
+    }
+}
+} // namespace node
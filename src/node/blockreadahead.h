@@ -0,0 +1,100 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKREADAHEAD_H
+#define BITCOIN_NODE_BLOCKREADAHEAD_H
+
+#include <flatfile.h>
+#include <primitives/block.h>
+#include <sync.h>
+#include <undo.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+class CBlockIndex;
+
+namespace node {
+class BlockManager;
+
+//! Maximum number of threads reading blocks ahead for one BlockReadAhead.
+static constexpr int MAX_READ_AHEAD_THREADS{4};
+
+/**
+ * Reads blocks, and optionally their undo data, in a given order ahead of
+ * their use.
+ *
+ * Up to `window` blocks past the last one taken are read by background
+ * threads, which also verify the checksums of the undo data, so that disk
+ * reads and hashing overlap with the processing of each block by the caller,
+ * such as disconnecting it during a reorg, or adding it to an index.
+ */
+class BlockReadAhead
+{
+public:
+    //! A block read ahead.
+    struct Entry {
+        const CBlockIndex* index;
+        //! The block, or nullptr if it could not be read.
+        std::shared_ptr<CBlock> block;
+        //! The undo data of the block, if requested, and it could be read and
+        //! its checksum matches. Blocks without undo data, like the genesis
+        //! block, have none.
+        std::optional<CBlockUndo> undo;
+    };
+
+    /**
+     * Start reading blocks ahead.
+     *
+     * @param[in] blocks     Blocks to read, in the order they are taken.
+     *                       Their positions on disk are looked up under
+     *                       cs_main once, here.
+     * @param[in] read_undo  Whether to also read the undo data of the blocks
+     * @param[in] window     Number of blocks read ahead of the last one taken
+     */
+    BlockReadAhead(const BlockManager& blockman, std::vector<const CBlockIndex*> blocks, bool read_undo, int window);
+    ~BlockReadAhead();
+
+    BlockReadAhead(const BlockReadAhead&) = delete;
+    BlockReadAhead& operator=(const BlockReadAhead&) = delete;
+
+    //! The next block to be taken, or nullptr if all were taken.
+    const CBlockIndex* Peek() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    //! Take the next block, waiting for it to be read. Must not be called
+    //! when Peek() returns nullptr.
+    Entry Next() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    struct Slot {
+        const CBlockIndex* index;
+        FlatFilePos block_pos;
+        FlatFilePos undo_pos;
+    };
+
+    const BlockManager& m_blockman;
+    const bool m_read_undo;
+    const size_t m_window;
+    const std::vector<Slot> m_slots;
+
+    mutable Mutex m_mutex;
+    //! Signals both reads completing, and blocks being taken.
+    std::condition_variable m_cv;
+    //! Blocks read, by position in m_slots, until they are taken.
+    std::vector<std::optional<Entry>> m_entries GUARDED_BY(m_mutex);
+    size_t m_next_read GUARDED_BY(m_mutex){0};
+    size_t m_next_taken GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    Entry Read(const Slot& slot) const;
+    void ThreadRead() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+} // namespace node
+
+#endif // BITCOIN_NODE_BLOCKREADAHEAD_H
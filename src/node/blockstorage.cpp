@@ -5,9 +5,12 @@
 #include <node/blockstorage.h>
 
 #include <arith_uint256.h>
+#include <asyncfilereader.h>
 #include <chain.h>
+#include <consensus/consensus.h>
 #include <consensus/params.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
 #include <dbwrapper.h>
 #include <flatfile.h>
 #include <hash.h>
@@ -31,12 +34,21 @@
 #include <util/batchpriority.h>
 #include <util/check.h>
 #include <util/fs.h>
+#include <util/lzcompress.h>
 #include <util/signalinterrupt.h>
 #include <util/strencodings.h>
+#include <util/thread.h>
 #include <util/translation.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <iterator>
 #include <map>
+#include <memory>
+#include <optional>
+#include <thread>
 #include <unordered_map>
 
 namespace kernel {
@@ -668,7 +680,33 @@ CBlockFileInfo* BlockManager::GetBlockFileInfo(size_t n)
     return &m_blockfile_info.at(n);
 }
 
-bool BlockManager::UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint256& hashBlock) const
+/**
+ * Compress serialized undo data into a frame (see COMPRESSED_FRAME_FLAG).
+ *
+ * @returns std::nullopt if the frame would not be smaller than the data, which
+ *          is then stored uncompressed.
+ */
+static std::optional<std::vector<std::byte>> CompressFrame(Span<const std::byte> data)
+{
+    std::vector<std::byte> frame(sizeof(uint32_t));
+    WriteLE32(UCharCast(frame.data()), data.size());
+    const std::vector<std::byte> compressed{util::LZCompress(data)};
+    if (frame.size() + compressed.size() >= data.size()) return std::nullopt;
+    frame.insert(frame.end(), compressed.begin(), compressed.end());
+    return frame;
+}
+
+/** Decompress a frame of undo data. Returns false if the frame is corrupt. */
+static bool DecompressFrame(Span<const std::byte> frame, std::vector<uint8_t>& data)
+{
+    if (frame.size() < sizeof(uint32_t)) return false;
+    const uint32_t size{ReadLE32(UCharCast(frame.data()))};
+    if (size > MAX_SIZE) return false;
+    data.resize(size);
+    return util::LZDecompress(frame.subspan(sizeof(uint32_t)), MakeWritableByteSpan(data));
+}
+
+bool BlockManager::UndoWriteToDisk(Span<const std::byte> undo_data, FlatFilePos& pos, const uint256& hashBlock, const std::optional<std::vector<std::byte>>& frame) const
 {
     // Open history file to append
     AutoFile fileout{OpenUndoFile(pos)};
@@ -678,7 +716,7 @@ bool BlockManager::UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos
     }
 
     // Write index header
-    unsigned int nSize = GetSerializeSize(blockundo);
+    unsigned int nSize = frame ? (frame->size() | COMPRESSED_FRAME_FLAG) : undo_data.size();
     fileout << GetParams().MessageStart() << nSize;
 
     // Write undo data
@@ -688,12 +726,12 @@ bool BlockManager::UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos
         return false;
     }
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
+    fileout.write(frame ? Span{*frame} : undo_data);
 
-    // calculate & write checksum
+    // calculate & write checksum, over the uncompressed undo data
     HashWriter hasher{};
     hasher << hashBlock;
-    hasher << blockundo;
+    hasher.write(undo_data);
     fileout << hasher.GetHash();
 
     return true;
@@ -701,21 +739,35 @@ bool BlockManager::UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos
 
 bool BlockManager::UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex& index) const
 {
-    const FlatFilePos pos{WITH_LOCK(::cs_main, return index.GetUndoPos())};
+    return UndoReadFromDisk(blockundo, index, WITH_LOCK(::cs_main, return index.GetUndoPos()));
+}
 
+bool BlockManager::UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex& index, const FlatFilePos& pos) const
+{
     if (pos.IsNull()) {
         LogError("%s: no undo data available\n", __func__);
         return false;
     }
 
-    // Open history file to read
-    AutoFile filein{OpenUndoFile(pos, true)};
+    // The undo data is followed by its checksum.
+    if (const auto mapped{ReadMapped(m_undo_file_mapper, pos, uint256::size())}) {
+        return DeserializeUndo(UCharSpanCast(mapped->data), index, blockundo);
+    }
+
+    // Open history file to read, at the header in front of the undo data
+    AutoFile filein{pos.nPos < BLOCK_SERIALIZATION_HEADER_SIZE ? AutoFile{nullptr} : OpenUndoFile({pos.nFile, static_cast<unsigned int>(pos.nPos - BLOCK_SERIALIZATION_HEADER_SIZE)}, true)};
     if (filein.IsNull()) {
         LogError("%s: OpenUndoFile failed\n", __func__);
         return false;
     }
+    std::vector<uint8_t> data;
+    if (!ReadFromFile(filein, pos, uint256::size(), data)) return false;
+    return DeserializeUndo(data, index, blockundo);
+}
 
-    // Read block
+bool DeserializeUndo(Span<const uint8_t> data, const CBlockIndex& index, CBlockUndo& blockundo)
+{
+    SpanReader filein{data};
     uint256 hashChecksum;
     HashVerifier verifier{filein}; // Use HashVerifier as reserializing may lose data, c.f. commit d342424301013ec47dc146a4beb49d5c9319d80a
     try {
@@ -739,6 +791,8 @@ bool BlockManager::UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex& in
 bool BlockManager::FlushUndoFile(int block_file, bool finalize)
 {
     FlatFilePos undo_pos_old(block_file, m_blockfile_info[block_file].nUndoSize);
+    // Finalizing truncates the file, which a mapping must not outlive.
+    if (finalize) m_undo_file_mapper.Forget(block_file);
     if (!UndoFileSeq().Flush(undo_pos_old, finalize)) {
         m_opts.notifications.flushError(_("Flushing undo file to disk failed. This is likely the result of an I/O error."));
         return false;
@@ -761,6 +815,8 @@ bool BlockManager::FlushBlockFile(int blockfile_num, bool fFinalize, bool finali
     assert(static_cast<int>(m_blockfile_info.size()) > blockfile_num);
 
     FlatFilePos block_pos_old(blockfile_num, m_blockfile_info[blockfile_num].nSize);
+    // Finalizing truncates the file, which a mapping must not outlive.
+    if (fFinalize) m_block_file_mapper.Forget(blockfile_num);
     if (!BlockFileSeq().Flush(block_pos_old, fFinalize)) {
         m_opts.notifications.flushError(_("Flushing block file to disk failed. This is likely the result of an I/O error."));
         success = false;
@@ -813,6 +869,8 @@ void BlockManager::UnlinkPrunedFiles(const std::set<int>& setFilesToPrune) const
     std::error_code ec;
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         FlatFilePos pos(*it, 0);
+        m_block_file_mapper.Forget(*it);
+        m_undo_file_mapper.Forget(*it);
         const bool removed_blockfile{fs::remove(BlockFileSeq().FileName(pos), ec)};
         const bool removed_undofile{fs::remove(UndoFileSeq().FileName(pos), ec)};
         if (removed_blockfile || removed_undofile) {
@@ -1014,12 +1072,17 @@ bool BlockManager::WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValid
 
     // Write undo information to disk
     if (block.GetUndoPos().IsNull()) {
+        // Serialize the undo data once, for the frame, the file and the checksum.
+        DataStream serialized{};
+        serialized << blockundo;
+        std::optional<std::vector<std::byte>> frame;
+        if (m_opts.compress_undo_files) frame = CompressFrame(serialized);
         FlatFilePos _pos;
-        if (!FindUndoPos(state, block.nFile, _pos, ::GetSerializeSize(blockundo) + 40)) {
+        if (!FindUndoPos(state, block.nFile, _pos, (frame ? frame->size() : serialized.size()) + 40)) {
             LogError("ConnectBlock(): FindUndoPos failed\n");
             return false;
         }
-        if (!UndoWriteToDisk(blockundo, _pos, block.pprev->GetBlockHash())) {
+        if (!UndoWriteToDisk(serialized, _pos, block.pprev->GetBlockHash(), frame)) {
             return FatalError(m_opts.notifications, state, _("Failed to write undo data."));
         }
         // rev files are written in block height order, whereas blk files are written as blocks come in (often out of order)
@@ -1048,20 +1111,43 @@ bool BlockManager::WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValid
     return true;
 }
 
+std::optional<MappedFlatFileSpan> BlockManager::ReadMapped(FlatFileMapper& mapper, const FlatFilePos& pos, size_t trailer_size) const
+{
+    if (!m_opts.mmap_block_files || pos.nPos < BLOCK_SERIALIZATION_HEADER_SIZE) return std::nullopt;
+
+    const auto header{mapper.Read({pos.nFile, static_cast<unsigned int>(pos.nPos - BLOCK_SERIALIZATION_HEADER_SIZE)}, BLOCK_SERIALIZATION_HEADER_SIZE)};
+    if (!header) return std::nullopt;
+    MessageStartChars start;
+    unsigned int size;
+    SpanReader{UCharSpanCast(header->data)} >> start >> size;
+    // Leave reporting corrupt data, and decompressing frames, to the file read.
+    if (start != GetParams().MessageStart() || (size & COMPRESSED_FRAME_FLAG) || size > MAX_SIZE) return std::nullopt;
+
+    return mapper.Read(pos, size_t{size} + trailer_size);
+}
+
+std::optional<MappedFlatFileSpan> BlockManager::ReadMappedRawBlockFromDisk(const FlatFilePos& pos) const
+{
+    return ReadMapped(m_block_file_mapper, pos, /*trailer_size=*/0);
+}
+
 bool BlockManager::ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos) const
 {
     block.SetNull();
 
-    // Open history file to read
-    AutoFile filein{OpenBlockFile(pos, true)};
-    if (filein.IsNull()) {
-        LogError("ReadBlockFromDisk: OpenBlockFile failed for %s\n", pos.ToString());
-        return false;
-    }
-
     // Read block
     try {
-        filein >> TX_WITH_WITNESS(block);
+        if (const auto mapped{ReadMappedRawBlockFromDisk(pos)}) {
+            SpanReader{UCharSpanCast(mapped->data)} >> TX_WITH_WITNESS(block);
+        } else {
+            // Open history file to read
+            AutoFile filein{OpenBlockFile(pos, true)};
+            if (filein.IsNull()) {
+                LogError("ReadBlockFromDisk: OpenBlockFile failed for %s\n", pos.ToString());
+                return false;
+            }
+            filein >> TX_WITH_WITNESS(block);
+        }
     } catch (const std::exception& e) {
         LogError("%s: Deserialize or I/O error - %s at %s\n", __func__, e.what(), pos.ToString());
         return false;
@@ -1106,13 +1192,21 @@ bool BlockManager::ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatF
         LogError("%s: OpenBlockFile failed for %s\n", __func__, pos.ToString());
         return false;
     }
+    if (const auto mapped{ReadMappedRawBlockFromDisk(pos)}) {
+        block.assign(UCharCast(mapped->data.begin()), UCharCast(mapped->data.end()));
+        return true;
+    }
     hpos.nPos -= 8; // Seek back 8 bytes for meta header
     AutoFile filein{OpenBlockFile(hpos, true)};
     if (filein.IsNull()) {
         LogError("%s: OpenBlockFile failed for %s\n", __func__, pos.ToString());
         return false;
     }
+    return ReadFromFile(filein, pos, /*trailer_size=*/0, block);
+}
 
+bool BlockManager::ReadFromFile(AutoFile& filein, const FlatFilePos& pos, size_t trailer_size, std::vector<uint8_t>& data) const
+{
     try {
         MessageStartChars blk_start;
         unsigned int blk_size;
@@ -1126,14 +1220,30 @@ bool BlockManager::ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatF
             return false;
         }
 
+        const bool compressed{(blk_size & COMPRESSED_FRAME_FLAG) != 0};
+        blk_size &= ~COMPRESSED_FRAME_FLAG;
         if (blk_size > MAX_SIZE) {
             LogError("%s: Block data is larger than maximum deserialization size for %s: %s versus %s\n", __func__, pos.ToString(),
                          blk_size, MAX_SIZE);
             return false;
         }
 
-        block.resize(blk_size); // Zeroing of memory is intentional here
-        filein.read(MakeWritableByteSpan(block));
+        if (compressed) {
+            std::vector<std::byte> frame(blk_size);
+            filein.read(frame);
+            if (!DecompressFrame(frame, data)) {
+                LogError("%s: Corrupt compressed data for %s\n", __func__, pos.ToString());
+                return false;
+            }
+        } else {
+            data.resize(blk_size); // Zeroing of memory is intentional here
+            filein.read(MakeWritableByteSpan(data));
+        }
+        if (trailer_size > 0) {
+            const size_t size{data.size()};
+            data.resize(size + trailer_size);
+            filein.read(MakeWritableByteSpan(data).subspan(size));
+        }
     } catch (const std::exception& e) {
         LogError("%s: Read from block file failed: %s for %s\n", __func__, e.what(), pos.ToString());
         return false;
@@ -1142,6 +1252,78 @@ bool BlockManager::ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatF
     return true;
 }
 
+std::future<std::optional<std::vector<uint8_t>>> BlockManager::ReadAsync(FlatFileMapper& mapper, FlatFileSeq seq, const FlatFilePos& pos, size_t trailer_size) const
+{
+    auto promise{std::make_shared<std::promise<std::optional<std::vector<uint8_t>>>>()};
+    AsyncRead result{promise->get_future()};
+    if (pos.IsNull() || pos.nPos < BLOCK_SERIALIZATION_HEADER_SIZE) {
+        LogError("%s: No data at %s\n", __func__, pos.ToString());
+        promise->set_value(std::nullopt);
+        return result;
+    }
+    if (const auto mapped{ReadMapped(mapper, pos, trailer_size)}) {
+        promise->set_value(std::vector<uint8_t>(UCharCast(mapped->data.begin()), UCharCast(mapped->data.end())));
+        return result;
+    }
+    const FlatFilePos header_pos{pos.nFile, static_cast<unsigned int>(pos.nPos - BLOCK_SERIALIZATION_HEADER_SIZE)};
+    if (!m_async_reader) {
+        AutoFile filein{seq.Open(header_pos, /*read_only=*/true)};
+        std::vector<uint8_t> data;
+        if (filein.IsNull() || !ReadFromFile(filein, pos, trailer_size, data)) {
+            promise->set_value(std::nullopt);
+        } else {
+            promise->set_value(std::move(data));
+        }
+        return result;
+    }
+
+    // The size of the data is only known once the header in front of it is
+    // read, so read the header first, and then queue the read of the data.
+    AsyncFileReader& reader{*m_async_reader};
+    const fs::path path{seq.FileName(pos)};
+    const MessageStartChars message_start{GetParams().MessageStart()};
+    reader.Read(path, header_pos.nPos, BLOCK_SERIALIZATION_HEADER_SIZE, [&reader, promise, path, pos, trailer_size, message_start](std::optional<std::vector<uint8_t>> header) {
+        if (!header) {
+            LogError("ReadAsync: Read of header failed for %s\n", pos.ToString());
+            return promise->set_value(std::nullopt);
+        }
+        MessageStartChars start;
+        unsigned int size;
+        SpanReader{*header} >> start >> size;
+        const bool compressed{(size & COMPRESSED_FRAME_FLAG) != 0};
+        size &= ~COMPRESSED_FRAME_FLAG;
+        if (start != message_start || size > MAX_SIZE) {
+            LogError("ReadAsync: Corrupt header for %s\n", pos.ToString());
+            return promise->set_value(std::nullopt);
+        }
+        reader.Read(path, pos.nPos, size_t{size} + trailer_size, [promise, pos, size, compressed](std::optional<std::vector<uint8_t>> data) {
+            if (data && compressed) {
+                std::vector<uint8_t> decompressed;
+                if (DecompressFrame(MakeByteSpan(*data).first(size), decompressed)) {
+                    decompressed.insert(decompressed.end(), data->begin() + size, data->end());
+                    data = std::move(decompressed);
+                } else {
+                    data.reset();
+                }
+            }
+            if (!data) LogError("ReadAsync: Read of data failed for %s\n", pos.ToString());
+            promise->set_value(std::move(data));
+        });
+    });
+    return result;
+}
+
+BlockManager::AsyncRead BlockManager::ReadRawBlockAsync(const FlatFilePos& pos) const
+{
+    return ReadAsync(m_block_file_mapper, BlockFileSeq(), pos, /*trailer_size=*/0);
+}
+
+BlockManager::AsyncRead BlockManager::ReadRawUndoAsync(const CBlockIndex& index) const
+{
+    // The undo data is followed by its checksum.
+    return ReadAsync(m_undo_file_mapper, UndoFileSeq(), WITH_LOCK(::cs_main, return index.GetUndoPos()), uint256::size());
+}
+
 FlatFilePos BlockManager::SaveBlockToDisk(const CBlock& block, int nHeight)
 {
     unsigned int nBlockSize = ::GetSerializeSize(TX_WITH_WITNESS(block));
@@ -1160,6 +1342,52 @@ FlatFilePos BlockManager::SaveBlockToDisk(const CBlock& block, int nHeight)
     return blockPos;
 }
 
+std::vector<ScannedBlock> BlockManager::ScanBlockFile(AutoFile& file_in, int file_num) const
+{
+    const MessageStartChars& message_start{GetParams().MessageStart()};
+    std::vector<ScannedBlock> blocks;
+    try {
+        BufferedFile blkdat{file_in, 2 * MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE + 8};
+        // Where to resume scanning, one byte further than the last attempt in case of failure.
+        uint64_t rewind{blkdat.GetPos()};
+        while (!blkdat.eof()) {
+            if (m_interrupt) break;
+
+            blkdat.SetPos(rewind);
+            ++rewind;
+            blkdat.SetLimit();
+            unsigned int size{0};
+            try {
+                MessageStartChars buf;
+                blkdat.FindByte(std::byte(message_start[0]));
+                rewind = blkdat.GetPos() + 1;
+                blkdat >> buf;
+                if (buf != message_start) continue;
+                blkdat >> size;
+                if (size < 80 || size > MAX_BLOCK_SERIALIZED_SIZE) continue;
+            } catch (const std::exception&) {
+                // No further block; this happens at the end of every block file.
+                break;
+            }
+            try {
+                const uint64_t block_pos{blkdat.GetPos()};
+                blkdat.SetLimit(block_pos + size);
+                CBlockHeader header;
+                blkdat >> header;
+                // Only record the block if all of it is in the file.
+                rewind = block_pos + size;
+                blkdat.SkipTo(rewind);
+                blocks.push_back({header.GetHash(), header, FlatFilePos{file_num, static_cast<unsigned int>(block_pos)}});
+            } catch (const std::exception& e) {
+                LogPrint(BCLog::REINDEX, "%s: unexpected data at offset 0x%x of blk%05u.dat - %s. continuing\n", __func__, (rewind - 1), file_num, e.what());
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        LogPrintf("%s: error reading blk%05u.dat: %s\n", __func__, file_num, e.what());
+    }
+    return blocks;
+}
+
 class ImportingNow
 {
     std::atomic<bool>& m_importing;
@@ -1177,32 +1405,77 @@ public:
     }
 };
 
+/**
+ * Scan all block files for -reindex with several threads, as a block file's
+ * blocks can be found without knowing those of other files.
+ *
+ * @returns the blocks found, in the order of the block files.
+ */
+static std::vector<ScannedBlock> ScanBlockFiles(const BlockManager& blockman, int num_threads)
+{
+    int num_files{0};
+    while (fs::exists(blockman.GetBlockPosFilename(FlatFilePos(num_files, 0)))) {
+        ++num_files;
+    }
+    LogPrintf("Scanning %d block files with %d threads...\n", num_files, num_threads);
+
+    std::vector<std::vector<ScannedBlock>> file_blocks(num_files);
+    std::atomic<int> next_file{0};
+    std::vector<std::thread> threads;
+    for (int n{0}; n < std::min(num_threads, num_files); ++n) {
+        threads.emplace_back(&util::TraceThread, strprintf("blkscan.%i", n), [&] {
+            for (int file_num{next_file++}; file_num < num_files && !blockman.m_interrupt; file_num = next_file++) {
+                AutoFile file{blockman.OpenBlockFile(FlatFilePos(file_num, 0), true)};
+                if (file.IsNull()) continue; // This error is logged in OpenBlockFile
+                file_blocks[file_num] = blockman.ScanBlockFile(file, file_num);
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    std::vector<ScannedBlock> blocks;
+    for (auto& file : file_blocks) {
+        blocks.insert(blocks.end(), std::make_move_iterator(file.begin()), std::make_move_iterator(file.end()));
+        file.clear();
+        file.shrink_to_fit();
+    }
+    return blocks;
+}
+
 void ImportBlocks(ChainstateManager& chainman, std::vector<fs::path> vImportFiles)
 {
     ImportingNow imp{chainman.m_blockman.m_importing};
 
     // -reindex
     if (!chainman.m_blockman.m_blockfiles_indexed) {
-        int nFile = 0;
-        // Map of disk positions for blocks with unknown parent (only used for reindex);
-        // parent hash -> child disk position, multiple children can have the same parent.
-        std::multimap<uint256, FlatFilePos> blocks_with_unknown_parent;
-        while (true) {
-            FlatFilePos pos(nFile, 0);
-            if (!fs::exists(chainman.m_blockman.GetBlockPosFilename(pos))) {
-                break; // No block files left to reindex
-            }
-            AutoFile file{chainman.m_blockman.OpenBlockFile(pos, true)};
-            if (file.IsNull()) {
-                break; // This error is logged in OpenBlockFile
-            }
-            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-            chainman.LoadExternalBlockFile(file, &pos, &blocks_with_unknown_parent);
+        if (const int num_threads{chainman.m_blockman.ReindexThreads()}; num_threads > 0) {
+            chainman.LoadScannedBlocks(ScanBlockFiles(chainman.m_blockman, num_threads));
             if (chainman.m_interrupt) {
                 LogPrintf("Interrupt requested. Exit %s\n", __func__);
                 return;
             }
-            nFile++;
+        } else {
+            int nFile = 0;
+            // Map of disk positions for blocks with unknown parent (only used for reindex);
+            // parent hash -> child disk position, multiple children can have the same parent.
+            std::multimap<uint256, FlatFilePos> blocks_with_unknown_parent;
+            while (true) {
+                FlatFilePos pos(nFile, 0);
+                if (!fs::exists(chainman.m_blockman.GetBlockPosFilename(pos))) {
+                    break; // No block files left to reindex
+                }
+                AutoFile file{chainman.m_blockman.OpenBlockFile(pos, true)};
+                if (file.IsNull()) {
+                    break; // This error is logged in OpenBlockFile
+                }
+                LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
+                chainman.LoadExternalBlockFile(file, &pos, &blocks_with_unknown_parent);
+                if (chainman.m_interrupt) {
+                    LogPrintf("Interrupt requested. Exit %s\n", __func__);
+                    return;
+                }
+                nFile++;
+            }
         }
         WITH_LOCK(::cs_main, chainman.m_blockman.m_block_tree_db->WriteReindexing(false));
         chainman.m_blockman.m_blockfiles_indexed = true;
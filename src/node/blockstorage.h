@@ -5,6 +5,7 @@
 #ifndef BITCOIN_NODE_BLOCKSTORAGE_H
 #define BITCOIN_NODE_BLOCKSTORAGE_H
 
+#include <asyncfilereader.h>
 #include <attributes.h>
 #include <chain.h>
 #include <dbwrapper.h>
@@ -14,6 +15,7 @@
 #include <kernel/cs_main.h>
 #include <kernel/messagestartchars.h>
 #include <primitives/block.h>
+#include <span.h>
 #include <streams.h>
 #include <sync.h>
 #include <uint256.h>
@@ -24,6 +26,7 @@
 #include <atomic>
 #include <cstdint>
 #include <functional>
+#include <future>
 #include <limits>
 #include <map>
 #include <memory>
@@ -76,6 +79,23 @@ static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** Size of header written by WriteBlockToDisk before a serialized CBlock */
 static constexpr size_t BLOCK_SERIALIZATION_HEADER_SIZE = std::tuple_size_v<MessageStartChars> + sizeof(unsigned int);
 
+/**
+ * Set in the size field of the header in front of undo data that is stored as
+ * a compressed frame (-compressundofiles). The size field then holds the size
+ * of the frame, which is the size of the data as 4 bytes, followed by the data
+ * compressed with util::LZCompress(). Positions of such data still point after
+ * the header, and each frame can be read on its own. Blocks are not compressed,
+ * as they are written while validating them.
+ */
+static constexpr uint32_t COMPRESSED_FRAME_FLAG{0x80000000};
+
+/**
+ * Deserialize the undo data of index, followed by its checksum, as read by
+ * BlockManager::ReadRawUndoAsync(). Returns false if the data is corrupt or
+ * the checksum does not match.
+ */
+[[nodiscard]] bool DeserializeUndo(Span<const uint8_t> data, const CBlockIndex& index, CBlockUndo& blockundo);
+
 // Because validation code takes pointers to the map's CBlockIndex objects, if
 // we ever switch to another associative container, we need to either use a
 // container that has stable addressing (true of all std associative
@@ -123,6 +143,14 @@ struct BlockfileCursor {
 
 std::ostream& operator<<(std::ostream& os, const BlockfileCursor& cursor);
 
+//! A block found in a block file by BlockManager::ScanBlockFile().
+struct ScannedBlock {
+    uint256 hash;
+    CBlockHeader header;
+    //! Position of the block data, after the message start and size.
+    FlatFilePos pos;
+};
+
 
 /**
  * Maintains a tree of blocks (stored in `m_block_index`) which is consulted
@@ -178,7 +206,20 @@ private:
      * (BLOCK_SERIALIZATION_HEADER_SIZE)
      */
     bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos) const;
-    bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint256& hashBlock) const;
+    /**
+     * Write serialized undo data, or the frame compressing it if set (see
+     * COMPRESSED_FRAME_FLAG), followed by the checksum of the undo data.
+     */
+    bool UndoWriteToDisk(Span<const std::byte> undo_data, FlatFilePos& pos, const uint256& hashBlock, const std::optional<std::vector<std::byte>>& frame) const;
+
+    /**
+     * Read the data at pos in a block or undo file, whose size is taken from
+     * the header in front of it, plus `trailer_size` bytes. Data stored as a
+     * compressed frame is decompressed.
+     *
+     * @param[in] filein  The file, positioned at the header in front of pos
+     */
+    bool ReadFromFile(AutoFile& filein, const FlatFilePos& pos, size_t trailer_size, std::vector<uint8_t>& data) const;
 
     /* Calculate the block/rev files to delete based on height specified by user with RPC command pruneblockchain */
     void FindFilesToPruneManual(
@@ -261,12 +302,37 @@ private:
 
     const kernel::BlockManagerOpts m_opts;
 
+    //! Mappings of the block and undo files, used if m_opts.mmap_block_files is set.
+    mutable FlatFileMapper m_block_file_mapper;
+    mutable FlatFileMapper m_undo_file_mapper;
+
+    /**
+     * Get the data at pos in a mapped block or undo file, whose size is taken
+     * from the header in front of it, plus `trailer_size` bytes.
+     *
+     * @returns std::nullopt if files are not mapped, the data is stored as a
+     *          compressed frame, or the data cannot be read from the mapping,
+     *          in which case the caller falls back to reading the file.
+     */
+    std::optional<MappedFlatFileSpan> ReadMapped(FlatFileMapper& mapper, const FlatFilePos& pos, size_t trailer_size) const;
+
+    //! Completes the reads queued by ReadRawBlockAsync() and ReadRawUndoAsync(), if m_opts.async_block_reads is set.
+    std::unique_ptr<AsyncFileReader> m_async_reader;
+
+    /** Queue a read of the data at pos in a block or undo file, as ReadMapped() or ReadFromFile() would return it. */
+    std::future<std::optional<std::vector<uint8_t>>> ReadAsync(FlatFileMapper& mapper, FlatFileSeq seq, const FlatFilePos& pos, size_t trailer_size) const;
+
 public:
     using Options = kernel::BlockManagerOpts;
+    //! The data read by ReadRawBlockAsync() or ReadRawUndoAsync(), or std::nullopt if the read failed.
+    using AsyncRead = std::future<std::optional<std::vector<uint8_t>>>;
 
     explicit BlockManager(const util::SignalInterrupt& interrupt, Options opts)
         : m_prune_mode{opts.prune_target > 0},
           m_opts{std::move(opts)},
+          m_block_file_mapper{BlockFileSeq()},
+          m_undo_file_mapper{UndoFileSeq()},
+          m_async_reader{m_opts.async_block_reads > 0 ? MakeAsyncFileReader(m_opts.async_block_reads) : nullptr},
           m_interrupt{interrupt} {}
 
     const util::SignalInterrupt& m_interrupt;
@@ -357,6 +423,13 @@ public:
 
     /** Attempt to stay below this number of bytes of block files. */
     [[nodiscard]] uint64_t GetPruneTarget() const { return m_opts.prune_target; }
+
+    //! Number of threads scanning block files during -reindex, or 0 to load them one at a time.
+    [[nodiscard]] int ReindexThreads() const { return m_opts.reindex_threads; }
+
+    //! Number of blocks read ahead of their use by a BlockReadAhead, or 0 to read them one at a time.
+    [[nodiscard]] int ReadAheadWindow() const { return m_opts.block_read_ahead; }
+
     static constexpr auto PRUNE_TARGET_MANUAL{std::numeric_limits<uint64_t>::max()};
 
     [[nodiscard]] bool LoadingBlocks() const { return m_importing || !m_blockfiles_indexed; }
@@ -401,10 +474,41 @@ public:
     bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos) const;
     bool ReadBlockFromDisk(CBlock& block, const CBlockIndex& index) const;
     bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos) const;
+    //! Get the serialized block at pos from a mapping of its block file, without
+    //! copying it. Returns std::nullopt if block files are not mapped, in which
+    //! case ReadRawBlockFromDisk() must be used.
+    std::optional<MappedFlatFileSpan> ReadMappedRawBlockFromDisk(const FlatFilePos& pos) const;
 
     bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex& index) const;
+    //! Read the undo data of index at pos, which the caller looked up under cs_main.
+    bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex& index, const FlatFilePos& pos) const;
+
+    /**
+     * Queue a read of the serialized block at pos, as ReadRawBlockFromDisk()
+     * would return it. With -asyncblockreads, up to that many reads are in
+     * flight at once and complete in the background. Otherwise, the block is
+     * read before returning.
+     */
+    AsyncRead ReadRawBlockAsync(const FlatFilePos& pos) const;
+    /** Queue a read of the undo data of index, for DeserializeUndo(), as ReadRawBlockAsync() does for blocks. */
+    AsyncRead ReadRawUndoAsync(const CBlockIndex& index) const;
+    //! Whether ReadRawBlockAsync() and ReadRawUndoAsync() complete in the background.
+    [[nodiscard]] bool HasAsyncReads() const { return m_async_reader != nullptr; }
 
     void CleanupBlockRevFiles() const;
+
+    /**
+     * Find the blocks stored in a block file, reading only their headers and
+     * skipping over the rest of each block. Data that is not a block is
+     * skipped as by ChainstateManager::LoadExternalBlockFile().
+     *
+     * Safe to call from several threads for different files, to scan block
+     * files in parallel during -reindex.
+     *
+     * @param[in] file_in   Block file, positioned at its start
+     * @param[in] file_num  Number of the block file, recorded in the block positions
+     */
+    std::vector<ScannedBlock> ScanBlockFile(AutoFile& file_in, int file_num) const;
 };
 
 void ImportBlocks(ChainstateManager& chainman, std::vector<fs::path> vImportFiles);
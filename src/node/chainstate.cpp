@@ -261,6 +261,9 @@ ChainstateLoadResult VerifyLoadedChainstate(ChainstateManager& chainman, const C
                                                          "Only rebuild the block database if you are sure that your computer's date and time are correct")};
             }
 
+            if (!chainstate->WaitForCoinsDBWrite()) {
+                return {ChainstateLoadStatus::FAILURE, _("Failed to write to coin database.")};
+            }
             VerifyDBResult result = CVerifyDB(chainman.GetNotifications()).VerifyDB(
                 *chainstate, chainman.GetConsensus(), chainstate->CoinsDB(),
                 options.check_level,
@@ -42,8 +42,9 @@ util::Result<void> ApplyArgsManOptions(const ArgsManager& args, ChainstateManage
 
     if (auto value{args.GetIntArg("-maxtipage")}) opts.max_tip_age = std::chrono::seconds{*value};
 
-    ReadDatabaseArgs(args, opts.block_tree_db);
-    ReadDatabaseArgs(args, opts.coins_db);
+    if (auto result{CheckDatabaseArgs(args)}; !result) return util::Error{util::ErrorString(result)};
+    ReadDatabaseArgs(args, opts.block_tree_db, "blockindex");
+    ReadDatabaseArgs(args, opts.coins_db, "chainstate");
     ReadCoinsViewArgs(args, opts.coins_view);
 
     int script_threads = args.GetIntArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
@@ -55,6 +56,8 @@ util::Result<void> ApplyArgsManOptions(const ArgsManager& args, ChainstateManage
     // Subtract 1 because the main thread counts towards the par threads.
     opts.worker_threads_num = std::clamp(script_threads - 1, 0, MAX_SCRIPTCHECK_THREADS);
     LogPrintf("Script verification uses %d additional threads\n", opts.worker_threads_num);
+    opts.script_check_work_stealing = args.GetBoolArg("-parworkstealing", DEFAULT_SCRIPTCHECK_WORK_STEALING);
+    opts.async_coins_flush = args.GetBoolArg("-asynccoinsflush", DEFAULT_ASYNC_COINS_FLUSH);
 
     return {};
 }
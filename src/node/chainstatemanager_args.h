@@ -14,6 +14,10 @@ class ArgsManager;
 static constexpr int MAX_SCRIPTCHECK_THREADS{15};
 /** -par default (number of script-checking threads, 0 = auto) */
 static constexpr int DEFAULT_SCRIPTCHECK_THREADS{0};
+/** -parworkstealing default */
+static constexpr bool DEFAULT_SCRIPTCHECK_WORK_STEALING{false};
+/** -asynccoinsflush default */
+static constexpr bool DEFAULT_ASYNC_COINS_FLUSH{false};
 
 namespace node {
 [[nodiscard]] util::Result<void> ApplyArgsManOptions(const ArgsManager& args, ChainstateManager::Options& opts);
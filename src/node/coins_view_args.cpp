@@ -12,5 +12,6 @@ void ReadCoinsViewArgs(const ArgsManager& args, CoinsViewOptions& options)
 {
     if (auto value = args.GetIntArg("-dbbatchsize")) options.batch_write_bytes = *value;
     if (auto value = args.GetIntArg("-dbcrashratio")) options.simulate_crash_ratio = *value;
+    options.lookup_filter = args.GetBoolArg("-coinslookupfilter", DEFAULT_COINS_LOOKUP_FILTER);
 }
 } // namespace node
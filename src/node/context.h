@@ -38,6 +38,7 @@ class SignalInterrupt;
 }
 
 namespace node {
+class BlockTemplateCache;
 class KernelNotifications;
 class Warnings;
 
@@ -84,6 +85,8 @@ struct NodeContext {
     std::atomic<int> exit_status{EXIT_SUCCESS};
     //! Manages all the node warnings
     std::unique_ptr<node::Warnings> warnings;
+    //! Block template served by getblocktemplate
+    std::unique_ptr<BlockTemplateCache> block_template_cache;
 
     //! Declare default constructor and destructor that are not inline, so code
     //! instantiating the NodeContext struct doesn't need to #include class
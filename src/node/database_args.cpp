@@ -6,13 +6,81 @@
 
 #include <common/args.h>
 #include <dbwrapper.h>
+#include <tinyformat.h>
+#include <util/strencodings.h>
+#include <util/string.h>
+#include <util/translation.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
 
 namespace node {
-void ReadDatabaseArgs(const ArgsManager& args, DBOptions& options)
+namespace {
+//! A database option taking an integer, given as -<name>=[<db>:]<n>.
+struct DatabaseIntArg {
+    const char* name;
+    int64_t min;
+    int64_t max;
+};
+
+constexpr DatabaseIntArg DB_BLOOM_BITS{"-dbbloombits", 0, 64};
+constexpr DatabaseIntArg DB_BLOCK_SIZE{"-dbblocksize", 1, 1024}; // KiB
+constexpr DatabaseIntArg DB_MAX_FILE_SIZE{"-dbmaxfilesize", 1, 1024}; // MiB
+constexpr DatabaseIntArg DB_WRITE_BUFFER{"-dbwritebuffer", 1, 4096}; // MiB
+
+//! Parse one value of a database option into the database it applies to
+//! (empty for all) and its value, or std::nullopt if it is invalid.
+std::optional<std::pair<std::string_view, int64_t>> ParseDatabaseArg(std::string_view arg, const DatabaseIntArg& option)
+{
+    std::string_view db_name;
+    if (const auto sep{arg.find(':')}; sep != std::string_view::npos) {
+        db_name = arg.substr(0, sep);
+        arg.remove_prefix(sep + 1);
+        if (std::find(DATABASE_NAMES.begin(), DATABASE_NAMES.end(), db_name) == DATABASE_NAMES.end()) return std::nullopt;
+    }
+    const auto value{ToIntegral<int64_t>(arg)};
+    if (!value || *value < option.min || *value > option.max) return std::nullopt;
+    return std::make_pair(db_name, *value);
+}
+
+std::optional<int64_t> GetDatabaseArg(const ArgsManager& args, const DatabaseIntArg& option, std::string_view db_name)
+{
+    std::optional<int64_t> for_all, for_db;
+    for (const std::string& arg : args.GetArgs(option.name)) {
+        const auto parsed{ParseDatabaseArg(arg, option)};
+        if (!parsed) continue;
+        if (parsed->first.empty()) {
+            for_all = parsed->second;
+        } else if (parsed->first == db_name) {
+            for_db = parsed->second;
+        }
+    }
+    return for_db ? for_db : for_all;
+}
+} // namespace
+
+void ReadDatabaseArgs(const ArgsManager& args, DBOptions& options, std::string_view db_name)
 {
-    // Settings here apply to all databases (chainstate, blocks, and index
-    // databases), but it'd be easy to parse database-specific options by adding
-    // a database_type string or enum parameter to this function.
     if (auto value = args.GetBoolArg("-forcecompactdb")) options.force_compact = *value;
+    if (auto value{GetDatabaseArg(args, DB_BLOOM_BITS, db_name)}) options.bloom_bits = *value;
+    if (auto value{GetDatabaseArg(args, DB_BLOCK_SIZE, db_name)}) options.block_bytes = *value << 10;
+    if (auto value{GetDatabaseArg(args, DB_MAX_FILE_SIZE, db_name)}) options.max_file_bytes = *value << 20;
+    if (auto value{GetDatabaseArg(args, DB_WRITE_BUFFER, db_name)}) options.write_buffer_bytes = *value << 20;
+}
+
+util::Result<void> CheckDatabaseArgs(const ArgsManager& args)
+{
+    for (const DatabaseIntArg& option : {DB_BLOOM_BITS, DB_BLOCK_SIZE, DB_MAX_FILE_SIZE, DB_WRITE_BUFFER}) {
+        for (const std::string& arg : args.GetArgs(option.name)) {
+            if (!ParseDatabaseArg(arg, option)) {
+                return util::Error{strprintf(Untranslated("Invalid value for %s: '%s'. Expected [<db>:]<n>, with <n> from %d to %d, and <db> one of %s"),
+                                             option.name, arg, option.min, option.max, util::Join(DATABASE_NAMES, ", ", [](std::string_view name) { return std::string{name}; }))};
+            }
+        }
+    }
+    return {};
 }
 } // namespace node
@@ -5,11 +5,28 @@
 #ifndef BITCOIN_NODE_DATABASE_ARGS_H
 #define BITCOIN_NODE_DATABASE_ARGS_H
 
+#include <util/result.h>
+
+#include <array>
+#include <string_view>
+
 class ArgsManager;
 struct DBOptions;
 
 namespace node {
-void ReadDatabaseArgs(const ArgsManager& args, DBOptions& options);
+//! Names of the databases that can be tuned separately, as in -dbbloombits=<db>:<n>.
+inline constexpr std::array<std::string_view, 5> DATABASE_NAMES{"blockfilterindex", "blockindex", "chainstate", "coinstatsindex", "txindex"};
+
+/**
+ * Read the options of the database `db_name`. Options given as
+ * -<option>=<db>:<value> apply to that database only, and take precedence
+ * over -<option>=<value>, which applies to all databases. Invalid values are
+ * ignored, and reported by CheckDatabaseArgs.
+ */
+void ReadDatabaseArgs(const ArgsManager& args, DBOptions& options, std::string_view db_name);
+
+//! Check that all values given for database options are valid.
+[[nodiscard]] util::Result<void> CheckDatabaseArgs(const ArgsManager& args);
 } // namespace node
 
 #endif // BITCOIN_NODE_DATABASE_ARGS_H
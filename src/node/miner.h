@@ -96,6 +96,9 @@ struct CompareTxIterByAncestorCount {
     }
 };
 
+// Multi_index tag names
+struct ancestor_score {};
+
 typedef boost::multi_index_container<
     CTxMemPoolModifiedEntry,
     boost::multi_index::indexed_by<
@@ -105,7 +108,6 @@ typedef boost::multi_index_container<
         >,
         // sorted by modified ancestor fee rate
         boost::multi_index::ordered_non_unique<
-            // Reuse same tag from CTxMemPool's similar index
             boost::multi_index::tag<ancestor_score>,
             boost::multi_index::identity<CTxMemPoolModifiedEntry>,
             CompareTxMemPoolEntryByAncestorFee
@@ -167,12 +169,22 @@ public:
     /** Construct a new block template with coinbase to scriptPubKeyIn */
     std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn);
 
+    /**
+     * Construct a new block template with coinbase to scriptPubKeyIn, holding
+     * the given mempool transactions in the given order instead of selecting
+     * them. The caller is responsible for them forming a valid block.
+     */
+    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, const std::vector<CTxMemPool::txiter>& selected)
+        EXCLUSIVE_LOCKS_REQUIRED(m_mempool->cs);
+
     inline static std::optional<int64_t> m_last_block_num_txs{};
     inline static std::optional<int64_t> m_last_block_weight{};
 
 private:
     const Options m_options;
 
+    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, const std::vector<CTxMemPool::txiter>* selected);
+
     // utility functions
     /** Clear the block's state and prepare for assembling a new block */
     void resetBlock();
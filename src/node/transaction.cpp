@@ -52,7 +52,7 @@ TransactionError BroadcastTransaction(NodeContext& node, const CTransactionRef t
         // and return early.
         CCoinsViewCache &view = node.chainman->ActiveChainstate().CoinsTip();
         for (size_t o = 0; o < tx->vout.size(); o++) {
-            const Coin& existingCoin = view.AccessCoin(COutPoint(txid, o));
+            const CompactCoin& existingCoin = view.AccessCoin(COutPoint(txid, o));
             // IsSpent doesn't mean the coin is spent, it means the output doesn't exist.
             // So if the output does exist, then this transaction exists in the chain.
             if (!existingCoin.IsSpent()) return TransactionError::ALREADY_IN_CHAIN;
@@ -4,6 +4,9 @@
 
 #include <node/utxo_snapshot.h>
 
+#include <consensus/amount.h>
+#include <hash.h>
+#include <kernel/coinstats.h>
 #include <logging.h>
 #include <streams.h>
 #include <sync.h>
@@ -11,15 +14,169 @@
 #include <txdb.h>
 #include <uint256.h>
 #include <util/fs.h>
+#include <util/thread.h>
 #include <validation.h>
 
 #include <cassert>
 #include <cstdio>
+#include <limits>
 #include <optional>
 #include <string>
 
 namespace node {
 
+//! Number of coins passed between the stages of SnapshotCoinsLoader at once.
+static constexpr size_t SNAPSHOT_LOAD_BATCH_SIZE{10'000};
+//! Number of batches each stage of SnapshotCoinsLoader may get ahead of the next.
+static constexpr size_t SNAPSHOT_LOAD_QUEUE_DEPTH{8};
+
+bool SnapshotCoinsLoader::BatchQueue::Push(Batch&& batch)
+{
+    WAIT_LOCK(m_mutex, lock);
+    m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_closed || m_batches.size() < SNAPSHOT_LOAD_QUEUE_DEPTH; });
+    if (m_closed) return false;
+    m_batches.push_back(std::move(batch));
+    m_cv.notify_all();
+    return true;
+}
+
+std::optional<SnapshotCoinsLoader::Batch> SnapshotCoinsLoader::BatchQueue::Pop()
+{
+    WAIT_LOCK(m_mutex, lock);
+    m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_closed || !m_batches.empty(); });
+    if (m_batches.empty()) return std::nullopt;
+    Batch batch{std::move(m_batches.front())};
+    m_batches.pop_front();
+    m_cv.notify_all();
+    return batch;
+}
+
+void SnapshotCoinsLoader::BatchQueue::Close()
+{
+    LOCK(m_mutex);
+    m_closed = true;
+    m_cv.notify_all();
+}
+
+SnapshotCoinsLoader::SnapshotCoinsLoader(AutoFile& file, uint64_t coins_count, int base_height)
+{
+    m_reader = std::thread{&util::TraceThread, "snapread", [this, &file, coins_count, base_height] { ReadCoins(file, coins_count, base_height); }};
+    m_hasher = std::thread{&util::TraceThread, "snaphash", [this] { HashCoins(); }};
+}
+
+SnapshotCoinsLoader::~SnapshotCoinsLoader()
+{
+    Interrupt();
+    if (m_reader.joinable()) m_reader.join();
+    if (m_hasher.joinable()) m_hasher.join();
+}
+
+void SnapshotCoinsLoader::Interrupt()
+{
+    m_read.Close();
+    m_hashed.Close();
+}
+
+void SnapshotCoinsLoader::ReadCoins(AutoFile& file, uint64_t coins_count, int base_height)
+{
+    uint64_t coins_left{coins_count};
+    Batch batch;
+    batch.reserve(SNAPSHOT_LOAD_BATCH_SIZE);
+    std::optional<Txid> prev_txid;
+
+    // Returns false if the snapshot is invalid or loading was interrupted.
+    const auto read_coins{[&]() -> bool {
+        while (coins_left > 0) {
+            Txid txid;
+            file >> txid;
+            const size_t coins_per_txid{ReadCompactSize(file)};
+            if (coins_per_txid > coins_left) {
+                m_error = "mismatch in coins count in snapshot metadata and actual snapshot data";
+                return false;
+            }
+            // The coins database is ordered by txid, and then by output index.
+            if (prev_txid && !(*prev_txid < txid)) m_in_db_order = false;
+            prev_txid = txid;
+
+            std::optional<uint32_t> prev_n;
+            for (size_t i{0}; i < coins_per_txid; ++i) {
+                COutPoint outpoint;
+                Coin coin;
+                outpoint.n = static_cast<uint32_t>(ReadCompactSize(file));
+                outpoint.hash = txid;
+                file >> coin;
+                if (coin.nHeight > base_height ||
+                    outpoint.n >= std::numeric_limits<decltype(outpoint.n)>::max() // Avoid integer wrap-around in coinstats.cpp:ApplyHash
+                ) {
+                    m_error = strprintf("bad snapshot data after deserializing %d coins", coins_count - coins_left);
+                    return false;
+                }
+                if (!MoneyRange(coin.out.nValue)) {
+                    m_error = strprintf("bad snapshot data after deserializing %d coins - bad tx out value", coins_count - coins_left);
+                    return false;
+                }
+                if (prev_n && *prev_n >= outpoint.n) m_in_db_order = false;
+                prev_n = outpoint.n;
+
+                batch.emplace_back(std::move(outpoint), std::move(coin));
+                --coins_left;
+                if (batch.size() == SNAPSHOT_LOAD_BATCH_SIZE) {
+                    if (!m_read.Push(std::move(batch))) return false;
+                    batch.clear();
+                    batch.reserve(SNAPSHOT_LOAD_BATCH_SIZE);
+                }
+            }
+        }
+        return true;
+    }};
+
+    try {
+        if (read_coins() && (batch.empty() || m_read.Push(std::move(batch)))) {
+            bool out_of_coins{false};
+            try {
+                std::byte left_over_byte;
+                file >> left_over_byte;
+            } catch (const std::ios_base::failure&) {
+                // We expect an exception since we should be out of coins.
+                out_of_coins = true;
+            }
+            if (!out_of_coins) {
+                m_error = strprintf("bad snapshot - coins left over after deserializing %d coins", coins_count);
+            }
+        }
+    } catch (const std::ios_base::failure&) {
+        m_error = strprintf("bad snapshot format or truncated snapshot after deserializing %d coins", coins_count - coins_left);
+    }
+    m_read.Close();
+}
+
+void SnapshotCoinsLoader::HashCoins()
+{
+    HashWriter ss{};
+    while (auto batch{m_read.Pop()}) {
+        for (const auto& [outpoint, coin] : *batch) {
+            kernel::ApplyCoinHash(ss, outpoint, coin);
+        }
+        if (!m_hashed.Push(std::move(*batch))) return;
+    }
+    m_hash = ss.GetHash();
+    m_hashed.Close();
+}
+
+SnapshotCoinsLoader::Batch SnapshotCoinsLoader::NextBatch()
+{
+    if (auto batch{m_hashed.Pop()}) return std::move(*batch);
+    if (m_reader.joinable()) m_reader.join();
+    if (m_hasher.joinable()) m_hasher.join();
+    return {};
+}
+
+std::optional<uint256> SnapshotCoinsLoader::GetSerializedHash() const
+{
+    if (m_error || !m_in_db_order) return std::nullopt;
+    return m_hash;
+}
+
 bool WriteSnapshotBaseBlockhash(Chainstate& snapshot_chainstate)
 {
     AssertLockHeld(::cs_main);
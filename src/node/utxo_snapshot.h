@@ -7,8 +7,10 @@
 #define BITCOIN_NODE_UTXO_SNAPSHOT_H
 
 #include <chainparams.h>
+#include <coins.h>
 #include <kernel/chainparams.h>
 #include <kernel/cs_main.h>
+#include <primitives/transaction.h>
 #include <serialize.h>
 #include <sync.h>
 #include <uint256.h>
@@ -16,13 +18,20 @@
 #include <util/check.h>
 #include <util/fs.h>
 
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <optional>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 // UTXO set snapshot magic bytes
 static constexpr std::array<uint8_t, 5> SNAPSHOT_MAGIC_BYTES = {'u', 't', 'x', 'o', 0xff};
 
+class AutoFile;
 class Chainstate;
 
 namespace node {
@@ -104,6 +113,77 @@ public:
     }
 };
 
+/**
+ * Reads the coins of a UTXO snapshot in a pipeline of background threads.
+ *
+ * A reader thread deserializes and checks the coins, a hasher thread hashes
+ * them as ComputeUTXOStats() does for CoinStatsHashType::HASH_SERIALIZED, and
+ * the caller consumes them in batches with NextBatch(), e.g. to write them to
+ * the coins database. The stages run concurrently.
+ *
+ * Snapshots are written in the order of the coins database, so the hash of the
+ * coins in file order is the hash of the database they are loaded into. That
+ * saves reading all coins back from the database to validate the snapshot.
+ */
+class SnapshotCoinsLoader
+{
+public:
+    using Batch = std::vector<std::pair<COutPoint, Coin>>;
+
+private:
+    //! Bounded queue of batches between two pipeline stages.
+    class BatchQueue
+    {
+        Mutex m_mutex;
+        std::condition_variable m_cv;
+        std::deque<Batch> m_batches GUARDED_BY(m_mutex);
+        bool m_closed GUARDED_BY(m_mutex){false};
+
+    public:
+        //! Wait for room and append a batch. @returns false if the queue was closed.
+        bool Push(Batch&& batch) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+        //! Wait for a batch. @returns std::nullopt once the queue is closed and empty.
+        std::optional<Batch> Pop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+        void Close() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    };
+
+    BatchQueue m_read;
+    BatchQueue m_hashed;
+    //! Written by the pipeline threads, and only read once they were joined.
+    std::optional<std::string> m_error;
+    bool m_in_db_order{true};
+    //! Set once all coins were hashed.
+    std::optional<uint256> m_hash;
+    std::thread m_reader;
+    std::thread m_hasher;
+
+    void ReadCoins(AutoFile& file, uint64_t coins_count, int base_height);
+    void HashCoins();
+
+public:
+    SnapshotCoinsLoader(AutoFile& file, uint64_t coins_count, int base_height);
+    ~SnapshotCoinsLoader();
+
+    SnapshotCoinsLoader(const SnapshotCoinsLoader&) = delete;
+    SnapshotCoinsLoader& operator=(const SnapshotCoinsLoader&) = delete;
+
+    //! The next batch of coins, in file order. Empty once all coins were read,
+    //! the snapshot turned out to be invalid, or loading was interrupted, at
+    //! which point the pipeline threads have exited.
+    Batch NextBatch();
+
+    //! Stop reading and hashing.
+    void Interrupt();
+
+    //! Once NextBatch() returned an empty batch, why the snapshot is invalid, if it is.
+    const std::optional<std::string>& GetError() const { return m_error; }
+
+    //! Once NextBatch() returned an empty batch, the HASH_SERIALIZED hash of
+    //! the coins, or std::nullopt if they are not in the order of the coins
+    //! database and the hash must be computed from the database instead.
+    std::optional<uint256> GetSerializedHash() const;
+};
+
 //! The file in the snapshot chainstate dir which stores the base blockhash. This is
 //! needed to reconstruct snapshot chainstates on init.
 //!
@@ -11,6 +11,7 @@
 #include <clientversion.h>
 #include <coins.h>
 #include <common/args.h>
+#include <common/system.h>
 #include <consensus/amount.h>
 #include <consensus/params.h>
 #include <consensus/validation.h>
@@ -21,6 +22,7 @@
 #include <hash.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
+#include <kernel/coinsrangereader.h>
 #include <kernel/coinstats.h>
 #include <logging/timer.h>
 #include <net.h>
@@ -52,7 +54,10 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <map>
 #include <memory>
 #include <mutex>
 
@@ -957,6 +962,9 @@ static RPCHelpMan gettxoutsetinfo()
     BlockManager* blockman;
     {
         LOCK(::cs_main);
+        if (!active_chainstate.WaitForCoinsDBWrite()) {
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to write UTXO set");
+        }
         coins_view = &active_chainstate.CoinsDB();
         blockman = &active_chainstate.m_blockman;
         pindex = blockman->LookupBlockIndex(coins_view->GetBestBlock());
@@ -2029,33 +2037,63 @@ static RPCHelpMan getblockstats()
     };
 }
 
+//! Number of threads reading the coins database for scantxoutset and dumptxoutset.
+static int CoinsReadThreads()
+{
+    return std::clamp(GetNumCores(), 1, kernel::MAX_COINS_READ_THREADS);
+}
+
+//! Number of coins a scantxoutset thread checks before passing on its matches.
+static constexpr int64_t SCAN_TXOUTSET_CHUNK_COINS{1 << 16};
+
 namespace {
-//! Search for a given set of pubkey scripts
-bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results, std::function<void()>& interruption_point)
+//! Coins checked by a scantxoutset thread.
+struct ScanChunk {
+    int64_t count{0};
+    //! The coins whose scriptPubKey matched
+    std::map<COutPoint, Coin> coins{};
+    //! Txid of the last coin checked, to report progress
+    Txid last{};
+};
+
+//! Search for a given set of pubkey scripts, in the disjoint ranges of the
+//! cursors on several threads
+bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, std::vector<std::unique_ptr<CCoinsViewCursor>> cursors, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results, std::function<void()>& interruption_point)
 {
     scan_progress = 0;
     count = 0;
-    while (cursor->Valid()) {
-        COutPoint key;
-        Coin coin;
-        if (!cursor->GetKey(key) || !cursor->GetValue(coin)) return false;
-        if (++count % 8192 == 0) {
-            interruption_point();
-            if (should_abort) {
+    const auto read_range{[&](CCoinsViewCursor& cursor, const kernel::CoinsRangeReader<ScanChunk>::PushChunk& push) {
+        ScanChunk chunk;
+        for (; cursor.Valid(); cursor.Next()) {
+            COutPoint key;
+            Coin coin;
+            if (!cursor.GetKey(key) || !cursor.GetValue(coin)) return false;
+            if (++chunk.count % 8192 == 0 && should_abort) {
                 // allow to abort the scan via the abort reference
                 return false;
             }
+            if (needles.count(coin.out.scriptPubKey)) {
+                chunk.coins.emplace(key, std::move(coin));
+            }
+            chunk.last = key.hash;
+            if (chunk.count == SCAN_TXOUTSET_CHUNK_COINS) {
+                if (!push(std::move(chunk))) return false;
+                chunk = {};
+            }
         }
-        if (count % 256 == 0) {
-            // update progress reference every 256 item
-            uint32_t high = 0x100 * *UCharCast(key.hash.begin()) + *(UCharCast(key.hash.begin()) + 1);
-            scan_progress = (int)(high * 100.0 / 65536.0 + 0.5);
-        }
-        if (needles.count(coin.out.scriptPubKey)) {
-            out_results.emplace(key, coin);
-        }
-        cursor->Next();
+        return chunk.count == 0 || push(std::move(chunk));
+    }};
+
+    kernel::CoinsRangeReader<ScanChunk> reader{std::move(cursors), CoinsReadThreads(), "scancoins", read_range};
+    while (auto chunk{reader.NextChunk()}) {
+        interruption_point();
+        count += chunk->count;
+        out_results.merge(chunk->coins);
+        // update progress reference after every chunk, which are handed out in key order
+        uint32_t high = 0x100 * *UCharCast(chunk->last.begin()) + *(UCharCast(chunk->last.begin()) + 1);
+        scan_progress = (int)(high * 100.0 / 65536.0 + 0.5);
     }
+    if (reader.Failed()) return false;
     scan_progress = 100;
     return true;
 }
@@ -2235,7 +2273,7 @@ static RPCHelpMan scantxoutset()
         std::map<COutPoint, Coin> coins;
         g_should_abort_scan = false;
         int64_t count = 0;
-        std::unique_ptr<CCoinsViewCursor> pcursor;
+        std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
         const CBlockIndex* tip;
         NodeContext& node = EnsureAnyNodeContext(request.context);
         {
@@ -2243,10 +2281,13 @@ static RPCHelpMan scantxoutset()
             LOCK(cs_main);
             Chainstate& active_chainstate = chainman.ActiveChainstate();
             active_chainstate.ForceFlushStateToDisk();
-            pcursor = CHECK_NONFATAL(active_chainstate.CoinsDB().Cursor());
+            if (!active_chainstate.WaitForCoinsDBWrite()) {
+                throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to write UTXO set");
+            }
+            cursors = active_chainstate.CoinsDB().Cursors(CoinsReadThreads() * kernel::COINS_READ_RANGES_PER_THREAD);
             tip = CHECK_NONFATAL(active_chainstate.m_chain.Tip());
         }
-        bool res = FindScriptPubKey(g_scan_progress, g_should_abort_scan, count, pcursor.get(), needles, coins, node.rpc_interruption_point);
+        bool res = FindScriptPubKey(g_scan_progress, g_should_abort_scan, count, std::move(cursors), needles, coins, node.rpc_interruption_point);
         result.pushKV("success", res);
         result.pushKV("txouts", count);
         result.pushKV("height", tip->nHeight);
@@ -2661,6 +2702,67 @@ static RPCHelpMan dumptxoutset()
     };
 }
 
+//! Size in bytes of the serialized coins that a reading thread passes on at once.
+static constexpr size_t DUMP_TXOUTSET_CHUNK_SIZE{1 << 18};
+
+namespace {
+//! Coins read for a UTXO snapshot, serialized as in the snapshot file and as
+//! hashed for CoinStatsHashType::HASH_SERIALIZED.
+struct SnapshotChunk {
+    DataStream coins{};
+    DataStream hashed{};
+    uint64_t coins_count{0};
+};
+
+//! Serialize the coins of a range, which never splits the coins of a txid.
+bool ReadSnapshotRange(CCoinsViewCursor& cursor, const kernel::CoinsRangeReader<SnapshotChunk>::PushChunk& push)
+{
+    SnapshotChunk chunk;
+    // The coins of the current txid, which are preceded by their number
+    // in the snapshot file.
+    DataStream group{};
+    uint64_t group_size{0};
+    Txid txid;
+    // The same coins by output index. The cursor yields them in the order of
+    // their VARINT-encoded keys, which is not numeric once n exceeds 16511,
+    // while the hash, like ComputeUTXOStats, needs them in numeric order.
+    std::map<uint32_t, Coin> outputs;
+    const auto end_group{[&] {
+        if (group_size == 0) return;
+        chunk.coins << txid;
+        WriteCompactSize(chunk.coins, group_size);
+        chunk.coins.write(group);
+        for (const auto& [n, output] : outputs) {
+            kernel::SerializeCoinForHash(chunk.hashed, COutPoint{txid, n}, output);
+        }
+        group.clear();
+        group_size = 0;
+        outputs.clear();
+    }};
+
+    COutPoint key;
+    Coin coin;
+    for (; cursor.Valid(); cursor.Next()) {
+        if (!cursor.GetKey(key) || !cursor.GetValue(coin)) return false;
+        if (key.hash != txid) {
+            end_group();
+            txid = key.hash;
+            if (chunk.coins.size() >= DUMP_TXOUTSET_CHUNK_SIZE) {
+                if (!push(std::move(chunk))) return false;
+                chunk = {};
+            }
+        }
+        WriteCompactSize(group, key.n);
+        group << coin;
+        ++group_size;
+        outputs.emplace(key.n, std::move(coin));
+        ++chunk.coins_count;
+    }
+    end_group();
+    return chunk.coins_count == 0 || push(std::move(chunk));
+}
+} // namespace
+
 UniValue CreateUTXOSnapshot(
     NodeContext& node,
     Chainstate& chainstate,
@@ -2668,18 +2770,17 @@ UniValue CreateUTXOSnapshot(
     const fs::path& path,
     const fs::path& temppath)
 {
-    std::unique_ptr<CCoinsViewCursor> pcursor;
-    std::optional<CCoinsStats> maybe_stats;
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
     const CBlockIndex* tip;
 
     {
         // We need to lock cs_main to ensure that the coinsdb isn't written to
-        // between (i) flushing coins cache to disk (coinsdb), (ii) getting stats
-        // based upon the coinsdb, and (iii) constructing a cursor to the
-        // coinsdb for use below this block.
+        // between (i) flushing coins cache to disk (coinsdb), (ii) getting
+        // its best block, and (iii) constructing the cursors to the coinsdb
+        // for use below this block.
         //
         // Cursors returned by leveldb iterate over snapshots, so the contents
-        // of the pcursor will not be affected by simultaneous writes during
+        // of the cursors will not be affected by simultaneous writes during
         // use below this block.
         //
         // See discussion here:
@@ -2688,70 +2789,48 @@ UniValue CreateUTXOSnapshot(
         LOCK(::cs_main);
 
         chainstate.ForceFlushStateToDisk();
-
-        maybe_stats = GetUTXOStats(&chainstate.CoinsDB(), chainstate.m_blockman, CoinStatsHashType::HASH_SERIALIZED, node.rpc_interruption_point);
-        if (!maybe_stats) {
-            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+        if (!chainstate.WaitForCoinsDBWrite()) {
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to write UTXO set");
         }
 
-        pcursor = chainstate.CoinsDB().Cursor();
-        tip = CHECK_NONFATAL(chainstate.m_blockman.LookupBlockIndex(maybe_stats->hashBlock));
+        const CCoinsViewDB& coins_db{chainstate.CoinsDB()};
+        tip = CHECK_NONFATAL(chainstate.m_blockman.LookupBlockIndex(coins_db.GetBestBlock()));
+
+        cursors = coins_db.Cursors(CoinsReadThreads() * kernel::COINS_READ_RANGES_PER_THREAD);
     }
 
     LOG_TIME_SECONDS(strprintf("writing UTXO snapshot at height %s (%s) to file %s (via %s)",
         tip->nHeight, tip->GetBlockHash().ToString(),
         fs::PathToString(path), fs::PathToString(temppath)));
 
-    SnapshotMetadata metadata{chainstate.m_chainman.GetParams().MessageStart(), tip->GetBlockHash(), tip->nHeight, maybe_stats->coins_count};
-
-    afile << metadata;
-
-    COutPoint key;
-    Txid last_hash;
-    Coin coin;
-    unsigned int iter{0};
-    size_t written_coins_count{0};
-    std::vector<std::pair<uint32_t, Coin>> coins;
+    // The number of coins is only known once they were all written, so the
+    // metadata is written again at the end.
+    const int64_t metadata_pos{afile.tell()};
+    afile << SnapshotMetadata{chainstate.m_chainman.GetParams().MessageStart(), tip->GetBlockHash(), tip->nHeight, /*coins_count=*/0};
 
     // To reduce space the serialization format of the snapshot avoids
     // duplication of tx hashes. The code takes advantage of the guarantee by
-    // leveldb that keys are lexicographically sorted.
-    // In the coins vector we collect all coins that belong to a certain tx hash
-    // (key.hash) and when we have them all (key.hash != last_hash) we write
-    // them to file using the below lambda function.
+    // leveldb that keys are lexicographically sorted: the coins of a tx hash
+    // are adjacent, and never span two ranges.
     // See also https://github.com/bitcoin/bitcoin/issues/25675
-    auto write_coins_to_file = [&](AutoFile& afile, const Txid& last_hash, const std::vector<std::pair<uint32_t, Coin>>& coins, size_t& written_coins_count) {
-        afile << last_hash;
-        WriteCompactSize(afile, coins.size());
-        for (const auto& [n, coin] : coins) {
-            WriteCompactSize(afile, n);
-            afile << coin;
-            ++written_coins_count;
-        }
-    };
-
-    pcursor->GetKey(key);
-    last_hash = key.hash;
-    while (pcursor->Valid()) {
-        if (iter % 5000 == 0) node.rpc_interruption_point();
-        ++iter;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
-            if (key.hash != last_hash) {
-                write_coins_to_file(afile, last_hash, coins, written_coins_count);
-                last_hash = key.hash;
-                coins.clear();
-            }
-            coins.emplace_back(key.n, coin);
+    HashWriter hasher{};
+    uint64_t written_coins_count{0};
+    {
+        kernel::CoinsRangeReader<SnapshotChunk> reader{std::move(cursors), CoinsReadThreads(), "dumpcoins", ReadSnapshotRange};
+        while (auto chunk{reader.NextChunk()}) {
+            node.rpc_interruption_point();
+            afile.write(chunk->coins);
+            hasher.write(chunk->hashed);
+            written_coins_count += chunk->coins_count;
+        }
+        if (reader.Failed()) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
         }
-        pcursor->Next();
     }
+    const uint256 txoutset_hash{hasher.GetHash()};
 
-    if (!coins.empty()) {
-        write_coins_to_file(afile, last_hash, coins, written_coins_count);
-    }
-
-    CHECK_NONFATAL(written_coins_count == maybe_stats->coins_count);
-
+    afile.seek(metadata_pos, SEEK_SET);
+    afile << SnapshotMetadata{chainstate.m_chainman.GetParams().MessageStart(), tip->GetBlockHash(), tip->nHeight, written_coins_count};
     afile.fclose();
 
     UniValue result(UniValue::VOBJ);
@@ -2759,7 +2838,7 @@ UniValue CreateUTXOSnapshot(
     result.pushKV("base_hash", tip->GetBlockHash().ToString());
     result.pushKV("base_height", tip->nHeight);
     result.pushKV("path", path.utf8string());
-    result.pushKV("txoutset_hash", maybe_stats->hashSerialized.ToString());
+    result.pushKV("txoutset_hash", txoutset_hash.ToString());
     result.pushKV("nchaintx", tip->nChainTx);
     return result;
 }
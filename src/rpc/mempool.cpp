@@ -12,7 +12,6 @@
 #include <kernel/mempool_entry.h>
 #include <node/mempool_persist_args.h>
 #include <node/types.h>
-#include <policy/rbf.h>
 #include <policy/settings.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
@@ -20,12 +19,16 @@
 #include <rpc/util.h>
 #include <txmempool.h>
 #include <univalue.h>
+#include <util/check.h>
 #include <util/fs.h>
 #include <util/moneystr.h>
 #include <util/strencodings.h>
 #include <util/time.h>
 
+#include <set>
+#include <string>
 #include <utility>
+#include <vector>
 
 using kernel::DumpMempool;
 
@@ -279,33 +282,28 @@ static std::vector<RPCResult> MempoolEntryDescription()
     };
 }
 
-static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPoolEntry& e) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+static void entryToJSON(UniValue& info, const MempoolEntrySnapshot& e)
 {
-    AssertLockHeld(pool.cs);
-
-    info.pushKV("vsize", (int)e.GetTxSize());
-    info.pushKV("weight", (int)e.GetTxWeight());
-    info.pushKV("time", count_seconds(e.GetTime()));
-    info.pushKV("height", (int)e.GetHeight());
-    info.pushKV("descendantcount", e.GetCountWithDescendants());
-    info.pushKV("descendantsize", e.GetSizeWithDescendants());
-    info.pushKV("ancestorcount", e.GetCountWithAncestors());
-    info.pushKV("ancestorsize", e.GetSizeWithAncestors());
-    info.pushKV("wtxid", e.GetTx().GetWitnessHash().ToString());
+    info.pushKV("vsize", (int)e.vsize);
+    info.pushKV("weight", (int)e.weight);
+    info.pushKV("time", count_seconds(e.time));
+    info.pushKV("height", (int)e.height);
+    info.pushKV("descendantcount", e.descendant_count);
+    info.pushKV("descendantsize", e.descendant_size);
+    info.pushKV("ancestorcount", e.ancestor_count);
+    info.pushKV("ancestorsize", e.ancestor_size);
+    info.pushKV("wtxid", e.tx->GetWitnessHash().ToString());
 
     UniValue fees(UniValue::VOBJ);
-    fees.pushKV("base", ValueFromAmount(e.GetFee()));
-    fees.pushKV("modified", ValueFromAmount(e.GetModifiedFee()));
-    fees.pushKV("ancestor", ValueFromAmount(e.GetModFeesWithAncestors()));
-    fees.pushKV("descendant", ValueFromAmount(e.GetModFeesWithDescendants()));
+    fees.pushKV("base", ValueFromAmount(e.fee));
+    fees.pushKV("modified", ValueFromAmount(e.modified_fee));
+    fees.pushKV("ancestor", ValueFromAmount(e.ancestor_fees));
+    fees.pushKV("descendant", ValueFromAmount(e.descendant_fees));
     info.pushKV("fees", std::move(fees));
 
-    const CTransaction& tx = e.GetTx();
     std::set<std::string> setDepends;
-    for (const CTxIn& txin : tx.vin)
-    {
-        if (pool.exists(GenTxid::Txid(txin.prevout.hash)))
-            setDepends.insert(txin.prevout.hash.ToString());
+    for (const Txid& parent : e.depends) {
+        setDepends.insert(parent.ToString());
     }
 
     UniValue depends(UniValue::VARR);
@@ -317,23 +315,14 @@ static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPool
     info.pushKV("depends", std::move(depends));
 
     UniValue spent(UniValue::VARR);
-    for (const CTxMemPoolEntry& child : e.GetMemPoolChildrenConst()) {
-        spent.push_back(child.GetTx().GetHash().ToString());
+    for (const Txid& child : e.spent_by) {
+        spent.push_back(child.ToString());
     }
 
     info.pushKV("spentby", std::move(spent));
 
-    // Add opt-in RBF status
-    bool rbfStatus = false;
-    RBFTransactionState rbfState = IsRBFOptIn(tx, pool);
-    if (rbfState == RBFTransactionState::UNKNOWN) {
-        throw JSONRPCError(RPC_MISC_ERROR, "Transaction is not in mempool");
-    } else if (rbfState == RBFTransactionState::REPLACEABLE_BIP125) {
-        rbfStatus = true;
-    }
-
-    info.pushKV("bip125-replaceable", rbfStatus);
-    info.pushKV("unbroadcast", pool.IsUnbroadcastTx(tx.GetHash()));
+    info.pushKV("bip125-replaceable", e.bip125_replaceable);
+    info.pushKV("unbroadcast", e.unbroadcast);
 }
 
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempool_sequence)
@@ -342,15 +331,17 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempoo
         if (include_mempool_sequence) {
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbose results cannot contain mempool sequence values.");
         }
-        LOCK(pool.cs);
+        // Build the result from a snapshot, so that the mempool is not locked
+        // while converting possibly many entries to JSON.
+        const auto snapshot{pool.GetSnapshot()};
         UniValue o(UniValue::VOBJ);
-        for (const CTxMemPoolEntry& e : pool.entryAll()) {
+        for (const MempoolEntrySnapshot& e : snapshot->entries) {
             UniValue info(UniValue::VOBJ);
-            entryToJSON(pool, info, e);
+            entryToJSON(info, e);
             // Mempool has unique entries so there is no advantage in using
             // UniValue::pushKV, which checks if the key already exists in O(N).
             // UniValue::pushKVEnd is used instead which currently is O(1).
-            o.pushKVEnd(e.GetTx().GetHash().ToString(), std::move(info));
+            o.pushKVEnd(e.tx->GetHash().ToString(), std::move(info));
         }
         return o;
     } else {
@@ -476,7 +467,7 @@ static RPCHelpMan getmempoolancestors()
             const CTxMemPoolEntry &e = *ancestorIt;
             const uint256& _hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
-            entryToJSON(mempool, info, e);
+            entryToJSON(info, mempool.GetEntrySnapshot(e));
             o.pushKV(_hash.ToString(), std::move(info));
         }
         return o;
@@ -541,7 +532,7 @@ static RPCHelpMan getmempooldescendants()
             const CTxMemPoolEntry &e = *descendantIt;
             const uint256& _hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
-            entryToJSON(mempool, info, e);
+            entryToJSON(info, mempool.GetEntrySnapshot(e));
             o.pushKV(_hash.ToString(), std::move(info));
         }
         return o;
@@ -576,7 +567,7 @@ static RPCHelpMan getmempoolentry()
     }
 
     UniValue info(UniValue::VOBJ);
-    entryToJSON(mempool, info, *entry);
+    entryToJSON(info, mempool.GetEntrySnapshot(*entry));
     return info;
 },
     };
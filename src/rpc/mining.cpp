@@ -18,6 +18,7 @@
 #include <deploymentstatus.h>
 #include <key_io.h>
 #include <net.h>
+#include <node/block_template_cache.h>
 #include <node/context.h>
 #include <node/miner.h>
 #include <node/warnings.h>
@@ -798,31 +799,18 @@ static RPCHelpMan getblocktemplate()
     }
 
     // Update block
-    static CBlockIndex* pindexPrev;
-    static int64_t time_start;
-    static std::unique_ptr<CBlockTemplate> pblocktemplate;
-    if (pindexPrev != active_chain.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - time_start > 5))
-    {
-        // Clear pindexPrev so future calls make a new block, despite any failures from here on
-        pindexPrev = nullptr;
-
-        // Store the pindexBest used before CreateNewBlock, to avoid races
-        nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-        CBlockIndex* pindexPrevNew = active_chain.Tip();
-        time_start = GetTime();
-
-        // Create new block
-        CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate = BlockAssembler{active_chainstate, &mempool}.CreateNewBlock(scriptDummy);
-        if (!pblocktemplate)
-            throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
-
-        // Need to update only after we know CreateNewBlock succeeded
-        pindexPrev = pindexPrevNew;
+    if (!node.block_template_cache) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block template cache not found");
     }
-    CHECK_NONFATAL(pindexPrev);
-    CBlock* pblock = &pblocktemplate->block; // pointer for convenience
+    const auto [pblocktemplate, transactions_updated]{node.block_template_cache->Get()};
+    if (!pblocktemplate)
+        throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
+    nTransactionsUpdatedLast = transactions_updated;
+    const CBlockIndex* const pindexPrev{active_chain.Tip()};
+    CHECK_NONFATAL(pblocktemplate->block.hashPrevBlock == pindexPrev->GetBlockHash());
+    // The template is shared with later calls, so only modify a copy
+    CBlock block{pblocktemplate->block};
+    CBlock* pblock = &block; // pointer for convenience
 
     // Update nTime
     UpdateTime(pblock, consensusParams, pindexPrev);
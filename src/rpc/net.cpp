@@ -633,6 +633,14 @@ static RPCHelpMan getnetworkinfo()
                         }},
                         {RPCResult::Type::BOOL, "localrelay", "true if transaction relay is requested from peers"},
                         {RPCResult::Type::NUM, "timeoffset", "the time offset"},
+                        {RPCResult::Type::OBJ, "blockservecache", /*optional=*/true, "the cache of serialized blocks served to peers (only present if -blockservecache is set)",
+                        {
+                            {RPCResult::Type::NUM, "hits", "the number of block requests served from the cache"},
+                            {RPCResult::Type::NUM, "misses", "the number of block requests that were not in the cache"},
+                            {RPCResult::Type::NUM, "entries", "the number of cached blocks, counting each serialization separately"},
+                            {RPCResult::Type::NUM, "usage", "the memory used by the cache, in bytes"},
+                            {RPCResult::Type::NUM, "maxusage", "the maximum memory used by the cache, in bytes"},
+                        }},
                         {RPCResult::Type::NUM, "connections", "the total number of connections"},
                         {RPCResult::Type::NUM, "connections_in", "the number of inbound connections"},
                         {RPCResult::Type::NUM, "connections_out", "the number of outbound connections"},
@@ -690,6 +698,15 @@ static RPCHelpMan getnetworkinfo()
         auto peerman_info{node.peerman->GetInfo()};
         obj.pushKV("localrelay", !peerman_info.ignores_incoming_txs);
         obj.pushKV("timeoffset", Ticks<std::chrono::seconds>(peerman_info.median_outbound_time_offset));
+        if (const auto& cache_stats{peerman_info.block_serve_cache}) {
+            UniValue cache(UniValue::VOBJ);
+            cache.pushKV("hits", cache_stats->hits);
+            cache.pushKV("misses", cache_stats->misses);
+            cache.pushKV("entries", cache_stats->entries);
+            cache.pushKV("usage", cache_stats->memory_usage);
+            cache.pushKV("maxusage", cache_stats->max_memory_usage);
+            obj.pushKV("blockservecache", std::move(cache));
+        }
     }
     if (node.connman) {
         obj.pushKV("networkactive", node.connman->GetNetworkActive());
@@ -6,6 +6,7 @@
 #include <config/bitcoin-config.h> // IWYU pragma: keep
 
 #include <chainparams.h>
+#include <dbwrapper.h>
 #include <httpserver.h>
 #include <index/blockfilterindex.h>
 #include <index/coinstatsindex.h>
@@ -16,16 +17,22 @@
 #include <interfaces/ipc.h>
 #include <kernel/cs_main.h>
 #include <logging.h>
+#include <node/blockstorage.h>
 #include <node/context.h>
+#include <node/database_args.h>
 #include <rpc/server.h>
 #include <rpc/server_util.h>
 #include <rpc/util.h>
 #include <scheduler.h>
+#include <txdb.h>
 #include <univalue.h>
 #include <util/any.h>
 #include <util/check.h>
+#include <util/string.h>
 #include <util/time.h>
+#include <validation.h>
 
+#include <algorithm>
 #include <stdint.h>
 #ifdef HAVE_MALLOC_INFO
 #include <malloc.h>
@@ -401,9 +408,140 @@ static RPCHelpMan getindexinfo()
     };
 }
 
+static UniValue LatencyToJSON(const std::array<uint64_t, LatencyHistogram::NUM_BUCKETS>& buckets, std::chrono::microseconds total)
+{
+    UniValue histogram(UniValue::VARR);
+    uint64_t count{0};
+    for (const uint64_t bucket : buckets) {
+        histogram.push_back(bucket);
+        count += bucket;
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("count", count);
+    ret.pushKV("total_us", Ticks<std::chrono::microseconds>(total));
+    ret.pushKV("histogram", std::move(histogram));
+    return ret;
+}
+
+static UniValue DBStatsToJSON(const DBStats& stats)
+{
+    UniValue levels(UniValue::VARR);
+    for (const DBLevelStats& level : stats.levels) {
+        UniValue level_json(UniValue::VOBJ);
+        level_json.pushKV("files", level.files);
+        level_json.pushKV("size_mib", level.size_mib);
+        level_json.pushKV("compaction_seconds", level.compaction_seconds);
+        level_json.pushKV("compaction_read_mib", level.compaction_read_mib);
+        level_json.pushKV("compaction_write_mib", level.compaction_write_mib);
+        levels.push_back(std::move(level_json));
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("approximate_size", stats.approximate_size);
+    ret.pushKV("memory_usage", stats.memory_usage);
+    ret.pushKV("levels", std::move(levels));
+    ret.pushKV("write_latency", LatencyToJSON(stats.write_latency, stats.write_time));
+    ret.pushKV("leveldb_stats", stats.leveldb_stats);
+    return ret;
+}
+
+static RPCHelpMan getdbstats()
+{
+    const std::string db_names{util::Join(node::DATABASE_NAMES, ", ", [](std::string_view name) { return std::string{name}; })};
+    return RPCHelpMan{"getdbstats",
+                "\nReturns leveldb statistics, and the latencies of batch writes since startup, of one or all databases of the node.\n",
+                {
+                    {"db_name", RPCArg::Type::STR, RPCArg::Optional::OMITTED, strprintf("Filter results for a database with a specific name, one of %s.", db_names)},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ_DYN, "", "", {
+                        {
+                            RPCResult::Type::OBJ, "name", strprintf("The name of the database, one of %s, as in the database options (e.g. -dbbloombits=<name>:<n>). The chainstate created from a UTXO snapshot is chainstate_snapshot, like its directory, and is also selected by chainstate.", db_names),
+                            {
+                                {RPCResult::Type::NUM, "approximate_size", "Approximate size of the data on disk, in bytes"},
+                                {RPCResult::Type::NUM, "memory_usage", "Approximate memory used by leveldb, in bytes"},
+                                {RPCResult::Type::ARR, "levels", "Table files and compactions of each level, from the leveldb.stats property",
+                                    {
+                                        {RPCResult::Type::OBJ, "", "",
+                                            {
+                                                {RPCResult::Type::NUM, "files", "Number of table files"},
+                                                {RPCResult::Type::NUM, "size_mib", "Size of the table files, in MiB"},
+                                                {RPCResult::Type::NUM, "compaction_seconds", "Time spent in compactions into the level since the database was opened, in seconds. Those of level 0 are the writes of the write buffer to table files"},
+                                                {RPCResult::Type::NUM, "compaction_read_mib", "Data read by these compactions, in MiB"},
+                                                {RPCResult::Type::NUM, "compaction_write_mib", "Data written by these compactions, in MiB"},
+                                            }},
+                                    }},
+                                {RPCResult::Type::OBJ, "write_latency", "Latencies of batch writes",
+                                    {
+                                        {RPCResult::Type::NUM, "count", "Number of batch writes"},
+                                        {RPCResult::Type::NUM, "total_us", "Total time spent in batch writes, in microseconds"},
+                                        {RPCResult::Type::ARR, "histogram", strprintf("Number of batch writes by latency. The first entry counts writes taking less than 1 microsecond, entry i > 0 those taking from 2^(i-1) up to 2^i microseconds, and the last one (%d) all slower writes", LatencyHistogram::NUM_BUCKETS - 1),
+                                            {{RPCResult::Type::NUM, "", "Number of batch writes"}}},
+                                    }},
+                                {RPCResult::Type::STR, "leveldb_stats", "The leveldb.stats property"},
+                            }
+                        },
+                    },
+                },
+                RPCExamples{
+                    HelpExampleCli("getdbstats", "")
+                  + HelpExampleRpc("getdbstats", "")
+                  + HelpExampleCli("getdbstats", "chainstate")
+                  + HelpExampleRpc("getdbstats", "chainstate")
+                },
+                [db_names](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    UniValue result(UniValue::VOBJ);
+    const std::string db_name = request.params[0].isNull() ? "" : request.params[0].get_str();
+    if (!db_name.empty() && std::find(node::DATABASE_NAMES.begin(), node::DATABASE_NAMES.end(), db_name) == node::DATABASE_NAMES.end()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Unknown database %s, expected one of %s", db_name, db_names));
+    }
+    const auto wanted{[&](std::string_view name) { return db_name.empty() || db_name == name; }};
+
+    // Reading the statistics takes leveldb's mutex, so only look up the
+    // databases while holding cs_main.
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    kernel::BlockTreeDB* block_tree_db;
+    std::vector<std::pair<std::string, CCoinsViewDB*>> coins_dbs;
+    {
+        LOCK(cs_main);
+        block_tree_db = chainman.m_blockman.m_block_tree_db.get();
+        for (Chainstate* chainstate : chainman.GetAll()) {
+            coins_dbs.emplace_back(chainstate->m_from_snapshot_blockhash ? "chainstate_snapshot" : "chainstate", &chainstate->CoinsDB());
+        }
+    }
+
+    if (wanted("blockindex")) {
+        result.pushKV("blockindex", DBStatsToJSON(block_tree_db->GetStats()));
+    }
+
+    if (wanted("chainstate")) {
+        for (const auto& [name, coins_db] : coins_dbs) {
+            result.pushKV(name, DBStatsToJSON(coins_db->GetDBStats()));
+        }
+    }
+
+    if (g_txindex && wanted(g_txindex->GetDBName())) {
+        result.pushKV(g_txindex->GetDBName(), DBStatsToJSON(g_txindex->GetDBStats()));
+    }
+
+    if (g_coin_stats_index && wanted(g_coin_stats_index->GetDBName())) {
+        result.pushKV(g_coin_stats_index->GetDBName(), DBStatsToJSON(g_coin_stats_index->GetDBStats()));
+    }
+
+    ForEachBlockFilterIndex([&](const BlockFilterIndex& index) {
+        if (wanted(index.GetDBName())) result.pushKV(index.GetDBName(), DBStatsToJSON(index.GetDBStats()));
+    });
+
+    return result;
+},
+    };
+}
+
 void RegisterNodeRPCCommands(CRPCTable& t)
 {
     static const CRPCCommand commands[]{
+        {"control", &getdbstats},
         {"control", &getmemoryinfo},
         {"control", &logging},
         {"util", &getindexinfo},
@@ -69,9 +69,9 @@ static RPCHelpMan gettxoutproof()
 
                 // Loop through txids and try to find which block they're in. Exit loop once a block is found.
                 for (const auto& tx : setTxids) {
-                    const Coin& coin{AccessByTxid(active_chainstate.CoinsTip(), tx)};
+                    const CompactCoin& coin{AccessByTxid(active_chainstate.CoinsTip(), tx)};
                     if (!coin.IsSpent()) {
-                        pblockindex = active_chainstate.m_chain[coin.nHeight];
+                        pblockindex = active_chainstate.m_chain[coin.GetHeight()];
                         break;
                     }
                 }
@@ -0,0 +1,85 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <asyncfilereader.h>
+#include <streams.h>
+#include <sync.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <util/fs.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(asyncfilereader_tests, BasicTestingSetup)
+
+static void CheckReader(std::unique_ptr<AsyncFileReader> reader, const fs::path& dir)
+{
+    const fs::path path{dir / "data.dat"};
+    const auto contents{g_insecure_rand_ctx.randbytes<uint8_t>(100'000)};
+    {
+        AutoFile file{fsbridge::fopen(path, "wb")};
+        file.write(MakeByteSpan(contents));
+    }
+
+    struct Result {
+        uint64_t offset;
+        size_t size;
+        std::optional<std::vector<uint8_t>> data;
+    };
+    Mutex mutex;
+    std::vector<Result> results;
+    AsyncFileReader& async_reader{*reader};
+    const auto read{[&](uint64_t offset, size_t size) {
+        async_reader.Read(path, offset, size, [&, offset, size](std::optional<std::vector<uint8_t>> data) {
+            LOCK(mutex);
+            results.push_back({offset, size, std::move(data)});
+        });
+    }};
+
+    for (int i{0}; i < 200; ++i) {
+        const uint64_t offset{InsecureRandRange(contents.size())};
+        read(offset, InsecureRandRange(contents.size() - offset + 1));
+    }
+    // Reads past the end of the file fail.
+    read(contents.size() - 10, 11);
+    read(contents.size() + 10, 1);
+    // Callbacks can queue further reads.
+    async_reader.Read(path, 0, 10, [&](std::optional<std::vector<uint8_t>>) { read(10, 10); });
+    // Reads of files that do not exist fail.
+    bool missing_failed{false};
+    async_reader.Read(dir / "missing.dat", 0, 1, [&](std::optional<std::vector<uint8_t>> data) { missing_failed = !data; });
+
+    // Destroying the reader waits for all reads.
+    reader.reset();
+    BOOST_CHECK(missing_failed);
+    BOOST_REQUIRE_EQUAL(results.size(), 203U);
+    for (const auto& result : results) {
+        if (result.offset + result.size > contents.size()) {
+            BOOST_CHECK(!result.data);
+        } else {
+            BOOST_REQUIRE(result.data);
+            BOOST_CHECK(std::equal(result.data->begin(), result.data->end(), contents.begin() + result.offset, contents.begin() + result.offset + result.size));
+            BOOST_CHECK_EQUAL(result.data->size(), result.size);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(thread_pool)
+{
+    CheckReader(MakeThreadPoolFileReader(1), m_args.GetDataDirBase());
+    CheckReader(MakeThreadPoolFileReader(4), m_args.GetDataDirBase());
+}
+
+BOOST_AUTO_TEST_CASE(io_uring)
+{
+    // io_uring is only available on Linux, and may be disabled.
+    if (auto reader{MakeIoUringFileReader(1)}) CheckReader(std::move(reader), m_args.GetDataDirBase());
+    if (auto reader{MakeIoUringFileReader(8)}) CheckReader(std::move(reader), m_args.GetDataDirBase());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,11 +4,14 @@
 
 #include <chainparams.h>
 #include <clientversion.h>
+#include <hash.h>
+#include <node/blockreadahead.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
 #include <node/kernel_notifications.h>
 #include <script/solver.h>
 #include <primitives/block.h>
+#include <undo.h>
 #include <util/chaintype.h>
 #include <validation.h>
 
@@ -197,4 +200,203 @@ BOOST_AUTO_TEST_CASE(blockmanager_flush_block_file)
     BOOST_CHECK_EQUAL(read_block.nVersion, 2);
 }
 
+BOOST_FIXTURE_TEST_CASE(blockmanager_mmap_reads, TestChain100Setup)
+{
+    auto& chainman{*Assert(m_node.chainman)};
+    KernelNotifications notifications{*Assert(m_node.shutdown), m_node.exit_status, *Assert(m_node.warnings)};
+    BlockManager mapped_blockman{*Assert(m_node.shutdown), {
+        .chainparams = Params(),
+        .blocks_dir = m_args.GetBlocksDirPath(),
+        .notifications = notifications,
+        .mmap_block_files = true,
+    }};
+
+    const auto check_reads{[&](const CBlockIndex& index) {
+        const FlatFilePos pos{WITH_LOCK(::cs_main, return index.GetBlockPos())};
+        CBlock block;
+        BOOST_REQUIRE(mapped_blockman.ReadBlockFromDisk(block, index));
+
+        std::vector<uint8_t> raw_block;
+        BOOST_REQUIRE(chainman.m_blockman.ReadRawBlockFromDisk(raw_block, pos));
+        std::vector<uint8_t> mapped_raw_block;
+        BOOST_REQUIRE(mapped_blockman.ReadRawBlockFromDisk(mapped_raw_block, pos));
+        BOOST_CHECK(mapped_raw_block == raw_block);
+        const auto mapped{mapped_blockman.ReadMappedRawBlockFromDisk(pos)};
+        BOOST_REQUIRE(mapped);
+        BOOST_CHECK(std::ranges::equal(UCharSpanCast(mapped->data), raw_block));
+
+        if (index.pprev) {
+            CBlockUndo undo;
+            BOOST_REQUIRE(chainman.m_blockman.UndoReadFromDisk(undo, index));
+            CBlockUndo mapped_undo;
+            BOOST_REQUIRE(mapped_blockman.UndoReadFromDisk(mapped_undo, index));
+            BOOST_CHECK((HashWriter{} << mapped_undo).GetHash() == (HashWriter{} << undo).GetHash());
+        }
+    }};
+
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return chainman.ActiveChain().Tip())};
+    for (const CBlockIndex* index{tip}; index; index = index->pprev) check_reads(*index);
+
+    // Blocks written after their file was mapped are read from a new mapping.
+    CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    check_reads(*WITH_LOCK(::cs_main, return chainman.ActiveChain().Tip()));
+
+    // Without a header in front of the position, the file is read instead.
+    BOOST_CHECK(!mapped_blockman.ReadMappedRawBlockFromDisk(FlatFilePos{0, 0}));
+}
+
+BOOST_FIXTURE_TEST_CASE(blockmanager_scan_block_file, TestChain100Setup)
+{
+    auto& chainman{*Assert(m_node.chainman)};
+    AutoFile file{chainman.m_blockman.OpenBlockFile(FlatFilePos{0, 0}, true)};
+    BOOST_REQUIRE(!file.IsNull());
+    const auto blocks{chainman.m_blockman.ScanBlockFile(file, /*file_num=*/0)};
+
+    // All blocks of the chain are found at their position in the block index.
+    LOCK(::cs_main);
+    BOOST_CHECK_EQUAL(blocks.size(), size_t(chainman.ActiveHeight() + 1));
+    for (const auto& scanned : blocks) {
+        const CBlockIndex* index{chainman.m_blockman.LookupBlockIndex(scanned.hash)};
+        BOOST_REQUIRE(index);
+        BOOST_CHECK(scanned.header.GetHash() == scanned.hash);
+        BOOST_CHECK_EQUAL(scanned.pos.nFile, index->GetBlockPos().nFile);
+        BOOST_CHECK_EQUAL(scanned.pos.nPos, index->GetBlockPos().nPos);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(blockmanager_compressed_undo_data, TestChain100Setup)
+{
+    auto& chainman{*Assert(m_node.chainman)};
+    KernelNotifications notifications{*Assert(m_node.shutdown), m_node.exit_status, *Assert(m_node.warnings)};
+    const fs::path blocks_dir{m_args.GetDataDirNet() / "compressed_blocks"};
+    fs::create_directories(blocks_dir);
+    BlockManager blockman{*Assert(m_node.shutdown), {
+        .chainparams = Params(),
+        .blocks_dir = blocks_dir,
+        .notifications = notifications,
+        .compress_undo_files = true,
+        .async_block_reads = 2,
+    }};
+
+    // Blocks are stored as they are, as they are written while validating them.
+    CBlockIndex* tip{WITH_LOCK(::cs_main, return chainman.ActiveChain().Tip())};
+    CBlock block;
+    BOOST_REQUIRE(chainman.m_blockman.ReadBlockFromDisk(block, *tip));
+    DataStream serialized{};
+    serialized << TX_WITH_WITNESS(block);
+
+    const FlatFilePos pos{blockman.SaveBlockToDisk(block, tip->nHeight)};
+    BOOST_REQUIRE(!pos.IsNull());
+    BOOST_CHECK_EQUAL(blockman.CalculateCurrentUsage(), serialized.size() + BLOCK_SERIALIZATION_HEADER_SIZE);
+    std::vector<uint8_t> raw_block;
+    BOOST_REQUIRE(blockman.ReadRawBlockFromDisk(raw_block, pos));
+    BOOST_CHECK(std::ranges::equal(MakeByteSpan(raw_block), serialized));
+
+    // Undo data spending outputs paying to the same script, which compresses
+    // well, is stored as a compressed frame, and checked against its checksum.
+    const CTxOut& txout{block.vtx[0]->vout[0]};
+    CBlockUndo undo;
+    for (int i{0}; i < 100; ++i) {
+        undo.vtxundo.emplace_back().vprevout.emplace_back(txout, /*nHeightIn=*/i, /*fCoinBaseIn=*/false);
+    }
+    const uint64_t block_usage{blockman.CalculateCurrentUsage()};
+    CBlockIndex index{block};
+    index.pprev = tip->pprev;
+    index.nHeight = tip->nHeight;
+    index.nFile = pos.nFile;
+    index.nDataPos = pos.nPos;
+    index.nStatus = BLOCK_HAVE_DATA;
+    BlockValidationState state;
+    BOOST_REQUIRE(WITH_LOCK(::cs_main, return blockman.WriteUndoDataForBlock(undo, state, index)));
+    BOOST_CHECK_LT(blockman.CalculateCurrentUsage() - block_usage, ::GetSerializeSize(undo) / 2);
+    CBlockUndo read_undo;
+    BOOST_REQUIRE(blockman.UndoReadFromDisk(read_undo, index));
+    BOOST_CHECK((HashWriter{} << read_undo).GetHash() == (HashWriter{} << undo).GetHash());
+    const auto raw_undo{blockman.ReadRawUndoAsync(index).get()};
+    BOOST_REQUIRE(raw_undo);
+    BOOST_REQUIRE(node::DeserializeUndo(*raw_undo, index, read_undo));
+    BOOST_CHECK((HashWriter{} << read_undo).GetHash() == (HashWriter{} << undo).GetHash());
+}
+
+BOOST_FIXTURE_TEST_CASE(blockmanager_async_reads, TestChain100Setup)
+{
+    auto& chainman{*Assert(m_node.chainman)};
+    KernelNotifications notifications{*Assert(m_node.shutdown), m_node.exit_status, *Assert(m_node.warnings)};
+    BlockManager async_blockman{*Assert(m_node.shutdown), {
+        .chainparams = Params(),
+        .blocks_dir = m_args.GetBlocksDirPath(),
+        .notifications = notifications,
+        .async_block_reads = 4,
+    }};
+    BOOST_CHECK(async_blockman.HasAsyncReads());
+    BOOST_CHECK(!chainman.m_blockman.HasAsyncReads());
+
+    std::vector<const CBlockIndex*> blocks;
+    for (const CBlockIndex* pindex{WITH_LOCK(::cs_main, return chainman.ActiveChain().Tip())}; pindex->pprev; pindex = pindex->pprev) {
+        blocks.push_back(pindex);
+    }
+
+    // Reads complete the same with and without -asyncblockreads.
+    for (const BlockManager* blockman : {&async_blockman, &chainman.m_blockman}) {
+        std::vector<BlockManager::AsyncRead> block_reads;
+        std::vector<BlockManager::AsyncRead> undo_reads;
+        for (const CBlockIndex* pindex : blocks) {
+            block_reads.push_back(blockman->ReadRawBlockAsync(WITH_LOCK(::cs_main, return pindex->GetBlockPos())));
+            undo_reads.push_back(blockman->ReadRawUndoAsync(*pindex));
+        }
+        for (size_t i{0}; i < blocks.size(); ++i) {
+            std::vector<uint8_t> raw_block;
+            BOOST_REQUIRE(chainman.m_blockman.ReadRawBlockFromDisk(raw_block, WITH_LOCK(::cs_main, return blocks[i]->GetBlockPos())));
+            BOOST_CHECK(block_reads[i].get() == raw_block);
+
+            CBlockUndo undo;
+            BOOST_REQUIRE(chainman.m_blockman.UndoReadFromDisk(undo, *blocks[i]));
+            const auto raw_undo{undo_reads[i].get()};
+            BOOST_REQUIRE(raw_undo);
+            CBlockUndo read_undo;
+            BOOST_REQUIRE(node::DeserializeUndo(*raw_undo, *blocks[i], read_undo));
+            BOOST_CHECK((HashWriter{} << read_undo).GetHash() == (HashWriter{} << undo).GetHash());
+        }
+
+        // Reads of data that is not there fail.
+        const FlatFilePos pos{WITH_LOCK(::cs_main, return blocks[0]->GetBlockPos())};
+        BOOST_CHECK(!blockman->ReadRawBlockAsync(FlatFilePos{pos.nFile, pos.nPos + 1}).get());
+        BOOST_CHECK(!blockman->ReadRawBlockAsync(FlatFilePos{pos.nFile + 1, pos.nPos}).get());
+        BOOST_CHECK(!blockman->ReadRawBlockAsync(FlatFilePos{}).get());
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(blockmanager_read_ahead, TestChain100Setup)
+{
+    auto& chainman{*Assert(m_node.chainman)};
+    std::vector<const CBlockIndex*> blocks;
+    for (const CBlockIndex* pindex{WITH_LOCK(::cs_main, return chainman.ActiveChain().Tip())}; pindex; pindex = pindex->pprev) {
+        blocks.push_back(pindex);
+    }
+
+    // Blocks are taken in the given order, whatever order they are read in.
+    for (const bool read_undo : {false, true}) {
+        node::BlockReadAhead read_ahead{chainman.m_blockman, blocks, read_undo, /*window=*/3};
+        for (const CBlockIndex* pindex : blocks) {
+            BOOST_REQUIRE(read_ahead.Peek() == pindex);
+            auto entry{read_ahead.Next()};
+            BOOST_CHECK(entry.index == pindex);
+            BOOST_REQUIRE(entry.block);
+            BOOST_CHECK(entry.block->GetHash() == pindex->GetBlockHash());
+            // The genesis block has no undo data.
+            BOOST_REQUIRE_EQUAL(entry.undo.has_value(), read_undo && pindex->pprev);
+            if (entry.undo) {
+                CBlockUndo undo;
+                BOOST_REQUIRE(chainman.m_blockman.UndoReadFromDisk(undo, *pindex));
+                BOOST_CHECK((HashWriter{} << *entry.undo).GetHash() == (HashWriter{} << undo).GetHash());
+            }
+        }
+        BOOST_CHECK(!read_ahead.Peek());
+    }
+
+    // Stopping early does not wait for blocks that were not taken.
+    node::BlockReadAhead read_ahead{chainman.m_blockman, blocks, /*read_undo=*/true, /*window=*/8};
+    BOOST_CHECK(read_ahead.Next().block);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,69 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockservecache.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <vector>
+
+using Format = BlockServeCache::Format;
+
+BOOST_FIXTURE_TEST_SUITE(blockservecache_tests, BasicTestingSetup)
+
+static BlockServeCache::Data MakeData(size_t size)
+{
+    return std::make_shared<const std::vector<unsigned char>>(size, 0xab);
+}
+
+BOOST_AUTO_TEST_CASE(formats_are_separate)
+{
+    BlockServeCache cache{1 << 20};
+    const uint256 hash{InsecureRand256()};
+    const auto witness{MakeData(1000)};
+    cache.Put(hash, Format::WITNESS, witness);
+
+    BOOST_CHECK(cache.Get(hash, Format::WITNESS) == witness);
+    BOOST_CHECK(!cache.Get(hash, Format::NO_WITNESS));
+    BOOST_CHECK(!cache.Get(hash, Format::COMPACT));
+    BOOST_CHECK(!cache.Get(InsecureRand256(), Format::WITNESS));
+
+    const auto stats{cache.GetStats()};
+    BOOST_CHECK_EQUAL(stats.hits, 1U);
+    BOOST_CHECK_EQUAL(stats.misses, 3U);
+    BOOST_CHECK_EQUAL(stats.entries, 1U);
+    BOOST_CHECK_GT(stats.memory_usage, 1000U);
+    BOOST_CHECK_EQUAL(stats.max_memory_usage, 1U << 20);
+}
+
+BOOST_AUTO_TEST_CASE(evicts_least_recently_used)
+{
+    // Room for three entries of 100 kB, but not four.
+    BlockServeCache cache{350'000};
+    std::vector<uint256> hashes;
+    for (int i{0}; i < 3; ++i) {
+        hashes.push_back(InsecureRand256());
+        cache.Put(hashes.back(), Format::WITNESS, MakeData(100'000));
+    }
+    BOOST_CHECK_EQUAL(cache.GetStats().entries, 3U);
+
+    // Using the oldest entry makes the second one the least recently used.
+    BOOST_CHECK(cache.Get(hashes[0], Format::WITNESS));
+    cache.Put(InsecureRand256(), Format::WITNESS, MakeData(100'000));
+    BOOST_CHECK_EQUAL(cache.GetStats().entries, 3U);
+    BOOST_CHECK(cache.Get(hashes[0], Format::WITNESS));
+    BOOST_CHECK(!cache.Get(hashes[1], Format::WITNESS));
+    BOOST_CHECK(cache.Get(hashes[2], Format::WITNESS));
+    BOOST_CHECK_LE(cache.GetStats().memory_usage, 350'000U);
+
+    // Entries larger than the cache are not added.
+    cache.Put(InsecureRand256(), Format::WITNESS, MakeData(400'000));
+    BOOST_CHECK_EQUAL(cache.GetStats().entries, 3U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,126 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <addresstype.h>
+#include <chain.h>
+#include <kernel/cs_main.h>
+#include <node/block_template_cache.h>
+#include <node/miner.h>
+#include <policy/policy.h>
+#include <primitives/transaction.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace std::chrono_literals;
+using node::BlockTemplateCache;
+
+namespace {
+struct BlockTemplateCacheSetup : public TestChain100Setup {
+    BlockTemplateCache cache{*m_node.chainman, *m_node.mempool, {}};
+    const CScript spk{GetScriptForDestination(WitnessV0KeyHash(coinbaseKey.GetPubKey()))};
+
+    BlockTemplateCacheSetup()
+    {
+        // Make the second coinbase transaction spendable in the mempool.
+        CreateAndProcessBlock({}, spk);
+        // Frozen time keeps the template from being replaced in the background.
+        SetMockTime(GetTime<std::chrono::seconds>());
+        m_node.validation_signals->RegisterValidationInterface(&cache);
+    }
+    ~BlockTemplateCacheSetup()
+    {
+        m_node.validation_signals->UnregisterValidationInterface(&cache);
+        SetMockTime(0);
+    }
+
+    BlockTemplateCache::Result Get()
+    {
+        m_node.validation_signals->SyncWithValidationInterfaceQueue();
+        LOCK(::cs_main);
+        return cache.Get();
+    }
+
+    CTransactionRef Spend(const CTransactionRef& tx, int height)
+    {
+        return MakeTransactionRef(CreateValidMempoolTransaction(tx, 0, height, coinbaseKey, spk, tx->vout[0].nValue - 1000));
+    }
+};
+
+std::vector<Txid> Txids(const CBlock& block)
+{
+    std::vector<Txid> txids;
+    for (size_t i{1}; i < block.vtx.size(); ++i) txids.push_back(block.vtx[i]->GetHash());
+    return txids;
+}
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(blocktemplatecache_tests, BlockTemplateCacheSetup)
+
+BOOST_AUTO_TEST_CASE(updates_for_mempool_changes)
+{
+    const auto empty{Get()};
+    BOOST_REQUIRE(empty.block_template);
+    BOOST_CHECK_EQUAL(empty.block_template->block.vtx.size(), 1U);
+    // The same template is served while nothing changed.
+    BOOST_CHECK(Get().block_template == empty.block_template);
+
+    const CTransactionRef parent{Spend(m_coinbase_txns[0], 1)};
+    const CTransactionRef child{Spend(parent, 102)};
+    const CTransactionRef other{Spend(m_coinbase_txns[1], 2)};
+    const auto added{Get()};
+    BOOST_CHECK(added.block_template != empty.block_template);
+    // Transactions were appended, in the order they were added, without
+    // selecting them again.
+    BOOST_CHECK_EQUAL(added.transactions_updated, empty.transactions_updated);
+    BOOST_CHECK(Txids(added.block_template->block) == (std::vector<Txid>{parent->GetHash(), child->GetHash(), other->GetHash()}));
+    BOOST_CHECK_EQUAL(added.block_template->vTxFees.size(), 4U);
+    BOOST_CHECK_EQUAL(added.block_template->vTxFees[0], -3000);
+
+    // Removing a transaction also drops its descendants.
+    WITH_LOCK(m_node.mempool->cs, m_node.mempool->removeRecursive(*parent, MemPoolRemovalReason::REPLACED));
+    const auto removed{Get()};
+    BOOST_CHECK(Txids(removed.block_template->block) == std::vector<Txid>{other->GetHash()});
+
+    // Once the template is too old, its transactions are selected again.
+    SetMockTime(GetTime<std::chrono::seconds>() + BlockTemplateCache::MAX_AGE + 1s);
+    const auto rebuilt{Get()};
+    BOOST_CHECK_EQUAL(rebuilt.transactions_updated, m_node.mempool->GetTransactionsUpdated());
+    BOOST_CHECK(Txids(rebuilt.block_template->block) == std::vector<Txid>{other->GetHash()});
+}
+
+BOOST_AUTO_TEST_CASE(selects_again_for_new_block)
+{
+    const CTransactionRef mined{Spend(m_coinbase_txns[0], 1)};
+    const CTransactionRef unmined{Spend(m_coinbase_txns[1], 2)};
+    const auto before{Get()};
+    BOOST_CHECK_EQUAL(before.block_template->block.vtx.size(), 3U);
+
+    CreateAndProcessBlock({CMutableTransaction{*mined}}, spk);
+    // Added after the block, so not appended: the transactions are selected
+    // again right away.
+    const CTransactionRef added{Spend(m_coinbase_txns[2], 3)};
+    const auto after{Get()};
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return m_node.chainman->ActiveTip())};
+    BOOST_CHECK_EQUAL(after.block_template->block.hashPrevBlock, tip->GetBlockHash());
+    BOOST_CHECK_EQUAL(after.transactions_updated, m_node.mempool->GetTransactionsUpdated());
+    BOOST_CHECK(after.transactions_updated != before.transactions_updated);
+    const std::vector<Txid> txids{Txids(after.block_template->block)};
+    BOOST_CHECK_EQUAL(txids.size(), 2U);
+    BOOST_CHECK(std::find(txids.begin(), txids.end(), unmined->GetHash()) != txids.end());
+    BOOST_CHECK(std::find(txids.begin(), txids.end(), added->GetHash()) != txids.end());
+    // The coinbase is for the next height.
+    BOOST_CHECK(after.block_template->block.vtx[0]->vin[0].scriptSig == (CScript() << (tip->nHeight + 1) << OP_0));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
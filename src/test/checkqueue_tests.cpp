@@ -156,9 +156,9 @@ typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
 /** This test case checks that the CCheckQueue works properly
  * with each specified size_t Checks pushed.
  */
-static void Correct_Queue_range(std::vector<size_t> range)
+static void Correct_Queue_range(std::vector<size_t> range, bool work_stealing = false)
 {
-    auto small_queue = std::make_unique<Correct_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS);
+    auto small_queue = std::make_unique<Correct_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS, work_stealing);
     // Make vChecks here to save on malloc (this test can be slow...)
     std::vector<FakeCheckCheckCompletion> vChecks;
     vChecks.reserve(9);
@@ -211,12 +211,21 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_Random)
         range.push_back(i);
     Correct_Queue_range(range);
 }
+/** Test that the work stealing scheduler runs every check exactly as often
+ */
+BOOST_AUTO_TEST_CASE(test_CheckQueue_WorkStealing_Correct)
+{
+    std::vector<size_t> range{0, 1, 100000};
+    for (size_t i = 2; i < 100000; i += std::max((size_t)1, (size_t)InsecureRandRange(std::min((size_t)1000, ((size_t)100000) - i))))
+        range.push_back(i);
+    Correct_Queue_range(range, /*work_stealing=*/true);
+}
 
 
 /** Test that failing checks are caught */
-BOOST_AUTO_TEST_CASE(test_CheckQueue_Catches_Failure)
+static void CheckQueue_Catches_Failure(bool work_stealing)
 {
-    auto fail_queue = std::make_unique<Failing_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS);
+    auto fail_queue = std::make_unique<Failing_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS, work_stealing);
     for (size_t i = 0; i < 1001; ++i) {
         CCheckQueueControl<FailingCheck> control(fail_queue.get());
         size_t remaining = i;
@@ -237,11 +246,14 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Catches_Failure)
         }
     }
 }
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Catches_Failure) { CheckQueue_Catches_Failure(/*work_stealing=*/false); }
+BOOST_AUTO_TEST_CASE(test_CheckQueue_WorkStealing_Catches_Failure) { CheckQueue_Catches_Failure(/*work_stealing=*/true); }
+
 // Test that a block validation which fails does not interfere with
 // future blocks, ie, the bad state is cleared.
-BOOST_AUTO_TEST_CASE(test_CheckQueue_Recovers_From_Failure)
+static void CheckQueue_Recovers_From_Failure(bool work_stealing)
 {
-    auto fail_queue = std::make_unique<Failing_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS);
+    auto fail_queue = std::make_unique<Failing_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS, work_stealing);
     for (auto times = 0; times < 10; ++times) {
         for (const bool end_fails : {true, false}) {
             CCheckQueueControl<FailingCheck> control(fail_queue.get());
@@ -256,13 +268,16 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Recovers_From_Failure)
         }
     }
 }
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Recovers_From_Failure) { CheckQueue_Recovers_From_Failure(/*work_stealing=*/false); }
+BOOST_AUTO_TEST_CASE(test_CheckQueue_WorkStealing_Recovers_From_Failure) { CheckQueue_Recovers_From_Failure(/*work_stealing=*/true); }
 
 // Test that unique checks are actually all called individually, rather than
 // just one check being called repeatedly. Test that checks are not called
 // more than once as well
-BOOST_AUTO_TEST_CASE(test_CheckQueue_UniqueCheck)
+static void CheckQueue_UniqueCheck(bool work_stealing)
 {
-    auto queue = std::make_unique<Unique_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS);
+    WITH_LOCK(UniqueCheck::m, UniqueCheck::results.clear());
+    auto queue = std::make_unique<Unique_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS, work_stealing);
     size_t COUNT = 100000;
     size_t total = COUNT;
     {
@@ -285,6 +300,8 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_UniqueCheck)
         BOOST_REQUIRE(r);
     }
 }
+BOOST_AUTO_TEST_CASE(test_CheckQueue_UniqueCheck) { CheckQueue_UniqueCheck(/*work_stealing=*/false); }
+BOOST_AUTO_TEST_CASE(test_CheckQueue_WorkStealing_UniqueCheck) { CheckQueue_UniqueCheck(/*work_stealing=*/true); }
 
 
 // Test that blocks which might allocate lots of memory free their memory aggressively.
@@ -292,9 +309,9 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_UniqueCheck)
 // This test attempts to catch a pathological case where by lazily freeing
 // checks might mean leaving a check un-swapped out, and decreasing by 1 each
 // time could leave the data hanging across a sequence of blocks.
-BOOST_AUTO_TEST_CASE(test_CheckQueue_Memory)
+static void CheckQueue_Memory(bool work_stealing)
 {
-    auto queue = std::make_unique<Memory_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS);
+    auto queue = std::make_unique<Memory_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS, work_stealing);
     for (size_t i = 0; i < 1000; ++i) {
         size_t total = i;
         {
@@ -314,12 +331,14 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Memory)
         BOOST_REQUIRE_EQUAL(MemoryCheck::fake_allocated_memory, 0U);
     }
 }
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Memory) { CheckQueue_Memory(/*work_stealing=*/false); }
+BOOST_AUTO_TEST_CASE(test_CheckQueue_WorkStealing_Memory) { CheckQueue_Memory(/*work_stealing=*/true); }
 
 // Test that a new verification cannot occur until all checks
 // have been destructed
-BOOST_AUTO_TEST_CASE(test_CheckQueue_FrozenCleanup)
+static void CheckQueue_FrozenCleanup(bool work_stealing)
 {
-    auto queue = std::make_unique<FrozenCleanup_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS);
+    auto queue = std::make_unique<FrozenCleanup_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS, work_stealing);
     bool fails = false;
     std::thread t0([&]() {
         CCheckQueueControl<FrozenCleanupCheck> control(queue.get());
@@ -348,6 +367,8 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_FrozenCleanup)
     t0.join();
     BOOST_REQUIRE(!fails);
 }
+BOOST_AUTO_TEST_CASE(test_CheckQueue_FrozenCleanup) { CheckQueue_FrozenCleanup(/*work_stealing=*/false); }
+BOOST_AUTO_TEST_CASE(test_CheckQueue_WorkStealing_FrozenCleanup) { CheckQueue_FrozenCleanup(/*work_stealing=*/true); }
 
 
 /** Test that CCheckQueueControl is threadsafe */
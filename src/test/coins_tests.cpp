@@ -55,12 +55,12 @@ public:
 
     uint256 GetBestBlock() const override { return hashBestBlock_; }
 
-    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock, bool erase = true) override
+    bool BatchWrite(CoinsViewCacheCursor& cursor, const uint256& hashBlock) override
     {
-        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); it = erase ? mapCoins.erase(it) : std::next(it)) {
-            if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+        for (auto it{cursor.Begin()}; it != cursor.End(); it = cursor.NextAndMaybeErase(*it)) {
+            if (it->second.IsDirty()) {
                 // Same optimization used in CCoinsViewDB is to only write dirty entries.
-                map_[it->first] = it->second.coin;
+                map_[it->first] = it->second.coin.ToCoin();
                 if (it->second.coin.IsSpent() && InsecureRandRange(3) == 0) {
                     // Randomly delete empty entries on write.
                     map_.erase(it->first);
@@ -92,6 +92,7 @@ public:
     }
 
     CCoinsMap& map() const { return cacheCoins; }
+    CoinsCachePair& sentinel() const { return m_sentinel; }
     size_t& usage() const { return cachedCoinsUsage; }
 };
 
@@ -159,8 +160,8 @@ void SimulationTest(CCoinsView* base, bool fake_best_block)
 
             // Infrequently, test usage of AccessByTxid instead of AccessCoin - the
             // former just delegates to the latter and returns the first unspent in a txn.
-            const Coin& entry = (InsecureRandRange(500) == 0) ?
-                AccessByTxid(*stack.back(), txid) : stack.back()->AccessCoin(COutPoint(txid, 0));
+            const Coin entry{((InsecureRandRange(500) == 0) ?
+                AccessByTxid(*stack.back(), txid) : stack.back()->AccessCoin(COutPoint(txid, 0))).ToCoin()};
             BOOST_CHECK(coin == entry);
 
             if (test_havecoin_before) {
@@ -210,7 +211,7 @@ void SimulationTest(CCoinsView* base, bool fake_best_block)
         if (InsecureRandRange(1000) == 1 || i == NUM_SIMULATION_ITERATIONS - 1) {
             for (const auto& entry : result) {
                 bool have = stack.back()->HaveCoin(entry.first);
-                const Coin& coin = stack.back()->AccessCoin(entry.first);
+                const Coin coin{stack.back()->AccessCoin(entry.first).ToCoin()};
                 BOOST_CHECK(have == !coin.IsSpent());
                 BOOST_CHECK(coin == entry.second);
                 if (coin.IsSpent()) {
@@ -454,7 +455,7 @@ BOOST_AUTO_TEST_CASE(updatecoins_simulation_test)
         if (InsecureRandRange(1000) == 1 || i == NUM_SIMULATION_ITERATIONS - 1) {
             for (const auto& entry : result) {
                 bool have = stack.back()->HaveCoin(entry.first);
-                const Coin& coin = stack.back()->AccessCoin(entry.first);
+                const Coin coin{stack.back()->AccessCoin(entry.first).ToCoin()};
                 BOOST_CHECK(have == !coin.IsSpent());
                 BOOST_CHECK(coin == entry.second);
             }
@@ -552,6 +553,67 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     }
 }
 
+BOOST_AUTO_TEST_CASE(compact_coin)
+{
+    const auto random_bytes{[](size_t size) {
+        std::vector<unsigned char> bytes(size);
+        for (auto& byte : bytes) byte = InsecureRandBits(8);
+        return bytes;
+    }};
+    // Scripts of random bytes, which do not match any template.
+    const auto random_script{[&](size_t size) {
+        auto bytes{random_bytes(size)};
+        bytes[0] = OP_INVALIDOPCODE;
+        return CScript(bytes.begin(), bytes.end());
+    }};
+    std::vector<unsigned char> compressed_key{random_bytes(33)};
+    compressed_key[0] = 0x02;
+    std::vector<unsigned char> uncompressed_key{random_bytes(65)};
+    uncompressed_key[0] = 0x04;
+
+    // Scripts that are stored inline, and scripts that are not.
+    const std::vector<std::pair<CScript, bool>> scripts{
+        {CScript{}, true},
+        {GetScriptForDestination(PKHash(uint160(random_bytes(20)))), true},
+        {GetScriptForDestination(ScriptHash(uint160(random_bytes(20)))), true},
+        {CScript() << compressed_key << OP_CHECKSIG, true},
+        {CScript() << uncompressed_key << OP_CHECKSIG, false},
+        {GetScriptForDestination(WitnessV0KeyHash(uint160(random_bytes(20)))), true},
+        {GetScriptForDestination(WitnessV0ScriptHash(uint256(random_bytes(32)))), true},
+        {GetScriptForDestination(WitnessV1Taproot(XOnlyPubKey(random_bytes(32)))), true},
+        {CScript() << OP_2 << random_bytes(32), false},
+        {random_script(33), true},
+        {random_script(34), false},
+        {random_script(1000), false},
+    };
+    for (const auto& [script, is_inline] : scripts) {
+        const Coin coin{CTxOut{InsecureRandMoneyAmount(), script}, int(InsecureRandBits(31)), InsecureRandBool()};
+        CompactCoin compact{coin};
+        BOOST_CHECK(!compact.IsSpent());
+        BOOST_CHECK_EQUAL(compact.GetValue(), coin.out.nValue);
+        BOOST_CHECK_EQUAL(compact.GetHeight(), coin.nHeight);
+        BOOST_CHECK_EQUAL(compact.IsCoinBase(), coin.IsCoinBase());
+        BOOST_CHECK_EQUAL(compact.DynamicMemoryUsage() == 0, is_inline);
+
+        // Copies and moves keep the coin.
+        const CompactCoin copy{compact};
+        const CompactCoin moved{std::move(compact)};
+        for (const auto* c : {&copy, &moved}) {
+            const Coin decompressed{c->ToCoin()};
+            BOOST_CHECK(decompressed.out == coin.out);
+            BOOST_CHECK_EQUAL(decompressed.nHeight, coin.nHeight);
+            BOOST_CHECK_EQUAL(decompressed.IsCoinBase(), coin.IsCoinBase());
+        }
+
+        compact = copy;
+        BOOST_CHECK(compact.ToCoin().out == coin.out);
+        compact.Clear();
+        BOOST_CHECK(compact.IsSpent());
+        BOOST_CHECK(compact.ToCoin().IsSpent());
+        BOOST_CHECK_EQUAL(compact.DynamicMemoryUsage(), 0U);
+    }
+}
+
 const static COutPoint OUTPOINT;
 const static CAmount SPENT = -1;
 const static CAmount ABSENT = -2;
@@ -579,18 +641,20 @@ static void SetCoinsValue(CAmount value, Coin& coin)
     }
 }
 
-static size_t InsertCoinsMapEntry(CCoinsMap& map, CAmount value, char flags)
+static size_t InsertCoinsMapEntry(CCoinsMap& map, CoinsCachePair& sentinel, CAmount value, char flags)
 {
     if (value == ABSENT) {
         assert(flags == NO_ENTRY);
         return 0;
     }
     assert(flags != NO_ENTRY);
-    CCoinsCacheEntry entry;
-    entry.flags = flags;
-    SetCoinsValue(value, entry.coin);
+    Coin coin;
+    SetCoinsValue(value, coin);
+    CCoinsCacheEntry entry{coin};
     auto inserted = map.emplace(OUTPOINT, std::move(entry));
     assert(inserted.second);
+    if (flags & DIRTY) CCoinsCacheEntry::SetDirty(*inserted.first, sentinel);
+    if (flags & FRESH) CCoinsCacheEntry::SetFresh(*inserted.first, sentinel);
     return inserted.first->second.coin.DynamicMemoryUsage();
 }
 
@@ -604,19 +668,22 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags, const C
         if (it->second.coin.IsSpent()) {
             value = SPENT;
         } else {
-            value = it->second.coin.out.nValue;
+            value = it->second.coin.GetValue();
         }
-        flags = it->second.flags;
+        flags = it->second.GetFlags();
         assert(flags != NO_ENTRY);
     }
 }
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
+    CoinsCachePair sentinel{};
+    sentinel.second.SelfRef(sentinel);
     CCoinsMapMemoryResource resource;
     CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
-    InsertCoinsMapEntry(map, value, flags);
-    BOOST_CHECK(view.BatchWrite(map, {}));
+    auto usage{InsertCoinsMapEntry(map, sentinel, value, flags)};
+    auto cursor{CoinsViewCacheCursor(usage, sentinel, map, /*will_erase=*/true)};
+    BOOST_CHECK(view.BatchWrite(cursor, {}));
 }
 
 class SingleEntryCacheTest
@@ -625,7 +692,7 @@ public:
     SingleEntryCacheTest(CAmount base_value, CAmount cache_value, char cache_flags)
     {
         WriteCoinsViewEntry(base, base_value, base_value == ABSENT ? NO_ENTRY : DIRTY);
-        cache.usage() += InsertCoinsMapEntry(cache.map(), cache_value, cache_flags);
+        cache.usage() += InsertCoinsMapEntry(cache.map(), cache.sentinel(), cache_value, cache_flags);
     }
 
     CCoinsView root;
@@ -1084,6 +1151,97 @@ BOOST_AUTO_TEST_CASE(ccoins_flush_behavior)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_sync_keeps_clean_entries)
+{
+    CCoinsView root;
+    CCoinsViewCacheTest base{&root};
+    CCoinsViewCacheTest cache{&base};
+
+    std::vector<COutPoint> outpoints;
+    for (int i{0}; i < 100; ++i) {
+        outpoints.emplace_back(Txid::FromUint256(InsecureRand256()), 0);
+        cache.AddCoin(outpoints.back(), MakeCoin(), /*possible_overwrite=*/false);
+    }
+    BOOST_CHECK(cache.Sync());
+    cache.SanityCheck();
+    BOOST_CHECK_EQUAL(base.GetCacheSize(), outpoints.size());
+
+    // Only entries modified since the last Sync() are written to the parent.
+    BOOST_CHECK(cache.SpendCoin(outpoints[0]));
+    BOOST_CHECK(base.SpendCoin(outpoints[1]));
+    BOOST_CHECK(cache.Sync());
+    cache.SanityCheck();
+    BOOST_CHECK(!base.HaveCoinInCache(outpoints[0]));
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), outpoints.size() - 1);
+    // outpoints[1] is still cached (clean) in the child, so it was not written back.
+    BOOST_CHECK(cache.HaveCoinInCache(outpoints[1]));
+    BOOST_CHECK(!base.HaveCoinInCache(outpoints[1]));
+
+    // Evicting only drops clean entries, and stops at the target usage.
+    const COutPoint dirty{Txid::FromUint256(InsecureRand256()), 0};
+    cache.AddCoin(dirty, MakeCoin(), /*possible_overwrite=*/false);
+    const size_t live_usage{cache.LiveMemoryUsage()};
+    BOOST_CHECK_LE(live_usage, cache.DynamicMemoryUsage());
+    BOOST_CHECK_EQUAL(cache.EvictClean(live_usage), 0U);
+    BOOST_CHECK_GT(cache.EvictClean(live_usage - 1), 0U);
+    BOOST_CHECK(cache.LiveMemoryUsage() <= live_usage - 1);
+    BOOST_CHECK_EQUAL(cache.EvictClean(/*target_usage=*/0), outpoints.size() - 2);
+    cache.SanityCheck();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1U);
+    BOOST_CHECK(cache.HaveCoinInCache(dirty));
+
+    // The memory of evicted entries is reused for new ones.
+    BOOST_CHECK_LT(cache.LiveMemoryUsage(), cache.DynamicMemoryUsage());
+    const size_t map_usage{memusage::DynamicUsage(cache.map())};
+    for (int i{0}; i < 50; ++i) {
+        cache.AddCoin(COutPoint{Txid::FromUint256(InsecureRand256()), 0}, MakeCoin(), /*possible_overwrite=*/false);
+    }
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(cache.map()), map_usage);
+    cache.SanityCheck();
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_evict_clean_releases_memory)
+{
+    CCoinsView root;
+    CCoinsViewCacheTest base{&root};
+    CCoinsViewCacheTest cache{&base};
+
+    // Enough coins to span many chunks of the pool.
+    std::vector<COutPoint> outpoints;
+    for (int i{0}; i < 20000; ++i) {
+        outpoints.emplace_back(Txid::FromUint256(InsecureRand256()), 0);
+        cache.AddCoin(outpoints.back(), MakeCoin(), /*possible_overwrite=*/false);
+    }
+    BOOST_CHECK(cache.Sync());
+    const size_t full_usage{cache.DynamicMemoryUsage()};
+
+    // Evicting a few entries keeps their memory for reuse.
+    BOOST_CHECK_GT(cache.EvictClean(full_usage * 9 / 10), 0U);
+    cache.SanityCheck();
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), full_usage);
+    BOOST_CHECK_LT(cache.LiveMemoryUsage(), full_usage);
+
+    // Evicting most of them without compacting keeps their memory too.
+    BOOST_CHECK_GT(cache.EvictClean(full_usage / 3, /*compact=*/false), 0U);
+    cache.SanityCheck();
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), full_usage);
+
+    // A later call returns their memory, even if it evicts nothing, and keeps
+    // the rest cached.
+    BOOST_CHECK_EQUAL(cache.EvictClean(full_usage), 0U);
+    cache.SanityCheck();
+    BOOST_CHECK_EQUAL(cache.LiveMemoryUsage(), cache.DynamicMemoryUsage());
+    BOOST_CHECK_LE(cache.DynamicMemoryUsage(), full_usage / 2);
+    BOOST_CHECK_GT(cache.GetCacheSize(), 0U);
+    size_t cached{0};
+    for (const COutPoint& outpoint : outpoints) {
+        if (!cache.HaveCoinInCache(outpoint)) continue;
+        BOOST_CHECK(!cache.AccessCoin(outpoint).IsSpent());
+        ++cached;
+    }
+    BOOST_CHECK_EQUAL(cached, cache.GetCacheSize());
+}
+
 BOOST_AUTO_TEST_CASE(coins_resource_is_used)
 {
     CCoinsMapMemoryResource resource;
@@ -0,0 +1,112 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <coinsflusher.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <uint256.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <future>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(coinsflusher_tests, BasicTestingSetup)
+
+/** View that holds up BatchWrite() until it is released, to observe a write in progress. */
+class BlockingCoinsView : public CCoinsViewBacked
+{
+public:
+    std::promise<void> m_release;
+    std::shared_future<void> m_released{m_release.get_future().share()};
+
+    explicit BlockingCoinsView(CCoinsView* view) : CCoinsViewBacked(view) {}
+
+    bool BatchWrite(CoinsViewCacheCursor& cursor, const uint256& hashBlock) override
+    {
+        m_released.wait();
+        return base->BatchWrite(cursor, hashBlock);
+    }
+};
+
+static std::vector<COutPoint> AddRandomCoins(CCoinsViewCache& cache, size_t num_coins)
+{
+    std::vector<COutPoint> outpoints;
+    for (size_t i{0}; i < num_coins; ++i) {
+        COutPoint outpoint{Txid::FromUint256(InsecureRand256()), uint32_t(InsecureRandRange(4))};
+        CTxOut txout{int64_t(InsecureRandRange(1000)) + 1, CScript() << OP_TRUE};
+        cache.AddCoin(outpoint, Coin{std::move(txout), /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+        outpoints.push_back(outpoint);
+    }
+    return outpoints;
+}
+
+BOOST_AUTO_TEST_CASE(background_write)
+{
+    CCoinsViewDB db{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {}};
+    BlockingCoinsView blocking{&db};
+    CCoinsViewFlusher flusher{&blocking};
+    CCoinsViewCache cache{&flusher};
+
+    const auto added{AddRandomCoins(cache, 100)};
+    const uint256 best_block{InsecureRand256()};
+    cache.SetBestBlock(best_block);
+    BOOST_REQUIRE(flusher.SyncInBackground(cache));
+
+    // The cache is clean and keeps its coins, while the write is held up.
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), added.size());
+    BOOST_CHECK(flusher.IsWriting());
+    BOOST_CHECK(db.GetBestBlock().IsNull());
+    BOOST_CHECK(!db.HaveCoin(added[0]));
+
+    // Coins evicted from the cache are served by the snapshot.
+    for (const auto& outpoint : added) cache.Uncache(outpoint);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    for (const auto& outpoint : added) BOOST_CHECK(cache.HaveCoin(outpoint));
+    BOOST_CHECK(flusher.GetBestBlock() == best_block);
+    BOOST_CHECK(flusher.DynamicMemoryUsage() > 0);
+
+    blocking.m_release.set_value();
+    BOOST_CHECK(flusher.Wait());
+    BOOST_CHECK(!flusher.IsWriting());
+    BOOST_CHECK_EQUAL(flusher.DynamicMemoryUsage(), 0U);
+    BOOST_CHECK(db.GetBestBlock() == best_block);
+    for (const auto& outpoint : added) BOOST_CHECK(db.HaveCoin(outpoint));
+}
+
+BOOST_AUTO_TEST_CASE(consecutive_writes)
+{
+    CCoinsViewDB db{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {}};
+    CCoinsViewFlusher flusher{&db};
+    CCoinsViewCache cache{&flusher};
+
+    const auto first{AddRandomCoins(cache, 50)};
+    cache.SetBestBlock(InsecureRand256());
+    BOOST_REQUIRE(flusher.SyncInBackground(cache));
+
+    // Spending coins of the first write and writing again waits for the first
+    // write, so the spends are applied after it.
+    for (size_t i{0}; i < first.size(); i += 2) BOOST_CHECK(cache.SpendCoin(first[i]));
+    const auto second{AddRandomCoins(cache, 50)};
+    const uint256 best_block{InsecureRand256()};
+    cache.SetBestBlock(best_block);
+    BOOST_REQUIRE(flusher.SyncInBackground(cache));
+    BOOST_CHECK(flusher.Wait());
+
+    BOOST_CHECK(db.GetBestBlock() == best_block);
+    for (size_t i{0}; i < first.size(); ++i) BOOST_CHECK_EQUAL(db.HaveCoin(first[i]), i % 2 == 1);
+    for (const auto& outpoint : second) BOOST_CHECK(db.HaveCoin(outpoint));
+
+    // A synchronous flush goes straight to the database.
+    cache.SpendCoin(second[0]);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!flusher.IsWriting());
+    BOOST_CHECK(!db.HaveCoin(second[0]));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
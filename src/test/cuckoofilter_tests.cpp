@@ -0,0 +1,125 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <cuckoofilter.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(cuckoofilter_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(no_false_negatives)
+{
+    constexpr size_t CAPACITY{10'000};
+    CuckooFilter filter{CAPACITY};
+    BOOST_CHECK_GE(filter.Capacity(), CAPACITY);
+
+    std::vector<uint64_t> inserted;
+    for (size_t i{0}; i < CAPACITY; ++i) {
+        inserted.push_back(InsecureRandBits(64));
+        BOOST_REQUIRE(filter.Insert(inserted.back()));
+    }
+    BOOST_CHECK_EQUAL(filter.Size(), CAPACITY);
+    for (const uint64_t hash : inserted) BOOST_CHECK(filter.MayContain(hash));
+
+    // With 16-bit fingerprints and two buckets of four slots, at most about
+    // 8 in 65536 lookups of elements that were not inserted are positive.
+    size_t false_positives{0};
+    for (size_t i{0}; i < 100'000; ++i) false_positives += filter.MayContain(InsecureRandBits(64));
+    BOOST_CHECK_LT(false_positives, 50U);
+}
+
+BOOST_AUTO_TEST_CASE(full)
+{
+    CuckooFilter filter{100};
+    size_t inserted{0};
+    while (filter.Insert(InsecureRandBits(64))) ++inserted;
+    // Insertion only fails once most slots are used.
+    BOOST_CHECK_GE(inserted * 10, filter.Capacity() * 8);
+    BOOST_CHECK_LE(inserted, filter.Capacity());
+}
+
+static COutPoint AddRandomCoin(CCoinsViewCache& cache)
+{
+    COutPoint outpoint{Txid::FromUint256(InsecureRand256()), uint32_t(InsecureRandRange(4))};
+    cache.AddCoin(outpoint, Coin{CTxOut{1000, CScript() << OP_TRUE}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+    return outpoint;
+}
+
+BOOST_AUTO_TEST_CASE(coins_db_lookup_filter)
+{
+    CCoinsViewDB db{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {.lookup_filter = true}};
+    db.WaitForLookupFilter();
+    BOOST_CHECK(db.HasLookupFilter());
+
+    // Coins written after the filter was built are found, and erasing them
+    // does not affect other coins.
+    std::vector<COutPoint> outpoints;
+    {
+        CCoinsViewCache cache{&db};
+        for (int i{0}; i < 1000; ++i) outpoints.push_back(AddRandomCoin(cache));
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_REQUIRE(cache.Flush());
+    }
+    {
+        CCoinsViewCache cache{&db};
+        for (size_t i{0}; i < outpoints.size(); i += 2) BOOST_CHECK(cache.SpendCoin(outpoints[i]));
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_REQUIRE(cache.Flush());
+    }
+    for (size_t i{0}; i < outpoints.size(); ++i) {
+        Coin coin;
+        BOOST_CHECK_EQUAL(db.HaveCoin(outpoints[i]), i % 2 == 1);
+        BOOST_CHECK_EQUAL(db.GetCoin(outpoints[i], coin), i % 2 == 1);
+    }
+    BOOST_CHECK(!db.HaveCoin(COutPoint{Txid::FromUint256(InsecureRand256()), 0}));
+}
+
+BOOST_AUTO_TEST_CASE(coins_db_lookup_filter_rebuild)
+{
+    CCoinsViewDB db{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {.lookup_filter = true}};
+    db.WaitForLookupFilter();
+    const size_t capacity{db.LookupFilterCapacity()};
+    BOOST_REQUIRE_GT(capacity, 0U);
+
+    // Spent coins stay in the filter, so adding and spending coins fills it
+    // up several times over. It is rebuilt for the size of the database each
+    // time, rather than growing with all coins ever written: it only grows by
+    // the spent coins that are not compacted away yet, and shrinks back once
+    // they are.
+    constexpr size_t COINS_PER_CYCLE{16'384};
+    size_t written{0};
+    size_t max_capacity{0};
+    while (written < capacity * 8) {
+        std::vector<COutPoint> outpoints;
+        {
+            CCoinsViewCache cache{&db};
+            for (size_t i{0}; i < COINS_PER_CYCLE; ++i) outpoints.push_back(AddRandomCoin(cache));
+            cache.SetBestBlock(InsecureRand256());
+            BOOST_REQUIRE(cache.Flush());
+        }
+        written += outpoints.size();
+        {
+            CCoinsViewCache cache{&db};
+            for (const COutPoint& outpoint : outpoints) BOOST_CHECK(cache.SpendCoin(outpoint));
+            cache.SetBestBlock(InsecureRand256());
+            BOOST_REQUIRE(cache.Flush());
+        }
+        db.WaitForLookupFilter();
+        max_capacity = std::max(max_capacity, db.LookupFilterCapacity());
+    }
+    BOOST_CHECK_LT(max_capacity, CuckooFilter{written}.Capacity() / 2);
+    BOOST_CHECK_EQUAL(db.LookupFilterCapacity(), capacity);
+    BOOST_CHECK(db.HasLookupFilter());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,13 +2,18 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <common/args.h>
 #include <dbwrapper.h>
+#include <node/database_args.h>
 #include <test/util/random.h>
 #include <test/util/setup_common.h>
 #include <uint256.h>
 #include <util/string.h>
 
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -399,5 +404,133 @@ BOOST_AUTO_TEST_CASE(unicodepath)
     BOOST_CHECK(fs::exists(lockPath));
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_options_stats)
+{
+    for (const int bloom_bits : {0, 16}) {
+        const fs::path ph{m_args.GetDataDirBase() / fs::PathFromString(strprintf("dbwrapper_stats_%d", bloom_bits))};
+        CDBWrapper dbw({.path = ph, .cache_bytes = 1 << 20, .wipe_data = true, .options = {
+            .bloom_bits = bloom_bits,
+            .write_buffer_bytes = 64 << 10,
+            .max_file_bytes = 128 << 10,
+            .block_bytes = 1 << 10,
+        }});
+        const DBStats initial{dbw.GetStats()};
+        BOOST_CHECK_EQUAL(initial.levels.size(), 7U);
+        for (const DBLevelStats& level : initial.levels) {
+            BOOST_CHECK_EQUAL(level.files, 0);
+            BOOST_CHECK_EQUAL(level.compaction_write_mib, 0);
+        }
+        BOOST_CHECK(!initial.leveldb_stats.empty());
+
+        // Write enough to fill several write buffers.
+        for (uint32_t i{0}; i < 64; ++i) {
+            CDBBatch batch{dbw};
+            for (uint32_t j{0}; j < 1000; ++j) batch.Write(std::make_pair(uint8_t{'k'}, i * 1000 + j), InsecureRand256());
+            BOOST_CHECK(dbw.WriteBatch(batch));
+        }
+        uint256 value;
+        for (uint32_t i{0}; i < 1000; ++i) {
+            BOOST_CHECK(dbw.Read(std::make_pair(uint8_t{'k'}, i), value));
+            BOOST_CHECK(!dbw.Exists(std::make_pair(uint8_t{'m'}, i)));
+        }
+
+        const DBStats stats{dbw.GetStats()};
+        BOOST_CHECK_EQUAL(stats.levels.size(), 7U);
+        int files{0};
+        double written{0};
+        for (const DBLevelStats& level : stats.levels) {
+            files += level.files;
+            written += level.compaction_write_mib;
+        }
+        BOOST_CHECK_GT(files, 0);
+        // The write buffers written to table files amount to several MiB.
+        BOOST_CHECK_GT(written, 0);
+        BOOST_CHECK_GT(stats.approximate_size, 0U);
+        BOOST_CHECK_GT(stats.memory_usage, 0U);
+        uint64_t writes{0};
+        for (const uint64_t bucket : stats.write_latency) writes += bucket;
+        BOOST_CHECK_EQUAL(writes, 64U);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_range_iterators)
+{
+    for (const bool memory_only : {true, false}) {
+        const fs::path ph{m_args.GetDataDirBase() / fs::PathFromString(strprintf("dbwrapper_ranges_%d", memory_only))};
+        // A small write buffer moves most keys to table files, whose sizes
+        // the ranges are split by.
+        CDBWrapper dbw({.path = ph, .cache_bytes = 1 << 20, .memory_only = memory_only, .wipe_data = true, .obfuscate = true, .options = {.write_buffer_bytes = 64 << 10}});
+        std::vector<uint256> keys;
+        for (int i{0}; i < 5000; ++i) {
+            keys.push_back(InsecureRand256());
+            BOOST_CHECK(dbw.Write(std::make_pair(uint8_t{'c'}, keys.back()), i));
+            // Keys with other prefixes are never iterated over.
+            BOOST_CHECK(dbw.Write(std::make_pair(uint8_t{'b'}, keys.back()), i));
+            BOOST_CHECK(dbw.Write(std::make_pair(uint8_t{'d'}, keys.back()), i));
+        }
+        std::sort(keys.begin(), keys.end());
+
+        for (const size_t num_ranges : {0, 1, 3, 16, 64}) {
+            auto iterators{dbw.NewRangeIterators(uint8_t{'c'}, num_ranges)};
+            BOOST_CHECK_GE(iterators.size(), 1U);
+            BOOST_CHECK_LE(iterators.size(), std::max<size_t>(num_ranges, 1));
+            // Writes after creating the iterators are not seen.
+            BOOST_CHECK(dbw.Write(std::make_pair(uint8_t{'c'}, uint256::ZERO), 0));
+            std::vector<uint256> seen;
+            for (const auto& it : iterators) {
+                for (; it->Valid(); it->Next()) {
+                    std::pair<uint8_t, uint256> key;
+                    BOOST_REQUIRE(it->GetKey(key));
+                    BOOST_CHECK_EQUAL(key.first, 'c');
+                    seen.push_back(key.second);
+                }
+            }
+            BOOST_CHECK(dbw.Erase(std::make_pair(uint8_t{'c'}, uint256::ZERO)));
+            BOOST_CHECK(seen == keys);
+            if (!memory_only && num_ranges == 16) {
+                // Ranges hold roughly the same number of keys.
+                BOOST_CHECK_GE(iterators.size(), 8U);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_args)
+{
+    ArgsManager args;
+    for (const char* name : {"-dbblocksize", "-dbbloombits", "-dbmaxfilesize", "-dbwritebuffer"}) {
+        args.AddArg(name, "", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    }
+    const auto parse{[&](std::vector<const char*> argv) {
+        argv.insert(argv.begin(), "ignored");
+        std::string error;
+        BOOST_REQUIRE(args.ParseParameters(argv.size(), argv.data(), error));
+    }};
+
+    parse({"-dbbloombits=chainstate:16", "-dbbloombits=12", "-dbwritebuffer=txindex:32", "-dbblocksize=8", "-dbmaxfilesize=blockindex:4"});
+    BOOST_CHECK(node::CheckDatabaseArgs(args));
+    DBOptions chainstate, txindex, blockindex;
+    node::ReadDatabaseArgs(args, chainstate, "chainstate");
+    node::ReadDatabaseArgs(args, txindex, "txindex");
+    node::ReadDatabaseArgs(args, blockindex, "blockindex");
+    BOOST_CHECK_EQUAL(chainstate.bloom_bits, 16);
+    BOOST_CHECK_EQUAL(txindex.bloom_bits, 12);
+    BOOST_CHECK(!chainstate.write_buffer_bytes);
+    BOOST_CHECK_EQUAL(txindex.write_buffer_bytes.value(), 32U << 20);
+    BOOST_CHECK_EQUAL(chainstate.block_bytes, 8U << 10);
+    BOOST_CHECK_EQUAL(chainstate.max_file_bytes, DEFAULT_DB_MAX_FILE_SIZE);
+    BOOST_CHECK_EQUAL(blockindex.max_file_bytes, 4U << 20);
+
+    for (const char* invalid : {"-dbbloombits=65", "-dbbloombits=wallet:10", "-dbwritebuffer=0", "-dbmaxfilesize=chainstate:yes", "-dbblocksize=chainstate"}) {
+        parse({"-dbbloombits=8", invalid});
+        BOOST_CHECK(!node::CheckDatabaseArgs(args));
+        // Invalid values are ignored.
+        DBOptions options;
+        node::ReadDatabaseArgs(args, options, "chainstate");
+        BOOST_CHECK_EQUAL(options.bloom_bits, 8);
+        BOOST_CHECK_EQUAL(options.block_bytes, DEFAULT_DB_BLOCK_SIZE);
+        BOOST_CHECK(!options.write_buffer_bytes);
+    }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <flatnodemap.h>
+#include <memusage.h>
+#include <test/util/poolresourcetester.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+
+BOOST_FIXTURE_TEST_SUITE(flatnodemap_tests, BasicTestingSetup)
+
+namespace {
+struct IdentityHasher {
+    size_t operator()(uint64_t x) const { return x; }
+};
+using Map = FlatNodeMap<uint64_t, uint64_t, IdentityHasher, std::equal_to<uint64_t>, sizeof(std::pair<const uint64_t, uint64_t>)>;
+} // namespace
+
+BOOST_AUTO_TEST_CASE(random_operations)
+{
+    Map::allocator_type::ResourceType resource;
+    {
+        Map map{0, IdentityHasher{}, std::equal_to<uint64_t>{}, &resource};
+        std::unordered_map<uint64_t, uint64_t> expected;
+        // Element addresses, to check that they never move.
+        std::unordered_map<uint64_t, const uint64_t*> addresses;
+
+        for (int i = 0; i < 20'000; ++i) {
+            // Use hashes with few distinct low bits so control bytes collide.
+            const uint64_t key{InsecureRandRange(1000) << 7 | InsecureRandRange(2)};
+            switch (InsecureRandRange(4)) {
+            case 0: {
+                const auto [it, inserted]{map.try_emplace(key, key * 2)};
+                BOOST_CHECK_EQUAL(inserted, expected.try_emplace(key, key * 2).second);
+                if (inserted) addresses[key] = &it->second;
+                break;
+            }
+            case 1:
+                BOOST_CHECK_EQUAL(map.erase(key), expected.erase(key));
+                addresses.erase(key);
+                break;
+            case 2: {
+                const auto it{map.find(key)};
+                BOOST_REQUIRE_EQUAL(it != map.end(), expected.count(key) == 1);
+                if (it != map.end()) {
+                    BOOST_CHECK_EQUAL(it->second, key * 2);
+                    BOOST_CHECK(&it->second == addresses.at(key));
+                }
+                break;
+            }
+            case 3:
+                // Erase about half of the elements while iterating.
+                if (InsecureRandRange(1000) == 0) {
+                    for (auto it{map.begin()}; it != map.end();) {
+                        if (InsecureRandBool()) {
+                            expected.erase(it->first);
+                            addresses.erase(it->first);
+                            it = map.erase(it);
+                        } else {
+                            ++it;
+                        }
+                    }
+                }
+                break;
+            }
+            BOOST_REQUIRE_EQUAL(map.size(), expected.size());
+        }
+
+        size_t count{0};
+        for (const auto& [key, value] : map) {
+            BOOST_CHECK_EQUAL(expected.at(key), value);
+            ++count;
+        }
+        BOOST_CHECK_EQUAL(count, expected.size());
+
+        map.clear();
+        BOOST_CHECK(map.empty());
+        BOOST_CHECK(map.begin() == map.end());
+    }
+    PoolResourceTester::CheckAllDataAccountedFor(resource);
+}
+
+BOOST_AUTO_TEST_CASE(reserve_and_memory_usage)
+{
+    Map::allocator_type::ResourceType resource;
+    Map map{0, IdentityHasher{}, std::equal_to<uint64_t>{}, &resource};
+    BOOST_CHECK_EQUAL(map.bucket_count(), 0U);
+    BOOST_CHECK(map.find(1) == map.end());
+
+    map.reserve(1000);
+    const size_t buckets{map.bucket_count()};
+    const size_t usage{memusage::DynamicUsage(map)};
+    for (uint64_t i = 0; i < 1000; ++i) map[i << 7] = i;
+    BOOST_CHECK_EQUAL(map.bucket_count(), buckets);
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), usage);
+
+    // Churning through erases and inserts only rebuilds the index at the same size.
+    for (uint64_t i = 0; i < 100'000; ++i) {
+        BOOST_CHECK_EQUAL(map.erase(i << 7), 1U);
+        map[(i + 1000) << 7] = i;
+    }
+    BOOST_CHECK_EQUAL(map.size(), 1000U);
+    BOOST_CHECK_EQUAL(map.bucket_count(), buckets);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -172,16 +172,14 @@ public:
     std::unique_ptr<CCoinsViewCursor> Cursor() const final { return {}; }
     size_t EstimateSize() const final { return m_data.size(); }
 
-    bool BatchWrite(CCoinsMap& data, const uint256&, bool erase) final
+    bool BatchWrite(CoinsViewCacheCursor& cursor, const uint256&) final
     {
-        for (auto it = data.begin(); it != data.end(); it = erase ? data.erase(it) : std::next(it)) {
-            if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+        for (auto it{cursor.Begin()}; it != cursor.End(); it = cursor.NextAndMaybeErase(*it)) {
+            if (it->second.IsDirty()) {
                 if (it->second.coin.IsSpent() && (it->first.n % 5) != 4) {
                     m_data.erase(it->first);
-                } else if (erase) {
-                    m_data[it->first] = std::move(it->second.coin);
                 } else {
-                    m_data[it->first] = it->second.coin;
+                    m_data[it->first] = it->second.coin.ToCoin();
                 }
             } else {
                 /* For non-dirty entries being written, compare them with what we have. */
@@ -190,9 +188,10 @@ public:
                     assert(it2 == m_data.end() || it2->second.IsSpent());
                 } else {
                     assert(it2 != m_data.end());
-                    assert(it->second.coin.out == it2->second.out);
-                    assert(it->second.coin.fCoinBase == it2->second.fCoinBase);
-                    assert(it->second.coin.nHeight == it2->second.nHeight);
+                    const Coin coin{it->second.coin.ToCoin()};
+                    assert(coin.out == it2->second.out);
+                    assert(coin.fCoinBase == it2->second.fCoinBase);
+                    assert(coin.nHeight == it2->second.nHeight);
                 }
             }
         }
@@ -312,9 +311,26 @@ FUZZ_TARGET(coinscache_sim)
                 } else {
                     assert(!realcoin.IsSpent());
                     const auto& simcoin = data.coins[sim->first];
-                    assert(simcoin.out == realcoin.out);
-                    assert(simcoin.fCoinBase == realcoin.fCoinBase);
-                    assert(realcoin.nHeight == sim->second);
+                    assert(simcoin.out == realcoin.GetTxOut());
+                    assert(simcoin.fCoinBase == realcoin.IsCoinBase());
+                    assert(realcoin.GetHeight() == sim->second);
+                }
+            },
+
+            [&]() { // AccessCoin on every outpoint, then again.
+                // Coins pulled into the cache must be unaffected by other entries
+                // being pulled into the same cache after them.
+                std::vector<std::pair<uint32_t, Coin>> accessed;
+                for (uint32_t outpointidx = 0; outpointidx < NUM_OUTPOINTS; ++outpointidx) {
+                    Coin realcoin{caches.back()->AccessCoin(data.outpoints[outpointidx]).ToCoin()};
+                    assert(realcoin.IsSpent() == !lookup(outpointidx).has_value());
+                    if (!realcoin.IsSpent()) accessed.emplace_back(outpointidx, std::move(realcoin));
+                }
+                for (const auto& [outpointidx, copy] : accessed) {
+                    const Coin realcoin{caches.back()->AccessCoin(data.outpoints[outpointidx]).ToCoin()};
+                    assert(realcoin.out == copy.out);
+                    assert(realcoin.fCoinBase == copy.fCoinBase);
+                    assert(realcoin.nHeight == copy.nHeight);
                 }
             },
 
@@ -420,6 +436,24 @@ FUZZ_TARGET(coinscache_sim)
                 caches.back()->ReallocateCache();
             },
 
+            [&]() { // EvictClean (only drops entries that match the parent, so nothing changes in the simulation).
+                auto& cache = *caches.back();
+                const size_t usage_before = cache.LiveMemoryUsage();
+                const size_t target = provider.ConsumeIntegralInRange<size_t>(0, usage_before);
+                const size_t evicted = cache.EvictClean(target);
+                assert(evicted == 0 || cache.LiveMemoryUsage() < usage_before);
+            },
+
+            [&]() { // Sync + EvictClean.
+                // Apply to simulation data.
+                flush();
+                // Apply to real caches.
+                caches.back()->Sync();
+                caches.back()->EvictClean(/*target_usage=*/0);
+                // Everything is clean after Sync(), so all entries are evicted.
+                assert(caches.back()->GetCacheSize() == 0);
+            },
+
             [&]() { // GetCacheSize
                 (void)caches.back()->GetCacheSize();
             },
@@ -453,9 +487,9 @@ FUZZ_TARGET(coinscache_sim)
                 assert(real.IsSpent());
             } else {
                 assert(!real.IsSpent());
-                assert(real.out == data.coins[sim->first].out);
-                assert(real.fCoinBase == data.coins[sim->first].fCoinBase);
-                assert(real.nHeight == sim->second);
+                assert(real.GetTxOut() == data.coins[sim->first].out);
+                assert(real.IsCoinBase() == data.coins[sim->first].fCoinBase);
+                assert(real.GetHeight() == sim->second);
             }
         }
 
@@ -0,0 +1,29 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <span.h>
+#include <test/fuzz/FuzzedDataProvider.h>
+#include <test/fuzz/fuzz.h>
+#include <util/lzcompress.h>
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+FUZZ_TARGET(lzcompress_roundtrip)
+{
+    const std::vector<std::byte> data(MakeByteSpan(buffer).begin(), MakeByteSpan(buffer).end());
+    const std::vector<std::byte> compressed{util::LZCompress(data)};
+    std::vector<std::byte> decompressed(data.size());
+    assert(util::LZDecompress(compressed, decompressed));
+    assert(decompressed == data);
+}
+
+FUZZ_TARGET(lzdecompress)
+{
+    FuzzedDataProvider fuzzed_data_provider{buffer.data(), buffer.size()};
+    std::vector<std::byte> data(fuzzed_data_provider.ConsumeIntegralInRange<size_t>(0, 1 << 16));
+    const std::vector<std::byte> compressed{fuzzed_data_provider.ConsumeRemainingBytes<std::byte>()};
+    (void)util::LZDecompress(compressed, data);
+}
@@ -129,6 +129,7 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "getchainstates",
     "getchaintxstats",
     "getconnectioncount",
+    "getdbstats",
     "getdeploymentinfo",
     "getdescriptorinfo",
     "getdifficulty",
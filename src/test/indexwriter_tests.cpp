@@ -0,0 +1,179 @@
+// Copyright (c) 2024 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <addresstype.h>
+#include <common/args.h>
+#include <dbwrapper.h>
+#include <index/base.h>
+#include <index/indexwriter.h>
+#include <interfaces/chain.h>
+#include <test/util/index.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+#include <util/check.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+constexpr uint8_t DB_TEST_HEIGHT{'h'};
+
+namespace {
+/** Index writing the hash of each block by height. */
+class TestIndex final : public BaseIndex
+{
+    std::unique_ptr<BaseIndex::DB> m_db;
+
+protected:
+    bool AllowPrune() const override { return false; }
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    bool CustomAppend(const interfaces::BlockInfo& block) override
+    {
+        return m_db->QueueWrite([&](CDBBatch& batch) { batch.Write(std::make_pair(DB_TEST_HEIGHT, block.height), block.hash); });
+    }
+
+public:
+    explicit TestIndex(std::unique_ptr<interfaces::Chain> chain)
+        : BaseIndex{std::move(chain), "testindex"},
+          m_db{std::make_unique<BaseIndex::DB>(gArgs.GetDataDirNet() / "indexes" / "testindex", "testindex", 1 << 20, /*f_memory=*/true)} {}
+
+    //! Whether the block at a height was written, without waiting for the
+    //! batches still queued.
+    bool IsWritten(int height, const uint256& hash) const
+    {
+        uint256 written;
+        return m_db->Read(std::make_pair(DB_TEST_HEIGHT, height), written) && written == hash;
+    }
+};
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(indexwriter_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(indexwriter_write_order)
+{
+    CDBWrapper db1{{.path = m_args.GetDataDirBase() / "indexwriter1", .cache_bytes = 1 << 20, .memory_only = true}};
+    CDBWrapper db2{{.path = m_args.GetDataDirBase() / "indexwriter2", .cache_bytes = 1 << 20, .memory_only = true}};
+    IndexWriter writer;
+
+    // Nothing queued yet.
+    BOOST_CHECK(writer.Flush(db1));
+
+    // Queue batches overwriting and erasing the keys of the batches before
+    // them, flushing now and then, so they get written by several writes.
+    for (int i{0}; i < 100; ++i) {
+        BOOST_CHECK(writer.Queue(db1, [&](CDBBatch& batch) {
+            batch.Write(uint8_t{'k'}, i);
+            batch.Write(std::make_pair(uint8_t{'i'}, i), i);
+            if (i > 0) batch.Erase(std::make_pair(uint8_t{'i'}, i - 1));
+        }));
+        BOOST_CHECK(writer.Queue(db2, [&](CDBBatch& batch) { batch.Write(uint8_t{'k'}, -i); }));
+        if (i % 7 == 0) BOOST_CHECK(writer.Flush(db1));
+    }
+
+    // Flushing a database makes all batches queued for it visible, with the
+    // later batches winning.
+    BOOST_CHECK(writer.Flush(db1));
+    int value;
+    BOOST_CHECK(db1.Read(uint8_t{'k'}, value));
+    BOOST_CHECK_EQUAL(value, 99);
+    for (int i{0}; i < 99; ++i) {
+        BOOST_CHECK(!db1.Exists(std::make_pair(uint8_t{'i'}, i)));
+    }
+    BOOST_CHECK(db1.Exists(std::make_pair(uint8_t{'i'}, 99)));
+
+    // Each database gets its own writes.
+    BOOST_CHECK(writer.Flush(db2));
+    BOOST_CHECK(db2.Read(uint8_t{'k'}, value));
+    BOOST_CHECK_EQUAL(value, -99);
+    BOOST_CHECK(!db2.Exists(std::make_pair(uint8_t{'i'}, 0)));
+
+    writer.Remove(db1);
+    writer.Remove(db2);
+}
+
+BOOST_AUTO_TEST_CASE(indexwriter_write_error)
+{
+    CDBWrapper db1{{.path = m_args.GetDataDirBase() / "indexwriter1", .cache_bytes = 1 << 20, .memory_only = true}};
+    CDBWrapper db2{{.path = m_args.GetDataDirBase() / "indexwriter2", .cache_bytes = 1 << 20, .memory_only = true}};
+    std::atomic<bool> fail{false};
+    IndexWriter writer{[&](CDBWrapper& db, CDBBatch& batch) {
+        if (fail && &db == &db1) return false;
+        return db.WriteBatch(batch);
+    }};
+
+    BOOST_CHECK(writer.Queue(db1, [](CDBBatch& batch) { batch.Write(uint8_t{'k'}, 1); }));
+    BOOST_CHECK(writer.Flush(db1));
+
+    // A failed write is reported by waiting for it, and by queueing after it.
+    fail = true;
+    BOOST_CHECK(writer.Queue(db1, [](CDBBatch& batch) { batch.Write(uint8_t{'k'}, 2); }));
+    BOOST_CHECK(!writer.Flush(db1));
+    BOOST_CHECK(!writer.Queue(db1, [](CDBBatch& batch) { batch.Write(uint8_t{'k'}, 3); }));
+    BOOST_CHECK(!writer.Flush(db1));
+    int value;
+    BOOST_CHECK(db1.Read(uint8_t{'k'}, value));
+    BOOST_CHECK_EQUAL(value, 1);
+
+    // Other databases are not affected.
+    BOOST_CHECK(writer.Queue(db2, [](CDBBatch& batch) { batch.Write(uint8_t{'k'}, 4); }));
+    BOOST_CHECK(writer.Flush(db2));
+    BOOST_CHECK(db2.Read(uint8_t{'k'}, value));
+    BOOST_CHECK_EQUAL(value, 4);
+
+    // Database errors thrown by a write are reported the same way.
+    IndexWriter throwing_writer{[](CDBWrapper&, CDBBatch&) -> bool { throw dbwrapper_error{"test"}; }};
+    BOOST_CHECK(throwing_writer.Queue(db2, [](CDBBatch& batch) { batch.Write(uint8_t{'k'}, 5); }));
+    BOOST_CHECK(!throwing_writer.Flush(db2));
+    BOOST_CHECK(!throwing_writer.Queue(db2, [](CDBBatch& batch) { batch.Write(uint8_t{'k'}, 6); }));
+
+    throwing_writer.Remove(db2);
+    writer.Remove(db1);
+    writer.Remove(db2);
+}
+
+BOOST_FIXTURE_TEST_CASE(indexwriter_commit_stop, TestChain100Setup)
+{
+    TestIndex index{interfaces::MakeChain(m_node)};
+    BOOST_REQUIRE(index.Init());
+    BOOST_REQUIRE(index.StartBackgroundSync());
+    IndexWaitSynced(index, *Assert(m_node.shutdown));
+
+    // The sync thread commits the index once in sync, which writes the
+    // batches queued for all blocks before it.
+    for (const CBlockIndex* block{WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Tip())}; block; block = block->pprev) {
+        BOOST_CHECK(index.IsWritten(block->nHeight, block->GetBlockHash()));
+    }
+
+    // Flushing the chainstate commits the index too.
+    const CScript script{GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()))};
+    std::vector<uint256> hashes;
+    for (int i{0}; i < 3; ++i) {
+        hashes.push_back(CreateAndProcessBlock({}, script).GetHash());
+    }
+    BOOST_CHECK(index.BlockUntilSyncedToCurrentChain());
+    m_node.chainman->ActiveChainstate().ForceFlushStateToDisk();
+    m_node.validation_signals->SyncWithValidationInterfaceQueue();
+    for (int i{0}; i < 3; ++i) {
+        BOOST_CHECK(index.IsWritten(101 + i, hashes[i]));
+    }
+
+    // Stopping the index writes the batches queued for the blocks connected
+    // since the last commit.
+    for (int i{0}; i < 3; ++i) {
+        hashes.push_back(CreateAndProcessBlock({}, script).GetHash());
+    }
+    BOOST_CHECK(index.BlockUntilSyncedToCurrentChain());
+    m_node.validation_signals->SyncWithValidationInterfaceQueue();
+    index.Stop();
+    for (int i{3}; i < 6; ++i) {
+        BOOST_CHECK(index.IsWritten(101 + i, hashes[i]));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
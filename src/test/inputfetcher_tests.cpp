@@ -0,0 +1,118 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <inputfetcher.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(inputfetcher_tests, BasicTestingSetup)
+
+static constexpr int FETCHER_THREADS{3};
+
+/** Fill db with num_coins random coins and return their outpoints. */
+static std::vector<COutPoint> PopulateDB(CCoinsViewDB& db, size_t num_coins)
+{
+    std::vector<COutPoint> outpoints;
+    CCoinsViewCache cache{&db};
+    for (size_t i{0}; i < num_coins; ++i) {
+        COutPoint outpoint{Txid::FromUint256(InsecureRand256()), uint32_t(InsecureRandRange(4))};
+        CTxOut txout{int64_t(InsecureRandRange(1000)) + 1, CScript() << OP_TRUE};
+        cache.AddCoin(outpoint, Coin{std::move(txout), /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+        outpoints.push_back(outpoint);
+    }
+    cache.SetBestBlock(InsecureRand256());
+    BOOST_REQUIRE(cache.Flush());
+    return outpoints;
+}
+
+/** Build a block with a coinbase followed by one transaction per input. */
+static CBlock MakeBlock(const std::vector<COutPoint>& prevouts)
+{
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.resize(1);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    for (const auto& prevout : prevouts) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(prevout);
+        tx.vout.emplace_back(1, CScript() << OP_TRUE);
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(fetch_inputs)
+{
+    CCoinsViewDB db{{.path = "test", .cache_bytes = 1 << 20, .memory_only = true}, {}};
+    const auto outpoints{PopulateDB(db, 500)};
+    const CBlock block{MakeBlock(outpoints)};
+
+    InputFetcher fetcher{/*batch_size=*/8, FETCHER_THREADS};
+    CCoinsViewCache cache{&db};
+    BOOST_CHECK_EQUAL(fetcher.FetchInputs(cache, db, block), outpoints.size());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), outpoints.size());
+
+    for (const auto& outpoint : outpoints) {
+        BOOST_REQUIRE(cache.HaveCoinInCache(outpoint));
+        Coin expected;
+        BOOST_REQUIRE(db.GetCoin(outpoint, expected));
+        BOOST_CHECK(cache.AccessCoin(outpoint).GetTxOut() == expected.out);
+    }
+    cache.SanityCheck();
+
+    // Fetched entries are clean, so they can be uncached again.
+    for (const auto& outpoint : outpoints) {
+        cache.Uncache(outpoint);
+    }
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+
+    // A second fetch into a warm cache does not read anything.
+    BOOST_CHECK_EQUAL(fetcher.FetchInputs(cache, db, block), outpoints.size());
+    BOOST_CHECK_EQUAL(fetcher.FetchInputs(cache, db, block), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(fetch_inputs_skips)
+{
+    CCoinsViewDB db{{.path = "test", .cache_bytes = 1 << 20, .memory_only = true}, {}};
+    auto outpoints{PopulateDB(db, 10)};
+    CCoinsViewCache cache{&db};
+
+    // A coin that is already spent in the cache must not be resurrected.
+    BOOST_REQUIRE(cache.SpendCoin(outpoints[0]));
+    // A coin that does not exist is not added.
+    outpoints.emplace_back(Txid::FromUint256(InsecureRand256()), 0);
+    CBlock block{MakeBlock(outpoints)};
+
+    // Spend an output of a transaction in the same block.
+    CMutableTransaction child;
+    child.vin.emplace_back(block.vtx.back()->GetHash(), 0);
+    child.vout.emplace_back(1, CScript() << OP_TRUE);
+    block.vtx.push_back(MakeTransactionRef(child));
+
+    InputFetcher fetcher{/*batch_size=*/1, FETCHER_THREADS};
+    BOOST_CHECK_EQUAL(fetcher.FetchInputs(cache, db, block), outpoints.size() - 2);
+    BOOST_CHECK(!cache.HaveCoinInCache(outpoints[0]));
+    BOOST_CHECK(!cache.HaveCoinInCache(outpoints.back()));
+    BOOST_CHECK(!cache.HaveCoinInCache(COutPoint{block.vtx.back()->GetHash(), 0}));
+    cache.SanityCheck();
+
+    // Without worker threads, fetching is left to ConnectBlock().
+    InputFetcher no_threads{/*batch_size=*/8, /*worker_threads_num=*/0};
+    CCoinsViewCache cold_cache{&db};
+    BOOST_CHECK(!no_threads.HasThreads());
+    BOOST_CHECK_EQUAL(no_threads.FetchInputs(cold_cache, db, block), 0U);
+    BOOST_CHECK_EQUAL(cold_cache.GetCacheSize(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,84 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <span.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <util/lzcompress.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <vector>
+
+using util::LZCompress;
+using util::LZDecompress;
+
+BOOST_FIXTURE_TEST_SUITE(lzcompress_tests, BasicTestingSetup)
+
+static void CheckRoundTrip(const std::vector<std::byte>& data)
+{
+    const std::vector<std::byte> compressed{LZCompress(data)};
+    std::vector<std::byte> decompressed(data.size());
+    BOOST_REQUIRE(LZDecompress(compressed, decompressed));
+    BOOST_CHECK(decompressed == data);
+
+    // The size of the data must be known.
+    std::vector<std::byte> too_small(data.size() - (data.empty() ? 0 : 1));
+    if (!data.empty()) BOOST_CHECK(!LZDecompress(compressed, too_small));
+    std::vector<std::byte> too_large(data.size() + 1);
+    BOOST_CHECK(!LZDecompress(compressed, too_large));
+}
+
+BOOST_AUTO_TEST_CASE(round_trip)
+{
+    CheckRoundTrip({});
+    CheckRoundTrip(std::vector<std::byte>(3, std::byte{7}));
+    CheckRoundTrip(std::vector<std::byte>(100'000, std::byte{0}));
+    CheckRoundTrip(g_insecure_rand_ctx.randbytes<std::byte>(100'000));
+
+    // Random data interspersed with repeats, near and far.
+    std::vector<std::byte> data;
+    for (int i{0}; i < 2000; ++i) {
+        const auto chunk{g_insecure_rand_ctx.randbytes<std::byte>(InsecureRandRange(300))};
+        data.insert(data.end(), chunk.begin(), chunk.end());
+        if (data.size() > 1000) {
+            const size_t begin{InsecureRandRange(data.size() - 1000)};
+            const std::vector<std::byte> repeat(data.begin() + begin, data.begin() + begin + InsecureRandRange(1000));
+            data.insert(data.end(), repeat.begin(), repeat.end());
+        }
+    }
+    CheckRoundTrip(data);
+}
+
+BOOST_AUTO_TEST_CASE(compresses_repeats)
+{
+    std::vector<std::byte> data;
+    const auto pattern{g_insecure_rand_ctx.randbytes<std::byte>(1000)};
+    for (int i{0}; i < 100; ++i) data.insert(data.end(), pattern.begin(), pattern.end());
+    BOOST_CHECK_LT(LZCompress(data).size(), 2000U);
+}
+
+BOOST_AUTO_TEST_CASE(corrupt_input)
+{
+    std::vector<std::byte> data;
+    const auto pattern{g_insecure_rand_ctx.randbytes<std::byte>(500)};
+    for (int i{0}; i < 20; ++i) data.insert(data.end(), pattern.begin(), pattern.end());
+    const std::vector<std::byte> compressed{LZCompress(data)};
+
+    // Truncated input never decompresses to the full size.
+    std::vector<std::byte> out(data.size());
+    for (size_t size{0}; size < compressed.size(); ++size) {
+        BOOST_CHECK(!LZDecompress(Span{compressed}.first(size), out));
+    }
+
+    // Random input never reads or writes out of bounds.
+    for (int i{0}; i < 1000; ++i) {
+        const auto random{g_insecure_rand_ctx.randbytes<std::byte>(InsecureRandRange(100))};
+        std::vector<std::byte> random_out(InsecureRandRange(1000));
+        (void)LZDecompress(random, random_out);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
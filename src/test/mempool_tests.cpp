@@ -4,6 +4,7 @@
 
 #include <common/system.h>
 #include <policy/policy.h>
+#include <util/rbf.h>
 #include <test/util/txmempool.h>
 #include <txmempool.h>
 #include <util/time.h>
@@ -11,6 +12,9 @@
 #include <test/util/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 BOOST_FIXTURE_TEST_SUITE(mempool_tests, TestingSetup)
@@ -115,17 +119,27 @@ BOOST_AUTO_TEST_CASE(MempoolRemoveTest)
     BOOST_CHECK_EQUAL(testPool.size(), 0U);
 }
 
-template <typename name>
-static void CheckSort(CTxMemPool& pool, std::vector<std::string>& sortedOrder) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+static void CheckSort(const std::vector<const CTxMemPoolEntry*>& sorted, std::vector<std::string>& sortedOrder)
 {
-    BOOST_CHECK_EQUAL(pool.size(), sortedOrder.size());
-    typename CTxMemPool::indexed_transaction_set::index<name>::type::iterator it = pool.mapTx.get<name>().begin();
-    int count = 0;
-    for (; it != pool.mapTx.get<name>().end(); ++it, ++count) {
-        BOOST_CHECK_EQUAL(it->GetTx().GetHash().ToString(), sortedOrder[count]);
+    BOOST_CHECK_EQUAL(sorted.size(), sortedOrder.size());
+    for (size_t count = 0; count < std::min(sorted.size(), sortedOrder.size()); ++count) {
+        BOOST_CHECK_EQUAL(sorted[count]->GetTx().GetHash().ToString(), sortedOrder[count]);
     }
 }
 
+static std::vector<const CTxMemPoolEntry*> SortedByDescendantScore(CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+{
+    std::vector<const CTxMemPoolEntry*> sorted;
+    for (const auto& it : pool.mapTx.sorted_by_descendant_score()) sorted.push_back(&*it);
+    return sorted;
+}
+
+static std::vector<const CTxMemPoolEntry*> SortedByAncestorScore(CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+{
+    const auto& by_ancestor_score{pool.mapTx.by_ancestor_score()};
+    return {by_ancestor_score.begin(), by_ancestor_score.end()};
+}
+
 BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
 {
     CTxMemPool& pool = *Assert(m_node.mempool);
@@ -176,7 +190,7 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     sortedOrder[2] = tx1.GetHash().ToString(); // 10000
     sortedOrder[3] = tx4.GetHash().ToString(); // 15000
     sortedOrder[4] = tx2.GetHash().ToString(); // 20000
-    CheckSort<descendant_score>(pool, sortedOrder);
+    CheckSort(SortedByDescendantScore(pool), sortedOrder);
 
     /* low fee but with high fee child */
     /* tx6 -> tx7 -> tx8, tx9 -> tx10 */
@@ -188,7 +202,7 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     BOOST_CHECK_EQUAL(pool.size(), 6U);
     // Check that at this point, tx6 is sorted low
     sortedOrder.insert(sortedOrder.begin(), tx6.GetHash().ToString());
-    CheckSort<descendant_score>(pool, sortedOrder);
+    CheckSort(SortedByDescendantScore(pool), sortedOrder);
 
     CTxMemPool::setEntries setAncestors;
     setAncestors.insert(pool.GetIter(tx6.GetHash()).value());
@@ -215,7 +229,7 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     sortedOrder.erase(sortedOrder.begin());
     sortedOrder.push_back(tx6.GetHash().ToString());
     sortedOrder.push_back(tx7.GetHash().ToString());
-    CheckSort<descendant_score>(pool, sortedOrder);
+    CheckSort(SortedByDescendantScore(pool), sortedOrder);
 
     /* low fee child of tx7 */
     CMutableTransaction tx8 = CMutableTransaction();
@@ -230,7 +244,7 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
 
     // Now tx8 should be sorted low, but tx6/tx both high
     sortedOrder.insert(sortedOrder.begin(), tx8.GetHash().ToString());
-    CheckSort<descendant_score>(pool, sortedOrder);
+    CheckSort(SortedByDescendantScore(pool), sortedOrder);
 
     /* low fee child of tx7 */
     CMutableTransaction tx9 = CMutableTransaction();
@@ -245,7 +259,7 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     // tx9 should be sorted low
     BOOST_CHECK_EQUAL(pool.size(), 9U);
     sortedOrder.insert(sortedOrder.begin(), tx9.GetHash().ToString());
-    CheckSort<descendant_score>(pool, sortedOrder);
+    CheckSort(SortedByDescendantScore(pool), sortedOrder);
 
     std::vector<std::string> snapshotOrder = sortedOrder;
 
@@ -289,14 +303,14 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     sortedOrder.insert(sortedOrder.begin()+5, tx9.GetHash().ToString());
     sortedOrder.insert(sortedOrder.begin()+6, tx8.GetHash().ToString());
     sortedOrder.insert(sortedOrder.begin()+7, tx10.GetHash().ToString()); // tx10 is just before tx6
-    CheckSort<descendant_score>(pool, sortedOrder);
+    CheckSort(SortedByDescendantScore(pool), sortedOrder);
 
     // there should be 10 transactions in the mempool
     BOOST_CHECK_EQUAL(pool.size(), 10U);
 
     // Now try removing tx10 and verify the sort order returns to normal
     pool.removeRecursive(*Assert(pool.get(tx10.GetHash())), REMOVAL_REASON_DUMMY);
-    CheckSort<descendant_score>(pool, snapshotOrder);
+    CheckSort(SortedByDescendantScore(pool), snapshotOrder);
 
     pool.removeRecursive(*Assert(pool.get(tx9.GetHash())), REMOVAL_REASON_DUMMY);
     pool.removeRecursive(*Assert(pool.get(tx8.GetHash())), REMOVAL_REASON_DUMMY);
@@ -361,7 +375,7 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
     }
     sortedOrder[4] = tx3.GetHash().ToString(); // 0
 
-    CheckSort<ancestor_score>(pool, sortedOrder);
+    CheckSort(SortedByAncestorScore(pool), sortedOrder);
 
     /* low fee parent with high fee child */
     /* tx6 (0) -> tx7 (high) */
@@ -379,7 +393,7 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
     else
         sortedOrder.insert(sortedOrder.end()-1,tx6.GetHash().ToString());
 
-    CheckSort<ancestor_score>(pool, sortedOrder);
+    CheckSort(SortedByAncestorScore(pool), sortedOrder);
 
     CMutableTransaction tx7 = CMutableTransaction();
     tx7.vin.resize(1);
@@ -396,7 +410,7 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
     pool.addUnchecked(entry.Fee(fee).FromTx(tx7));
     BOOST_CHECK_EQUAL(pool.size(), 7U);
     sortedOrder.insert(sortedOrder.begin()+1, tx7.GetHash().ToString());
-    CheckSort<ancestor_score>(pool, sortedOrder);
+    CheckSort(SortedByAncestorScore(pool), sortedOrder);
 
     /* after tx6 is mined, tx7 should move up in the sort */
     std::vector<CTransactionRef> vtx;
@@ -410,7 +424,7 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
     else
         sortedOrder.erase(sortedOrder.end()-2);
     sortedOrder.insert(sortedOrder.begin(), tx7.GetHash().ToString());
-    CheckSort<ancestor_score>(pool, sortedOrder);
+    CheckSort(SortedByAncestorScore(pool), sortedOrder);
 
     // High-fee parent, low-fee child
     // tx7 -> tx8
@@ -427,7 +441,7 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
     // but the transaction's own feerate is lower
     pool.addUnchecked(entry.Fee(5000LL).FromTx(tx8));
     sortedOrder.insert(sortedOrder.end()-1, tx8.GetHash().ToString());
-    CheckSort<ancestor_score>(pool, sortedOrder);
+    CheckSort(SortedByAncestorScore(pool), sortedOrder);
 }
 
 
@@ -600,6 +614,41 @@ inline CTransactionRef make_tx(std::vector<CAmount>&& output_values, std::vector
 }
 
 
+BOOST_AUTO_TEST_CASE(MempoolSizeLimitChainTest)
+{
+    auto& pool = static_cast<MemPoolTest&>(*Assert(m_node.mempool));
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // A chain whose two last transactions pay less than the two first.
+    CTransactionRef tx1 = make_tx(/*output_values=*/{10 * COIN});
+    CTransactionRef tx2 = make_tx(/*output_values=*/{10 * COIN}, {tx1});
+    CTransactionRef tx3 = make_tx(/*output_values=*/{10 * COIN}, {tx2});
+    CTransactionRef tx4 = make_tx(/*output_values=*/{10 * COIN}, {tx3});
+    pool.addUnchecked(entry.Fee(10000LL).FromTx(tx1));
+    pool.addUnchecked(entry.Fee(10000LL).FromTx(tx2));
+    pool.addUnchecked(entry.Fee(100LL).FromTx(tx3));
+    pool.addUnchecked(entry.Fee(200LL).FromTx(tx4));
+
+    // tx3 is removed with its descendant, and the descendant state of the
+    // transactions that stay no longer counts them.
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK_EQUAL(pool.size(), 2U);
+    BOOST_CHECK(!pool.exists(GenTxid::Txid(tx3->GetHash())));
+    BOOST_CHECK(!pool.exists(GenTxid::Txid(tx4->GetHash())));
+    const auto entry1{pool.GetIter(tx1->GetHash()).value()};
+    const auto entry2{pool.GetIter(tx2->GetHash()).value()};
+    BOOST_CHECK_EQUAL(entry1->GetCountWithDescendants(), 2U);
+    BOOST_CHECK_EQUAL(entry1->GetSizeWithDescendants(), entry1->GetTxSize() + entry2->GetTxSize());
+    BOOST_CHECK_EQUAL(entry1->GetModFeesWithDescendants(), 20000);
+    BOOST_CHECK_EQUAL(entry2->GetCountWithDescendants(), 1U);
+    BOOST_CHECK_EQUAL(entry2->GetSizeWithDescendants(), entry2->GetTxSize());
+    BOOST_CHECK_EQUAL(entry2->GetModFeesWithDescendants(), 10000);
+    BOOST_CHECK(entry1->GetMemPoolChildrenConst().size() == 1);
+    BOOST_CHECK(entry2->GetMemPoolChildrenConst().empty());
+}
+
+
 BOOST_AUTO_TEST_CASE(MempoolAncestryTests)
 {
     size_t ancestors, descendants;
@@ -804,4 +853,101 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTestsDiamond)
     BOOST_CHECK_EQUAL(descendants, 4ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolSnapshotTest)
+{
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    TestMemPoolEntryHelper entry;
+
+    // A parent signaling replaceability, and a child that does not.
+    CMutableTransaction parent;
+    parent.vin.resize(1);
+    parent.vin[0].scriptSig = CScript() << OP_11;
+    parent.vin[0].nSequence = MAX_BIP125_RBF_SEQUENCE;
+    parent.vout.resize(2);
+    for (auto& out : parent.vout) {
+        out.scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        out.nValue = 10 * COIN;
+    }
+    CMutableTransaction child;
+    child.vin.resize(1);
+    child.vin[0].scriptSig = CScript() << OP_11;
+    child.vin[0].prevout = COutPoint{parent.GetHash(), 0};
+    child.vout.resize(1);
+    child.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    child.vout[0].nValue = 9 * COIN;
+    const Txid parent_txid{parent.GetHash()}, child_txid{child.GetHash()};
+
+    const auto empty{pool.GetSnapshot()};
+    BOOST_CHECK(empty->entries.empty());
+    BOOST_CHECK(pool.GetSnapshot() == empty);
+
+    {
+        LOCK2(::cs_main, pool.cs);
+        pool.addUnchecked(entry.Fee(1000).FromTx(parent));
+        pool.addUnchecked(entry.Fee(2000).FromTx(child));
+    }
+    pool.AddUnbroadcastTx(child_txid);
+    const auto snapshot{pool.GetSnapshot()};
+    // The earlier snapshot is unchanged, and the new one is shared while the
+    // mempool does not change.
+    BOOST_CHECK(empty->entries.empty());
+    BOOST_CHECK(pool.GetSnapshot() == snapshot);
+    BOOST_REQUIRE_EQUAL(snapshot->entries.size(), 2U);
+    BOOST_CHECK(snapshot->entries[0].tx->GetHash() == parent_txid);
+    BOOST_CHECK(snapshot->Find(Txid::FromUint256(uint256::ONE)) == nullptr);
+
+    const MempoolEntrySnapshot& p{*Assert(snapshot->Find(parent_txid))};
+    const MempoolEntrySnapshot& c{*Assert(snapshot->Find(child_txid))};
+    BOOST_CHECK_EQUAL(p.fee, 1000);
+    BOOST_CHECK_EQUAL(p.descendant_count, 2U);
+    BOOST_CHECK_EQUAL(p.descendant_fees, 3000);
+    BOOST_CHECK(p.depends.empty());
+    BOOST_CHECK(p.spent_by == std::vector<Txid>{child_txid});
+    BOOST_CHECK(p.bip125_replaceable);
+    BOOST_CHECK(!p.unbroadcast);
+    BOOST_CHECK_EQUAL(c.ancestor_count, 2U);
+    BOOST_CHECK_EQUAL(c.ancestor_size, p.vsize + c.vsize);
+    BOOST_CHECK(c.depends == std::vector<Txid>{parent_txid});
+    BOOST_CHECK(c.spent_by.empty());
+    // Replaceable through its parent.
+    BOOST_CHECK(c.bip125_replaceable);
+    BOOST_CHECK(c.unbroadcast);
+
+    // Changes to the mempool lead to a new snapshot.
+    pool.PrioritiseTransaction(child_txid, 500);
+    const auto prioritised{pool.GetSnapshot()};
+    BOOST_CHECK(prioritised != snapshot);
+    BOOST_CHECK_EQUAL(prioritised->Find(child_txid)->modified_fee, 2500);
+    BOOST_CHECK_EQUAL(prioritised->Find(parent_txid)->descendant_fees, 3500);
+    BOOST_CHECK_EQUAL(snapshot->Find(child_txid)->modified_fee, 2000);
+
+    pool.RemoveUnbroadcastTx(child_txid);
+    BOOST_CHECK(!pool.GetSnapshot()->Find(child_txid)->unbroadcast);
+
+    // A single entry copied under the lock matches its snapshot.
+    {
+        const auto current{pool.GetSnapshot()};
+        const MempoolEntrySnapshot& in_snapshot{*Assert(current->Find(child_txid))};
+        const MempoolEntrySnapshot single{WITH_LOCK(pool.cs, return pool.GetEntrySnapshot(*Assert(pool.GetEntry(child_txid))))};
+        BOOST_CHECK_EQUAL(single.modified_fee, in_snapshot.modified_fee);
+        BOOST_CHECK_EQUAL(single.ancestor_count, in_snapshot.ancestor_count);
+        BOOST_CHECK(single.depends == in_snapshot.depends);
+        BOOST_CHECK(single.bip125_replaceable);
+        BOOST_CHECK(!single.unbroadcast);
+    }
+
+    // The mempool does not keep a snapshot with removed transactions alive.
+    const std::weak_ptr<const MempoolSnapshot> stale{pool.GetSnapshot()};
+    {
+        LOCK2(::cs_main, pool.cs);
+        pool.removeRecursive(CTransaction{child}, REMOVAL_REASON_DUMMY);
+    }
+    BOOST_CHECK(stale.expired());
+    const auto removed{pool.GetSnapshot()};
+    BOOST_CHECK_EQUAL(removed->entries.size(), 1U);
+    BOOST_CHECK(removed->Find(child_txid) == nullptr);
+    BOOST_CHECK(removed->Find(parent_txid)->spent_by.empty());
+    BOOST_CHECK_EQUAL(removed->sequence, WITH_LOCK(pool.cs, return pool.GetSequence()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,133 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <primitives/transaction.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <test/util/txmempool.h>
+#include <txmempool.h>
+#include <txmempoolindex.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <map>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(txmempoolindex_tests, BasicTestingSetup)
+
+namespace {
+using Index = CTxMemPool::indexed_transaction_set;
+
+CTransactionRef RandomTx()
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint{Txid::FromUint256(InsecureRand256()), 0};
+    tx.vin[0].scriptWitness.stack.push_back({uint8_t(InsecureRandBits(8))});
+    tx.vout.resize(1 + InsecureRandRange(3));
+    for (auto& out : tx.vout) out.nValue = InsecureRandRange(1000);
+    return MakeTransactionRef(tx);
+}
+
+template <typename Compare>
+void CheckSorted(const std::vector<const CTxMemPoolEntry*>& sorted)
+{
+    // The descendant score order holds both ways for entries with the same
+    // score and time, so only check that no entry strictly sorts before the
+    // previous one.
+    for (size_t i{1}; i < sorted.size(); ++i) {
+        BOOST_CHECK(!Compare{}(*sorted[i], *sorted[i - 1]) || Compare{}(*sorted[i - 1], *sorted[i]));
+    }
+}
+
+void CheckIndex(const Index& index, const std::map<Txid, CTransactionRef>& expected)
+{
+    BOOST_CHECK_EQUAL(index.size(), expected.size());
+    size_t count{0};
+    for (auto it{index.begin()}; it != index.end(); ++it, ++count) {
+        BOOST_CHECK(expected.count(it->GetTx().GetHash()));
+    }
+    BOOST_CHECK_EQUAL(count, expected.size());
+    for (const auto& [txid, tx] : expected) {
+        const auto it{index.find(txid.ToUint256())};
+        BOOST_REQUIRE(it != index.end());
+        BOOST_CHECK(index.find_by_wtxid(tx->GetWitnessHash().ToUint256()) == it);
+    }
+
+    std::vector<const CTxMemPoolEntry*> by_descendant_score;
+    for (const auto& it : index.sorted_by_descendant_score()) by_descendant_score.push_back(&*it);
+    BOOST_CHECK_EQUAL(by_descendant_score.size(), expected.size());
+    CheckSorted<CompareTxMemPoolEntryByDescendantScore>(by_descendant_score);
+    if (!index.empty()) BOOST_CHECK(&*index.worst_by_descendant_score() == by_descendant_score.front());
+
+    const auto& by_ancestor_score{index.by_ancestor_score()};
+    BOOST_CHECK_EQUAL(by_ancestor_score.size(), expected.size());
+    CheckSorted<CompareTxMemPoolEntryByAncestorFee>({by_ancestor_score.begin(), by_ancestor_score.end()});
+
+    // Visiting by entry time finds exactly the entries older than the limit.
+    const auto limit{std::chrono::seconds{InsecureRandRange(1000)}};
+    size_t older{0}, visited{0};
+    for (const auto& it : index.sorted_by_descendant_score()) older += it->GetTime() < limit;
+    index.visit_by_entry_time([&](const CTxMemPoolEntry& entry) { return entry.GetTime() < limit; },
+                              [&](Index::const_iterator it) { ++visited; BOOST_CHECK(it->GetTime() < limit); });
+    BOOST_CHECK_EQUAL(visited, older);
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(random_operations)
+{
+    Index index;
+    std::map<Txid, CTransactionRef> expected;
+    TestMemPoolEntryHelper entry;
+
+    for (int i = 0; i < 5'000; ++i) {
+        switch (InsecureRandRange(4)) {
+        case 0:
+        case 1: {
+            const auto tx{RandomTx()};
+            // Few distinct fees and times, so that many entries compare equal.
+            const auto [it, inserted]{index.emplace(CTxMemPoolEntry::ExplicitCopy, entry.Fee(InsecureRandRange(10) * 100).Time(NodeSeconds{std::chrono::seconds{InsecureRandRange(1000)}}).FromTx(tx))};
+            BOOST_CHECK(inserted);
+            BOOST_CHECK(it->GetSharedTx() == tx);
+            expected.emplace(tx->GetHash(), tx);
+            // Inserting the same transaction again fails.
+            BOOST_CHECK(!index.emplace(CTxMemPoolEntry::ExplicitCopy, entry.FromTx(tx)).second);
+            break;
+        }
+        case 2: {
+            if (expected.empty()) break;
+            auto pick{expected.begin()};
+            std::advance(pick, InsecureRandRange(expected.size()));
+            index.modify(index.find(pick->first.ToUint256()), [](CTxMemPoolEntry& e) {
+                e.UpdateModifiedFee(CAmount(InsecureRandRange(1000)) - 500);
+                e.UpdateDescendantState(0, CAmount(InsecureRandRange(1000)) - 500, 0);
+                e.UpdateAncestorState(0, CAmount(InsecureRandRange(1000)) - 500, 0, 0);
+            });
+            break;
+        }
+        case 3: {
+            if (expected.empty()) break;
+            auto pick{expected.begin()};
+            std::advance(pick, InsecureRandRange(expected.size()));
+            index.erase(index.find(pick->first.ToUint256()));
+            BOOST_CHECK(index.find(pick->first.ToUint256()) == index.end());
+            BOOST_CHECK(!index.count_by_wtxid(pick->second->GetWitnessHash().ToUint256()));
+            expected.erase(pick);
+            break;
+        }
+        }
+        if (i % 500 == 0) CheckIndex(index, expected);
+    }
+    CheckIndex(index, expected);
+
+    while (!expected.empty()) {
+        index.erase(index.find(expected.begin()->first.ToUint256()));
+        expected.erase(expected.begin());
+    }
+    CheckIndex(index, expected);
+    BOOST_CHECK(index.begin() == index.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <addresstype.h>
 #include <consensus/validation.h>
 #include <key_io.h>
 #include <policy/v3_policy.h>
@@ -52,6 +53,53 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_reject_coinbase, TestChain100Setup)
     BOOST_CHECK(result.m_state.GetResult() == TxValidationResult::TX_CONSENSUS);
 }
 
+/**
+ * Ensure that transactions checked in a batch get the same results as one after the other.
+ */
+BOOST_FIXTURE_TEST_CASE(tx_mempool_process_transactions, TestChain100Setup)
+{
+    const CScript spk{GetScriptForDestination(WitnessV0KeyHash(coinbaseKey.GetPubKey()))};
+    const CTransactionRef fanout{MakeTransactionRef(CreateValidMempoolTransaction(
+        {m_coinbase_txns[0]}, {COutPoint{m_coinbase_txns[0]->GetHash(), 0}}, /*input_height=*/1, {coinbaseKey},
+        {CTxOut{10 * COIN, spk}, CTxOut{10 * COIN, spk}, CTxOut{10 * COIN, spk}}, /*submit=*/false))};
+    CreateAndProcessBlock({CMutableTransaction{*fanout}}, spk);
+    const int fanout_height{WITH_LOCK(cs_main, return m_node.chainman->ActiveHeight())};
+
+    const auto spend{[&](const CTransactionRef& parent, uint32_t vout, int height) {
+        return MakeTransactionRef(CreateValidMempoolTransaction(parent, vout, height, coinbaseKey, spk, 9 * COIN, /*submit=*/false));
+    }};
+    const CTransactionRef tx_valid{spend(fanout, 0, fanout_height)};
+    CMutableTransaction mtx_bad_sig{*spend(fanout, 1, fanout_height)};
+    mtx_bad_sig.vin[0].scriptWitness.stack[0][10] ^= 1;
+    const CTransactionRef tx_bad_sig{MakeTransactionRef(mtx_bad_sig)};
+    // Spends an output of tx_valid, so it can only be checked once tx_valid was added.
+    const CTransactionRef tx_child{MakeTransactionRef(CreateValidMempoolTransaction(
+        {tx_valid}, {COutPoint{tx_valid->GetHash(), 0}}, fanout_height, {coinbaseKey}, {CTxOut{8 * COIN, spk}}, /*submit=*/false))};
+    const CTransactionRef tx_other{spend(fanout, 2, fanout_height)};
+    CMutableTransaction mtx_coinbase;
+    mtx_coinbase.vin.resize(1);
+    mtx_coinbase.vout.emplace_back(1 * COIN, spk);
+    const CTransactionRef tx_coinbase{MakeTransactionRef(mtx_coinbase)};
+
+    const std::vector<CTransactionRef> txs{tx_coinbase, tx_valid, tx_bad_sig, tx_child, tx_other, tx_valid};
+    const auto results{m_node.chainman->ProcessTransactions(txs)};
+    BOOST_REQUIRE_EQUAL(results.size(), txs.size());
+
+    BOOST_CHECK_EQUAL(results[0].m_state.GetRejectReason(), "bad-cb-length");
+    BOOST_CHECK(results[1].m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK(results[2].m_state.GetResult() == TxValidationResult::TX_CONSENSUS);
+    BOOST_CHECK(results[2].m_state.GetRejectReason().starts_with("mandatory-script-verify-flag-failed"));
+    BOOST_CHECK(results[3].m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK(results[4].m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK_EQUAL(results[5].m_state.GetRejectReason(), "txn-already-in-mempool");
+
+    LOCK(m_node.mempool->cs);
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 3U);
+    for (const auto& tx : {tx_valid, tx_child, tx_other}) {
+        BOOST_CHECK(m_node.mempool->exists(GenTxid::Txid(tx->GetHash())));
+    }
+}
+
 // Generate a number of random, nonexistent outpoints.
 static inline std::vector<COutPoint> random_outpoints(size_t num_outpoints) {
     std::vector<COutPoint> outpoints;
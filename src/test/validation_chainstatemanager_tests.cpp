@@ -4,6 +4,7 @@
 //
 #include <chainparams.h>
 #include <consensus/validation.h>
+#include <kernel/coinstats.h>
 #include <kernel/disconnected_transactions.h>
 #include <node/kernel_notifications.h>
 #include <node/utxo_snapshot.h>
@@ -158,6 +159,32 @@ BOOST_FIXTURE_TEST_CASE(chainstatemanager_rebalance_caches, TestChain100Setup)
     BOOST_CHECK_CLOSE(c2.m_coinsdb_cache_size_bytes, max_cache * 0.95, 1);
 }
 
+//! Test that the hash of a written UTXO snapshot matches the HASH_SERIALIZED
+//! UTXO set hash when the coins database does not return the outputs of a
+//! transaction in numeric order (keys encode the output index as a VARINT, so
+//! 16512 sorts before 16511).
+BOOST_FIXTURE_TEST_CASE(chainstatemanager_snapshot_hash_output_order, TestChain100Setup)
+{
+    Chainstate& chainstate{m_node.chainman->ActiveChainstate()};
+    const Txid txid{Txid::FromUint256(InsecureRand256())};
+    {
+        LOCK(::cs_main);
+        for (const uint32_t n : {0U, 127U, 128U, 16511U, 16512U, 2113663U, 2113664U}) {
+            Coin coin{CTxOut{n + 1, CScript{} << OP_TRUE}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false};
+            chainstate.CoinsTip().AddCoin(COutPoint{txid, n}, std::move(coin), /*possible_overwrite=*/false);
+        }
+    }
+
+    const fs::path snapshot_path{m_path_root / "test_snapshot_order.dat"};
+    AutoFile outfile{fsbridge::fopen(snapshot_path, "wb")};
+    const UniValue result{CreateUTXOSnapshot(m_node, chainstate, outfile, snapshot_path, snapshot_path)};
+
+    const auto stats{WITH_LOCK(::cs_main, return kernel::ComputeUTXOStats(kernel::CoinStatsHashType::HASH_SERIALIZED, &chainstate.CoinsDB(), m_node.chainman->m_blockman))};
+    BOOST_REQUIRE(stats);
+    BOOST_CHECK_EQUAL(result["txoutset_hash"].get_str(), stats->hashSerialized.ToString());
+    BOOST_CHECK_EQUAL(result["coins_written"].getInt<uint64_t>(), stats->coins_count);
+}
+
 struct SnapshotTestSetup : TestChain100Setup {
     // Run with coinsdb on the filesystem to support, e.g., moving invalidated
     // chainstate dirs to "*_invalid".
@@ -51,7 +51,7 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
 
         for (int i{0}; i < 1000; ++i) {
             const COutPoint res = AddTestCoin(view);
-            BOOST_CHECK_EQUAL(view.AccessCoin(res).DynamicMemoryUsage(), COIN_SIZE);
+            BOOST_CHECK_EQUAL(view.AccessCoin(res).ToCoin().DynamicMemoryUsage(), COIN_SIZE);
         }
 
         BOOST_CHECK_EQUAL(
@@ -79,7 +79,7 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
     for (int i{0}; i < COINS_UNTIL_CRITICAL; ++i) {
         const COutPoint res = AddTestCoin(view);
         print_view_mem_usage(view);
-        BOOST_CHECK_EQUAL(view.AccessCoin(res).DynamicMemoryUsage(), COIN_SIZE);
+        BOOST_CHECK_EQUAL(view.AccessCoin(res).ToCoin().DynamicMemoryUsage(), COIN_SIZE);
 
         // adding first coin causes the MemoryResource to allocate one 256 KiB chunk of memory,
         // pushing us immediately over to LARGE
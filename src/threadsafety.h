@@ -7,6 +7,7 @@
 #define BITCOIN_THREADSAFETY_H
 
 #include <mutex>
+#include <shared_mutex>
 
 #ifdef __clang__
 // TL;DR Add GUARDED_BY(mutex) to member variables. The others are
@@ -74,4 +75,31 @@ public:
     ~StdLockGuard() UNLOCK_FUNCTION() {}
 };
 
+// StdSharedMutex provides an annotated version of std::shared_mutex for us,
+// and should only be used when sync.h Mutex/LOCK/etc are not usable.
+class LOCKABLE StdSharedMutex : public std::shared_mutex
+{
+public:
+#ifdef __clang__
+    //! For negative capabilities in the Clang Thread Safety Analysis.
+    const StdSharedMutex& operator!() const { return *this; }
+#endif // __clang__
+};
+
+// StdExclusiveLock and StdSharedLock provide annotated versions of
+// std::unique_lock and std::shared_lock over a StdSharedMutex.
+class SCOPED_LOCKABLE StdExclusiveLock : public std::unique_lock<StdSharedMutex>
+{
+public:
+    explicit StdExclusiveLock(StdSharedMutex& cs) EXCLUSIVE_LOCK_FUNCTION(cs) : std::unique_lock<StdSharedMutex>(cs) {}
+    ~StdExclusiveLock() UNLOCK_FUNCTION() {}
+};
+
+class SCOPED_LOCKABLE StdSharedLock : public std::shared_lock<StdSharedMutex>
+{
+public:
+    explicit StdSharedLock(StdSharedMutex& cs) SHARED_LOCK_FUNCTION(cs) : std::shared_lock<StdSharedMutex>(cs) {}
+    ~StdSharedLock() UNLOCK_FUNCTION() {}
+};
+
 #endif // BITCOIN_THREADSAFETY_H
@@ -0,0 +1,153 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TXACCEPTWORKERS_H
+#define BITCOIN_TXACCEPTWORKERS_H
+
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/thread.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/**
+ * Worker threads that check a batch of transactions for mempool acceptance
+ * without holding cs_main.
+ *
+ * ChainstateManager::ProcessTransactions() uses Run() for the checks that do
+ * not need the chainstate or the mempool: the context-free checks, and
+ * verifying the scripts against the outputs the transactions spend. Each
+ * transaction is checked by one thread, and the calling thread joins in as
+ * well, so that a batch is also checked without any worker threads. The
+ * threads are only started by the first batch of more than one transaction.
+ */
+class TxAcceptWorkers
+{
+private:
+    //! Serializes Run() calls, which share the state of the current round.
+    Mutex m_control_mutex;
+
+    //! Mutex to protect the inner state
+    Mutex m_mutex;
+
+    //! Worker threads block on this when out of work
+    std::condition_variable m_worker_cv;
+
+    //! Master thread blocks on this while workers are still checking
+    std::condition_variable m_master_cv;
+
+    //! Incremented for every new round of work, so workers know to wake up.
+    uint64_t m_generation GUARDED_BY(m_mutex){0};
+
+    //! The number of workers that have not finished the current round yet.
+    int m_active_workers GUARDED_BY(m_mutex){0};
+
+    bool m_request_stop GUARDED_BY(m_mutex){false};
+
+    /**
+     * State of the current round. Written by the master thread before
+     * m_generation is incremented and read by the workers afterwards, so access
+     * is ordered by m_mutex even though the members are not guarded by it.
+     */
+    const std::function<void(size_t)>* m_job{nullptr};
+    size_t m_count{0};
+
+    //! Index of the next transaction to be claimed by a thread.
+    std::atomic<size_t> m_next{0};
+
+    //! Number of worker threads to start once they are needed.
+    const int m_worker_threads_num;
+    std::vector<std::thread> m_worker_threads GUARDED_BY(m_control_mutex);
+
+    /** Run the job until there is nothing left to claim. */
+    void Work()
+    {
+        for (size_t i{m_next.fetch_add(1, std::memory_order_relaxed)}; i < m_count; i = m_next.fetch_add(1, std::memory_order_relaxed)) {
+            (*m_job)(i);
+        }
+    }
+
+    void Loop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        uint64_t generation{0};
+        while (true) {
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_worker_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_generation != generation || m_request_stop; });
+                if (m_request_stop) return;
+                generation = m_generation;
+            }
+            Work();
+            {
+                LOCK(m_mutex);
+                if (--m_active_workers == 0) m_master_cv.notify_one();
+            }
+        }
+    }
+
+public:
+    explicit TxAcceptWorkers(int worker_threads_num) : m_worker_threads_num{worker_threads_num} {}
+
+    // Since this class manages its own resources, which is a thread
+    // pool `m_worker_threads`, copy and move operations are not appropriate.
+    TxAcceptWorkers(const TxAcceptWorkers&) = delete;
+    TxAcceptWorkers& operator=(const TxAcceptWorkers&) = delete;
+    TxAcceptWorkers(TxAcceptWorkers&&) = delete;
+    TxAcceptWorkers& operator=(TxAcceptWorkers&&) = delete;
+
+    /**
+     * Call job(i) for every i below count, on the worker threads and the
+     * calling thread, and return once all calls have returned. Calls for
+     * different i may run concurrently.
+     */
+    void Run(size_t count, const std::function<void(size_t)>& job) EXCLUSIVE_LOCKS_REQUIRED(!m_control_mutex, !m_mutex)
+    {
+        if (count == 0) return;
+        LOCK(m_control_mutex);
+        m_job = &job;
+        m_count = count;
+        m_next.store(0, std::memory_order_relaxed);
+        if (count > 1 && m_worker_threads.empty()) {
+            m_worker_threads.reserve(m_worker_threads_num);
+            for (int n = 0; n < m_worker_threads_num; ++n) {
+                m_worker_threads.emplace_back(&util::TraceThread, strprintf("txaccept.%i", n), [this] { Loop(); });
+            }
+        }
+        if (count > 1 && !m_worker_threads.empty()) {
+            {
+                LOCK(m_mutex);
+                m_active_workers = m_worker_threads.size();
+                ++m_generation;
+            }
+            m_worker_cv.notify_all();
+        }
+
+        // The master participates in the checks instead of sitting idle.
+        Work();
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_master_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_active_workers == 0; });
+        }
+        m_job = nullptr;
+        m_count = 0;
+    }
+
+    ~TxAcceptWorkers() EXCLUSIVE_LOCKS_REQUIRED(!m_control_mutex, !m_mutex)
+    {
+        WITH_LOCK(m_mutex, m_request_stop = true);
+        m_worker_cv.notify_all();
+        LOCK(m_control_mutex);
+        for (std::thread& t : m_worker_threads) {
+            t.join();
+        }
+    }
+};
+
+#endif // BITCOIN_TXACCEPTWORKERS_H
@@ -12,8 +12,11 @@
 #include <random.h>
 #include <serialize.h>
 #include <uint256.h>
+#include <util/thread.h>
+#include <util/time.h>
 #include <util/vector.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <iterator>
@@ -46,33 +49,183 @@ struct CoinEntry {
 
 } // namespace
 
+//! Lower bound on the initial size of the lookup filter.
+static constexpr size_t MIN_FILTER_CAPACITY{1 << 16};
+//! Bytes per coin in the database, to estimate the number of coins from its
+//! size. Underestimates, so that the filter tends to be too large rather than
+//! built twice.
+static constexpr size_t FILTER_BYTES_PER_COIN_ESTIMATE{40};
+//! Number of coins added to the filter being built per m_filter_mutex lock.
+static constexpr size_t FILTER_BUILD_CHUNK{1000};
+
 CCoinsViewDB::CCoinsViewDB(DBParams db_params, CoinsViewOptions options) :
     m_db_params{std::move(db_params)},
     m_options{std::move(options)},
-    m_db{std::make_unique<CDBWrapper>(m_db_params)} { }
+    m_db{std::make_unique<CDBWrapper>(m_db_params)}
+{
+    if (m_options.lookup_filter) {
+        StartFilterBuild(FilterCapacity());
+    }
+}
+
+CCoinsViewDB::~CCoinsViewDB()
+{
+    StopFilterBuild();
+}
 
 void CCoinsViewDB::ResizeCache(size_t new_cache_size)
 {
     // We can't do this operation with an in-memory DB since we'll lose all the coins upon
     // reset.
     if (!m_db_params.memory_only) {
+        // The filter builder iterates over the database.
+        bool was_building;
+        {
+            StdSharedLock lock{m_filter_mutex};
+            was_building = m_filter_building;
+        }
+        StopFilterBuild();
         // Have to do a reset first to get the original `m_db` state to release its
         // filesystem lock.
         m_db.reset();
         m_db_params.cache_bytes = new_cache_size;
         m_db_params.wipe_data = false;
         m_db = std::make_unique<CDBWrapper>(m_db_params);
+        if (was_building) {
+            StartFilterBuild(FilterCapacity());
+        }
     }
 }
 
+size_t CCoinsViewDB::FilterCapacity() const
+{
+    // Leave room for the coins set to grow before the filter is rebuilt.
+    return std::max(MIN_FILTER_CAPACITY, EstimateSize() / FILTER_BYTES_PER_COIN_ESTIMATE * 5 / 4);
+}
+
+bool CCoinsViewDB::MayHaveCoin(const COutPoint& outpoint) const
+{
+    if (!m_options.lookup_filter) return true;
+    StdSharedLock lock{m_filter_mutex};
+    return !m_filter || m_filter->MayContain(m_filter_hasher(outpoint));
+}
+
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    if (!MayHaveCoin(outpoint)) return false;
     return m_db->Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    if (!MayHaveCoin(outpoint)) return false;
     return m_db->Exists(CoinEntry(&outpoint));
 }
 
+bool CCoinsViewDB::HasLookupFilter() const
+{
+    StdSharedLock lock{m_filter_mutex};
+    return m_filter != nullptr;
+}
+
+size_t CCoinsViewDB::LookupFilterCapacity() const
+{
+    StdSharedLock lock{m_filter_mutex};
+    return m_filter ? m_filter->Capacity() : 0;
+}
+
+void CCoinsViewDB::WaitForLookupFilter()
+{
+    if (m_filter_thread.joinable()) m_filter_thread.join();
+}
+
+void CCoinsViewDB::AddToFilter(const std::vector<uint64_t>& hashes)
+{
+    if (!m_options.lookup_filter || hashes.empty()) return;
+    bool rebuild{false};
+    {
+        StdExclusiveLock lock{m_filter_mutex};
+        for (const uint64_t hash : hashes) {
+            if (m_filter && !m_filter->Insert(hash)) {
+                LogPrint(BCLog::COINDB, "Coins lookup filter is full after %u coins\n", m_filter->Size());
+                rebuild = !m_filter_building;
+                m_filter.reset();
+            }
+            if (m_next_filter && !m_next_filter_full && !m_next_filter->Insert(hash)) m_next_filter_full = true;
+        }
+    }
+    // The new filter's snapshot of the database is only taken once the
+    // current write is complete, so the coins written from here on are in it.
+    // As spent coins are never removed, the filter fills up with the coins
+    // written over time, so it is sized for the coins in the database rather
+    // than grown.
+    if (rebuild) StartFilterBuild(FilterCapacity());
+}
+
+void CCoinsViewDB::StartFilterBuild(size_t capacity)
+{
+    if (m_filter_thread.joinable()) m_filter_thread.join();
+    {
+        StdExclusiveLock lock{m_filter_mutex};
+        m_filter_building = true;
+    }
+    m_filter_thread = std::thread{&util::TraceThread, "coinsfilter", [this, capacity] { BuildFilter(capacity); }};
+}
+
+void CCoinsViewDB::StopFilterBuild()
+{
+    m_filter_interrupt = true;
+    if (m_filter_thread.joinable()) m_filter_thread.join();
+    m_filter_interrupt = false;
+}
+
+void CCoinsViewDB::BuildFilter(size_t capacity)
+{
+    const auto start{SteadyClock::now()};
+    bool complete{false};
+    while (!complete && !m_filter_interrupt) {
+        std::unique_ptr<CDBIterator> cursor;
+        {
+            LOCK(m_filter_write_mutex);
+            StdExclusiveLock lock{m_filter_mutex};
+            m_next_filter = std::make_unique<CuckooFilter>(capacity);
+            m_next_filter_full = false;
+            cursor.reset(m_db->NewIterator());
+        }
+        cursor->Seek(DB_COIN);
+        std::vector<uint64_t> hashes;
+        hashes.reserve(FILTER_BUILD_CHUNK);
+        while (!m_filter_interrupt) {
+            COutPoint outpoint;
+            CoinEntry entry(&outpoint);
+            const bool valid{cursor->Valid() && cursor->GetKey(entry) && entry.key == DB_COIN};
+            if (valid) {
+                hashes.push_back(m_filter_hasher(outpoint));
+                cursor->Next();
+                if (hashes.size() < FILTER_BUILD_CHUNK) continue;
+            }
+            StdExclusiveLock lock{m_filter_mutex};
+            for (const uint64_t hash : hashes) {
+                if (!m_next_filter_full && !m_next_filter->Insert(hash)) m_next_filter_full = true;
+            }
+            hashes.clear();
+            if (m_next_filter_full) break;
+            if (!valid) {
+                LogPrintf("Built coins lookup filter for %u coins (%.1f MiB) in %.2fs\n", m_next_filter->Size(),
+                          m_next_filter->DynamicMemoryUsage() * (1.0 / (1 << 20)), Ticks<SecondsDouble>(SteadyClock::now() - start));
+                m_filter = std::move(m_next_filter);
+                complete = true;
+                break;
+            }
+        }
+        if (!complete && !m_filter_interrupt) {
+            LogPrint(BCLog::COINDB, "Coins lookup filter with room for %u coins is too small, retrying\n", capacity);
+            capacity *= 2;
+        }
+    }
+    StdExclusiveLock lock{m_filter_mutex};
+    m_next_filter.reset();
+    m_filter_building = false;
+}
+
 uint256 CCoinsViewDB::GetBestBlock() const {
     uint256 hashBestChain;
     if (!m_db->Read(DB_BEST_BLOCK, hashBestChain))
@@ -88,7 +241,7 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     return vhashHeadBlocks;
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase) {
+bool CCoinsViewDB::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashBlock) {
     CDBBatch batch(*m_db);
     size_t count = 0;
     size_t changed = 0;
@@ -114,19 +267,27 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, boo
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, Vector(hashBlock, old_tip));
 
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
-        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+    // Coins are added to the lookup filter before they are written, so that
+    // concurrent lookups never miss a coin that is in the database.
+    LOCK(m_filter_write_mutex);
+    std::vector<uint64_t> new_coins;
+    for (auto it{cursor.Begin()}; it != cursor.End();) {
+        if (it->second.IsDirty()) {
             CoinEntry entry(&it->first);
-            if (it->second.coin.IsSpent())
+            if (it->second.coin.IsSpent()) {
                 batch.Erase(entry);
-            else
-                batch.Write(entry, it->second.coin);
+            } else {
+                batch.Write(entry, it->second.coin.ToCoin());
+                if (m_options.lookup_filter) new_coins.push_back(m_filter_hasher(it->first));
+            }
             changed++;
         }
         count++;
-        it = erase ? mapCoins.erase(it) : std::next(it);
+        it = cursor.NextAndMaybeErase(*it);
         if (batch.SizeEstimate() > m_options.batch_write_bytes) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
+            AddToFilter(new_coins);
+            new_coins.clear();
             m_db->WriteBatch(batch);
             batch.Clear();
             if (m_options.simulate_crash_ratio) {
@@ -144,6 +305,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, boo
     batch.Write(DB_BEST_BLOCK, hashBlock);
 
     LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
+    AddToFilter(new_coins);
     bool ret = m_db->WriteBatch(batch);
     LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
     return ret;
@@ -174,9 +336,22 @@ private:
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
 
+    //! Cache the key of the current record, or invalidate the cursor past the last one.
+    void CacheKey();
+
     friend class CCoinsViewDB;
 };
 
+void CCoinsViewDBCursor::CacheKey()
+{
+    CoinEntry entry(&keyTmp.second);
+    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
+        keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
+    } else {
+        keyTmp.first = entry.key;
+    }
+}
+
 std::unique_ptr<CCoinsViewCursor> CCoinsViewDB::Cursor() const
 {
     auto i = std::make_unique<CCoinsViewDBCursor>(
@@ -186,16 +361,24 @@ std::unique_ptr<CCoinsViewCursor> CCoinsViewDB::Cursor() const
        that restriction.  */
     i->pcursor->Seek(DB_COIN);
     // Cache key of first record
-    if (i->pcursor->Valid()) {
-        CoinEntry entry(&i->keyTmp.second);
-        i->pcursor->GetKey(entry);
-        i->keyTmp.first = entry.key;
-    } else {
-        i->keyTmp.first = 0; // Make sure Valid() and GetKey() return false
-    }
+    i->CacheKey();
     return i;
 }
 
+std::vector<std::unique_ptr<CCoinsViewCursor>> CCoinsViewDB::Cursors(size_t num_ranges) const
+{
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    const uint256 best_block{GetBestBlock()};
+    // Coin keys start with DB_COIN and the txid, so the outputs of a
+    // transaction are never split across ranges.
+    for (auto& iterator : m_db->NewRangeIterators(DB_COIN, num_ranges)) {
+        auto cursor{std::make_unique<CCoinsViewDBCursor>(iterator.release(), best_block)};
+        cursor->CacheKey();
+        cursors.push_back(std::move(cursor));
+    }
+    return cursors;
+}
+
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 {
     // Return cached key
@@ -219,10 +402,5 @@ bool CCoinsViewDBCursor::Valid() const
 void CCoinsViewDBCursor::Next()
 {
     pcursor->Next();
-    CoinEntry entry(&keyTmp.second);
-    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
-        keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
-    } else {
-        keyTmp.first = entry.key;
-    }
+    CacheKey();
 }
@@ -7,15 +7,20 @@
 #define BITCOIN_TXDB_H
 
 #include <coins.h>
+#include <cuckoofilter.h>
 #include <dbwrapper.h>
 #include <kernel/cs_main.h>
 #include <sync.h>
+#include <threadsafety.h>
 #include <util/fs.h>
+#include <util/hasher.h>
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <thread>
 #include <vector>
 
 class COutPoint;
@@ -39,6 +44,8 @@ static const int64_t nMaxTxIndexCache = 1024;
 static const int64_t max_filter_index_cache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! -coinslookupfilter default
+static constexpr bool DEFAULT_COINS_LOOKUP_FILTER{false};
 
 //! User-controlled performance and debug options.
 struct CoinsViewOptions {
@@ -47,6 +54,9 @@ struct CoinsViewOptions {
     //! If non-zero, randomly exit when the database is flushed with (1/ratio)
     //! probability.
     int simulate_crash_ratio = 0;
+    //! Whether to keep a filter over the coins in the database in memory, to
+    //! answer lookups of missing coins without reading the database.
+    bool lookup_filter = false;
 };
 
 /** CCoinsView backed by the coin database (chainstate/) */
@@ -56,25 +66,72 @@ protected:
     DBParams m_db_params;
     CoinsViewOptions m_options;
     std::unique_ptr<CDBWrapper> m_db;
+
+    /**
+     * Filter over the coins in the database, if enabled with
+     * CoinsViewOptions::lookup_filter. It is built on a background thread
+     * after startup, and all coins written after that are added to it. Spent
+     * coins are not removed from it. When it is full, it is discarded and a
+     * larger one is built.
+     */
+    const SaltedOutpointHasher m_filter_hasher;
+    //! Guards the filters. Held shared for lookups.
+    mutable StdSharedMutex m_filter_mutex;
+    //! Null while there is no complete filter.
+    std::unique_ptr<CuckooFilter> m_filter GUARDED_BY(m_filter_mutex);
+    //! The filter being built, which also receives the coins written meanwhile.
+    std::unique_ptr<CuckooFilter> m_next_filter GUARDED_BY(m_filter_mutex);
+    bool m_next_filter_full GUARDED_BY(m_filter_mutex){false};
+    bool m_filter_building GUARDED_BY(m_filter_mutex){false};
+    //! Held while writing to the database, and while the filter builder
+    //! takes the database snapshot it scans, so that every written coin is
+    //! either in that snapshot or added to the filter being built.
+    Mutex m_filter_write_mutex;
+    std::thread m_filter_thread;
+    std::atomic<bool> m_filter_interrupt{false};
+
+    //! Number of coins a new filter is built with room for.
+    size_t FilterCapacity() const;
+    bool MayHaveCoin(const COutPoint& outpoint) const EXCLUSIVE_LOCKS_REQUIRED(!m_filter_mutex);
+    void AddToFilter(const std::vector<uint64_t>& hashes) EXCLUSIVE_LOCKS_REQUIRED(m_filter_write_mutex, !m_filter_mutex);
+    void StartFilterBuild(size_t capacity) EXCLUSIVE_LOCKS_REQUIRED(!m_filter_mutex);
+    void StopFilterBuild();
+    void BuildFilter(size_t capacity) EXCLUSIVE_LOCKS_REQUIRED(!m_filter_write_mutex, !m_filter_mutex);
+
 public:
     explicit CCoinsViewDB(DBParams db_params, CoinsViewOptions options);
+    ~CCoinsViewDB() override;
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
-    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true) override;
+    bool BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashBlock) override;
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
+    //! Cursors over ranges holding roughly the same amount of coins on disk, see CDBWrapper::NewRangeIterators().
+    std::vector<std::unique_ptr<CCoinsViewCursor>> Cursors(size_t num_ranges) const override;
 
     //! Whether an unsupported database format is used.
     bool NeedsUpgrade();
     size_t EstimateSize() const override;
 
     //! Dynamically alter the underlying leveldb cache size.
-    void ResizeCache(size_t new_cache_size) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    void ResizeCache(size_t new_cache_size) EXCLUSIVE_LOCKS_REQUIRED(cs_main, !m_filter_mutex);
 
     //! @returns filesystem path to on-disk storage or std::nullopt if in memory.
     std::optional<fs::path> StoragePath() { return m_db->StoragePath(); }
+
+    //! Get statistics of the underlying database.
+    DBStats GetDBStats() const { return m_db->GetStats(); }
+
+    //! Whether lookups are answered by the lookup filter.
+    bool HasLookupFilter() const EXCLUSIVE_LOCKS_REQUIRED(!m_filter_mutex);
+
+    //! Number of coins the lookup filter has room for, or 0 if there is none.
+    size_t LookupFilterCapacity() const EXCLUSIVE_LOCKS_REQUIRED(!m_filter_mutex);
+
+    //! Wait for the lookup filter to be built, if it is being built.
+    void WaitForLookupFilter();
 };
 
 #endif // BITCOIN_TXDB_H
@@ -21,6 +21,7 @@
 #include <util/feefrac.h>
 #include <util/moneystr.h>
 #include <util/overflow.h>
+#include <util/rbf.h>
 #include <util/result.h>
 #include <util/time.h>
 #include <util/trace.h>
@@ -320,7 +321,7 @@ void CTxMemPool::UpdateChildrenForRemoval(txiter it)
     }
 }
 
-void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants)
+void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants, const descendantUpdateMap* ancestorUpdates)
 {
     // For each entry, walk back all ancestors and decrement size associated with this
     // transaction
@@ -343,8 +344,18 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
             }
         }
     }
+    // Each ancestor that stays in the mempool has its descendant state updated
+    // once for all the entries removed below it, rather than once per entry,
+    // and ancestors that are removed too are not updated at all.
+    descendantUpdateMap computedUpdates;
     for (txiter removeIt : entriesToRemove) {
         const CTxMemPoolEntry &entry = *removeIt;
+        // Sever the child links that point to removeIt in the entries for the
+        // parents of removeIt.
+        for (const CTxMemPoolEntry& parent : entry.GetMemPoolParentsConst()) {
+            UpdateChild(mapTx.iterator_to(parent), removeIt, false);
+        }
+        if (ancestorUpdates || entry.GetMemPoolParentsConst().empty()) continue;
         // Since this is a tx that is already in the mempool, we can call CMPA
         // with fSearchForParents = false.  If the mempool is in a consistent
         // state, then using true or false should both be correct, though false
@@ -364,10 +375,16 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         // mempool parents we'd calculate by searching, and it's important that
         // we use the cached notion of ancestor transactions as the set of
         // things to update for removal.
-        auto ancestors{AssumeCalculateMemPoolAncestors(__func__, entry, Limits::NoLimits(), /*fSearchForParents=*/false)};
-        // Note that UpdateAncestorsOf severs the child links that point to
-        // removeIt in the entries for the parents of removeIt.
-        UpdateAncestorsOf(false, removeIt, ancestors);
+        for (txiter ancestorIt : AssumeCalculateMemPoolAncestors(__func__, entry, Limits::NoLimits(), /*fSearchForParents=*/false)) {
+            if (entriesToRemove.count(ancestorIt)) continue;
+            DescendantUpdate& update{computedUpdates[ancestorIt]};
+            update.size -= entry.GetTxSize();
+            update.fee -= entry.GetModifiedFee();
+            --update.count;
+        }
+    }
+    for (const auto& [ancestorIt, update] : ancestorUpdates ? *ancestorUpdates : computedUpdates) {
+        mapTx.modify(ancestorIt, [&](CTxMemPoolEntry& e) { e.UpdateDescendantState(update.size, update.fee, update.count); });
     }
     // After updating all the ancestor sizes, we can now sever the link between each
     // transaction being removed and any mempool children (ie, update CTxMemPoolEntry::m_parents
@@ -434,6 +451,7 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
     // Add to memory pool without checking anything.
     // Used by AcceptToMemoryPool(), which DOES do
     // all the appropriate checks.
+    m_snapshot.reset();
     indexed_transaction_set::iterator newit = mapTx.emplace(CTxMemPoolEntry::ExplicitCopy, entry).first;
 
     // Update transaction for any feeDelta created by PrioritiseTransaction
@@ -489,6 +507,8 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     // We increment mempool sequence value no matter removal reason
     // even if not directly reported below.
     uint64_t mempool_sequence = GetAndIncrementSequence();
+    // Do not keep the transaction alive in a stale snapshot.
+    m_snapshot.reset();
 
     if (reason != MemPoolRemovalReason::BLOCK && m_opts.signals) {
         // Notify clients that a transaction has been removed from the mempool
@@ -838,6 +858,80 @@ std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
     return ret;
 }
 
+std::shared_ptr<const MempoolSnapshot> CTxMemPool::GetSnapshot() const
+{
+    LOCK(cs);
+    if (m_snapshot && m_snapshot->mutations == mapTx.mutations()) return m_snapshot;
+
+    auto snapshot{std::make_shared<MempoolSnapshot>()};
+    snapshot->sequence = m_sequence_number;
+    snapshot->mutations = mapTx.mutations();
+    snapshot->entries.reserve(mapTx.size());
+    snapshot->positions.reserve(mapTx.size());
+    // Parents sort before their children, so the replaceability of all
+    // ancestors is known by the time an entry is copied.
+    for (const auto& it : GetSortedDepthAndScore()) {
+        const CTxMemPoolEntry& e{*it};
+        bool replaceable{SignalsOptInRBF(e.GetTx())};
+        for (const CTxMemPoolEntry& parent : e.GetMemPoolParentsConst()) {
+            replaceable = replaceable || snapshot->entries[snapshot->positions.at(parent.GetTx().GetHash())].bip125_replaceable;
+        }
+        snapshot->positions.emplace(e.GetTx().GetHash(), snapshot->entries.size());
+        snapshot->entries.push_back(MakeEntrySnapshot(e, replaceable));
+    }
+    m_snapshot = std::move(snapshot);
+    return m_snapshot;
+}
+
+MempoolEntrySnapshot CTxMemPool::GetEntrySnapshot(const CTxMemPoolEntry& entry) const
+{
+    AssertLockHeld(cs);
+    bool replaceable{SignalsOptInRBF(entry.GetTx())};
+    if (!replaceable) {
+        for (txiter ancestor : AssumeCalculateMemPoolAncestors(__func__, entry, Limits::NoLimits(), /*fSearchForParents=*/false)) {
+            if (SignalsOptInRBF(ancestor->GetTx())) {
+                replaceable = true;
+                break;
+            }
+        }
+    }
+    return MakeEntrySnapshot(entry, replaceable);
+}
+
+MempoolEntrySnapshot CTxMemPool::MakeEntrySnapshot(const CTxMemPoolEntry& e, bool bip125_replaceable) const
+{
+    AssertLockHeld(cs);
+    std::vector<Txid> depends;
+    depends.reserve(e.GetMemPoolParentsConst().size());
+    for (const CTxMemPoolEntry& parent : e.GetMemPoolParentsConst()) {
+        depends.push_back(parent.GetTx().GetHash());
+    }
+    std::vector<Txid> spent_by;
+    spent_by.reserve(e.GetMemPoolChildrenConst().size());
+    for (const CTxMemPoolEntry& child : e.GetMemPoolChildrenConst()) {
+        spent_by.push_back(child.GetTx().GetHash());
+    }
+    return MempoolEntrySnapshot{
+        .tx = e.GetSharedTx(),
+        .vsize = e.GetTxSize(),
+        .weight = e.GetTxWeight(),
+        .time = e.GetTime(),
+        .height = e.GetHeight(),
+        .descendant_count = e.GetCountWithDescendants(),
+        .descendant_size = e.GetSizeWithDescendants(),
+        .ancestor_count = e.GetCountWithAncestors(),
+        .ancestor_size = e.GetSizeWithAncestors(),
+        .fee = e.GetFee(),
+        .modified_fee = e.GetModifiedFee(),
+        .ancestor_fees = e.GetModFeesWithAncestors(),
+        .descendant_fees = e.GetModFeesWithDescendants(),
+        .depends = std::move(depends),
+        .spent_by = std::move(spent_by),
+        .bip125_replaceable = bip125_replaceable,
+        .unbroadcast = m_unbroadcast_txids.count(e.GetTx().GetHash()) != 0,
+    };
+}
+
 const CTxMemPoolEntry* CTxMemPool::GetEntry(const Txid& txid) const
 {
     AssertLockHeld(cs);
@@ -1027,8 +1121,7 @@ void CCoinsViewMemPool::Reset()
 
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
-    // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(txns_randomized) + cachedInnerUsage;
+    return mapTx.DynamicMemoryUsage() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(txns_randomized) + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveUnbroadcastTx(const uint256& txid, const bool unchecked) {
@@ -1036,6 +1129,7 @@ void CTxMemPool::RemoveUnbroadcastTx(const uint256& txid, const bool unchecked)
 
     if (m_unbroadcast_txids.erase(txid))
     {
+        m_snapshot.reset();
         LogPrint(BCLog::MEMPOOL, "Removed %i from set of unbroadcast txns%s\n", txid.GetHex(), (unchecked ? " before confirmation that txn was sent out" : ""));
     }
 }
@@ -1051,12 +1145,9 @@ void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPool
 int CTxMemPool::Expire(std::chrono::seconds time)
 {
     AssertLockHeld(cs);
-    indexed_transaction_set::index<entry_time>::type::iterator it = mapTx.get<entry_time>().begin();
     setEntries toremove;
-    while (it != mapTx.get<entry_time>().end() && it->GetTime() < time) {
-        toremove.insert(mapTx.project<0>(it));
-        it++;
-    }
+    mapTx.visit_by_entry_time([&](const CTxMemPoolEntry& entry) { return entry.GetTime() < time; },
+                              [&](txiter it) { toremove.insert(it); });
     setEntries stage;
     for (txiter removeit : toremove) {
         CalculateDescendants(removeit, stage);
@@ -1074,6 +1165,8 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry)
 void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
 {
     AssertLockHeld(cs);
+    // The parent and child sets are not covered by mapTx.mutations().
+    m_snapshot.reset();
     CTxMemPoolEntry::Children s;
     if (add && entry->GetMemPoolChildren().insert(*child).second) {
         cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
@@ -1085,6 +1178,8 @@ void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
 void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
 {
     AssertLockHeld(cs);
+    // The parent and child sets are not covered by mapTx.mutations().
+    m_snapshot.reset();
     CTxMemPoolEntry::Parents s;
     if (add && entry->GetMemPoolParents().insert(*parent).second) {
         cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
@@ -1131,7 +1226,7 @@ void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpends
     unsigned nTxnRemoved = 0;
     CFeeRate maxFeeRateRemoved(0);
     while (!mapTx.empty() && DynamicMemoryUsage() > sizelimit) {
-        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+        txiter it = mapTx.worst_by_descendant_score();
 
         // We set the new mempool min fee to the feerate of the removed set, plus the
         // "minimum reasonable fee rate" (ie some value under which we consider txn
@@ -1143,19 +1238,42 @@ void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpends
         maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
 
         setEntries stage;
-        CalculateDescendants(mapTx.project<0>(it), stage);
+        CalculateDescendants(it, stage);
         nTxnRemoved += stage.size();
 
-        std::vector<CTransaction> txn;
+        std::vector<CTransactionRef> txn;
         if (pvNoSpendsRemaining) {
             txn.reserve(stage.size());
             for (txiter iter : stage)
-                txn.push_back(iter->GetTx());
+                txn.push_back(iter->GetSharedTx());
+        }
+        // Unless a descendant also spends a transaction outside of the package,
+        // the ancestors of the package that stay are those of its root, and
+        // each of them loses the whole package: they are found with a single
+        // walk, rather than one for each transaction of the package.
+        descendantUpdateMap ancestorUpdates;
+        const bool singleRoot{std::all_of(stage.begin(), stage.end(), [&](txiter removeIt) {
+            const auto& parents{removeIt->GetMemPoolParentsConst()};
+            return removeIt == it || std::all_of(parents.begin(), parents.end(), [&](const CTxMemPoolEntry& parent) { return stage.count(mapTx.iterator_to(parent)); });
+        })};
+        if (singleRoot && !it->GetMemPoolParentsConst().empty()) {
+            DescendantUpdate packageUpdate;
+            for (txiter removeIt : stage) {
+                packageUpdate.size -= removeIt->GetTxSize();
+                packageUpdate.fee -= removeIt->GetModifiedFee();
+                --packageUpdate.count;
+            }
+            for (txiter ancestorIt : AssumeCalculateMemPoolAncestors(__func__, *it, Limits::NoLimits(), /*fSearchForParents=*/false)) {
+                ancestorUpdates.emplace(ancestorIt, packageUpdate);
+            }
+        }
+        UpdateForRemoveFromMempool(stage, false, singleRoot ? &ancestorUpdates : nullptr);
+        for (txiter removeIt : stage) {
+            removeUnchecked(removeIt, MemPoolRemovalReason::SIZELIMIT);
         }
-        RemoveStaged(stage, false, MemPoolRemovalReason::SIZELIMIT);
         if (pvNoSpendsRemaining) {
-            for (const CTransaction& tx : txn) {
-                for (const CTxIn& txin : tx.vin) {
+            for (const CTransactionRef& tx : txn) {
+                for (const CTxIn& txin : tx->vin) {
                     if (exists(GenTxid::Txid(txin.prevout.hash))) continue;
                     pvNoSpendsRemaining->push_back(txin.prevout);
                 }
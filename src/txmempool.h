@@ -18,25 +18,20 @@
 #include <policy/packages.h>
 #include <primitives/transaction.h>
 #include <sync.h>
+#include <txmempoolindex.h>
 #include <util/epochguard.h>
 #include <util/hasher.h>
 #include <util/result.h>
 #include <util/feefrac.h>
 
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/identity.hpp>
-#include <boost/multi_index/indexed_by.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/sequenced_index.hpp>
-#include <boost/multi_index/tag.hpp>
-#include <boost/multi_index_container.hpp>
-
 #include <atomic>
 #include <map>
+#include <memory>
 #include <optional>
 #include <set>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -53,37 +48,6 @@ static const uint32_t MEMPOOL_HEIGHT = 0x7FFFFFFF;
  */
 bool TestLockPointValidity(CChain& active_chain, const LockPoints& lp) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-// extracts a transaction hash from CTxMemPoolEntry or CTransactionRef
-struct mempoolentry_txid
-{
-    typedef uint256 result_type;
-    result_type operator() (const CTxMemPoolEntry &entry) const
-    {
-        return entry.GetTx().GetHash();
-    }
-
-    result_type operator() (const CTransactionRef& tx) const
-    {
-        return tx->GetHash();
-    }
-};
-
-// extracts a transaction witness-hash from CTxMemPoolEntry or CTransactionRef
-struct mempoolentry_wtxid
-{
-    typedef uint256 result_type;
-    result_type operator() (const CTxMemPoolEntry &entry) const
-    {
-        return entry.GetTx().GetWitnessHash();
-    }
-
-    result_type operator() (const CTransactionRef& tx) const
-    {
-        return tx->GetWitnessHash();
-    }
-};
-
-
 /** \class CompareTxMemPoolEntryByDescendantScore
  *
  *  Sort an entry by max(score/size of entry's tx, score/size with all descendants).
@@ -200,12 +164,6 @@ public:
     }
 };
 
-// Multi_index tag names
-struct descendant_score {};
-struct entry_time {};
-struct ancestor_score {};
-struct index_by_wtxid {};
-
 /**
  * Information about a mempool transaction.
  */
@@ -227,6 +185,59 @@ struct TxMempoolInfo
     int64_t nFeeDelta;
 };
 
+/**
+ * Data of a mempool entry as reported by the RPC and REST interfaces, copied
+ * out of the mempool for a MempoolSnapshot.
+ */
+struct MempoolEntrySnapshot
+{
+    CTransactionRef tx;
+    int32_t vsize;
+    int32_t weight;
+    std::chrono::seconds time;
+    unsigned int height;
+    uint64_t descendant_count;
+    int64_t descendant_size;
+    uint64_t ancestor_count;
+    int64_t ancestor_size;
+    CAmount fee;
+    CAmount modified_fee;
+    CAmount ancestor_fees;
+    CAmount descendant_fees;
+    /** Txids of the in-mempool parents, which this transaction spends from. */
+    std::vector<Txid> depends;
+    /** Txids of the in-mempool children, which spend from this transaction. */
+    std::vector<Txid> spent_by;
+    /** Whether this transaction or any of its in-mempool ancestors signals BIP125 replaceability. */
+    bool bip125_replaceable;
+    bool unbroadcast;
+};
+
+/**
+ * Immutable copy of the mempool entries, so that large RPC and REST results
+ * can be built from it without holding CTxMemPool::cs.
+ *
+ * Obtained with CTxMemPool::GetSnapshot(), which hands out the same snapshot
+ * until the mempool is changed.
+ */
+struct MempoolSnapshot
+{
+    /** The entries, sorted by depth and score like CTxMemPool::entryAll(). */
+    std::vector<MempoolEntrySnapshot> entries;
+    /** Position of each transaction in entries. */
+    std::unordered_map<Txid, size_t, SaltedTxidHasher> positions;
+    /** The mempool sequence number at the time of the snapshot. */
+    uint64_t sequence;
+    /** Number of changes to CTxMemPool::mapTx at the time of the snapshot. */
+    uint64_t mutations;
+
+    const MempoolEntrySnapshot* Find(const Txid& txid) const
+    {
+        const auto it{positions.find(txid)};
+        return it == positions.end() ? nullptr : &entries[it->second];
+    }
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain transactions
  * that may be included in the next block.
@@ -242,7 +253,7 @@ struct TxMempoolInfo
  *
  * CTxMemPool::mapTx, and CTxMemPoolEntry bookkeeping:
  *
- * mapTx is a boost::multi_index that sorts the mempool on 5 criteria:
+ * mapTx is a TxMemPoolIndex that indexes the mempool on 5 criteria:
  * - transaction hash (txid)
  * - witness-transaction hash (wtxid)
  * - descendant feerate [we use max(feerate of tx, feerate of tx with all descendants)]
@@ -319,6 +330,13 @@ protected:
     // is added or removed from the mempool for any reason.
     mutable uint64_t m_sequence_number GUARDED_BY(cs){1};
 
+    //! Most recent snapshot returned by GetSnapshot(). Reset when a change is
+    //! not reflected by mapTx.mutations(), and when transactions are added or
+    //! removed, so that it does not keep removed transactions alive.
+    mutable std::shared_ptr<const MempoolSnapshot> m_snapshot GUARDED_BY(cs);
+
+    MempoolEntrySnapshot MakeEntrySnapshot(const CTxMemPoolEntry& entry, bool bip125_replaceable) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     void trackPackageRemoved(const CFeeRate& rate) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     bool m_load_tried GUARDED_BY(cs){false};
@@ -329,37 +347,10 @@ public:
 
     static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12; // public only for testing
 
-    typedef boost::multi_index_container<
-        CTxMemPoolEntry,
-        boost::multi_index::indexed_by<
-            // sorted by txid
-            boost::multi_index::hashed_unique<mempoolentry_txid, SaltedTxidHasher>,
-            // sorted by wtxid
-            boost::multi_index::hashed_unique<
-                boost::multi_index::tag<index_by_wtxid>,
-                mempoolentry_wtxid,
-                SaltedTxidHasher
-            >,
-            // sorted by fee rate
-            boost::multi_index::ordered_non_unique<
-                boost::multi_index::tag<descendant_score>,
-                boost::multi_index::identity<CTxMemPoolEntry>,
-                CompareTxMemPoolEntryByDescendantScore
-            >,
-            // sorted by entry time
-            boost::multi_index::ordered_non_unique<
-                boost::multi_index::tag<entry_time>,
-                boost::multi_index::identity<CTxMemPoolEntry>,
-                CompareTxMemPoolEntryByEntryTime
-            >,
-            // sorted by fee rate with ancestors
-            boost::multi_index::ordered_non_unique<
-                boost::multi_index::tag<ancestor_score>,
-                boost::multi_index::identity<CTxMemPoolEntry>,
-                CompareTxMemPoolEntryByAncestorFee
-            >
-        >
-    > indexed_transaction_set;
+    using indexed_transaction_set = TxMemPoolIndex<CTxMemPoolEntry, SaltedTxidHasher,
+                                                   CompareTxMemPoolEntryByDescendantScore,
+                                                   CompareTxMemPoolEntryByEntryTime,
+                                                   CompareTxMemPoolEntryByAncestorFee>;
 
     /**
      * This mutex needs to be locked when accessing `mapTx` or other members
@@ -391,7 +382,7 @@ public:
     mutable RecursiveMutex cs;
     indexed_transaction_set mapTx GUARDED_BY(cs);
 
-    using txiter = indexed_transaction_set::nth_index<0>::type::const_iterator;
+    using txiter = indexed_transaction_set::const_iterator;
     std::vector<CTransactionRef> txns_randomized GUARDED_BY(cs); //!< All transactions in mapTx, in random order
 
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
@@ -402,6 +393,14 @@ public:
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
+    /** Change to the descendant state of an entry, for the descendants removed below it. */
+    struct DescendantUpdate {
+        int32_t size{0};
+        CAmount fee{0};
+        int64_t count{0};
+    };
+    typedef std::map<txiter, DescendantUpdate, CompareIteratorByHash> descendantUpdateMap;
+
 
     void UpdateParent(txiter entry, txiter parent, bool add) EXCLUSIVE_LOCKS_REQUIRED(cs);
     void UpdateChild(txiter entry, txiter child, bool add) EXCLUSIVE_LOCKS_REQUIRED(cs);
@@ -667,7 +666,7 @@ public:
     {
         LOCK(cs);
         if (gtxid.IsWtxid()) {
-            return (mapTx.get<index_by_wtxid>().count(gtxid.GetHash()) != 0);
+            return (mapTx.count_by_wtxid(gtxid.GetHash()) != 0);
         }
         return (mapTx.count(gtxid.GetHash()) != 0);
     }
@@ -678,7 +677,7 @@ public:
     txiter get_iter_from_wtxid(const uint256& wtxid) const EXCLUSIVE_LOCKS_REQUIRED(cs)
     {
         AssertLockHeld(cs);
-        return mapTx.project<0>(mapTx.get<index_by_wtxid>().find(wtxid));
+        return mapTx.find_by_wtxid(wtxid);
     }
     TxMempoolInfo info(const GenTxid& gtxid) const;
 
@@ -688,6 +687,16 @@ public:
     std::vector<CTxMemPoolEntryRef> entryAll() const EXCLUSIVE_LOCKS_REQUIRED(cs);
     std::vector<TxMempoolInfo> infoAll() const;
 
+    /**
+     * Return a snapshot of all entries. It is built under cs when the mempool
+     * has changed since the previous call, and shared otherwise, so that
+     * frequent readers do not copy an unchanged mempool again.
+     */
+    std::shared_ptr<const MempoolSnapshot> GetSnapshot() const EXCLUSIVE_LOCKS_REQUIRED(!cs);
+
+    /** Copy the data of a single entry, for callers that look it up under cs instead of building a whole snapshot. */
+    MempoolEntrySnapshot GetEntrySnapshot(const CTxMemPoolEntry& entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     size_t DynamicMemoryUsage() const;
 
     /** Adds a transaction to the unbroadcast set */
@@ -696,7 +705,7 @@ public:
         LOCK(cs);
         // Sanity check the transaction is in the mempool & insert into
         // unbroadcast set.
-        if (exists(GenTxid::Txid(txid))) m_unbroadcast_txids.insert(txid);
+        if (exists(GenTxid::Txid(txid)) && m_unbroadcast_txids.insert(txid).second) m_snapshot.reset();
     };
 
     /** Removes a transaction from the unbroadcast set */
@@ -784,8 +793,9 @@ private:
     void UpdateEntryForAncestors(txiter it, const setEntries &setAncestors) EXCLUSIVE_LOCKS_REQUIRED(cs);
     /** For each transaction being removed, update ancestors and any direct children.
       * If updateDescendants is true, then also update in-mempool descendants'
-      * ancestor state. */
-    void UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants) EXCLUSIVE_LOCKS_REQUIRED(cs);
+      * ancestor state. If ancestorUpdates is given, it holds the changes to the
+      * descendant state of the ancestors that stay, so they are not walked. */
+    void UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants, const descendantUpdateMap* ancestorUpdates = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
     /** Sever link between specified transaction and direct children. */
     void UpdateChildrenForRemoval(txiter entry) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
@@ -0,0 +1,485 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TXMEMPOOLINDEX_H
+#define BITCOIN_TXMEMPOOLINDEX_H
+
+#include <memusage.h>
+#include <uint256.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Positions of an entry in the indexes of a TxMemPoolIndex. Entries hold one
+ * as their mutable m_index_positions member, which only the index uses.
+ */
+struct TxMemPoolIndexPositions {
+    //! Slot in the txid hash table, which is also the iteration order.
+    uint32_t txid_slot{0};
+    //! Position in the descendant score heap.
+    uint32_t descendant_score{0};
+    //! Position in the entry time heap.
+    uint32_t entry_time{0};
+    //! Position in the ancestor score order, or in the entries not sorted yet
+    //! if ANCESTOR_PENDING is set.
+    uint32_t ancestor_score{0};
+};
+
+/**
+ * Container of mempool entries, indexed by txid and wtxid, which also keeps
+ * them ordered by descendant score, entry time and ancestor score.
+ *
+ * It replaces a boost::multi_index_container with two hashed and three
+ * ordered indexes, whose every insertion, removal and modification rebalances
+ * three red-black trees, and whose nodes carry 15 pointers per entry. Here:
+ *
+ * - The txid and wtxid indexes are open-addressing tables of entry pointers,
+ *   laid out like the index of FlatNodeMap.
+ * - The descendant score and entry time orders are binary heaps, which is
+ *   all that eviction and expiry need: TrimToSize() only looks at the worst
+ *   entry, and Expire() at the entries older than a given time.
+ * - The ancestor score order, only walked in full when assembling a block, is
+ *   a sorted vector maintained lazily: entries added or modified since the
+ *   last walk are sorted and merged in on the next one.
+ *
+ * Entries are allocated individually and never move, so iterators and
+ * references to them stay valid until they are erased, as before. Iterating
+ * over the whole container visits the entries in no particular order.
+ */
+template <typename Entry, typename Hasher, typename DescendantScoreCompare, typename EntryTimeCompare, typename AncestorScoreCompare>
+class TxMemPoolIndex
+{
+    static constexpr uint8_t CTRL_EMPTY{0x80};
+    static constexpr uint8_t CTRL_DELETED{0xfe};
+    static constexpr size_t MIN_CAPACITY{16};
+    static constexpr uint32_t ANCESTOR_PENDING{uint32_t{1} << 31};
+
+    static bool IsFull(uint8_t ctrl) { return (ctrl & 0x80) == 0; }
+    /** Maximum number of full and deleted slots before a table is rebuilt (7/8 load factor). */
+    static size_t MaxLoad(size_t capacity) { return capacity - capacity / 8; }
+    static uint8_t HashTag(size_t hash) { return hash & 0x7f; }
+
+    static const uint256& TxidOf(const Entry& entry) { return entry.GetTx().GetHash().ToUint256(); }
+    static const uint256& WtxidOf(const Entry& entry) { return entry.GetTx().GetWitnessHash().ToUint256(); }
+
+    /** Open-addressing hash table of entries, keyed by KEY_OF. */
+    template <const uint256& (*KEY_OF)(const Entry&), bool TRACK_SLOTS>
+    struct HashTable {
+        std::unique_ptr<uint8_t[]> ctrl;
+        std::unique_ptr<Entry*[]> slots;
+        //! Number of slots, zero or a power of two.
+        size_t capacity{0};
+        size_t deleted{0};
+
+        /** Slot holding the entry with the given key, or capacity if there is none. */
+        size_t Find(const Hasher& hasher, const uint256& key) const
+        {
+            if (capacity == 0) return capacity;
+            const size_t hash{hasher(key)};
+            const uint8_t tag{HashTag(hash)};
+            const size_t mask{capacity - 1};
+            for (size_t index{(hash >> 7) & mask};; index = (index + 1) & mask) {
+                if (ctrl[index] == tag && KEY_OF(*slots[index]) == key) return index;
+                if (ctrl[index] == CTRL_EMPTY) return capacity;
+            }
+        }
+
+        /** Insert an entry whose key is not in the table yet, which then holds size entries. */
+        void Insert(const Hasher& hasher, Entry* entry, size_t size)
+        {
+            if (capacity == 0 || size + deleted > MaxLoad(capacity)) {
+                // If enough of the load is tombstones, rebuilding the table at
+                // the same capacity is enough (at most 25/32 full afterwards).
+                Rehash(hasher, capacity == 0 ? MIN_CAPACITY : (size * 32 <= capacity * 25 ? capacity : capacity * 2));
+            }
+            const size_t hash{hasher(KEY_OF(*entry))};
+            const size_t index{FindInsertIndex(hash)};
+            if (ctrl[index] == CTRL_DELETED) --deleted;
+            Place(index, hash, entry);
+        }
+
+        void Erase(size_t index)
+        {
+            assert(index < capacity && IsFull(ctrl[index]));
+            slots[index] = nullptr;
+            // No probe sequence continues past an empty slot, so if the next
+            // slot is empty this one can be made empty too instead of a tombstone.
+            if (ctrl[(index + 1) & (capacity - 1)] == CTRL_EMPTY) {
+                ctrl[index] = CTRL_EMPTY;
+            } else {
+                ctrl[index] = CTRL_DELETED;
+                ++deleted;
+            }
+        }
+
+        /** First full slot at or after index, or capacity if there is none. */
+        size_t NextFull(size_t index) const
+        {
+            while (index < capacity && !IsFull(ctrl[index])) ++index;
+            return index;
+        }
+
+        size_t FindInsertIndex(size_t hash) const
+        {
+            const size_t mask{capacity - 1};
+            size_t index{(hash >> 7) & mask};
+            while (IsFull(ctrl[index])) index = (index + 1) & mask;
+            return index;
+        }
+
+        void Place(size_t index, size_t hash, Entry* entry)
+        {
+            ctrl[index] = HashTag(hash);
+            slots[index] = entry;
+            if constexpr (TRACK_SLOTS) entry->m_index_positions.txid_slot = index;
+        }
+
+        void Rehash(const Hasher& hasher, size_t new_capacity)
+        {
+            assert(new_capacity >= MIN_CAPACITY && (new_capacity & (new_capacity - 1)) == 0);
+            auto old_ctrl{std::move(ctrl)};
+            auto old_slots{std::move(slots)};
+            const size_t old_capacity{capacity};
+
+            ctrl = std::make_unique<uint8_t[]>(new_capacity);
+            slots = std::make_unique<Entry*[]>(new_capacity);
+            capacity = new_capacity;
+            deleted = 0;
+            std::memset(ctrl.get(), CTRL_EMPTY, capacity);
+            for (size_t i{0}; i < old_capacity; ++i) {
+                if (!IsFull(old_ctrl[i])) continue;
+                const size_t hash{hasher(KEY_OF(*old_slots[i]))};
+                Place(FindInsertIndex(hash), hash, old_slots[i]);
+            }
+        }
+    };
+
+    /** Binary heap of entries, with the first entry in Compare order on top. */
+    template <typename Compare, uint32_t TxMemPoolIndexPositions::*POS>
+    struct Heap {
+        std::vector<Entry*> entries;
+
+        static bool Before(const Entry* a, const Entry* b) { return Compare{}(*a, *b); }
+
+        void Set(size_t pos, Entry* entry)
+        {
+            entries[pos] = entry;
+            entry->m_index_positions.*POS = pos;
+        }
+
+        /** Move the entry at pos towards the top while it sorts before its parent. Returns whether it moved. */
+        bool SiftUp(size_t pos)
+        {
+            Entry* const entry{entries[pos]};
+            const size_t start{pos};
+            while (pos > 0) {
+                const size_t parent{(pos - 1) / 2};
+                if (!Before(entry, entries[parent])) break;
+                Set(pos, entries[parent]);
+                pos = parent;
+            }
+            if (pos == start) return false;
+            Set(pos, entry);
+            return true;
+        }
+
+        void SiftDown(size_t pos)
+        {
+            Entry* const entry{entries[pos]};
+            const size_t size{entries.size()};
+            while (true) {
+                size_t child{2 * pos + 1};
+                if (child >= size) break;
+                if (child + 1 < size && Before(entries[child + 1], entries[child])) ++child;
+                if (!Before(entries[child], entry)) break;
+                Set(pos, entries[child]);
+                pos = child;
+            }
+            Set(pos, entry);
+        }
+
+        void Push(Entry* entry)
+        {
+            entries.push_back(entry);
+            entry->m_index_positions.*POS = entries.size() - 1;
+            SiftUp(entries.size() - 1);
+        }
+
+        void Remove(const Entry& entry)
+        {
+            const size_t pos{entry.m_index_positions.*POS};
+            Entry* const last{entries.back()};
+            entries.pop_back();
+            if (pos == entries.size()) return;
+            Set(pos, last);
+            Update(pos);
+        }
+
+        void Update(size_t pos)
+        {
+            if (!SiftUp(pos)) SiftDown(pos);
+        }
+
+        /**
+         * All entries in Compare order, by popping from a copy of the heap, so
+         * that entries that compare equal are in the order they would reach
+         * the top in.
+         */
+        std::vector<Entry*> Sorted() const
+        {
+            std::vector<Entry*> heap{entries}, sorted;
+            sorted.reserve(heap.size());
+            while (!heap.empty()) {
+                sorted.push_back(heap.front());
+                Entry* const entry{heap.back()};
+                heap.pop_back();
+                size_t pos{0};
+                while (!heap.empty()) {
+                    size_t child{2 * pos + 1};
+                    if (child >= heap.size()) break;
+                    if (child + 1 < heap.size() && Before(heap[child + 1], heap[child])) ++child;
+                    if (!Before(heap[child], entry)) break;
+                    heap[pos] = heap[child];
+                    pos = child;
+                }
+                if (!heap.empty()) heap[pos] = entry;
+            }
+            return sorted;
+        }
+    };
+
+    Hasher m_hasher;
+    size_t m_size{0};
+    //! Incremented by every emplace, modify and erase.
+    uint64_t m_mutations{0};
+    HashTable<&TxidOf, /*TRACK_SLOTS=*/true> m_by_txid;
+    HashTable<&WtxidOf, /*TRACK_SLOTS=*/false> m_by_wtxid;
+    Heap<DescendantScoreCompare, &TxMemPoolIndexPositions::descendant_score> m_by_descendant_score;
+    Heap<EntryTimeCompare, &TxMemPoolIndexPositions::entry_time> m_by_entry_time;
+    //! Entries sorted by ancestor score when last walked, with nullptr in place
+    //! of those erased or modified since.
+    mutable std::vector<Entry*> m_by_ancestor_score;
+    //! Entries added or modified since the ancestor score order was last walked.
+    mutable std::vector<Entry*> m_ancestor_score_pending;
+
+public:
+    class const_iterator
+    {
+        friend class TxMemPoolIndex;
+
+        const TxMemPoolIndex* m_index{nullptr};
+        const Entry* m_entry{nullptr};
+
+        const_iterator(const TxMemPoolIndex* index, const Entry* entry) : m_index{index}, m_entry{entry} {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Entry;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Entry*;
+        using reference = const Entry&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return *m_entry; }
+        pointer operator->() const { return m_entry; }
+
+        const_iterator& operator++()
+        {
+            m_entry = m_index->EntryAtOrAfter(m_entry->m_index_positions.txid_slot + 1);
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            const_iterator copy{*this};
+            ++*this;
+            return copy;
+        }
+
+        friend bool operator==(const const_iterator& a, const const_iterator& b) { return a.m_entry == b.m_entry; }
+        friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a.m_entry != b.m_entry; }
+    };
+    using iterator = const_iterator;
+
+    TxMemPoolIndex() = default;
+    TxMemPoolIndex(const TxMemPoolIndex&) = delete;
+    TxMemPoolIndex& operator=(const TxMemPoolIndex&) = delete;
+
+    ~TxMemPoolIndex()
+    {
+        for (size_t i{0}; i < m_by_txid.capacity; ++i) {
+            if (IsFull(m_by_txid.ctrl[i])) delete m_by_txid.slots[i];
+        }
+    }
+
+    const_iterator begin() const { return {this, EntryAtOrAfter(0)}; }
+    const_iterator end() const { return {this, nullptr}; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    /** Number of changes made to the entries so far, to tell whether data derived from them is stale. */
+    uint64_t mutations() const { return m_mutations; }
+
+    const_iterator find(const uint256& txid) const
+    {
+        const size_t index{m_by_txid.Find(m_hasher, txid)};
+        return {this, index == m_by_txid.capacity ? nullptr : m_by_txid.slots[index]};
+    }
+    size_t count(const uint256& txid) const { return find(txid) != end(); }
+
+    const_iterator find_by_wtxid(const uint256& wtxid) const
+    {
+        const size_t index{m_by_wtxid.Find(m_hasher, wtxid)};
+        return {this, index == m_by_wtxid.capacity ? nullptr : m_by_wtxid.slots[index]};
+    }
+    size_t count_by_wtxid(const uint256& wtxid) const { return find_by_wtxid(wtxid) != end(); }
+
+    /** Iterator to an entry of this container. */
+    const_iterator iterator_to(const Entry& entry) const { return {this, &entry}; }
+
+    /** Construct an entry, unless one with the same txid exists already. */
+    template <typename... Args>
+    std::pair<const_iterator, bool> emplace(Args&&... args)
+    {
+        auto entry{std::make_unique<Entry>(std::forward<Args>(args)...)};
+        if (const auto it{find(TxidOf(*entry))}; it != end()) return {it, false};
+        m_by_txid.Insert(m_hasher, entry.get(), m_size + 1);
+        m_by_wtxid.Insert(m_hasher, entry.get(), m_size + 1);
+        ++m_size;
+        m_by_descendant_score.Push(entry.get());
+        m_by_entry_time.Push(entry.get());
+        entry->m_index_positions.ancestor_score = ANCESTOR_PENDING | m_ancestor_score_pending.size();
+        m_ancestor_score_pending.push_back(entry.get());
+        ++m_mutations;
+        return {const_iterator{this, entry.release()}, true};
+    }
+
+    /** Modify an entry with mod(Entry&), and restore the orders it may have changed. Its txid must not change. */
+    template <typename Modifier>
+    void modify(const_iterator it, Modifier&& mod)
+    {
+        Entry& entry{const_cast<Entry&>(*it)};
+        mod(entry);
+        ++m_mutations;
+        m_by_descendant_score.Update(entry.m_index_positions.descendant_score);
+        m_by_entry_time.Update(entry.m_index_positions.entry_time);
+        uint32_t& pos{entry.m_index_positions.ancestor_score};
+        if (!(pos & ANCESTOR_PENDING)) {
+            m_by_ancestor_score[pos] = nullptr;
+            pos = ANCESTOR_PENDING | m_ancestor_score_pending.size();
+            m_ancestor_score_pending.push_back(&entry);
+        }
+    }
+
+    void erase(const_iterator it)
+    {
+        Entry* const entry{const_cast<Entry*>(it.m_entry)};
+        m_by_txid.Erase(entry->m_index_positions.txid_slot);
+        m_by_wtxid.Erase(m_by_wtxid.Find(m_hasher, WtxidOf(*entry)));
+        --m_size;
+        ++m_mutations;
+        m_by_descendant_score.Remove(*entry);
+        m_by_entry_time.Remove(*entry);
+        const uint32_t pos{entry->m_index_positions.ancestor_score};
+        if (pos & ANCESTOR_PENDING) {
+            Entry* const last{m_ancestor_score_pending.back()};
+            m_ancestor_score_pending.pop_back();
+            if (last != entry) {
+                m_ancestor_score_pending[pos & ~ANCESTOR_PENDING] = last;
+                last->m_index_positions.ancestor_score = pos;
+            }
+        } else {
+            m_by_ancestor_score[pos] = nullptr;
+        }
+        delete entry;
+    }
+
+    /** The entry with the lowest descendant score, or end() if empty. */
+    const_iterator worst_by_descendant_score() const
+    {
+        return {this, m_by_descendant_score.entries.empty() ? nullptr : m_by_descendant_score.entries.front()};
+    }
+
+    /**
+     * Call fn(const_iterator) for the entries that sort first by entry time,
+     * as long as pred(const Entry&) holds for them, in no particular order.
+     * pred must not hold for an entry without also holding for those sorting
+     * before it, like a time limit.
+     */
+    template <typename Pred, typename Fn>
+    void visit_by_entry_time(Pred&& pred, Fn&& fn) const
+    {
+        const auto& heap{m_by_entry_time.entries};
+        // The entries for which pred holds form a subtree at the top of the heap.
+        std::vector<size_t> todo;
+        if (!heap.empty()) todo.push_back(0);
+        while (!todo.empty()) {
+            const size_t pos{todo.back()};
+            todo.pop_back();
+            if (!pred(*heap[pos])) continue;
+            fn(const_iterator{this, heap[pos]});
+            for (size_t child{2 * pos + 1}; child < std::min(2 * pos + 3, heap.size()); ++child) todo.push_back(child);
+        }
+    }
+
+    /** All entries, from the best to the worst ancestor score. */
+    const std::vector<Entry*>& by_ancestor_score() const
+    {
+        if (!m_ancestor_score_pending.empty() || m_by_ancestor_score.size() != m_size) {
+            const auto before{[](const Entry* a, const Entry* b) { return AncestorScoreCompare{}(*a, *b); }};
+            std::sort(m_ancestor_score_pending.begin(), m_ancestor_score_pending.end(), before);
+            std::vector<Entry*> sorted;
+            sorted.reserve(m_size);
+            auto pending{m_ancestor_score_pending.begin()};
+            for (Entry* entry : m_by_ancestor_score) {
+                if (!entry) continue;
+                while (pending != m_ancestor_score_pending.end() && before(*pending, entry)) sorted.push_back(*pending++);
+                sorted.push_back(entry);
+            }
+            sorted.insert(sorted.end(), pending, m_ancestor_score_pending.end());
+            assert(sorted.size() == m_size);
+            for (size_t i{0}; i < sorted.size(); ++i) sorted[i]->m_index_positions.ancestor_score = i;
+            m_by_ancestor_score = std::move(sorted);
+            m_ancestor_score_pending.clear();
+        }
+        return m_by_ancestor_score;
+    }
+
+    /** All entries, from the lowest to the highest descendant score. */
+    std::vector<const_iterator> sorted_by_descendant_score() const
+    {
+        std::vector<const_iterator> sorted;
+        for (const Entry* entry : m_by_descendant_score.Sorted()) sorted.push_back(iterator_to(*entry));
+        return sorted;
+    }
+
+    /**
+     * Memory used by the entries and the indexes. As in the estimate for the
+     * boost container, the indexes are counted per entry rather than by the
+     * capacity they last grew to, so that erasing entries lowers the usage in
+     * proportion: two slots in each hash table (which are between 7/16 and 7/8
+     * full), and a pointer in each of the three orders.
+     */
+    size_t DynamicMemoryUsage() const
+    {
+        return (memusage::MallocUsage(sizeof(Entry)) + 2 * 2 * (1 + sizeof(Entry*)) + 3 * sizeof(Entry*)) * m_size;
+    }
+
+private:
+    const Entry* EntryAtOrAfter(size_t slot) const
+    {
+        const size_t index{m_by_txid.NextFull(slot)};
+        return index == m_by_txid.capacity ? nullptr : m_by_txid.slots[index];
+    }
+};
+
+#endif // BITCOIN_TXMEMPOOLINDEX_H
@@ -0,0 +1,125 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/lzcompress.h>
+
+#include <crypto/common.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace util {
+namespace {
+//! Shortest repeated stretch that is encoded as a match.
+constexpr size_t MIN_MATCH{4};
+//! Matches are found this far back at most, so that offsets fit in two bytes.
+constexpr size_t MAX_OFFSET{0xffff};
+//! Lengths are stored in four bits of the token, and in extra bytes if they do not fit.
+constexpr size_t TOKEN_LENGTH_MAX{15};
+//! Number of bits of the hash of four bytes used to find earlier occurrences.
+constexpr int HASH_BITS{14};
+
+uint32_t HashSequence(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+void WriteLength(std::vector<std::byte>& out, size_t length)
+{
+    for (; length >= 255; length -= 255) out.push_back(std::byte{255});
+    out.push_back(std::byte(length));
+}
+
+/** Append a sequence of literals, followed by a match unless match_length is 0. */
+void WriteSequence(std::vector<std::byte>& out, Span<const std::byte> literals, size_t offset, size_t match_length)
+{
+    const size_t match_code{match_length ? match_length - MIN_MATCH : 0};
+    out.push_back(std::byte(std::min(literals.size(), TOKEN_LENGTH_MAX) << 4 | std::min(match_code, TOKEN_LENGTH_MAX)));
+    if (literals.size() >= TOKEN_LENGTH_MAX) WriteLength(out, literals.size() - TOKEN_LENGTH_MAX);
+    out.insert(out.end(), literals.begin(), literals.end());
+    if (match_length == 0) return;
+    out.push_back(std::byte(offset & 0xff));
+    out.push_back(std::byte(offset >> 8));
+    if (match_code >= TOKEN_LENGTH_MAX) WriteLength(out, match_code - TOKEN_LENGTH_MAX);
+}
+} // namespace
+
+std::vector<std::byte> LZCompress(Span<const std::byte> data)
+{
+    std::vector<std::byte> out;
+    out.reserve(data.size() + data.size() / 255 + 16);
+    // Most recent position of each hash of four bytes.
+    std::vector<uint32_t> table(size_t{1} << HASH_BITS, 0);
+
+    size_t literals_begin{0};
+    size_t pos{0};
+    // Step over incompressible data faster the longer no match is found.
+    size_t misses{0};
+    while (pos + MIN_MATCH <= data.size()) {
+        const uint32_t sequence{ReadLE32(UCharCast(data.data() + pos))};
+        uint32_t& entry{table[HashSequence(sequence)]};
+        const size_t candidate{entry};
+        entry = static_cast<uint32_t>(pos);
+        if (candidate >= pos || pos - candidate > MAX_OFFSET || ReadLE32(UCharCast(data.data() + candidate)) != sequence) {
+            pos += 1 + (misses++ >> 5);
+            continue;
+        }
+        size_t length{MIN_MATCH};
+        while (pos + length < data.size() && data[candidate + length] == data[pos + length]) ++length;
+        WriteSequence(out, data.subspan(literals_begin, pos - literals_begin), pos - candidate, length);
+        pos += length;
+        literals_begin = pos;
+        misses = 0;
+    }
+    WriteSequence(out, data.subspan(literals_begin), /*offset=*/0, /*match_length=*/0);
+    return out;
+}
+
+bool LZDecompress(Span<const std::byte> compressed, Span<std::byte> data)
+{
+    size_t in{0};
+    size_t out{0};
+    const auto read_length{[&](size_t& length) {
+        if (length != TOKEN_LENGTH_MAX) return true;
+        uint8_t byte;
+        do {
+            if (in == compressed.size() || length > data.size()) return false;
+            byte = uint8_t(compressed[in++]);
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }};
+
+    while (true) {
+        // The data always ends with a sequence of literals, which may be empty.
+        if (in == compressed.size()) return false;
+        const uint8_t token{uint8_t(compressed[in++])};
+        size_t literals{size_t{token} >> 4};
+        if (!read_length(literals)) return false;
+        if (literals > compressed.size() - in || literals > data.size() - out) return false;
+        std::copy_n(compressed.begin() + in, literals, data.begin() + out);
+        in += literals;
+        out += literals;
+        // The last sequence has no match.
+        if (in == compressed.size()) break;
+
+        if (compressed.size() - in < 2) return false;
+        const size_t offset{uint8_t(compressed[in]) | size_t{uint8_t(compressed[in + 1])} << 8};
+        in += 2;
+        size_t length{size_t{token} & TOKEN_LENGTH_MAX};
+        if (!read_length(length)) return false;
+        length += MIN_MATCH;
+        if (offset == 0 || offset > out || length > data.size() - out) return false;
+        if (offset >= length) {
+            std::memcpy(data.data() + out, data.data() + out - offset, length);
+            out += length;
+        } else {
+            // The match overlaps the bytes it produces.
+            for (const size_t end{out + length}; out < end; ++out) data[out] = data[out - offset];
+        }
+    }
+    return out == data.size();
+}
+} // namespace util
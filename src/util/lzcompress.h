@@ -0,0 +1,37 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_LZCOMPRESS_H
+#define BITCOIN_UTIL_LZCOMPRESS_H
+
+#include <span.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace util {
+/**
+ * Fast LZ77 compression, in a format similar to the LZ4 block format: a
+ * sequence of tokens, each giving a number of literal bytes to copy and an
+ * earlier stretch of at least four bytes, within the previous 64 KiB of
+ * output, to repeat after them.
+ *
+ * This favors speed over compression ratio. It is meant for data that is
+ * read far more often than it is written, such as blocks on disk. The size
+ * of the input is not part of the output, and must be stored by the caller.
+ */
+std::vector<std::byte> LZCompress(Span<const std::byte> data);
+
+/**
+ * Decompress the output of LZCompress().
+ *
+ * @param[in]  compressed  Compressed data
+ * @param[out] data        Buffer of exactly the size of the uncompressed data
+ * @returns false if `compressed` is corrupt, or does not decompress to
+ *          exactly `data.size()` bytes.
+ */
+[[nodiscard]] bool LZDecompress(Span<const std::byte> compressed, Span<std::byte> data);
+} // namespace util
+
+#endif // BITCOIN_UTIL_LZCOMPRESS_H
@@ -30,6 +30,7 @@
 #include <kernel/warning.h>
 #include <logging.h>
 #include <logging/timer.h>
+#include <node/blockreadahead.h>
 #include <node/blockstorage.h>
 #include <node/utxo_snapshot.h>
 #include <policy/policy.h>
@@ -72,6 +73,8 @@
 #include <optional>
 #include <string>
 #include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 using kernel::CCoinsStats;
@@ -90,6 +93,8 @@ using node::SnapshotMetadata;
 static constexpr std::chrono::hours DATABASE_WRITE_INTERVAL{1};
 /** Time to wait between flushing chainstate to disk. */
 static constexpr std::chrono::hours DATABASE_FLUSH_INTERVAL{24};
+/** When the coins cache is full, evict clean coins until it uses at most this percentage of its size. */
+static constexpr size_t COINS_CACHE_EVICT_TARGET_PERCENT{50};
 /** Maximum age of our tip for us to be considered current for fee estimation */
 static constexpr std::chrono::hours MAX_FEE_ESTIMATION_TIP_AGE{3};
 const std::vector<std::string> CHECKLEVEL_DOC {
@@ -369,10 +374,10 @@ void Chainstate::MaybeUpdateMempoolForReorg(
         if (it->GetSpendsCoinbase()) {
             for (const CTxIn& txin : tx.vin) {
                 if (m_mempool->exists(GenTxid::Txid(txin.prevout.hash))) continue;
-                const Coin& coin{CoinsTip().AccessCoin(txin.prevout)};
+                const CompactCoin& coin{CoinsTip().AccessCoin(txin.prevout)};
                 assert(!coin.IsSpent());
                 const auto mempool_spend_height{m_chain.Tip()->nHeight + 1};
-                if (coin.IsCoinBase() && mempool_spend_height - coin.nHeight < COINBASE_MATURITY) {
+                if (coin.IsCoinBase() && mempool_spend_height - int(coin.GetHeight()) < COINBASE_MATURITY) {
                     return true;
                 }
             }
@@ -402,7 +407,7 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, TxValidationS
 
     assert(!tx.IsCoinBase());
     for (const CTxIn& txin : tx.vin) {
-        const Coin& coin = view.AccessCoin(txin.prevout);
+        const CompactCoin& coin = view.AccessCoin(txin.prevout);
 
         // This coin was checked in PreChecks and MemPoolAccept
         // has been holding cs_main since then.
@@ -417,11 +422,11 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, TxValidationS
         if (txFrom) {
             assert(txFrom->GetHash() == txin.prevout.hash);
             assert(txFrom->vout.size() > txin.prevout.n);
-            assert(txFrom->vout[txin.prevout.n] == coin.out);
+            assert(txFrom->vout[txin.prevout.n] == coin.GetTxOut());
         } else {
-            const Coin& coinFromUTXOSet = coins_tip.AccessCoin(txin.prevout);
+            const CompactCoin& coinFromUTXOSet = coins_tip.AccessCoin(txin.prevout);
             assert(!coinFromUTXOSet.IsSpent());
-            assert(coinFromUTXOSet.out == coin.out);
+            assert(coinFromUTXOSet.GetTxOut() == coin.GetTxOut());
         }
     }
 
@@ -590,8 +595,17 @@ public:
     /** Clean up all non-chainstate coins from m_view and m_viewmempool. */
     void CleanupTemporaryCoins() EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
 
-    // Single transaction acceptance
-    MempoolAcceptResult AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    // Single transaction acceptance. If preverified is set, the policy script checks are skipped
+    // for a transaction spending the outputs it holds, see AcceptToMemoryPool().
+    MempoolAcceptResult AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args,
+                                                PrecomputedTransactionData* preverified = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /**
+     * Run the checks of AcceptSingleTransaction() that come before the script checks, without
+     * changing the mempool. Returns the outputs the transaction spends if it passes them, so
+     * that its scripts can be verified without holding cs_main.
+     */
+    std::optional<std::vector<CTxOut>> PreCheckSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     /**
     * Multiple transaction acceptance. Transactions may or may not be interdependent, but must not
@@ -913,7 +927,7 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
     // during reorgs to ensure COINBASE_MATURITY is still met.
     bool fSpendsCoinbase = false;
     for (const CTxIn &txin : tx.vin) {
-        const Coin &coin = m_view.AccessCoin(txin.prevout);
+        const CompactCoin& coin = m_view.AccessCoin(txin.prevout);
         if (coin.IsCoinBase()) {
             fSpendsCoinbase = true;
             break;
@@ -1425,7 +1439,24 @@ bool MemPoolAccept::SubmitPackage(const ATMPArgs& args, std::vector<Workspace>&
     return all_submitted;
 }
 
-MempoolAcceptResult MemPoolAccept::AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args)
+std::optional<std::vector<CTxOut>> MemPoolAccept::PreCheckSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args)
+{
+    AssertLockHeld(cs_main);
+    LOCK(m_pool.cs);
+
+    Workspace ws(ptx);
+    if (!PreChecks(args, ws)) return std::nullopt;
+    if (m_subpackage.m_rbf && !ReplacementChecks(ws)) return std::nullopt;
+
+    std::vector<CTxOut> spent_outputs;
+    spent_outputs.reserve(ptx->vin.size());
+    for (const CTxIn& txin : ptx->vin) {
+        spent_outputs.push_back(m_view.AccessCoin(txin.prevout).GetTxOut());
+    }
+    return spent_outputs;
+}
+
+MempoolAcceptResult MemPoolAccept::AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args, PrecomputedTransactionData* preverified)
 {
     AssertLockHeld(cs_main);
     LOCK(m_pool.cs); // mempool "read lock" (held through m_pool.m_opts.signals->TransactionAddedToMempool())
@@ -1457,7 +1488,19 @@ MempoolAcceptResult MemPoolAccept::AcceptSingleTransaction(const CTransactionRef
 
     // Perform the inexpensive checks first and avoid hashing and signature verification unless
     // those checks pass, to mitigate CPU exhaustion denial-of-service attacks.
-    if (!PolicyScriptChecks(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
+    const auto spends_preverified_outputs{[&]() EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs) {
+        if (!preverified || preverified->m_spent_outputs.size() != ptx->vin.size()) return false;
+        for (size_t i{0}; i < ptx->vin.size(); ++i) {
+            if (m_view.AccessCoin(ptx->vin[i].prevout).GetTxOut() != preverified->m_spent_outputs[i]) return false;
+        }
+        return true;
+    }};
+    if (spends_preverified_outputs()) {
+        // The scripts passed with the policy flags already, against the same outputs.
+        ws.m_precomputed_txdata = std::move(*preverified);
+    } else if (!PolicyScriptChecks(args, ws)) {
+        return MempoolAcceptResult::Failure(ws.m_state);
+    }
 
     if (!ConsensusScriptChecks(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
 
@@ -1848,7 +1891,8 @@ PackageMempoolAcceptResult MemPoolAccept::AcceptPackage(const Package& package,
 } // anon namespace
 
 MempoolAcceptResult AcceptToMemoryPool(Chainstate& active_chainstate, const CTransactionRef& tx,
-                                       int64_t accept_time, bool bypass_limits, bool test_accept)
+                                       int64_t accept_time, bool bypass_limits, bool test_accept,
+                                       PrecomputedTransactionData* preverified)
     EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
 {
     AssertLockHeld(::cs_main);
@@ -1858,7 +1902,7 @@ MempoolAcceptResult AcceptToMemoryPool(Chainstate& active_chainstate, const CTra
 
     std::vector<COutPoint> coins_to_uncache;
     auto args = MemPoolAccept::ATMPArgs::SingleAccept(chainparams, accept_time, bypass_limits, coins_to_uncache, test_accept);
-    MempoolAcceptResult result = MemPoolAccept(pool, active_chainstate).AcceptSingleTransaction(tx, args);
+    MempoolAcceptResult result = MemPoolAccept(pool, active_chainstate).AcceptSingleTransaction(tx, args, preverified);
     if (result.m_result_type != MempoolAcceptResult::ResultType::VALID) {
         // Remove coins that were not present in the coins cache before calling
         // AcceptSingleTransaction(); this is to prevent memory DoS in case we receive a large
@@ -1925,12 +1969,13 @@ CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
 
 CoinsViews::CoinsViews(DBParams db_params, CoinsViewOptions options)
     : m_dbview{std::move(db_params), std::move(options)},
-      m_catcherview(&m_dbview) {}
+      m_catcherview(&m_dbview),
+      m_flusher(&m_catcherview) {}
 
 void CoinsViews::InitCache()
 {
     AssertLockHeld(::cs_main);
-    m_cacheview = std::make_unique<CCoinsViewCache>(&m_catcherview);
+    m_cacheview = std::make_unique<CCoinsViewCache>(&m_flusher);
 }
 
 Chainstate::Chainstate(
@@ -2159,9 +2204,9 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
 
         for (const auto& txin : tx.vin) {
             const COutPoint& prevout = txin.prevout;
-            const Coin& coin = inputs.AccessCoin(prevout);
+            const CompactCoin& coin = inputs.AccessCoin(prevout);
             assert(!coin.IsSpent());
-            spent_outputs.emplace_back(coin.out);
+            spent_outputs.emplace_back(coin.GetTxOut());
         }
         txdata.Init(tx, std::move(spent_outputs));
     }
@@ -2239,10 +2284,10 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
         // Missing undo metadata (height and coinbase). Older versions included this
         // information only in undo records for the last spend of a transactions'
         // outputs. This implies that it must be present for some other output of the same tx.
-        const Coin& alternate = AccessByTxid(view, out.hash);
+        const CompactCoin& alternate = AccessByTxid(view, out.hash);
         if (!alternate.IsSpent()) {
-            undo.nHeight = alternate.nHeight;
-            undo.fCoinBase = alternate.fCoinBase;
+            undo.nHeight = alternate.GetHeight();
+            undo.fCoinBase = alternate.IsCoinBase();
         } else {
             return DISCONNECT_FAILED; // adding output for transaction without known metadata
         }
@@ -2259,16 +2304,20 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
+DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CBlockUndo* block_undo)
 {
     AssertLockHeld(::cs_main);
     bool fClean = true;
 
-    CBlockUndo blockUndo;
-    if (!m_blockman.UndoReadFromDisk(blockUndo, *pindex)) {
-        LogError("DisconnectBlock(): failure reading undo data\n");
-        return DISCONNECT_FAILED;
+    CBlockUndo undo_read;
+    if (!block_undo) {
+        if (!m_blockman.UndoReadFromDisk(undo_read, *pindex)) {
+            LogError("DisconnectBlock(): failure reading undo data\n");
+            return DISCONNECT_FAILED;
+        }
+        block_undo = &undo_read;
     }
+    CBlockUndo& blockUndo{*block_undo};
 
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
         LogError("DisconnectBlock(): block and undo data inconsistent\n");
@@ -2644,7 +2693,7 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
             // be in ConnectBlock because they require the UTXO set
             prevheights.resize(tx.vin.size());
             for (size_t j = 0; j < tx.vin.size(); j++) {
-                prevheights[j] = view.AccessCoin(tx.vin[j].prevout).nHeight;
+                prevheights[j] = view.AccessCoin(tx.vin[j].prevout).GetHeight();
             }
 
             if (!SequenceLocks(tx, nLockTimeFlags, prevheights, *pindex)) {
@@ -2766,7 +2815,8 @@ CoinsCacheSizeState Chainstate::GetCoinsCacheSizeState(
 {
     AssertLockHeld(::cs_main);
     const int64_t nMempoolUsage = m_mempool ? m_mempool->DynamicMemoryUsage() : 0;
-    int64_t cacheSize = CoinsTip().DynamicMemoryUsage();
+    // The modified coins being written in the background are still in memory.
+    int64_t cacheSize = CoinsTip().LiveMemoryUsage() + m_coins_views->m_flusher.DynamicMemoryUsage();
     int64_t nTotalSpace =
         max_coins_cache_size_bytes + std::max<int64_t>(int64_t(max_mempool_size_bytes) - nMempoolUsage, 0);
 
@@ -2790,9 +2840,12 @@ bool Chainstate::FlushStateToDisk(
     int nManualPruneHeight)
 {
     LOCK(cs_main);
+    const auto lock_start{SteadyClock::now()};
     assert(this->CanFlushToDisk());
     std::set<int> setFilesToPrune;
     bool full_flush_completed = false;
+    CCoinsViewFlusher& flusher{m_coins_views->m_flusher};
+    flusher.ReleaseIfDone();
 
     const size_t coins_count = CoinsTip().GetCacheSize();
     const size_t coins_mem_usage = CoinsTip().DynamicMemoryUsage();
@@ -2910,10 +2963,35 @@ bool Chainstate::FlushStateToDisk(
                 return FatalError(m_chainman.GetNotifications(), state, _("Disk space is too low!"));
             }
             // Flush the chainstate (which may refer to block index entries).
-            const auto empty_cache{(mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical || fFlushForPrune};
-            if (empty_cache ? !CoinsTip().Flush() : !CoinsTip().Sync()) {
+            // Only the modified coins are written, and unless we are asked to
+            // empty the cache, unmodified coins stay cached.
+            const auto empty_cache{mode == FlushStateMode::ALWAYS};
+            // Unless we empty the cache or are about to prune, the database
+            // may be written in the background. A crash during that write is
+            // recovered from by ReplayBlocks(), which needs the blocks since
+            // the database's previous best block, and those are never pruned.
+            const bool in_background{m_chainman.m_options.async_coins_flush && !empty_cache && !fFlushForPrune};
+            bool flushed;
+            if (empty_cache) {
+                flushed = CoinsTip().Flush() && flusher.Wait();
+            } else if (in_background) {
+                flushed = flusher.SyncInBackground(CoinsTip());
+            } else {
+                flushed = CoinsTip().Sync() && flusher.Wait();
+            }
+            if (!flushed) {
                 return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to coin database."));
             }
+            if (!empty_cache && (fCacheLarge || fCacheCritical)) {
+                // All coins are clean now. Make room by evicting some of them
+                // instead of wiping the cache, so that validation does not
+                // continue with a cold cache. Releasing the memory of the
+                // evicted coins copies the remaining ones, so when the cache
+                // is already over its limit, that is left to a later flush.
+                LOG_TIME_MILLIS_WITH_CATEGORY("evict clean coins from cache", BCLog::BENCH);
+                const size_t evicted{CoinsTip().EvictClean(m_coinstip_cache_size_bytes * COINS_CACHE_EVICT_TARGET_PERCENT / 100, /*compact=*/!fCacheCritical)};
+                LogPrint(BCLog::COINDB, "Evicted %u of %u coins from the cache\n", evicted, coins_count);
+            }
             m_last_flush = nNow;
             full_flush_completed = true;
             TRACE5(utxocache, flush,
@@ -2922,6 +3000,9 @@ bool Chainstate::FlushStateToDisk(
                    (uint64_t)coins_count,
                    (uint64_t)coins_mem_usage,
                    (bool)fFlushForPrune);
+            LogPrint(BCLog::BENCH, "Flushed chainstate (%s) holding cs_main for %.2fms\n",
+                     in_background ? "background write" : "synchronous write",
+                     Ticks<MillisecondsDouble>(SteadyClock::now() - lock_start));
         }
     }
     if (full_flush_completed && m_chainman.m_options.signals) {
@@ -3031,7 +3112,7 @@ void Chainstate::UpdateTip(const CBlockIndex* pindexNew)
   * disconnectpool (note that the caller is responsible for mempool consistency
   * in any case).
   */
-bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool)
+bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool, node::BlockReadAhead* read_ahead)
 {
     AssertLockHeld(cs_main);
     if (m_mempool) AssertLockHeld(m_mempool->cs);
@@ -3039,19 +3120,28 @@ bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTra
     CBlockIndex *pindexDelete = m_chain.Tip();
     assert(pindexDelete);
     assert(pindexDelete->pprev);
-    // Read block from disk.
-    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-    CBlock& block = *pblock;
-    if (!m_blockman.ReadBlockFromDisk(block, *pindexDelete)) {
+    // Read block from disk, unless it was read ahead.
+    std::shared_ptr<CBlock> pblock;
+    std::optional<CBlockUndo> block_undo;
+    if (read_ahead && read_ahead->Peek() == pindexDelete) {
+        auto entry{read_ahead->Next()};
+        pblock = std::move(entry.block);
+        block_undo = std::move(entry.undo);
+    } else {
+        pblock = std::make_shared<CBlock>();
+        if (!m_blockman.ReadBlockFromDisk(*pblock, *pindexDelete)) pblock.reset();
+    }
+    if (!pblock) {
         LogError("DisconnectTip(): Failed to read block\n");
         return false;
     }
+    CBlock& block = *pblock;
     // Apply the block atomically to the chain state.
     const auto time_start{SteadyClock::now()};
     {
         CCoinsViewCache view(&CoinsTip());
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
-        if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK) {
+        if (DisconnectBlock(block, pindexDelete, view, block_undo ? &*block_undo : nullptr) != DISCONNECT_OK) {
             LogError("DisconnectTip(): DisconnectBlock %s failed\n", pindexDelete->GetBlockHash().ToString());
             return false;
         }
@@ -3167,13 +3257,19 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
         pthisBlock = pblock;
     }
     const CBlock& blockConnecting = *pthisBlock;
+    // Pull the coins spent by this block into the cache using parallel
+    // database reads, so ConnectBlock() does not wait on them one at a time.
+    const auto time_fetch{SteadyClock::now()};
+    const size_t inputs_fetched{m_chainman.GetInputFetcher().FetchInputs(CoinsTip(), m_coins_views->m_flusher, blockConnecting)};
     // Apply the block atomically to the chain state.
     const auto time_2{SteadyClock::now()};
     SteadyClock::time_point time_3;
     // When adding aggregate statistics in the future, keep in mind that
     // num_blocks_total may be zero until the ConnectBlock() call below.
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms\n",
-             Ticks<MillisecondsDouble>(time_2 - time_1));
+             Ticks<MillisecondsDouble>(time_fetch - time_1));
+    LogPrint(BCLog::BENCH, "  - Fetch %u inputs: %.2fms\n", inputs_fetched,
+             Ticks<MillisecondsDouble>(time_2 - time_fetch));
     {
         CCoinsViewCache view(&CoinsTip());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view);
@@ -3337,8 +3433,18 @@ bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex*
     // Disconnect active blocks which are no longer in the best chain.
     bool fBlocksDisconnected = false;
     DisconnectedBlockTransactions disconnectpool{MAX_DISCONNECTED_TX_POOL_BYTES};
+    // Read the blocks to disconnect, and their undo data, ahead of
+    // disconnecting them, if there are several.
+    std::optional<node::BlockReadAhead> read_ahead;
+    if (const int window{m_blockman.ReadAheadWindow()}; window > 0 && pindexOldTip && pindexFork && pindexOldTip->nHeight - pindexFork->nHeight > 1) {
+        std::vector<const CBlockIndex*> blocks;
+        for (const CBlockIndex* pindex{pindexOldTip}; pindex != pindexFork; pindex = pindex->pprev) {
+            blocks.push_back(pindex);
+        }
+        read_ahead.emplace(m_blockman, std::move(blocks), /*read_undo=*/true, window);
+    }
     while (m_chain.Tip() && m_chain.Tip() != pindexFork) {
-        if (!DisconnectTip(state, &disconnectpool)) {
+        if (!DisconnectTip(state, &disconnectpool, read_ahead ? &*read_ahead : nullptr)) {
             // This is likely a fatal error, but keep the mempool consistent,
             // just in case. Only remove from the mempool in this case.
             MaybeUpdateMempoolForReorg(disconnectpool, false);
@@ -4595,6 +4701,81 @@ MempoolAcceptResult ChainstateManager::ProcessTransaction(const CTransactionRef&
     return result;
 }
 
+std::vector<MempoolAcceptResult> ChainstateManager::ProcessTransactions(const std::vector<CTransactionRef>& txs, bool test_accept,
+                                                                       const std::vector<int64_t>& accept_times)
+{
+    AssertLockNotHeld(cs_main);
+    assert(accept_times.empty() || accept_times.size() == txs.size());
+    const auto accept_time{[&](size_t i) { return accept_times.empty() ? GetTime() : accept_times[i]; }};
+    std::vector<std::optional<MempoolAcceptResult>> results(txs.size());
+
+    // Context-free checks. Transactions failing them would fail the same way in PreChecks().
+    m_tx_accept_workers.Run(txs.size(), [&](size_t i) {
+        TxValidationState state;
+        if (!CheckTransaction(*txs[i], state)) results[i].emplace(MempoolAcceptResult::Failure(state));
+    });
+
+    // Look up the outputs spent by the transactions that pass the checks coming before the
+    // script checks. The others are left to AcceptToMemoryPool() below, as they may only
+    // pass once earlier transactions in the batch were added.
+    std::vector<std::optional<std::vector<CTxOut>>> spent_outputs(txs.size());
+    std::vector<std::vector<COutPoint>> coins_to_uncache(txs.size());
+    {
+        LOCK(cs_main);
+        Chainstate& active_chainstate = ActiveChainstate();
+        if (!active_chainstate.GetMempool()) {
+            std::vector<MempoolAcceptResult> no_mempool;
+            for (size_t i{0}; i < txs.size(); ++i) no_mempool.push_back(ProcessTransaction(txs[i], test_accept));
+            return no_mempool;
+        }
+        for (size_t i{0}; i < txs.size(); ++i) {
+            if (results[i]) continue;
+            auto args{MemPoolAccept::ATMPArgs::SingleAccept(GetParams(), accept_time(i), /*bypass_limits=*/false, coins_to_uncache[i], /*test_accept=*/true)};
+            spent_outputs[i] = MemPoolAccept(*active_chainstate.GetMempool(), active_chainstate).PreCheckSingleTransaction(txs[i], args);
+        }
+    }
+
+    // Verify the scripts like PolicyScriptChecks() does. Signatures are added to the signature
+    // cache, so that ConsensusScriptChecks() finds them there.
+    std::vector<std::optional<PrecomputedTransactionData>> preverified(txs.size());
+    m_tx_accept_workers.Run(txs.size(), [&](size_t i) {
+        if (!spent_outputs[i]) return;
+        const CTransaction& tx{*txs[i]};
+        PrecomputedTransactionData txdata;
+        txdata.Init(tx, std::move(*spent_outputs[i]));
+        for (unsigned int n = 0; n < tx.vin.size(); ++n) {
+            CScriptCheck check(txdata.m_spent_outputs[n], tx, n, STANDARD_SCRIPT_VERIFY_FLAGS, /*cacheIn=*/true, &txdata);
+            if (!check()) return;
+        }
+        preverified[i] = std::move(txdata);
+    });
+
+    std::vector<MempoolAcceptResult> ret;
+    ret.reserve(txs.size());
+    LOCK(cs_main);
+    Chainstate& active_chainstate = ActiveChainstate();
+    for (size_t i{0}; i < txs.size(); ++i) {
+        if (!results[i]) {
+            if (active_chainstate.GetMempool()) {
+                results[i].emplace(AcceptToMemoryPool(active_chainstate, txs[i], accept_time(i), /*bypass_limits=*/false, test_accept,
+                                                      preverified[i] ? &*preverified[i] : nullptr));
+            } else {
+                results[i].emplace(ProcessTransaction(txs[i], test_accept));
+            }
+        }
+        if (results[i]->m_result_type != MempoolAcceptResult::ResultType::VALID) {
+            // Like AcceptToMemoryPool(), remove the coins that were only added to the cache to
+            // check this transaction.
+            for (const COutPoint& outpoint : coins_to_uncache[i]) active_chainstate.CoinsTip().Uncache(outpoint);
+        }
+        ret.push_back(std::move(*results[i]));
+    }
+    if (active_chainstate.GetMempool()) {
+        active_chainstate.GetMempool()->check(active_chainstate.CoinsTip(), active_chainstate.m_chain.Height() + 1);
+    }
+    return ret;
+}
+
 bool TestBlockValidity(BlockValidationState& state,
                        const CChainParams& chainparams,
                        Chainstate& chainstate,
@@ -5190,6 +5371,90 @@ void ChainstateManager::LoadExternalBlockFile(
     LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, Ticks<std::chrono::milliseconds>(SteadyClock::now() - start));
 }
 
+void ChainstateManager::LoadScannedBlocks(std::vector<node::ScannedBlock> blocks)
+{
+    const auto start{SteadyClock::now()};
+    const uint256& genesis_hash{GetConsensus().hashGenesisBlock};
+
+    // Index the first copy of each block by its parent.
+    std::unordered_map<uint256, size_t, BlockHasher> first_copy;
+    std::unordered_multimap<uint256, size_t, BlockHasher> children;
+    for (size_t i{0}; i < blocks.size(); ++i) {
+        if (!first_copy.try_emplace(blocks[i].hash, i).second) continue;
+        if (blocks[i].hash != genesis_hash) children.emplace(blocks[i].header.hashPrevBlock, i);
+    }
+
+    // Order the blocks breadth-first from the genesis block and the children
+    // of blocks already in the block index, so that parents come before their
+    // children.
+    std::vector<size_t> order;
+    order.reserve(first_copy.size());
+    {
+        LOCK(cs_main);
+        for (const auto& [hash, i] : first_copy) {
+            const uint256& prev{blocks[i].header.hashPrevBlock};
+            if (hash == genesis_hash || (!first_copy.contains(prev) && m_blockman.LookupBlockIndex(prev))) {
+                order.push_back(i);
+            }
+        }
+    }
+    std::sort(order.begin(), order.end());
+    for (size_t k{0}; k < order.size(); ++k) {
+        const auto [begin, end]{children.equal_range(blocks[order[k]].hash)};
+        for (auto it{begin}; it != end; ++it) order.push_back(it->second);
+    }
+    LogPrintf("Found %u blocks in the block files, %u of which are connected to known blocks\n", blocks.size(), order.size());
+
+    int loaded{0};
+    try {
+        // Add the headers in batches, so as not to hold cs_main for too long.
+        static constexpr size_t HEADERS_PER_BATCH{2000};
+        for (size_t k{0}; k < order.size(); k += HEADERS_PER_BATCH) {
+            if (m_interrupt) return;
+            LOCK(cs_main);
+            for (size_t j{k}; j < std::min(order.size(), k + HEADERS_PER_BATCH); ++j) {
+                BlockValidationState state;
+                if (!AcceptBlockHeader(blocks[order[j]].header, state, nullptr, /*min_pow_checked=*/true)) {
+                    LogPrint(BCLog::REINDEX, "%s: header %s not accepted: %s\n", __func__, blocks[order[j]].hash.ToString(), state.ToString());
+                }
+            }
+        }
+        NotifyHeaderTip(*this);
+
+        for (const size_t i : order) {
+            if (m_interrupt) return;
+            const node::ScannedBlock& scanned{blocks[i]};
+            {
+                LOCK(cs_main);
+                const CBlockIndex* pindex{m_blockman.LookupBlockIndex(scanned.hash)};
+                if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) || (pindex->nStatus & BLOCK_FAILED_MASK)) continue;
+            }
+
+            auto pblock{std::make_shared<CBlock>()};
+            if (!m_blockman.ReadBlockFromDisk(*pblock, scanned.pos) || pblock->GetHash() != scanned.hash) continue;
+            {
+                LOCK(cs_main);
+                BlockValidationState state;
+                if (AcceptBlock(pblock, state, nullptr, true, &scanned.pos, nullptr, true)) {
+                    ++loaded;
+                }
+                if (state.IsError()) break;
+            }
+
+            // Activate the genesis block so normal node progress can continue
+            if (scanned.hash == genesis_hash) {
+                for (auto c : GetAll()) {
+                    BlockValidationState state;
+                    if (!c->ActivateBestChain(state, nullptr)) return;
+                }
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        GetNotifications().fatalError(strprintf(_("System error while loading block files: %s"), e.what()));
+    }
+    LogPrintf("Loaded %i blocks from block files in %dms\n", loaded, Ticks<std::chrono::milliseconds>(SteadyClock::now() - start));
+}
+
 bool ChainstateManager::ShouldCheckBlockIndex() const
 {
     // Assert to verify Flatten() has been called.
@@ -5529,6 +5794,11 @@ bool Chainstate::ResizeCoinsCaches(size_t coinstip_size, size_t coinsdb_size)
     size_t old_coinstip_size = m_coinstip_cache_size_bytes;
     m_coinstip_cache_size_bytes = coinstip_size;
     m_coinsdb_cache_size_bytes = coinsdb_size;
+    // The database is reopened with the new cache size.
+    if (!WaitForCoinsDBWrite()) {
+        BlockValidationState state;
+        return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to coin database."));
+    }
     CoinsDB().ResizeCache(coinsdb_size);
 
     LogPrintf("[%s] resized coinsdb cache to %.1f MiB\n",
@@ -5840,44 +6110,19 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     }
 
     const uint64_t coins_count = metadata.m_coins_count;
-    uint64_t coins_left = metadata.m_coins_count;
 
-    LogPrintf("[snapshot] loading %d coins from snapshot %s\n", coins_left, base_blockhash.ToString());
+    LogPrintf("[snapshot] loading %d coins from snapshot %s\n", coins_count, base_blockhash.ToString());
     int64_t coins_processed{0};
+    std::optional<uint256> loaded_hash;
 
-    while (coins_left > 0) {
-        try {
-            Txid txid;
-            coins_file >> txid;
-            size_t coins_per_txid{0};
-            coins_per_txid = ReadCompactSize(coins_file);
-
-            if (coins_per_txid > coins_left) {
-                LogPrintf("[snapshot] mismatch in coins count in snapshot metadata and actual snapshot data\n");
-                return false;
-            }
-
-            for (size_t i = 0; i < coins_per_txid; i++) {
-                COutPoint outpoint;
-                Coin coin;
-                outpoint.n = static_cast<uint32_t>(ReadCompactSize(coins_file));
-                outpoint.hash = txid;
-                coins_file >> coin;
-                if (coin.nHeight > base_height ||
-                    outpoint.n >= std::numeric_limits<decltype(outpoint.n)>::max() // Avoid integer wrap-around in coinstats.cpp:ApplyHash
-                ) {
-                    LogPrintf("[snapshot] bad snapshot data after deserializing %d coins\n",
-                              coins_count - coins_left);
-                    return false;
-                }
-                if (!MoneyRange(coin.out.nValue)) {
-                    LogPrintf("[snapshot] bad snapshot data after deserializing %d coins - bad tx out value\n",
-                              coins_count - coins_left);
-                    return false;
-                }
+    {
+        // Coins are read and hashed in background threads, while they are
+        // added to the cache here.
+        node::SnapshotCoinsLoader loader{coins_file, coins_count, base_height};
+        for (auto batch{loader.NextBatch()}; !batch.empty(); batch = loader.NextBatch()) {
+            for (auto& [outpoint, coin] : batch) {
                 coins_cache.EmplaceCoinInternalDANGER(std::move(outpoint), std::move(coin));
 
-                --coins_left;
                 ++coins_processed;
 
                 if (coins_processed % 1000000 == 0) {
@@ -5910,11 +6155,12 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
                     }
                 }
             }
-        } catch (const std::ios_base::failure&) {
-            LogPrintf("[snapshot] bad snapshot format or truncated snapshot after deserializing %d coins\n",
-                      coins_processed);
+        }
+        if (const auto& error{loader.GetError()}) {
+            LogPrintf("[snapshot] %s\n", *error);
             return false;
         }
+        loaded_hash = loader.GetSerializedHash();
     }
 
     // Important that we set this. This and the coins_cache accesses above are
@@ -5924,20 +6170,6 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     // method.
     coins_cache.SetBestBlock(base_blockhash);
 
-    bool out_of_coins{false};
-    try {
-        std::byte left_over_byte;
-        coins_file >> left_over_byte;
-    } catch (const std::ios_base::failure&) {
-        // We expect an exception since we should be out of coins.
-        out_of_coins = true;
-    }
-    if (!out_of_coins) {
-        LogPrintf("[snapshot] bad snapshot - coins left over after deserializing %d coins\n",
-            coins_count);
-        return false;
-    }
-
     LogPrintf("[snapshot] loaded %d (%.2f MB) coins from snapshot %s\n",
         coins_count,
         coins_cache.DynamicMemoryUsage() / (1000 * 1000),
@@ -5948,27 +6180,34 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
 
     assert(coins_cache.GetBestBlock() == base_blockhash);
 
-    // As above, okay to immediately release cs_main here since no other context knows
-    // about the snapshot_chainstate.
-    CCoinsViewDB* snapshot_coinsdb = WITH_LOCK(::cs_main, return &snapshot_chainstate.CoinsDB());
+    // The coins were hashed while loading if the snapshot lists them in the
+    // order of the coins database. Otherwise, hash the database contents.
+    if (!loaded_hash) {
+        LogPrintf("[snapshot] coins are not in database order, hashing the coins database\n");
 
-    std::optional<CCoinsStats> maybe_stats;
+        // As above, okay to immediately release cs_main here since no other context knows
+        // about the snapshot_chainstate.
+        CCoinsViewDB* snapshot_coinsdb = WITH_LOCK(::cs_main, return &snapshot_chainstate.CoinsDB());
 
-    try {
-        maybe_stats = ComputeUTXOStats(
-            CoinStatsHashType::HASH_SERIALIZED, snapshot_coinsdb, m_blockman, [&interrupt = m_interrupt] { SnapshotUTXOHashBreakpoint(interrupt); });
-    } catch (StopHashingException const&) {
-        return false;
-    }
-    if (!maybe_stats.has_value()) {
-        LogPrintf("[snapshot] failed to generate coins stats\n");
-        return false;
+        std::optional<CCoinsStats> maybe_stats;
+
+        try {
+            maybe_stats = ComputeUTXOStats(
+                CoinStatsHashType::HASH_SERIALIZED, snapshot_coinsdb, m_blockman, [&interrupt = m_interrupt] { SnapshotUTXOHashBreakpoint(interrupt); });
+        } catch (StopHashingException const&) {
+            return false;
+        }
+        if (!maybe_stats.has_value()) {
+            LogPrintf("[snapshot] failed to generate coins stats\n");
+            return false;
+        }
+        loaded_hash = maybe_stats->hashSerialized;
     }
 
     // Assert that the deserialized chainstate contents match the expected assumeutxo value.
-    if (AssumeutxoHash{maybe_stats->hashSerialized} != au_data.hash_serialized) {
+    if (AssumeutxoHash{*loaded_hash} != au_data.hash_serialized) {
         LogPrintf("[snapshot] bad snapshot content hash: expected %s, got %s\n",
-            au_data.hash_serialized.ToString(), maybe_stats->hashSerialized.ToString());
+            au_data.hash_serialized.ToString(), loaded_hash->ToString());
         return false;
     }
 
@@ -6100,6 +6339,10 @@ SnapshotCompletionResult ChainstateManager::MaybeCompleteSnapshotValidation()
 
     CCoinsViewDB& ibd_coins_db = m_ibd_chainstate->CoinsDB();
     m_ibd_chainstate->ForceFlushStateToDisk();
+    if (!m_ibd_chainstate->WaitForCoinsDBWrite()) {
+        LogPrintf("[snapshot] failed to write the coins db of the background chainstate\n");
+        return SnapshotCompletionResult::STATS_FAILED;
+    }
 
     const auto& maybe_au_data = m_options.chainparams.AssumeutxoForHeight(curr_height);
     if (!maybe_au_data) {
@@ -6227,7 +6470,9 @@ static ChainstateManager::Options&& Flatten(ChainstateManager::Options&& opts)
 }
 
 ChainstateManager::ChainstateManager(const util::SignalInterrupt& interrupt, Options options, node::BlockManager::Options blockman_options)
-    : m_script_check_queue{/*batch_size=*/128, options.worker_threads_num},
+    : m_script_check_queue{/*batch_size=*/128, options.worker_threads_num, options.script_check_work_stealing},
+      m_input_fetcher{/*batch_size=*/16, options.worker_threads_num},
+      m_tx_accept_workers{options.worker_threads_num},
       m_interrupt{interrupt},
       m_options{Flatten(std::move(options))},
       m_blockman{interrupt, std::move(blockman_options)}
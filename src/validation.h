@@ -10,6 +10,8 @@
 #include <attributes.h>
 #include <chain.h>
 #include <checkqueue.h>
+#include <coinsflusher.h>
+#include <inputfetcher.h>
 #include <kernel/chain.h>
 #include <consensus/amount.h>
 #include <deploymentstatus.h>
@@ -22,6 +24,7 @@
 #include <policy/policy.h>
 #include <script/script_error.h>
 #include <sync.h>
+#include <txacceptworkers.h>
 #include <txdb.h>
 #include <txmempool.h> // For CTxMemPool::cs
 #include <uint256.h>
@@ -44,6 +47,7 @@
 #include <utility>
 #include <vector>
 
+class CBlockUndo;
 class Chainstate;
 class CTxMemPool;
 class ChainstateManager;
@@ -53,6 +57,7 @@ struct PrecomputedTransactionData;
 struct LockPoints;
 struct AssumeutxoData;
 namespace node {
+class BlockReadAhead;
 class SnapshotMetadata;
 } // namespace node
 namespace Consensus {
@@ -263,11 +268,16 @@ struct PackageMempoolAcceptResult
  * @param[in]  bypass_limits      When true, don't enforce mempool fee and capacity limits,
  *                                and set entry_sequence to zero.
  * @param[in]  test_accept        When true, run validation checks but don't submit to mempool.
+ * @param[in]  preverified        If set, the data precomputed for tx from the outputs it spends, with
+ *                                which its scripts passed STANDARD_SCRIPT_VERIFY_FLAGS already. If tx
+ *                                still spends the same outputs, the policy script checks are skipped
+ *                                and the data is moved from.
  *
  * @returns a MempoolAcceptResult indicating whether the transaction was accepted/rejected with reason.
  */
 MempoolAcceptResult AcceptToMemoryPool(Chainstate& active_chainstate, const CTransactionRef& tx,
-                                       int64_t accept_time, bool bypass_limits, bool test_accept)
+                                       int64_t accept_time, bool bypass_limits, bool test_accept,
+                                       PrecomputedTransactionData* preverified = nullptr)
     EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 /**
@@ -447,6 +457,10 @@ public:
     //! This view wraps access to the leveldb instance and handles read errors gracefully.
     CCoinsViewErrorCatcher m_catcherview GUARDED_BY(cs_main);
 
+    //! This view can write the cache's modified coins to the database in the
+    //! background, and serves them to the cache until that write is done.
+    CCoinsViewFlusher m_flusher GUARDED_BY(cs_main);
+
     //! This is the top layer of the cache hierarchy - it keeps as many coins in memory as
     //! can fit per the dbcache setting.
     std::unique_ptr<CCoinsViewCache> m_cacheview GUARDED_BY(cs_main);
@@ -600,13 +614,24 @@ public:
         return *Assert(m_coins_views->m_cacheview);
     }
 
-    //! @returns A reference to the on-disk UTXO set database.
+    //! @returns A reference to the on-disk UTXO set database. A background
+    //!     write to it may be in progress, see WaitForCoinsDBWrite().
     CCoinsViewDB& CoinsDB() EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
     {
         AssertLockHeld(::cs_main);
         return Assert(m_coins_views)->m_dbview;
     }
 
+    //! Wait for any background write to the on-disk UTXO set database to
+    //! finish, so that its contents match its best block.
+    //!
+    //! @returns false if a background write failed.
+    [[nodiscard]] bool WaitForCoinsDBWrite() EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
+    {
+        AssertLockHeld(::cs_main);
+        return Assert(m_coins_views)->m_flusher.Wait();
+    }
+
     //! @returns A pointer to the mempool.
     CTxMemPool* GetMempool()
     {
@@ -688,14 +713,17 @@ public:
         EXCLUSIVE_LOCKS_REQUIRED(!m_chainstate_mutex)
         LOCKS_EXCLUDED(::cs_main);
 
-    // Block (dis)connection on a given view:
-    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
+    // Block (dis)connection on a given view. The undo data of the block is
+    // read from disk, unless block_undo is given, whose contents are then
+    // moved from.
+    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CBlockUndo* block_undo = nullptr)
         EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     bool ConnectBlock(const CBlock& block, BlockValidationState& state, CBlockIndex* pindex,
                       CCoinsViewCache& view, bool fJustCheck = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-    // Apply the effects of a block disconnection on the UTXO set.
-    bool DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
+    // Apply the effects of a block disconnection on the UTXO set. The block
+    // and its undo data are taken from read_ahead if it read them.
+    bool DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool, node::BlockReadAhead* read_ahead = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
 
     // Manual block validity manipulation:
     /** Mark a block as precious and reorganize.
@@ -927,6 +955,12 @@ private:
     //! A queue for script verifications that have to be performed by worker threads.
     CCheckQueue<CScriptCheck> m_script_check_queue;
 
+    //! Worker threads reading block inputs from the coins database ahead of ConnectBlock().
+    InputFetcher m_input_fetcher;
+
+    //! Worker threads checking transactions for ProcessTransactions() without cs_main.
+    TxAcceptWorkers m_tx_accept_workers;
+
 public:
     using Options = kernel::ChainstateManagerOpts;
 
@@ -1142,6 +1176,23 @@ public:
         FlatFilePos* dbp = nullptr,
         std::multimap<uint256, FlatFilePos>* blocks_with_unknown_parent = nullptr);
 
+    /**
+     * Load the blocks found in the block files by BlockManager::ScanBlockFile(),
+     * as an alternative to calling LoadExternalBlockFile() for each block file
+     * during reindexing.
+     *
+     * As the location of every block is known up front, the headers are added
+     * to the block index first, parents before children. Then each block is
+     * read from disk once and accepted in the same order, so there is no need
+     * to re-read blocks whose parent is stored after them.
+     *
+     * Blocks stored more than once are loaded from their first position, and
+     * blocks whose ancestry does not reach a known block are skipped.
+     *
+     * @param[in] blocks    Blocks found in the block files, in the order of the files
+     */
+    void LoadScannedBlocks(std::vector<node::ScannedBlock> blocks);
+
     /**
      * Process an incoming block. This only returns after the best known valid
      * block is made active. Note that it does not, however, guarantee that the
@@ -1213,6 +1264,28 @@ public:
     [[nodiscard]] MempoolAcceptResult ProcessTransaction(const CTransactionRef& tx, bool test_accept=false)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Try to add several transactions to the memory pool, in order, with the
+     * same results as calling ProcessTransaction() for each of them.
+     *
+     * The context-free checks and the script verification of the
+     * transactions run in parallel on worker threads, without holding
+     * cs_main. It is only held to look up the outputs they spend, after which
+     * only the transactions passing the cheaper policy checks have their
+     * scripts verified, and to add them to the mempool one after the other.
+     * Transactions spending outputs of earlier ones in the batch have their
+     * scripts verified when they are added instead.
+     *
+     * @param[in]  txs             The transactions to submit for mempool acceptance.
+     * @param[in]  test_accept     When true, run validation checks but don't submit to mempool.
+     * @param[in]  accept_times    The time each transaction entered the mempool, e.g. when
+     *                             loading them from disk. The current time for all if empty.
+     * @returns a MempoolAcceptResult for each transaction, in the same order.
+     */
+    [[nodiscard]] std::vector<MempoolAcceptResult> ProcessTransactions(const std::vector<CTransactionRef>& txs, bool test_accept=false,
+                                                                      const std::vector<int64_t>& accept_times={})
+        LOCKS_EXCLUDED(::cs_main);
+
     //! Load the block tree and coins database from disk, initializing state if we're running with -reindex
     bool LoadBlockIndex() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -1279,6 +1352,8 @@ public:
 
     CCheckQueue<CScriptCheck>& GetCheckQueue() { return m_script_check_queue; }
 
+    InputFetcher& GetInputFetcher() { return m_input_fetcher; }
+
     ~ChainstateManager();
 };
 
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+# Copyright (c) 2024 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the getdbstats RPC and the database options.
+
+Test corresponds to code in rpc/node.cpp and node/database_args.cpp.
+"""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.test_node import ErrorMatch
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than,
+    assert_raises_rpc_error,
+)
+
+DATABASE_NAMES = {"blockfilterindex", "blockindex", "chainstate", "coinstatsindex", "txindex"}
+NUM_LEVELS = 7
+NUM_LATENCY_BUCKETS = 24
+
+
+class GetDBStatsTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        self.extra_args = [[
+            "-blockfilterindex",
+            "-coinstatsindex",
+            "-txindex",
+            "-dbbloombits=chainstate:16",
+            "-dbwritebuffer=txindex:1",
+        ]]
+
+    def run_test(self):
+        self.test_stats()
+        self.test_filter()
+        self.test_invalid_options()
+
+    def test_stats(self):
+        self.log.info("Test getdbstats returns the stats of all databases")
+        node = self.nodes[0]
+        self.generate(node, 110)
+        self.wait_until(lambda: all(index["synced"] for index in node.getindexinfo().values()))
+        # Flushes the chainstate and block index.
+        node.gettxoutsetinfo()
+
+        stats = node.getdbstats()
+        assert_equal(set(stats), DATABASE_NAMES)
+        for name, db in stats.items():
+            self.log.debug(f"Check the stats of {name}")
+            assert_equal(set(db), {"approximate_size", "memory_usage", "levels", "write_latency", "leveldb_stats"})
+            assert_equal(len(db["levels"]), NUM_LEVELS)
+            for level in db["levels"]:
+                assert_equal(set(level), {"files", "size_mib", "compaction_seconds", "compaction_read_mib", "compaction_write_mib"})
+            latency = db["write_latency"]
+            assert_equal(len(latency["histogram"]), NUM_LATENCY_BUCKETS)
+            assert_equal(latency["count"], sum(latency["histogram"]))
+            assert_greater_than(latency["count"], 0)
+            assert_greater_than(db["memory_usage"], 0)
+            assert "Compactions" in db["leveldb_stats"]
+
+    def test_filter(self):
+        self.log.info("Test getdbstats filters by database name")
+        node = self.nodes[0]
+        for name in DATABASE_NAMES:
+            assert_equal(list(node.getdbstats(name)), [name])
+        assert_raises_rpc_error(-8, "Unknown database wallet", node.getdbstats, "wallet")
+        assert_raises_rpc_error(-8, "Unknown database basic block filter index", node.getdbstats, "basic block filter index")
+
+    def test_invalid_options(self):
+        self.log.info("Test invalid database options are rejected at startup")
+        self.stop_node(0)
+        for arg in ["-dbbloombits=65", "-dbbloombits=wallet:10", "-dbwritebuffer=0", "-dbmaxfilesize=chainstate:yes"]:
+            self.nodes[0].assert_start_raises_init_error(
+                extra_args=[arg],
+                expected_msg=f"Error: Invalid value for {arg.split('=')[0]}: '{arg.split('=')[1]}'",
+                match=ErrorMatch.PARTIAL_REGEX,
+            )
+        self.log.info("Test -dbcompression, which leveldb is built without support for, is not accepted")
+        self.nodes[0].assert_start_raises_init_error(
+            extra_args=["-dbcompression=1"],
+            expected_msg="Error: Error parsing command line arguments: Invalid parameter -dbcompression=1",
+        )
+        self.start_node(0)
+
+
+if __name__ == '__main__':
+    GetDBStatsTest().main()